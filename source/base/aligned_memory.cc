@@ -19,6 +19,14 @@
 #include "base/aligned_memory.h"
 #include "base/logging.h"
 
+#include <cstdint>
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif // defined(OS_WIN)
+
 #if defined(OS_ANDROID)
 #include <malloc.h>
 #endif
@@ -31,8 +39,10 @@ void* alignedAlloc(size_t size, size_t alignment)
     DCHECK_EQ((alignment & (alignment - 1)), 0U);
     DCHECK_EQ((alignment % sizeof(void*)), 0U);
 
+    void* ptr;
+
 #if defined(OS_WIN)
-    void* ptr =  _aligned_malloc(size, alignment);
+    ptr = _aligned_malloc(size, alignment);
 #elif defined(OS_ANDROID)
     ptr = memalign(alignment, size);
 #else
@@ -47,4 +57,240 @@ void* alignedAlloc(size_t size, size_t alignment)
     return ptr;
 }
 
+namespace {
+
+// The smallest size class. Smaller blocks are rounded up to it.
+const size_t kMinSizeClass = 256;
+
+// The number of size classes between two powers of two.
+const size_t kSizeClassSteps = 4;
+
+} // namespace
+
+AlignedMemoryPool::~AlignedMemoryPool()
+{
+    trim();
+}
+
+// static
+AlignedMemoryPool* AlignedMemoryPool::instance()
+{
+    // The pool is never destroyed because blocks may be released by static objects.
+    static AlignedMemoryPool* pool = new AlignedMemoryPool();
+    return pool;
+}
+
+void* AlignedMemoryPool::allocate(size_t size, size_t alignment)
+{
+    DCHECK_GT(size, 0U);
+    DCHECK_EQ((alignment & (alignment - 1)), 0U);
+    DCHECK_LE(alignment, kMaxAlignment);
+
+    const size_t size_class = sizeClass(size);
+    bool large_pages;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        ++statistics_.allocations;
+
+        auto it = cached_blocks_.find(size_class);
+        if (it != cached_blocks_.end() && !it->second.empty())
+        {
+            void* ptr = it->second.back();
+            it->second.pop_back();
+
+            statistics_.cached_size -= size_class;
+            ++statistics_.reused;
+            return ptr;
+        }
+
+        large_pages = large_pages_enabled_ && size_class >= kLargePageSize;
+    }
+
+    return allocateBlock(size_class, large_pages);
+}
+
+void AlignedMemoryPool::release(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    const size_t size_class = blockSizeClass(ptr);
+
+    {
+        std::scoped_lock lock(lock_);
+
+        if (statistics_.cached_size + size_class <= max_cached_size_)
+        {
+            cached_blocks_[size_class].push_back(ptr);
+            statistics_.cached_size += size_class;
+            return;
+        }
+    }
+
+    freeBlock(ptr);
+}
+
+void AlignedMemoryPool::setLargePagesEnabled(bool enable)
+{
+    std::scoped_lock lock(lock_);
+    large_pages_enabled_ = enable;
+}
+
+void AlignedMemoryPool::setMaxCachedSize(size_t max_cached_size)
+{
+    std::vector<void*> blocks;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        max_cached_size_ = max_cached_size;
+
+        // The largest blocks are freed first.
+        for (auto it = cached_blocks_.rbegin(); it != cached_blocks_.rend(); ++it)
+        {
+            while (statistics_.cached_size > max_cached_size_ && !it->second.empty())
+            {
+                blocks.push_back(it->second.back());
+                it->second.pop_back();
+                statistics_.cached_size -= it->first;
+            }
+        }
+    }
+
+    for (auto block : blocks)
+        freeBlock(block);
+}
+
+void AlignedMemoryPool::trim()
+{
+    std::map<size_t, std::vector<void*>> blocks;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        blocks.swap(cached_blocks_);
+        statistics_.cached_size = 0;
+    }
+
+    for (const auto& size_class : blocks)
+    {
+        for (auto block : size_class.second)
+            freeBlock(block);
+    }
+}
+
+void AlignedMemoryPool::trim(size_t size_class)
+{
+    std::vector<void*> blocks;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        auto it = cached_blocks_.find(size_class);
+        if (it == cached_blocks_.end())
+            return;
+
+        blocks.swap(it->second);
+        cached_blocks_.erase(it);
+        statistics_.cached_size -= blocks.size() * size_class;
+    }
+
+    for (auto block : blocks)
+        freeBlock(block);
+}
+
+AlignedMemoryPool::Statistics AlignedMemoryPool::statistics() const
+{
+    std::scoped_lock lock(lock_);
+    return statistics_;
+}
+
+// static
+size_t AlignedMemoryPool::sizeClass(size_t size)
+{
+    if (size <= kMinSizeClass)
+        return kMinSizeClass;
+
+    size_t power = kMinSizeClass;
+    while (power * 2 < size)
+        power *= 2;
+
+    // |size| is in the range (power, power * 2].
+    const size_t step = power / kSizeClassSteps;
+    return ((size - 1) / step + 1) * step;
+}
+
+// static
+size_t AlignedMemoryPool::blockSizeClass(const void* ptr)
+{
+    const BlockHeader* header = reinterpret_cast<const BlockHeader*>(
+        static_cast<const uint8_t*>(ptr) - kMaxAlignment);
+    return header->size_class;
+}
+
+// static
+void* AlignedMemoryPool::allocateBlock(size_t size_class, bool large_pages)
+{
+    // The header is stored before the block. The offset keeps the block aligned.
+    static_assert(sizeof(BlockHeader) <= kMaxAlignment);
+    const size_t size = size_class + kMaxAlignment;
+
+    uint8_t* memory = nullptr;
+
+#if defined(OS_WIN)
+    if (large_pages)
+    {
+        const size_t page_size = GetLargePageMinimum();
+        if (page_size)
+        {
+            // The call fails if the user does not have the SeLockMemoryPrivilege privilege.
+            memory = static_cast<uint8_t*>(
+                VirtualAlloc(nullptr, (size + page_size - 1) & ~(page_size - 1),
+                             MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+        }
+
+        if (!memory)
+            large_pages = false;
+    }
+
+    if (!memory)
+        memory = static_cast<uint8_t*>(alignedAlloc(size, kMaxAlignment));
+#else
+    memory = static_cast<uint8_t*>(
+        alignedAlloc(size, large_pages ? kLargePageSize : kMaxAlignment));
+
+#if defined(MADV_HUGEPAGE)
+    if (large_pages)
+        madvise(memory, size, MADV_HUGEPAGE);
+#endif // defined(MADV_HUGEPAGE)
+
+    // The memory is freed in the usual way.
+    large_pages = false;
+#endif // defined(OS_WIN)
+
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(memory);
+    header->size_class = size_class;
+    header->large_pages = large_pages;
+
+    return memory + kMaxAlignment;
+}
+
+// static
+void AlignedMemoryPool::freeBlock(void* ptr)
+{
+    uint8_t* memory = static_cast<uint8_t*>(ptr) - kMaxAlignment;
+
+#if defined(OS_WIN)
+    if (reinterpret_cast<BlockHeader*>(memory)->large_pages)
+    {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        return;
+    }
+#endif // defined(OS_WIN)
+
+    alignedFree(memory);
+}
+
 } // namespace base
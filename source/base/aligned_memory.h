@@ -44,13 +44,25 @@
 //
 //   std::unique_ptr<float, AlignedFreeDeleter> my_array(
 //       static_cast<float*>(alignedAlloc(size, alignment)));
+//
+// Large buffers that are reallocated often (frames, codec buffers) can be borrowed from the pool
+// of aligned memory blocks instead:
+//
+//   std::unique_ptr<uint8_t[], AlignedPoolDeleter> buffer(static_cast<uint8_t*>(
+//       AlignedMemoryPool::instance()->allocate(size, alignment)));
 
 #ifndef BASE__ALIGNED_MEMORY_H
 #define BASE__ALIGNED_MEMORY_H
 
 #include "build/build_config.h"
 
+#include "base/macros_magic.h"
+
 #include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #if defined(OS_WIN)
 #include <malloc.h>
@@ -80,6 +92,93 @@ struct AlignedFreeDeleter
     }
 };
 
+// Pool of aligned memory blocks. The requested sizes are rounded up to size classes (four
+// classes for each power of two) and the released blocks are kept for the next requests of the
+// same class, so frames and buffers recreated for key frames or after a reconfiguration reuse the
+// memory instead of returning it to the system. When the resolution or the format changes, the
+// codecs call trim() for the size class of the blocks they released, because the blocks of the
+// previous size are not requested anymore. The blocks of the other users are kept.
+// The methods can be called from any thread.
+class AlignedMemoryPool
+{
+public:
+    // Maximum alignment of the allocated blocks.
+    static const size_t kMaxAlignment = 64;
+
+    struct Statistics
+    {
+        int64_t allocations = 0;
+
+        // The number of allocations served from the cached blocks.
+        int64_t reused = 0;
+
+        // Size of the released blocks kept by the pool.
+        size_t cached_size = 0;
+    };
+
+    AlignedMemoryPool() = default;
+    ~AlignedMemoryPool();
+
+    // Returns the pool shared by the whole process.
+    static AlignedMemoryPool* instance();
+
+    // Returns a block of at least |size| bytes aligned to |alignment|. The alignment must be
+    // a power of two not greater than kMaxAlignment. The block must be returned with release().
+    void* allocate(size_t size, size_t alignment);
+    void release(void* ptr);
+
+    // Blocks of |kLargePageSize| bytes and more are allocated with large pages if the system
+    // allows it. Disabled by default.
+    void setLargePagesEnabled(bool enable);
+
+    // The released blocks are freed if the total size of the cached blocks would exceed
+    // |max_cached_size|.
+    void setMaxCachedSize(size_t max_cached_size);
+
+    // Frees all cached blocks.
+    void trim();
+
+    // Frees the cached blocks of |size_class|.
+    void trim(size_t size_class);
+
+    Statistics statistics() const;
+
+    static size_t sizeClass(size_t size);
+
+    // Returns the size class of a block returned by allocate().
+    static size_t blockSizeClass(const void* ptr);
+
+private:
+    static const size_t kLargePageSize = 2 * 1024 * 1024;
+
+    struct BlockHeader
+    {
+        size_t size_class;
+        bool large_pages;
+    };
+
+    static void* allocateBlock(size_t size_class, bool large_pages);
+    static void freeBlock(void* ptr);
+
+    mutable std::mutex lock_;
+    std::map<size_t, std::vector<void*>> cached_blocks_;
+    // Enough for a few frames of 1920x1080 in 32 bits per pixel.
+    size_t max_cached_size_ = 32 * 1024 * 1024;
+    bool large_pages_enabled_ = false;
+    Statistics statistics_;
+
+    DISALLOW_COPY_AND_ASSIGN(AlignedMemoryPool);
+};
+
+// Deleter for use with unique_ptr for the blocks of the shared AlignedMemoryPool.
+struct AlignedPoolDeleter
+{
+    void operator()(void* ptr) const
+    {
+        AlignedMemoryPool::instance()->release(ptr);
+    }
+};
+
 }  // namespace base
 
 #endif // BASE__ALIGNED_MEMORY_H
@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace base {
 
 #define EXPECT_ALIGNED(ptr, align) \
@@ -55,4 +58,111 @@ TEST(aligned_memory_test, scoped_dynamic_allocation)
     EXPECT_ALIGNED(p.get(), 8);
 }
 
+TEST(aligned_memory_test, pool_size_classes)
+{
+    EXPECT_EQ(AlignedMemoryPool::sizeClass(1), 256u);
+    EXPECT_EQ(AlignedMemoryPool::sizeClass(256), 256u);
+    EXPECT_EQ(AlignedMemoryPool::sizeClass(257), 320u);
+    EXPECT_EQ(AlignedMemoryPool::sizeClass(512), 512u);
+    EXPECT_EQ(AlignedMemoryPool::sizeClass(513), 640u);
+
+    // 1920x1080 32bpp frame.
+    EXPECT_EQ(AlignedMemoryPool::sizeClass(8294400), 8388608u);
+
+    for (size_t size = 1; size < 1024 * 1024; size = size * 3 / 2 + 1)
+    {
+        const size_t size_class = AlignedMemoryPool::sizeClass(size);
+
+        EXPECT_GE(size_class, size);
+        EXPECT_LE(size_class, std::max(size * 5 / 4 + 1, size_t(256)));
+        EXPECT_EQ(AlignedMemoryPool::sizeClass(size_class), size_class);
+    }
+}
+
+TEST(aligned_memory_test, pool_reuse)
+{
+    AlignedMemoryPool pool;
+
+    void* p1 = pool.allocate(1000, 32);
+    EXPECT_ALIGNED(p1, 32);
+    memset(p1, 0, 1000);
+
+    void* p2 = pool.allocate(100000, 64);
+    EXPECT_ALIGNED(p2, 64);
+    memset(p2, 0, 100000);
+
+    pool.release(p1);
+    EXPECT_EQ(pool.statistics().cached_size, AlignedMemoryPool::sizeClass(1000));
+
+    // A block of the same size class is reused.
+    void* p3 = pool.allocate(900, 16);
+    EXPECT_EQ(p3, p1);
+    EXPECT_EQ(pool.statistics().allocations, 3);
+    EXPECT_EQ(pool.statistics().reused, 1);
+    EXPECT_EQ(pool.statistics().cached_size, 0u);
+
+    pool.release(p2);
+    pool.release(p3);
+    pool.release(nullptr);
+
+    pool.trim();
+    EXPECT_EQ(pool.statistics().cached_size, 0u);
+}
+
+TEST(aligned_memory_test, pool_trim_size_class)
+{
+    AlignedMemoryPool pool;
+
+    void* p1 = pool.allocate(4096, 32);
+    void* p2 = pool.allocate(4000, 32);
+    void* p3 = pool.allocate(8192, 32);
+    EXPECT_EQ(AlignedMemoryPool::blockSizeClass(p1), 4096u);
+    EXPECT_EQ(AlignedMemoryPool::blockSizeClass(p3), 8192u);
+
+    pool.release(p1);
+    pool.release(p2);
+    pool.release(p3);
+    EXPECT_EQ(pool.statistics().cached_size, 2 * 4096u + 8192u);
+
+    // Only the blocks of the released size class are freed.
+    pool.trim(4096);
+    EXPECT_EQ(pool.statistics().cached_size, 8192u);
+
+    pool.trim(4096);
+    EXPECT_EQ(pool.statistics().cached_size, 8192u);
+
+    void* p4 = pool.allocate(8192, 32);
+    EXPECT_EQ(p4, p3);
+    EXPECT_EQ(pool.statistics().reused, 1);
+
+    pool.release(p4);
+}
+
+TEST(aligned_memory_test, pool_max_cached_size)
+{
+    AlignedMemoryPool pool;
+
+    void* p1 = pool.allocate(4096, 32);
+    void* p2 = pool.allocate(8192, 32);
+
+    pool.release(p1);
+    pool.release(p2);
+    EXPECT_EQ(pool.statistics().cached_size, 4096u + 8192u);
+
+    // The largest blocks are freed first.
+    pool.setMaxCachedSize(8192);
+    EXPECT_EQ(pool.statistics().cached_size, 4096u);
+
+    // The block does not fit into the limit and is freed.
+    pool.release(pool.allocate(8192, 32));
+    EXPECT_EQ(pool.statistics().cached_size, 4096u);
+
+    pool.setLargePagesEnabled(true);
+
+    void* p3 = pool.allocate(4 * 1024 * 1024, 64);
+    EXPECT_ALIGNED(p3, 64);
+    memset(p3, 0, 4 * 1024 * 1024);
+    pool.release(p3);
+}
+
 } // namespace base
@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/bandwidth_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+// The written bytes lose half of their weight in the estimate during this time.
+constexpr std::chrono::milliseconds kHalfLife{ 1000 };
+
+// The completions are reported with the accuracy of the system timer, so the message is assumed
+// to be written for at least this time.
+constexpr std::chrono::milliseconds kMinWriteTime{ 1 };
+
+} // namespace
+
+void BandwidthEstimator::setPendingBytes(size_t pending_bytes, const Clock::time_point& time)
+{
+    // The writing of the message starts when it is added to the empty queue.
+    if (!pending_bytes_ && pending_bytes)
+        write_time_ = time;
+
+    pending_bytes_ = pending_bytes;
+}
+
+void BandwidthEstimator::onMessageWritten(size_t message_size,
+                                          size_t pending_bytes,
+                                          const Clock::time_point& time)
+{
+    if (update_time_ != Clock::time_point())
+    {
+        const double factor =
+            std::exp2(-Milliseconds(time - update_time_) / Milliseconds(kHalfLife));
+
+        busy_bytes_ *= factor;
+        busy_time_ *= factor;
+    }
+
+    busy_bytes_ += static_cast<double>(message_size);
+    busy_time_ += std::max(Milliseconds(time - write_time_), Milliseconds(kMinWriteTime));
+    update_time_ = time;
+
+    // The next message in the queue is written after this one.
+    write_time_ = time;
+    pending_bytes_ = pending_bytes;
+}
+
+int64_t BandwidthEstimator::bandwidth() const
+{
+    if (busy_time_ == Milliseconds::zero())
+        return 0;
+
+    return std::llround(busy_bytes_ * 1000.0 / busy_time_.count());
+}
+
+} // namespace base
@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__BANDWIDTH_ESTIMATOR_H
+#define BASE__BANDWIDTH_ESTIMATOR_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace base {
+
+// Estimates the speed of an outgoing channel by the completions of the writes.
+// The channel is busy from the moment a message is added to the empty queue until the queue
+// becomes empty. The speed is the number of written bytes divided by the busy time. Both values
+// decay with the time, so the estimate follows the changes of the channel, and the periods when
+// the channel is saturated prevail over the short writes into the idle channel.
+// The class is not thread-safe.
+class BandwidthEstimator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    BandwidthEstimator() = default;
+    ~BandwidthEstimator() = default;
+
+    // Called when a message is added to the outgoing queue. |pending_bytes| is the number of
+    // bytes in the queue.
+    void setPendingBytes(size_t pending_bytes, const Clock::time_point& time);
+
+    // Called when a message of |message_size| bytes is written from the outgoing queue.
+    void onMessageWritten(size_t message_size, size_t pending_bytes, const Clock::time_point& time);
+
+    // Returns the estimated speed of the channel in bytes per second or 0 if nothing is written
+    // yet.
+    int64_t bandwidth() const;
+
+    size_t pendingBytes() const { return pending_bytes_; }
+
+private:
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    size_t pending_bytes_ = 0;
+
+    // The time when the writing of the first message in the queue has started.
+    Clock::time_point write_time_;
+
+    // The decaying sums of the written bytes and of the time spent on writing them.
+    double busy_bytes_ = 0;
+    Milliseconds busy_time_{ 0 };
+    Clock::time_point update_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(BandwidthEstimator);
+};
+
+} // namespace base
+
+#endif // BASE__BANDWIDTH_ESTIMATOR_H
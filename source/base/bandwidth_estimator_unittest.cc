@@ -0,0 +1,115 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/bandwidth_estimator.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+class FakeChannel
+{
+public:
+    FakeChannel() = default;
+
+    // Sends |count| messages of |message_size| bytes through the channel with the speed of
+    // |bytes_per_ms|. If |interval| is longer than the time of writing a message, the channel is
+    // idle between the messages.
+    void send(int count, size_t message_size, int64_t bytes_per_ms,
+              const std::chrono::milliseconds& interval)
+    {
+        const std::chrono::milliseconds write_time(
+            static_cast<int64_t>(message_size) / bytes_per_ms);
+
+        for (int i = 0; i < count; ++i)
+        {
+            estimator.setPendingBytes(message_size, time);
+            time += write_time;
+            estimator.onMessageWritten(message_size, 0, time);
+            time += std::max(interval - write_time, std::chrono::milliseconds::zero());
+        }
+    }
+
+    BandwidthEstimator estimator;
+    BandwidthEstimator::Clock::time_point time =
+        BandwidthEstimator::Clock::time_point() + std::chrono::hours(1);
+};
+
+} // namespace
+
+TEST(bandwidth_estimator_test, unknown)
+{
+    BandwidthEstimator estimator;
+    EXPECT_EQ(estimator.bandwidth(), 0);
+
+    estimator.setPendingBytes(1000, BandwidthEstimator::Clock::now());
+    EXPECT_EQ(estimator.bandwidth(), 0);
+    EXPECT_EQ(estimator.pendingBytes(), 1000U);
+}
+
+TEST(bandwidth_estimator_test, saturated_channel)
+{
+    BandwidthEstimator estimator;
+    BandwidthEstimator::Clock::time_point time = BandwidthEstimator::Clock::now();
+
+    // Ten messages are queued at once and written with the speed of 100 bytes per millisecond.
+    estimator.setPendingBytes(10000, time);
+
+    for (int i = 9; i >= 0; --i)
+    {
+        time += std::chrono::milliseconds(10);
+        estimator.onMessageWritten(1000, i * 1000, time);
+        EXPECT_EQ(estimator.pendingBytes(), static_cast<size_t>(i * 1000));
+    }
+
+    EXPECT_EQ(estimator.bandwidth(), 100000);
+}
+
+TEST(bandwidth_estimator_test, idle_channel)
+{
+    FakeChannel channel;
+
+    // The channel is saturated for a second.
+    channel.send(100, 10000, 1000, std::chrono::milliseconds(10));
+    EXPECT_EQ(channel.estimator.bandwidth(), 1000000);
+
+    // The short writes into the idle channel are written immediately, but the time when the
+    // channel was saturated prevails.
+    channel.send(10, 100, 1000, std::chrono::milliseconds(20));
+    EXPECT_LT(channel.estimator.bandwidth(), 1500000);
+}
+
+TEST(bandwidth_estimator_test, bandwidth_change)
+{
+    FakeChannel channel;
+
+    channel.send(1000, 1000, 100, std::chrono::milliseconds(10));
+    EXPECT_EQ(channel.estimator.bandwidth(), 100000);
+
+    // The channel becomes ten times slower.
+    channel.send(40, 1000, 10, std::chrono::milliseconds(100));
+    EXPECT_LT(channel.estimator.bandwidth(), 20000);
+
+    // The channel becomes fast again.
+    channel.send(400, 1000, 100, std::chrono::milliseconds(10));
+    EXPECT_GT(channel.estimator.bandwidth(), 80000);
+}
+
+} // namespace base
@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory_mapped_file.h"
+#include "base/logging.h"
+
+#include <limits>
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // defined(OS_WIN)
+
+namespace base {
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    closeHandles();
+}
+
+bool MemoryMappedFile::initialize(const std::filesystem::path& file_path)
+{
+    closeHandles();
+
+#if defined(OS_WIN)
+    file_ = CreateFileW(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        PLOG(LS_WARNING) << "CreateFileW failed";
+        file_ = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart <= 0 ||
+        static_cast<uint64_t>(file_size.QuadPart) > std::numeric_limits<size_t>::max())
+    {
+        LOG(LS_WARNING) << "Invalid file size";
+        closeHandles();
+        return false;
+    }
+
+    file_mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file_mapping_)
+    {
+        PLOG(LS_WARNING) << "CreateFileMappingW failed";
+        closeHandles();
+        return false;
+    }
+
+    data_ = static_cast<uint8_t*>(MapViewOfFile(file_mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+    {
+        PLOG(LS_WARNING) << "MapViewOfFile failed";
+        closeHandles();
+        return false;
+    }
+
+    length_ = static_cast<size_t>(file_size.QuadPart);
+#else
+    file_ = open(file_path.c_str(), O_RDONLY);
+    if (file_ == -1)
+    {
+        PLOG(LS_WARNING) << "open failed";
+        return false;
+    }
+
+    struct stat file_info;
+    if (fstat(file_, &file_info) != 0 || file_info.st_size <= 0)
+    {
+        LOG(LS_WARNING) << "Invalid file size";
+        closeHandles();
+        return false;
+    }
+
+    void* data = mmap(nullptr, file_info.st_size, PROT_READ, MAP_SHARED, file_, 0);
+    if (data == MAP_FAILED)
+    {
+        PLOG(LS_WARNING) << "mmap failed";
+        closeHandles();
+        return false;
+    }
+
+    data_ = static_cast<uint8_t*>(data);
+    length_ = static_cast<size_t>(file_info.st_size);
+#endif // defined(OS_WIN)
+
+    return true;
+}
+
+void MemoryMappedFile::closeHandles()
+{
+#if defined(OS_WIN)
+    if (data_)
+        UnmapViewOfFile(data_);
+
+    if (file_mapping_)
+        CloseHandle(file_mapping_);
+
+    if (file_)
+        CloseHandle(file_);
+
+    file_mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (data_)
+        munmap(data_, length_);
+
+    if (file_ != -1)
+        close(file_);
+
+    file_ = -1;
+#endif // defined(OS_WIN)
+
+    data_ = nullptr;
+    length_ = 0;
+}
+
+} // namespace base
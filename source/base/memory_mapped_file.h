@@ -0,0 +1,64 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MEMORY_MAPPED_FILE_H
+#define BASE__MEMORY_MAPPED_FILE_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace base {
+
+// Maps the whole file into memory for reading. The file must not be changed while it is mapped.
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() = default;
+    ~MemoryMappedFile();
+
+    // Opens and maps the file. Returns false if the file can not be opened or is empty.
+    bool initialize(const std::filesystem::path& file_path);
+
+    bool isValid() const { return data_ != nullptr; }
+
+    const uint8_t* data() const { return data_; }
+    size_t length() const { return length_; }
+
+private:
+    void closeHandles();
+
+#if defined(OS_WIN)
+    void* file_ = nullptr;
+    void* file_mapping_ = nullptr;
+#else
+    int file_ = -1;
+#endif // defined(OS_WIN)
+
+    uint8_t* data_ = nullptr;
+    size_t length_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
+};
+
+} // namespace base
+
+#endif // BASE__MEMORY_MAPPED_FILE_H
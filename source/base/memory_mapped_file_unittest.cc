@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory_mapped_file.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+namespace base {
+
+TEST(memory_mapped_file_test, map_file)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_memory_mapped_file_test.bin";
+
+    std::string content;
+    for (int i = 0; i < 100000; ++i)
+        content.push_back(static_cast<char>(i * 31));
+
+    {
+        std::ofstream file_stream(file_path, std::ofstream::binary);
+        file_stream.write(content.data(), content.size());
+    }
+
+    {
+        MemoryMappedFile file;
+        ASSERT_TRUE(file.initialize(file_path));
+        EXPECT_TRUE(file.isValid());
+        ASSERT_EQ(file.length(), content.size());
+        EXPECT_EQ(memcmp(file.data(), content.data(), content.size()), 0);
+    }
+
+    std::error_code ignored_error;
+    std::filesystem::remove(file_path, ignored_error);
+}
+
+TEST(memory_mapped_file_test, invalid_file)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_memory_mapped_file_empty.bin";
+
+    {
+        std::ofstream file_stream(file_path, std::ofstream::binary);
+    }
+
+    MemoryMappedFile file;
+
+    // Empty files can not be mapped.
+    EXPECT_FALSE(file.initialize(file_path));
+    EXPECT_FALSE(file.isValid());
+
+    EXPECT_FALSE(file.initialize(file_path / "missing"));
+    EXPECT_FALSE(file.isValid());
+
+    std::error_code ignored_error;
+    std::filesystem::remove(file_path, ignored_error);
+}
+
+} // namespace base
@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/thread_pool.h"
+#include "base/logging.h"
+
+namespace base {
+
+ThreadPool::ThreadPool(int thread_count)
+{
+    DCHECK_GT(thread_count, 0);
+
+    for (int i = 1; i < thread_count; ++i)
+        workers_.emplace_back(&ThreadPool::workerThread, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock lock(lock_);
+        terminate_ = true;
+    }
+
+    work_event_.notify_all();
+
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+void ThreadPool::run(int task_count, const Task& task)
+{
+    if (task_count <= 0)
+        return;
+
+    if (workers_.empty() || task_count == 1)
+    {
+        for (int i = 0; i < task_count; ++i)
+            task(i);
+        return;
+    }
+
+    std::unique_lock lock(lock_);
+
+    DCHECK(!task_);
+
+    task_ = &task;
+    task_count_ = task_count;
+    next_task_ = 0;
+    pending_tasks_ = task_count;
+
+    work_event_.notify_all();
+
+    // The calling thread takes tasks from the batch too.
+    while (next_task_ < task_count_)
+    {
+        const int index = next_task_++;
+
+        lock.unlock();
+        task(index);
+        lock.lock();
+
+        --pending_tasks_;
+    }
+
+    done_event_.wait(lock, [this]() { return pending_tasks_ == 0; });
+
+    task_ = nullptr;
+    task_count_ = 0;
+    next_task_ = 0;
+}
+
+// static
+int ThreadPool::hardwareConcurrency()
+{
+    const unsigned int count = std::thread::hardware_concurrency();
+    if (!count)
+        return 1;
+
+    return static_cast<int>(count);
+}
+
+void ThreadPool::workerThread()
+{
+    std::unique_lock lock(lock_);
+
+    while (true)
+    {
+        work_event_.wait(lock, [this]() { return terminate_ || next_task_ < task_count_; });
+
+        if (terminate_)
+            return;
+
+        const int index = next_task_++;
+        const Task* task = task_;
+
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+
+        if (--pending_tasks_ == 0)
+            done_event_.notify_all();
+    }
+}
+
+} // namespace base
@@ -0,0 +1,84 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREAD_POOL_H
+#define BASE__THREAD_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// ThreadPool holds a fixed set of worker threads that execute batches of independent tasks.
+// The calling thread also takes part in the execution of the batch, so a pool created with
+// |thread_count| equal to 1 does not start any threads and executes all tasks in place.
+//
+// Usage:
+//   ThreadPool pool(4);
+//
+//   pool.run(16, [&](int index)
+//   {
+//       processPart(index);
+//   });
+//
+//   // All 16 parts are processed here.
+class ThreadPool
+{
+public:
+    using Task = std::function<void(int index)>;
+
+    explicit ThreadPool(int thread_count);
+    ~ThreadPool();
+
+    // Returns the number of threads that execute tasks (including the calling thread).
+    int threadCount() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Calls |task| for each index in the range [0, task_count) and returns after all calls are
+    // completed. The order in which the indexes are processed is not defined.
+    // The method must not be called from several threads at the same time.
+    void run(int task_count, const Task& task);
+
+    // Returns the number of threads that the system can run in parallel.
+    static int hardwareConcurrency();
+
+private:
+    void workerThread();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex lock_;
+    std::condition_variable work_event_;
+    std::condition_variable done_event_;
+
+    const Task* task_ = nullptr;
+    int task_count_ = 0;
+    int next_task_ = 0;
+    int pending_tasks_ = 0;
+    bool terminate_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+} // namespace base
+
+#endif // BASE__THREAD_POOL_H
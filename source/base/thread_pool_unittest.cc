@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+namespace base {
+
+TEST(thread_pool_test, single_thread)
+{
+    ThreadPool pool(1);
+    EXPECT_EQ(pool.threadCount(), 1);
+
+    std::vector<int> result(10, 0);
+
+    pool.run(static_cast<int>(result.size()), [&](int index)
+    {
+        result[index] = index + 1;
+    });
+
+    for (size_t i = 0; i < result.size(); ++i)
+        EXPECT_EQ(result[i], static_cast<int>(i) + 1);
+}
+
+TEST(thread_pool_test, all_tasks_executed_once)
+{
+    for (int thread_count = 2; thread_count <= 8; ++thread_count)
+    {
+        ThreadPool pool(thread_count);
+        EXPECT_EQ(pool.threadCount(), thread_count);
+
+        for (int task_count = 0; task_count < 50; ++task_count)
+        {
+            std::vector<std::atomic_int> result(task_count);
+
+            pool.run(task_count, [&](int index)
+            {
+                ++result[index];
+            });
+
+            for (int i = 0; i < task_count; ++i)
+                EXPECT_EQ(result[i], 1);
+        }
+    }
+}
+
+TEST(thread_pool_test, sequential_batches)
+{
+    ThreadPool pool(4);
+    std::atomic_int sum = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        pool.run(7, [&](int index)
+        {
+            sum += index;
+        });
+    }
+
+    EXPECT_EQ(sum, 1000 * (0 + 1 + 2 + 3 + 4 + 5 + 6));
+}
+
+} // namespace base
@@ -0,0 +1,243 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "benchmarks/desktop_content.h"
+
+#include "desktop/desktop_frame_aligned.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+namespace benchmarks {
+
+const desktop::Size kResolutions[] =
+{
+    desktop::Size(1280, 1024),
+    desktop::Size(1920, 1080),
+    desktop::Size(2560, 1440),
+    desktop::Size(3840, 2160)
+};
+
+const int kResolutionCount = std::size(kResolutions);
+
+namespace {
+
+const uint32_t kBackgroundColor = 0x003A6EA5;
+const uint32_t kWindowColor = 0x00FFFFFF;
+const uint32_t kTitleColor = 0x000A246A;
+const uint32_t kTextColor = 0x00202020;
+
+const int kTitleHeight = 24;
+const int kGlyphWidth = 7;
+const int kGlyphHeight = 14;
+
+void fillRect(desktop::Frame* frame, const desktop::Rect& rect, uint32_t color)
+{
+    desktop::Rect clipped(rect);
+    clipped.intersectWith(desktop::Rect::makeSize(frame->size()));
+
+    for (int y = clipped.top(); y < clipped.bottom(); ++y)
+    {
+        uint32_t* pixel = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(clipped.left(), y));
+        std::fill(pixel, pixel + clipped.width(), color);
+    }
+}
+
+// Draws a glyph-like pattern of strokes. The pattern depends only on |seed|.
+void drawGlyph(desktop::Frame* frame, int x, int y, uint32_t seed)
+{
+    std::minstd_rand random(seed);
+
+    fillRect(frame, desktop::Rect::makeXYWH(x, y, kGlyphWidth, kGlyphHeight), kWindowColor);
+
+    if (seed % 6 == 0)
+        return; // Space.
+
+    const int strokes = 2 + random() % 3;
+
+    for (int i = 0; i < strokes; ++i)
+    {
+        const int sx = x + 1 + random() % (kGlyphWidth - 2);
+        const int sy = y + 2 + random() % (kGlyphHeight - 4);
+
+        if (random() % 2)
+            fillRect(frame, desktop::Rect::makeXYWH(sx, y + 2, 1, kGlyphHeight - 4), kTextColor);
+        else
+            fillRect(frame, desktop::Rect::makeXYWH(x + 1, sy, kGlyphWidth - 2, 1), kTextColor);
+    }
+}
+
+void drawTextLine(desktop::Frame* frame, const desktop::Rect& line_rect, uint32_t seed)
+{
+    fillRect(frame, line_rect, kWindowColor);
+
+    std::minstd_rand random(seed + 1);
+    const int length = line_rect.width() / kGlyphWidth * (50 + random() % 50) / 100;
+
+    for (int i = 0; i < length; ++i)
+    {
+        drawGlyph(frame,
+                  line_rect.left() + i * kGlyphWidth,
+                  line_rect.top(),
+                  static_cast<uint32_t>(random()));
+    }
+}
+
+desktop::Rect textWindowRect(const desktop::Size& size)
+{
+    return desktop::Rect::makeLTRB(size.width() / 16, size.height() / 16,
+                                   size.width() * 9 / 16, size.height() * 13 / 16);
+}
+
+desktop::Rect textAreaRect(const desktop::Size& size)
+{
+    desktop::Rect rect = textWindowRect(size);
+    return desktop::Rect::makeLTRB(rect.left() + 4, rect.top() + kTitleHeight + 4,
+                                   rect.right() - 4, rect.bottom() - 4);
+}
+
+desktop::Rect pictureWindowRect(const desktop::Size& size)
+{
+    return desktop::Rect::makeLTRB(size.width() * 10 / 16, size.height() * 3 / 16,
+                                   size.width() * 15 / 16, size.height() * 10 / 16);
+}
+
+void drawWindow(desktop::Frame* frame, const desktop::Rect& rect)
+{
+    fillRect(frame, rect, kWindowColor);
+
+    for (int y = 0; y < kTitleHeight; ++y)
+    {
+        // Vertical gradient of the title bar.
+        const uint32_t shade = static_cast<uint32_t>(y * 3);
+        fillRect(frame,
+                 desktop::Rect::makeXYWH(rect.left(), rect.top() + y, rect.width(), 1),
+                 kTitleColor + (shade << 16) + (shade << 8) + shade);
+    }
+}
+
+} // namespace
+
+std::unique_ptr<desktop::Frame> createDesktopFrame(const desktop::Size& size)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameAligned::create(size, desktop::PixelFormat::ARGB(), 32);
+
+    fillRect(frame.get(), desktop::Rect::makeSize(size), kBackgroundColor);
+
+    // Window with text.
+    drawWindow(frame.get(), textWindowRect(size));
+
+    const desktop::Rect text_area = textAreaRect(size);
+    for (int y = text_area.top(); y + kGlyphHeight <= text_area.bottom(); y += kGlyphHeight)
+    {
+        drawTextLine(frame.get(),
+                     desktop::Rect::makeXYWH(text_area.left(), y, text_area.width(), kGlyphHeight),
+                     static_cast<uint32_t>(y));
+    }
+
+    // Window with a picture.
+    const desktop::Rect picture_window = pictureWindowRect(size);
+    drawWindow(frame.get(), picture_window);
+
+    std::minstd_rand random(size.width() * size.height());
+
+    for (int y = picture_window.top() + kTitleHeight; y < picture_window.bottom(); ++y)
+    {
+        uint32_t* pixel = reinterpret_cast<uint32_t*>(
+            frame->frameDataAtPos(picture_window.left(), y));
+
+        for (int x = 0; x < picture_window.width(); ++x)
+        {
+            // Smooth gradient with some noise, like a photo.
+            const uint32_t red = (x * 255 / picture_window.width() + random() % 16) & 0xFF;
+            const uint32_t green = (y * 255 / frame->size().height() + random() % 16) & 0xFF;
+            const uint32_t blue = ((x + y) % 256 + random() % 16) & 0xFF;
+
+            pixel[x] = (red << 16) | (green << 8) | blue;
+        }
+    }
+
+    frame->updatedRegion()->setRect(desktop::Rect::makeSize(size));
+    return frame;
+}
+
+void typeText(desktop::Frame* frame, int step)
+{
+    const desktop::Rect text_area = textAreaRect(frame->size());
+
+    const int columns = text_area.width() / kGlyphWidth;
+    const int rows = text_area.height() / kGlyphHeight;
+
+    const int column = step % columns;
+    const int row = (step / columns) % rows;
+
+    const desktop::Rect glyph_rect = desktop::Rect::makeXYWH(
+        text_area.left() + column * kGlyphWidth,
+        text_area.top() + row * kGlyphHeight,
+        kGlyphWidth,
+        kGlyphHeight);
+
+    drawGlyph(frame, glyph_rect.left(), glyph_rect.top(), static_cast<uint32_t>(step));
+    frame->updatedRegion()->setRect(glyph_rect);
+}
+
+void scrollWindow(desktop::Frame* frame, int dy)
+{
+    const desktop::Rect text_area = textAreaRect(frame->size());
+
+    dy = std::clamp(dy, -text_area.height(), text_area.height());
+
+    desktop::Rect exposed_rect;
+
+    if (dy < 0)
+    {
+        // Content moves up, new lines appear at the bottom.
+        frame->movePixels(
+            desktop::Point(text_area.left(), text_area.top() - dy),
+            desktop::Rect::makeLTRB(text_area.left(), text_area.top(),
+                                    text_area.right(), text_area.bottom() + dy));
+
+        exposed_rect = desktop::Rect::makeLTRB(
+            text_area.left(), text_area.bottom() + dy, text_area.right(), text_area.bottom());
+    }
+    else
+    {
+        frame->movePixels(
+            desktop::Point(text_area.left(), text_area.top()),
+            desktop::Rect::makeLTRB(text_area.left(), text_area.top() + dy,
+                                    text_area.right(), text_area.bottom()));
+
+        exposed_rect = desktop::Rect::makeLTRB(
+            text_area.left(), text_area.top(), text_area.right(), text_area.top() + dy);
+    }
+
+    fillRect(frame, exposed_rect, kWindowColor);
+
+    for (int y = exposed_rect.top(); y + kGlyphHeight <= exposed_rect.bottom(); y += kGlyphHeight)
+    {
+        drawTextLine(frame,
+                     desktop::Rect::makeXYWH(text_area.left(), y, text_area.width(), kGlyphHeight),
+                     static_cast<uint32_t>(y + dy));
+    }
+
+    frame->updatedRegion()->setRect(text_area);
+}
+
+} // namespace benchmarks
@@ -0,0 +1,46 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BENCHMARKS__DESKTOP_CONTENT_H
+#define BENCHMARKS__DESKTOP_CONTENT_H
+
+#include "desktop/desktop_frame.h"
+
+#include <memory>
+
+namespace benchmarks {
+
+// Resolutions used by the benchmarks. The index is passed as the benchmark argument.
+extern const desktop::Size kResolutions[];
+extern const int kResolutionCount;
+
+// Creates a 32bpp frame with synthetic desktop content: solid background, windows with title
+// bars, lines of "text" and a noisy picture. The content is the same for the same |size|.
+std::unique_ptr<desktop::Frame> createDesktopFrame(const desktop::Size& size);
+
+// Simulates typing in one of the windows: changes a small area which depends on |step| and sets
+// the updated region of |frame| to the changed area.
+void typeText(desktop::Frame* frame, int step);
+
+// Simulates scrolling of the contents of a window by |dy| pixels. Sets the updated region of
+// |frame| to the window area.
+void scrollWindow(desktop::Frame* frame, int dy);
+
+} // namespace benchmarks
+
+#endif // BENCHMARKS__DESKTOP_CONTENT_H
@@ -0,0 +1,185 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "benchmarks/desktop_content.h"
+#include "desktop/diff_block_16bpp_c.h"
+#include "desktop/diff_block_32bpp_avx2.h"
+#include "desktop/diff_block_32bpp_c.h"
+#include "desktop/diff_block_32bpp_sse2.h"
+#include "desktop/diff_block_32bpp_sse3.h"
+#include "desktop/differ.h"
+
+#include <benchmark/benchmark.h>
+#include <libyuv/cpu_id.h>
+
+#include <vector>
+
+namespace {
+
+using DiffFullBlockFunc = uint8_t(*)(const uint8_t*, const uint8_t*, int);
+
+// Compares all full blocks of two identical 1920x1080 images. Identical blocks are the worst case
+// for the kernels because every byte has to be read.
+void diffFullBlock(benchmark::State& state,
+                   DiffFullBlockFunc func,
+                   int bytes_per_pixel,
+                   int block_size,
+                   int cpu_flag)
+{
+    if (cpu_flag && !libyuv::TestCpuFlag(cpu_flag))
+    {
+        state.SkipWithError("Instruction set is not supported");
+        return;
+    }
+
+    const desktop::Size size(1920, 1080);
+    const int bytes_per_row = size.width() * bytes_per_pixel;
+    const int bytes_per_block = block_size * bytes_per_pixel;
+
+    std::vector<uint8_t> image1(bytes_per_row * size.height());
+    for (size_t i = 0; i < image1.size(); ++i)
+        image1[i] = static_cast<uint8_t>(i * 7);
+
+    const std::vector<uint8_t> image2(image1);
+
+    const int blocks_x = size.width() / block_size;
+    const int blocks_y = size.height() / block_size;
+
+    for (auto _ : state)
+    {
+        int changed = 0;
+
+        for (int y = 0; y < blocks_y; ++y)
+        {
+            const uint8_t* block1 = image1.data() + y * block_size * bytes_per_row;
+            const uint8_t* block2 = image2.data() + y * block_size * bytes_per_row;
+
+            for (int x = 0; x < blocks_x; ++x)
+            {
+                changed += func(block1, block2, bytes_per_row);
+
+                block1 += bytes_per_block;
+                block2 += bytes_per_block;
+            }
+        }
+
+        benchmark::DoNotOptimize(changed);
+    }
+
+    state.SetBytesProcessed(
+        static_cast<int64_t>(state.iterations()) * blocks_x * blocks_y * bytes_per_block *
+        block_size * 2);
+}
+
+#define DIFF_BLOCK_BENCHMARK(bpp, bytes_per_pixel, size, suffix, cpu_flag) \
+    BENCHMARK_CAPTURE(diffFullBlock, bpp##_##size##x##size##_##suffix, \
+                      desktop::diffFullBlock_##bpp##_##size##x##size##_##suffix, \
+                      bytes_per_pixel, size, cpu_flag)
+
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 8, C, 0);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 16, C, 0);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 32, C, 0);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 8, SSE2, libyuv::kCpuHasSSE2);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 16, SSE2, libyuv::kCpuHasSSE2);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 32, SSE2, libyuv::kCpuHasSSE2);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 8, SSE3, libyuv::kCpuHasSSSE3);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 16, SSE3, libyuv::kCpuHasSSSE3);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 32, SSE3, libyuv::kCpuHasSSSE3);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 8, AVX2, libyuv::kCpuHasAVX2);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 16, AVX2, libyuv::kCpuHasAVX2);
+DIFF_BLOCK_BENCHMARK(32bpp, 4, 32, AVX2, libyuv::kCpuHasAVX2);
+DIFF_BLOCK_BENCHMARK(16bpp, 2, 8, C, 0);
+DIFF_BLOCK_BENCHMARK(16bpp, 2, 16, C, 0);
+DIFF_BLOCK_BENCHMARK(16bpp, 2, 32, C, 0);
+
+// Arguments: resolution index, block size, thread count.
+void differCompare(benchmark::State& state)
+{
+    const desktop::Size& size = benchmarks::kResolutions[state.range(0)];
+
+    std::unique_ptr<desktop::Frame> prev_frame = benchmarks::createDesktopFrame(size);
+    std::unique_ptr<desktop::Frame> curr_frame = benchmarks::createDesktopFrame(size);
+
+    desktop::Differ differ(size, curr_frame->format(),
+                           static_cast<int>(state.range(2)), static_cast<int>(state.range(1)));
+    desktop::Region dirty_region;
+
+    int step = 0;
+
+    for (auto _ : state)
+    {
+        // A few changes per frame, like typing. The previous frame stays the same, so the
+        // changes are limited to a few lines to keep the size of the region stable.
+        for (int i = 0; i < 4; ++i)
+            benchmarks::typeText(curr_frame.get(), step++ % 256);
+
+        differ.calcDirtyRegion(prev_frame->frameData(), curr_frame->frameData(), &dirty_region);
+        benchmark::DoNotOptimize(dirty_region);
+    }
+
+    state.SetBytesProcessed(
+        static_cast<int64_t>(state.iterations()) * curr_frame->stride() * size.height() * 2);
+}
+
+// Arguments: resolution index, block size, thread count.
+void differHash(benchmark::State& state)
+{
+    const desktop::Size& size = benchmarks::kResolutions[state.range(0)];
+
+    std::unique_ptr<desktop::Frame> frame = benchmarks::createDesktopFrame(size);
+
+    desktop::Differ differ(size, frame->format(),
+                           static_cast<int>(state.range(2)), static_cast<int>(state.range(1)));
+    desktop::Region dirty_region;
+
+    // The first call calculates the hashes of the whole screen.
+    differ.calcDirtyRegion(frame->frameData(), &dirty_region);
+
+    int step = 0;
+
+    for (auto _ : state)
+    {
+        for (int i = 0; i < 4; ++i)
+            benchmarks::typeText(frame.get(), step++);
+
+        differ.calcDirtyRegion(frame->frameData(), &dirty_region);
+        benchmark::DoNotOptimize(dirty_region);
+    }
+
+    state.SetBytesProcessed(
+        static_cast<int64_t>(state.iterations()) * frame->stride() * size.height());
+}
+
+void differArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "resolution", "block", "threads" });
+
+    for (int resolution = 0; resolution < benchmarks::kResolutionCount; ++resolution)
+    {
+        for (int block_size : { 8, 16, 32 })
+        {
+            for (int thread_count : { 1, 4 })
+                benchmark->Args({ resolution, block_size, thread_count });
+        }
+    }
+}
+
+BENCHMARK(differCompare)->Apply(differArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(differHash)->Apply(differArguments)->Unit(benchmark::kMicrosecond);
+
+} // namespace
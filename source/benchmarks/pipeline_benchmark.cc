@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "benchmarks/desktop_content.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd.h"
+#include "desktop/screen_capturer_fake.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+const int kZstdCompressionRatio = 8;
+
+std::unique_ptr<codec::VideoEncoder> createEncoder(proto::desktop::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::desktop::VIDEO_ENCODING_ZSTD:
+        {
+            // The same settings as the host uses for clients which support all features.
+            std::unique_ptr<codec::VideoEncoderZstd> encoder(codec::VideoEncoderZstd::create(
+                desktop::PixelFormat::ARGB(), kZstdCompressionRatio));
+            encoder->setCopyRectEnabled(true);
+            encoder->setTileCacheEnabled(true);
+            return encoder;
+        }
+
+        case proto::desktop::VIDEO_ENCODING_VP8:
+            return std::unique_ptr<codec::VideoEncoder>(codec::VideoEncoderVPX::createVP8());
+
+        case proto::desktop::VIDEO_ENCODING_VP9:
+            return std::unique_ptr<codec::VideoEncoder>(codec::VideoEncoderVPX::createVP9());
+
+        default:
+            return nullptr;
+    }
+}
+
+// Measures the capture -> encode pipeline of the host with the synthetic capturer. The content
+// of the frames depends only on the frame number, so the results can be compared between runs.
+// Arguments: content, encoding, resolution index.
+void captureAndEncode(benchmark::State& state)
+{
+    const auto content = static_cast<desktop::ScreenCapturerFake::Content>(state.range(0));
+    const auto encoding = static_cast<proto::desktop::VideoEncoding>(state.range(1));
+    const desktop::Size& size = benchmarks::kResolutions[state.range(2)];
+
+    desktop::ScreenCapturerFake capturer(content, size);
+    std::unique_ptr<codec::VideoEncoder> encoder = createEncoder(encoding);
+
+    // The first frame contains the whole screen and is not measured.
+    desktop::ScreenCapturer::Error error;
+    proto::desktop::VideoPacket packet;
+    encoder->encode(capturer.captureFrame(&error), &packet);
+
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        const desktop::Frame* frame = capturer.captureFrame(&error);
+        if (!frame)
+        {
+            state.SkipWithError("Capture failed");
+            return;
+        }
+
+        // The host does not send packets without changes.
+        if (frame->constUpdatedRegion().isEmpty())
+            continue;
+
+        packet.Clear();
+        encoder->encode(frame, &packet);
+        bytes += packet.ByteSizeLong();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+void pipelineArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "content", "encoding", "resolution" });
+
+    for (auto content : { desktop::ScreenCapturerFake::Content::IDLE_DESKTOP,
+                          desktop::ScreenCapturerFake::Content::SCROLLING_TEXT,
+                          desktop::ScreenCapturerFake::Content::VIDEO })
+    {
+        for (int encoding : { proto::desktop::VIDEO_ENCODING_ZSTD,
+                              proto::desktop::VIDEO_ENCODING_VP8,
+                              proto::desktop::VIDEO_ENCODING_VP9 })
+        {
+            for (int resolution = 0; resolution < benchmarks::kResolutionCount; ++resolution)
+                benchmark->Args({ static_cast<int>(content), encoding, resolution });
+        }
+    }
+}
+
+BENCHMARK(captureAndEncode)->Apply(pipelineArguments)->Unit(benchmark::kMillisecond);
+
+} // namespace
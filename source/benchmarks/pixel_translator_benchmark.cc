@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "benchmarks/desktop_content.h"
+#include "codec/pixel_translator.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Format
+{
+    const char* name;
+    desktop::PixelFormat format;
+};
+
+const Format kFormats[] =
+{
+    { "ARGB", desktop::PixelFormat::ARGB() },
+    { "RGB565", desktop::PixelFormat::RGB565() },
+    { "RGB332", desktop::PixelFormat::RGB332() },
+    { "RGB222", desktop::PixelFormat::RGB222() },
+    { "RGB111", desktop::PixelFormat::RGB111() }
+};
+
+// Translates a 1920x1080 screen from |source_format| to |target_format|. Non-32bpp sources are
+// prepared by translating the synthetic desktop content first.
+void translate(benchmark::State& state,
+               const desktop::PixelFormat& source_format,
+               const desktop::PixelFormat& target_format)
+{
+    const desktop::Size size(1920, 1080);
+
+    std::unique_ptr<desktop::Frame> frame = benchmarks::createDesktopFrame(size);
+
+    const int src_stride = size.width() * source_format.bytesPerPixel();
+    std::vector<uint8_t> source(src_stride * size.height());
+
+    codec::PixelTranslator::create(frame->format(), source_format)->translate(
+        frame->frameData(), frame->stride(), source.data(), src_stride,
+        size.width(), size.height());
+
+    const int dst_stride = size.width() * target_format.bytesPerPixel();
+    std::vector<uint8_t> target(dst_stride * size.height());
+
+    std::unique_ptr<codec::PixelTranslator> translator =
+        codec::PixelTranslator::create(source_format, target_format);
+
+    for (auto _ : state)
+    {
+        translator->translate(source.data(), src_stride, target.data(), dst_stride,
+                              size.width(), size.height());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * size.width() * size.height());
+}
+
+// Registers the benchmarks for every pair of the formats.
+const int kRegistered = []()
+{
+    for (const auto& source : kFormats)
+    {
+        for (const auto& target : kFormats)
+        {
+            const std::string name =
+                std::string("translate/") + source.name + "_to_" + target.name;
+
+            benchmark::RegisterBenchmark(name.c_str(), translate, source.format, target.format);
+        }
+    }
+
+    return 0;
+}();
+
+} // namespace
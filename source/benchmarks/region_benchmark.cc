@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/desktop_region.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// Rectangles like the ones produced by the differ: aligned to 8 pixels and scattered over a
+// 1920x1080 screen.
+std::vector<desktop::Rect> scatteredRects(int count)
+{
+    std::mt19937 random(count);
+    std::uniform_int_distribution<int> x(0, 1920 / 8 - 4);
+    std::uniform_int_distribution<int> y(0, 1080 / 8 - 4);
+    std::uniform_int_distribution<int> blocks(1, 4);
+
+    std::vector<desktop::Rect> rects;
+    rects.reserve(count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        rects.push_back(desktop::Rect::makeXYWH(
+            x(random) * 8, y(random) * 8, blocks(random) * 8, blocks(random) * 8));
+    }
+
+    return rects;
+}
+
+// Rectangles of a dense grid, added row by row like in Differ::mergeBlocks().
+std::vector<desktop::Rect> gridRects(int count)
+{
+    std::vector<desktop::Rect> rects;
+    rects.reserve(count);
+
+    const int columns = 1920 / 16;
+
+    for (int i = 0; i < count; ++i)
+        rects.push_back(desktop::Rect::makeXYWH((i % columns) * 16, (i / columns) * 16, 8, 8));
+
+    return rects;
+}
+
+void regionAddRectScattered(benchmark::State& state)
+{
+    const std::vector<desktop::Rect> rects = scatteredRects(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        desktop::Region region;
+
+        for (const auto& rect : rects)
+            region.addRect(rect);
+
+        benchmark::DoNotOptimize(region);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+void regionAddRectGrid(benchmark::State& state)
+{
+    const std::vector<desktop::Rect> rects = gridRects(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        desktop::Region region;
+
+        for (const auto& rect : rects)
+            region.addRect(rect);
+
+        benchmark::DoNotOptimize(region);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+void regionIterate(benchmark::State& state)
+{
+    const std::vector<desktop::Rect> rects = scatteredRects(static_cast<int>(state.range(0)));
+    const desktop::Region region(rects.data(), static_cast<int>(rects.size()));
+
+    int64_t rect_count = 0;
+
+    for (auto _ : state)
+    {
+        int64_t area = 0;
+
+        for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            area += it.rect().width() * it.rect().height();
+            ++rect_count;
+        }
+
+        benchmark::DoNotOptimize(area);
+    }
+
+    state.SetItemsProcessed(rect_count);
+}
+
+BENCHMARK(regionAddRectScattered)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(regionAddRectGrid)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(regionIterate)->RangeMultiplier(4)->Range(16, 4096);
+
+} // namespace
@@ -0,0 +1,254 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "benchmarks/desktop_content.h"
+#include "codec/video_decoder.h"
+#include "codec/video_encoder_av1.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace {
+
+const int kZstdCompressionRatio = 8;
+
+// The number of packets decoded in one iteration of the decoder benchmarks.
+const int kDecodedPackets = 30;
+
+std::unique_ptr<codec::VideoEncoder> createEncoder(proto::desktop::VideoEncoding encoding,
+                                                   bool enable_copy_rect = false)
+{
+    switch (encoding)
+    {
+        case proto::desktop::VIDEO_ENCODING_ZSTD:
+        {
+            std::unique_ptr<codec::VideoEncoderZstd> encoder(codec::VideoEncoderZstd::create(
+                desktop::PixelFormat::ARGB(), kZstdCompressionRatio));
+            encoder->setCopyRectEnabled(enable_copy_rect);
+            return encoder;
+        }
+
+        case proto::desktop::VIDEO_ENCODING_VP8:
+            return std::unique_ptr<codec::VideoEncoder>(codec::VideoEncoderVPX::createVP8());
+
+        case proto::desktop::VIDEO_ENCODING_VP9:
+            return std::unique_ptr<codec::VideoEncoder>(codec::VideoEncoderVPX::createVP9());
+
+        case proto::desktop::VIDEO_ENCODING_AV1:
+            return std::unique_ptr<codec::VideoEncoder>(codec::VideoEncoderAV1::create());
+
+        default:
+            return nullptr;
+    }
+}
+
+// Arguments: encoding, resolution index.
+void encodeFullScreen(benchmark::State& state)
+{
+    const auto encoding = static_cast<proto::desktop::VideoEncoding>(state.range(0));
+    const desktop::Size& size = benchmarks::kResolutions[state.range(1)];
+
+    std::unique_ptr<desktop::Frame> frame = benchmarks::createDesktopFrame(size);
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        // A new encoder every time, so that every packet is a key frame.
+        state.PauseTiming();
+        std::unique_ptr<codec::VideoEncoder> encoder = createEncoder(encoding);
+        proto::desktop::VideoPacket packet;
+        state.ResumeTiming();
+
+        encoder->encode(frame.get(), &packet);
+        bytes += packet.data().size();
+    }
+
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+// Arguments: encoding, resolution index.
+void encodeTyping(benchmark::State& state)
+{
+    const auto encoding = static_cast<proto::desktop::VideoEncoding>(state.range(0));
+    const desktop::Size& size = benchmarks::kResolutions[state.range(1)];
+
+    std::unique_ptr<desktop::Frame> frame = benchmarks::createDesktopFrame(size);
+    std::unique_ptr<codec::VideoEncoder> encoder = createEncoder(encoding);
+
+    proto::desktop::VideoPacket packet;
+    encoder->encode(frame.get(), &packet);
+
+    int step = 0;
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        benchmarks::typeText(frame.get(), step++);
+
+        packet.Clear();
+        encoder->encode(frame.get(), &packet);
+        bytes += packet.data().size();
+    }
+
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+// Arguments: encoding, resolution index, copy rect enabled.
+void encodeScrolling(benchmark::State& state)
+{
+    const auto encoding = static_cast<proto::desktop::VideoEncoding>(state.range(0));
+    const desktop::Size& size = benchmarks::kResolutions[state.range(1)];
+
+    std::unique_ptr<desktop::Frame> frame = benchmarks::createDesktopFrame(size);
+    std::unique_ptr<codec::VideoEncoder> encoder = createEncoder(encoding, state.range(2) != 0);
+
+    proto::desktop::VideoPacket packet;
+    encoder->encode(frame.get(), &packet);
+
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        benchmarks::scrollWindow(frame.get(), -42);
+
+        packet.Clear();
+        encoder->encode(frame.get(), &packet);
+        bytes += packet.data().size();
+    }
+
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+// Arguments: resolution index, thread count.
+void encodeVp9Threads(benchmark::State& state)
+{
+    const desktop::Size& size = benchmarks::kResolutions[state.range(0)];
+
+    std::unique_ptr<desktop::Frame> frame = benchmarks::createDesktopFrame(size);
+    std::unique_ptr<codec::VideoEncoderVPX> encoder(codec::VideoEncoderVPX::createVP9());
+    encoder->setThreadCount(static_cast<int>(state.range(1)));
+
+    proto::desktop::VideoPacket packet;
+    encoder->encode(frame.get(), &packet);
+
+    for (auto _ : state)
+    {
+        // Scrolling changes a large area in every frame, which is where the threads help.
+        benchmarks::scrollWindow(frame.get(), -42);
+
+        packet.Clear();
+        encoder->encode(frame.get(), &packet);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Arguments: encoding, resolution index.
+void decodeTyping(benchmark::State& state)
+{
+    const auto encoding = static_cast<proto::desktop::VideoEncoding>(state.range(0));
+    const desktop::Size& size = benchmarks::kResolutions[state.range(1)];
+
+    std::unique_ptr<desktop::Frame> source_frame = benchmarks::createDesktopFrame(size);
+    std::unique_ptr<codec::VideoEncoder> encoder = createEncoder(encoding);
+
+    // The first packet contains the whole screen, the rest contain the typed text.
+    std::vector<proto::desktop::VideoPacket> packets(kDecodedPackets);
+
+    for (int i = 0; i < kDecodedPackets; ++i)
+    {
+        if (i != 0)
+            benchmarks::typeText(source_frame.get(), i);
+
+        encoder->encode(source_frame.get(), &packets[i]);
+    }
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameAligned::create(size, desktop::PixelFormat::ARGB(), 32);
+
+    for (auto _ : state)
+    {
+        std::unique_ptr<codec::VideoDecoder> decoder = codec::VideoDecoder::create(encoding);
+
+        for (const auto& packet : packets)
+        {
+            if (!decoder->decode(packet, frame.get()))
+            {
+                state.SkipWithError("Decoding failed");
+                return;
+            }
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kDecodedPackets);
+}
+
+void codecArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "encoding", "resolution" });
+
+    for (int encoding : { proto::desktop::VIDEO_ENCODING_ZSTD,
+                          proto::desktop::VIDEO_ENCODING_VP8,
+                          proto::desktop::VIDEO_ENCODING_VP9,
+                          proto::desktop::VIDEO_ENCODING_AV1 })
+    {
+        for (int resolution = 0; resolution < benchmarks::kResolutionCount; ++resolution)
+            benchmark->Args({ encoding, resolution });
+    }
+}
+
+void scrollingArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "encoding", "resolution", "copy_rect" });
+
+    for (int resolution = 0; resolution < benchmarks::kResolutionCount; ++resolution)
+    {
+        benchmark->Args({ proto::desktop::VIDEO_ENCODING_ZSTD, resolution, 0 });
+        benchmark->Args({ proto::desktop::VIDEO_ENCODING_ZSTD, resolution, 1 });
+        benchmark->Args({ proto::desktop::VIDEO_ENCODING_VP8, resolution, 0 });
+        benchmark->Args({ proto::desktop::VIDEO_ENCODING_VP9, resolution, 0 });
+        benchmark->Args({ proto::desktop::VIDEO_ENCODING_AV1, resolution, 0 });
+    }
+}
+
+void threadArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "resolution", "threads" });
+
+    for (int resolution = 0; resolution < benchmarks::kResolutionCount; ++resolution)
+    {
+        for (int thread_count : { 1, 2, 4, 8 })
+            benchmark->Args({ resolution, thread_count });
+    }
+}
+
+BENCHMARK(encodeFullScreen)->Apply(codecArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(encodeTyping)->Apply(codecArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(encodeScrolling)->Apply(scrollingArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(encodeVp9Threads)->Apply(threadArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(decodeTyping)->Apply(codecArguments)->Unit(benchmark::kMillisecond);
+
+} // namespace
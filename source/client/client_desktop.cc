@@ -21,6 +21,7 @@
 #include "codec/cursor_decoder.h"
 #include "codec/video_decoder.h"
 #include "codec/video_util.h"
+#include "codec/zstd_dictionary.h"
 #include "common/desktop_session_constants.h"
 #include "desktop/mouse_cursor.h"
 
@@ -144,7 +145,22 @@ void ClientDesktop::sendConfig(const proto::desktop::Config& config)
         cursor_decoder_.reset();
 
     outgoing_message_.Clear();
-    outgoing_message_.mutable_config()->CopyFrom(config);
+
+    proto::desktop::Config* outgoing_config = outgoing_message_.mutable_config();
+    outgoing_config->CopyFrom(config);
+
+    // The client is always able to apply copy rects, to keep the tile cache and the large
+    // cursor cache, to continue the compression streams, to apply the delta filter and to
+    // decode the palettes.
+    outgoing_config->set_flags(
+        config.flags() | proto::desktop::ENABLE_COPY_RECT | proto::desktop::ENABLE_TILE_CACHE |
+        proto::desktop::ENABLE_LARGE_CURSOR_CACHE | proto::desktop::ENABLE_PERSISTENT_STREAM |
+        proto::desktop::ENABLE_DELTA_FILTER | proto::desktop::ENABLE_PALETTE);
+
+    outgoing_config->clear_zstd_dictionary();
+    for (uint32_t dictionary_id : codec::ZstdDictionaryStore::instance()->ids())
+        outgoing_config->add_zstd_dictionary(dictionary_id);
+
     sendMessage(outgoing_message_);
 }
 
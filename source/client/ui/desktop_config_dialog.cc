@@ -21,6 +21,9 @@
 #include "client/config_factory.h"
 #include "codec/video_util.h"
 
+#include <QApplication>
+#include <QDesktopWidget>
+
 namespace client {
 
 namespace {
@@ -49,6 +52,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
 
     QComboBox* combo_codec = ui.combo_codec;
 
+    if (video_encodings & proto::desktop::VIDEO_ENCODING_AV1)
+        combo_codec->addItem(QLatin1String("AV1"), proto::desktop::VIDEO_ENCODING_AV1);
+
     if (video_encodings & proto::desktop::VIDEO_ENCODING_VP9)
         combo_codec->addItem(QLatin1String("VP9"), proto::desktop::VIDEO_ENCODING_VP9);
 
@@ -58,6 +64,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (video_encodings & proto::desktop::VIDEO_ENCODING_ZSTD)
         combo_codec->addItem(QLatin1String("ZSTD"), proto::desktop::VIDEO_ENCODING_ZSTD);
 
+    if (video_encodings & proto::desktop::VIDEO_ENCODING_HYBRID)
+        combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::desktop::VIDEO_ENCODING_HYBRID);
+
     int current_codec = combo_codec->findData(config_.video_encoding());
     if (current_codec == -1)
         current_codec = 0;
@@ -65,6 +74,12 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     combo_codec->setCurrentIndex(current_codec);
     onCodecChanged(current_codec);
 
+    if (config_.flags() & proto::desktop::ENABLE_VP9_I444)
+        ui.checkbox_vp9_i444->setChecked(true);
+
+    if (config_.flags() & proto::desktop::ENABLE_VP9_LOSSLESS)
+        ui.checkbox_vp9_lossless->setChecked(true);
+
     QComboBox* combo_color_depth = ui.combo_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
     combo_color_depth->addItem(tr("High color (16 bit)"), COLOR_DEPTH_RGB565);
@@ -120,6 +135,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (config_.flags() & proto::desktop::DISABLE_DESKTOP_WALLPAPER)
         ui.checkbox_desktop_wallpaper->setChecked(true);
 
+    if (config_.max_width() && config_.max_height())
+        ui.checkbox_scale_to_screen->setChecked(true);
+
     connect(combo_codec, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &DesktopConfigDialog::onCodecChanged);
 
@@ -134,8 +152,10 @@ DesktopConfigDialog::~DesktopConfigDialog() = default;
 
 void DesktopConfigDialog::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::desktop::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+
+    bool has_pixel_format = (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::desktop::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -143,6 +163,11 @@ void DesktopConfigDialog::onCodecChanged(int item_index)
     ui.slider_compression_ratio->setEnabled(has_pixel_format);
     ui.label_fast->setEnabled(has_pixel_format);
     ui.label_best->setEnabled(has_pixel_format);
+
+    const bool is_vp9 = (video_encoding == proto::desktop::VIDEO_ENCODING_VP9);
+
+    ui.checkbox_vp9_i444->setEnabled(is_vp9);
+    ui.checkbox_vp9_lossless->setEnabled(is_vp9);
 }
 
 void DesktopConfigDialog::onCompressionRatioChanged(int value)
@@ -159,7 +184,8 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
 
         config_.set_video_encoding(video_encoding);
 
-        if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD)
+        if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+            video_encoding == proto::desktop::VIDEO_ENCODING_HYBRID)
         {
             desktop::PixelFormat pixel_format;
 
@@ -214,8 +240,27 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         if (ui.checkbox_block_remote_input->isChecked())
             flags |= proto::desktop::BLOCK_REMOTE_INPUT;
 
+        if (ui.checkbox_vp9_i444->isChecked() && ui.checkbox_vp9_i444->isEnabled())
+            flags |= proto::desktop::ENABLE_VP9_I444;
+
+        if (ui.checkbox_vp9_lossless->isChecked() && ui.checkbox_vp9_lossless->isEnabled())
+            flags |= proto::desktop::ENABLE_VP9_LOSSLESS;
+
         config_.set_flags(flags);
 
+        if (ui.checkbox_scale_to_screen->isChecked())
+        {
+            QSize screen_size = QApplication::desktop()->availableGeometry(this).size();
+
+            config_.set_max_width(screen_size.width());
+            config_.set_max_height(screen_size.height());
+        }
+        else
+        {
+            config_.set_max_width(0);
+            config_.set_max_height(0);
+        }
+
         emit configChanged(config_);
         accept();
     }
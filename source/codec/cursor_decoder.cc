@@ -39,18 +39,29 @@ bool CursorDecoder::decompressCursor(const proto::desktop::CursorShape& cursor_s
     if (data.empty())
         return false;
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    if (!cursor_shape.continue_stream())
+    {
+        size_t ret = ZSTD_initDStream(stream_.get());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        stream_started_ = true;
+    }
+    else if (!stream_started_)
+    {
+        LOG(LS_WARNING) << "The cursor continues the stream which was not started";
+        return false;
+    }
 
     ZSTD_inBuffer input = { data.data(), data.size(), 0 };
     ZSTD_outBuffer output = { output_data, output_size, 0 };
 
     while (input.pos < input.size)
     {
-        ret = ZSTD_decompressStream(stream_.get(), &output, &input);
+        size_t ret = ZSTD_decompressStream(stream_.get(), &output, &input);
         if (ZSTD_isError(ret))
         {
             LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            stream_started_ = false;
             return false;
         }
     }
@@ -65,8 +76,21 @@ std::shared_ptr<desktop::MouseCursor> CursorDecoder::decode(
 
     if (cursor_shape.flags() & proto::desktop::CursorShape::CACHE)
     {
-        // Bits 0-4 contain the cursor position in the cache.
-        cache_index = cursor_shape.flags() & 0x1F;
+        if (!cache_)
+        {
+            LOG(LS_WARNING) << "Host did not send cache reset command";
+            return nullptr;
+        }
+
+        if (cache_->eviction() == desktop::MouseCursorCache::Eviction::LRU)
+        {
+            cache_index = cursor_shape.cache_index();
+        }
+        else
+        {
+            // Bits 0-4 contain the cursor position in the cache.
+            cache_index = cursor_shape.flags() & 0x1F;
+        }
     }
     else
     {
@@ -95,11 +119,20 @@ std::shared_ptr<desktop::MouseCursor> CursorDecoder::decode(
         if (cursor_shape.flags() & proto::desktop::CursorShape::RESET_CACHE)
         {
             size_t cache_size = cursor_shape.flags() & 0x1F;
+            desktop::MouseCursorCache::Eviction eviction =
+                desktop::MouseCursorCache::Eviction::FIFO;
+
+            // If bits 0-4 are zero, the size of the large cache is sent in a separate field.
+            if (!cache_size)
+            {
+                cache_size = cursor_shape.cache_size();
+                eviction = desktop::MouseCursorCache::Eviction::LRU;
+            }
 
-            if (!desktop::MouseCursorCache::isValidCacheSize(cache_size))
+            if (!desktop::MouseCursorCache::isValidCacheSize(cache_size, eviction))
                 return nullptr;
 
-            cache_ = std::make_unique<desktop::MouseCursorCache>(cache_size);
+            cache_ = std::make_unique<desktop::MouseCursorCache>(cache_size, eviction);
         }
 
         if (!cache_)
@@ -48,6 +48,9 @@ private:
     std::unique_ptr<desktop::MouseCursorCache> cache_;
     ScopedZstdDStream stream_;
 
+    // True if the cursors can continue the stream of the previous cursor.
+    bool stream_started_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(CursorDecoder);
 };
 
@@ -26,6 +26,9 @@ namespace {
 // Cache size can be in the range from 2 to 31.
 constexpr uint8_t kCacheSize = 16;
 
+// Cache size can be in the range from 2 to 1024.
+constexpr size_t kLargeCacheSize = 256;
+
 // The compression ratio can be in the range of 1 to 22.
 constexpr int kCompressionRatio = 8;
 
@@ -37,41 +40,62 @@ uint8_t* outputBuffer(proto::desktop::CursorShape* cursor_shape, size_t size)
 
 } // namespace
 
-CursorEncoder::CursorEncoder()
+CursorEncoder::CursorEncoder(CacheType cache_type)
     : stream_(ZSTD_createCStream()),
-      cache_(kCacheSize)
+      cache_(cache_type == CacheType::LARGE ? kLargeCacheSize : kCacheSize,
+             cache_type == CacheType::LARGE ? desktop::MouseCursorCache::Eviction::LRU :
+                                              desktop::MouseCursorCache::Eviction::FIFO)
 {
     static_assert(kCacheSize >= 2 && kCacheSize <= 31);
+    static_assert(kLargeCacheSize >= 2 && kLargeCacheSize <= 1024);
     static_assert(kCompressionRatio >= 1 && kCompressionRatio <= 22);
 }
 
 bool CursorEncoder::compressCursor(proto::desktop::CursorShape* cursor_shape,
                                    const desktop::MouseCursor* mouse_cursor)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), kCompressionRatio);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    // The persistent stream starts again when the client resets the cache.
+    if (!persistent_stream_ || cache_.isEmpty())
+    {
+        size_t ret = ZSTD_CCtx_reset(stream_.get(), ZSTD_reset_session_and_parameters);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_compressionLevel, kCompressionRatio);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+    else
+    {
+        cursor_shape->set_continue_stream(true);
+    }
 
     const size_t input_size = mouse_cursor->stride() * mouse_cursor->size().height();
     const uint8_t* input_data = mouse_cursor->data();
 
-    const size_t output_size = ZSTD_compressBound(input_size);
-    uint8_t* output_data = outputBuffer(cursor_shape, output_size);
+    size_t output_size = ZSTD_compressBound(input_size);
 
     ZSTD_inBuffer input = { input_data, input_size, 0 };
-    ZSTD_outBuffer output = { output_data, output_size, 0 };
+    ZSTD_outBuffer output = { outputBuffer(cursor_shape, output_size), output_size, 0 };
+
+    // The persistent stream is flushed after each cursor, but the frame is not ended.
+    const ZSTD_EndDirective end_op = persistent_stream_ ? ZSTD_e_flush : ZSTD_e_end;
 
-    while (input.pos < input.size)
+    while (true)
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
+        const size_t ret = ZSTD_compressStream2(stream_.get(), &output, &input, end_op);
         if (ZSTD_isError(ret))
         {
-            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
             return false;
         }
-    }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+        if (!ret)
+            break;
+
+        // The output buffer is full.
+        output_size *= 2;
+        output.dst = outputBuffer(cursor_shape, output_size);
+        output.size = output_size;
+    }
 
     cursor_shape->mutable_data()->resize(output.pos);
     return true;
@@ -108,12 +132,29 @@ bool CursorEncoder::encode(std::unique_ptr<desktop::MouseCursor> mouse_cursor,
 
         // If the cache is empty, then set the cache reset flag on the client
         // side and pass the maximum cache size.
-        cursor_shape->set_flags(cache_.isEmpty() ?
-            (proto::desktop::CursorShape::RESET_CACHE | (kCacheSize & 0x1F)) : 0);
+        if (!cache_.isEmpty())
+        {
+            cursor_shape->set_flags(0);
+        }
+        else if (isLargeCache())
+        {
+            cursor_shape->set_flags(proto::desktop::CursorShape::RESET_CACHE);
+            cursor_shape->set_cache_size(static_cast<uint32_t>(cache_.size()));
+        }
+        else
+        {
+            cursor_shape->set_flags(
+                proto::desktop::CursorShape::RESET_CACHE | (cache_.size() & 0x1F));
+        }
 
         // Add the cursor to the cache.
         cache_.add(std::move(mouse_cursor));
     }
+    else if (isLargeCache())
+    {
+        cursor_shape->set_flags(proto::desktop::CursorShape::CACHE);
+        cursor_shape->set_cache_index(static_cast<uint32_t>(index));
+    }
     else
     {
         cursor_shape->set_flags(proto::desktop::CursorShape::CACHE | (index & 0x1F));
@@ -122,4 +163,9 @@ bool CursorEncoder::encode(std::unique_ptr<desktop::MouseCursor> mouse_cursor,
     return true;
 }
 
+bool CursorEncoder::isLargeCache() const
+{
+    return cache_.eviction() == desktop::MouseCursorCache::Eviction::LRU;
+}
+
 } // namespace codec
@@ -29,18 +29,35 @@ namespace codec {
 class CursorEncoder
 {
 public:
-    CursorEncoder();
+    enum class CacheType
+    {
+        // The cache of 16 cursors with FIFO eviction. Supported by all clients.
+        SMALL,
+
+        // The cache of 256 cursors with LRU eviction. The client must support the large cursor
+        // cache (ENABLE_LARGE_CURSOR_CACHE).
+        LARGE
+    };
+
+    explicit CursorEncoder(CacheType cache_type = CacheType::SMALL);
     ~CursorEncoder() = default;
 
+    // Enables the stream which is not restarted for each cursor, so the similar cursors are
+    // compressed better. The stream starts again together with the cache. The client must
+    // support the persistent streams.
+    void setPersistentStreamEnabled(bool enable) { persistent_stream_ = enable; }
+
     bool encode(std::unique_ptr<desktop::MouseCursor> mouse_cursor,
                 proto::desktop::CursorShape* cursor_shape);
 
 private:
+    bool isLargeCache() const;
     bool compressCursor(proto::desktop::CursorShape* cursor_shape,
                         const desktop::MouseCursor* mouse_cursor);
 
     ScopedZstdCStream stream_;
     desktop::MouseCursorCache cache_;
+    bool persistent_stream_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(CursorEncoder);
 };
@@ -0,0 +1,222 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_palette.h"
+#include "base/logging.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+int hashColor(uint32_t color)
+{
+    // Fibonacci hashing to 10 bits.
+    return static_cast<int>((color * 2654435761U) >> 22);
+}
+
+} // namespace
+
+PixelPalette::PixelPalette(int bytes_per_pixel)
+    : bytes_per_pixel_(bytes_per_pixel)
+{
+    static_assert(kHashSize == 1 << 10, "The hash function must match the size of the table");
+    DCHECK(bytes_per_pixel_ == 1 || bytes_per_pixel_ == 2 || bytes_per_pixel_ == 4);
+}
+
+bool PixelPalette::build(const uint8_t* pixels, int stride, int width, int height)
+{
+    size_ = 0;
+    memset(hash_indexes_, -1, sizeof(hash_indexes_));
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* row = pixels + y * stride;
+        int x = 0;
+
+        while (x < width)
+        {
+            const uint32_t color = pixel(row + x * bytes_per_pixel_);
+            const int slot = find(color);
+
+            if (hash_indexes_[slot] < 0)
+            {
+                if (size_ == kMaxSize)
+                    return false;
+
+                hash_colors_[slot] = color;
+                hash_indexes_[slot] = static_cast<int16_t>(size_);
+
+                memcpy(colors_ + size_ * bytes_per_pixel_, &color, bytes_per_pixel_);
+                ++size_;
+            }
+
+            x = skipRun(row, x + 1, width, color);
+        }
+    }
+
+    return true;
+}
+
+void PixelPalette::setColors(const uint8_t* colors, int size)
+{
+    DCHECK_LE(size, kMaxSize);
+
+    size_ = size;
+
+    memcpy(colors_, colors, size_ * bytes_per_pixel_);
+    memset(colors_ + size_ * bytes_per_pixel_, 0, (kMaxSize - size_) * bytes_per_pixel_);
+}
+
+// static
+int PixelPalette::bitsPerIndex(int palette_size)
+{
+    if (palette_size <= 2)
+        return 1;
+
+    if (palette_size <= 4)
+        return 2;
+
+    if (palette_size <= 16)
+        return 4;
+
+    return 8;
+}
+
+// static
+size_t PixelPalette::packedRowSize(int width, int bits_per_index)
+{
+    return (static_cast<size_t>(width) * bits_per_index + 7) / 8;
+}
+
+size_t PixelPalette::encodedSize(int width, int height) const
+{
+    return size_ * bytes_per_pixel_ + height * packedRowSize(width, bitsPerIndex(size_));
+}
+
+void PixelPalette::packRow(const uint8_t* pixels, int width, uint8_t* packed) const
+{
+    const int bits_per_index = bitsPerIndex(size_);
+
+    memset(packed, 0, packedRowSize(width, bits_per_index));
+
+    int x = 0;
+
+    while (x < width)
+    {
+        const uint32_t color = pixel(pixels + x * bytes_per_pixel_);
+        const int index = hash_indexes_[find(color)];
+        DCHECK_GE(index, 0);
+
+        const int run_end = skipRun(pixels, x + 1, width, color);
+
+        if (bits_per_index == 8)
+        {
+            memset(packed + x, index, run_end - x);
+            x = run_end;
+            continue;
+        }
+
+        for (; x < run_end; ++x)
+        {
+            const int bit = x * bits_per_index;
+            packed[bit >> 3] |= static_cast<uint8_t>(index << (8 - bits_per_index - (bit & 7)));
+        }
+    }
+}
+
+void PixelPalette::unpackRow(const uint8_t* packed, int width, uint8_t* pixels) const
+{
+    const int bits_per_index = bitsPerIndex(size_);
+    const int mask = (1 << bits_per_index) - 1;
+
+    for (int x = 0; x < width; ++x)
+    {
+        const int bit = x * bits_per_index;
+        const int index = (packed[bit >> 3] >> (8 - bits_per_index - (bit & 7))) & mask;
+
+        memcpy(pixels + x * bytes_per_pixel_, colors_ + index * bytes_per_pixel_,
+               bytes_per_pixel_);
+    }
+}
+
+uint32_t PixelPalette::pixel(const uint8_t* data) const
+{
+    uint32_t color = 0;
+    memcpy(&color, data, bytes_per_pixel_);
+    return color;
+}
+
+int PixelPalette::skipRun(const uint8_t* row, int x, int width, uint32_t color) const
+{
+    __m128i pattern;
+
+    switch (bytes_per_pixel_)
+    {
+        case 4:
+            pattern = _mm_set1_epi32(static_cast<int>(color));
+            break;
+
+        case 2:
+            pattern = _mm_set1_epi16(static_cast<short>(color));
+            break;
+
+        default:
+            pattern = _mm_set1_epi8(static_cast<char>(color));
+            break;
+    }
+
+    // The screen content has long runs of the same color, so 16 bytes are compared at once.
+    const int pixels_per_step = 16 / bytes_per_pixel_;
+
+    while (x + pixels_per_step <= width)
+    {
+        const __m128i data =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * bytes_per_pixel_));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(data, pattern)) != 0xFFFF)
+            break;
+
+        x += pixels_per_step;
+    }
+
+    while (x < width && pixel(row + x * bytes_per_pixel_) == color)
+        ++x;
+
+    return x;
+}
+
+int PixelPalette::find(uint32_t color) const
+{
+    int slot = hashColor(color);
+
+    while (hash_indexes_[slot] >= 0 && hash_colors_[slot] != color)
+        slot = (slot + 1) & (kHashSize - 1);
+
+    return slot;
+}
+
+} // namespace codec
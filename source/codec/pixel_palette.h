@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__PIXEL_PALETTE_H
+#define CODEC__PIXEL_PALETTE_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace codec {
+
+// The palette of an area with few colors. The pixels of the area are sent as the colors of the
+// palette followed by the rows of the indexes in the palette packed to 1, 2, 4 or 8 bits (the
+// most significant bits first, each row starts from a new byte).
+class PixelPalette
+{
+public:
+    static const int kMaxSize = 256;
+
+    // |bytes_per_pixel| must be 1, 2 or 4.
+    explicit PixelPalette(int bytes_per_pixel);
+    ~PixelPalette() = default;
+
+    // Collects the colors of the pixels. Returns false if there are more than kMaxSize colors.
+    bool build(const uint8_t* pixels, int stride, int width, int height);
+
+    // Sets the colors received from the encoder (size() * bytes per pixel bytes).
+    void setColors(const uint8_t* colors, int size);
+
+    int size() const { return size_; }
+    const uint8_t* colors() const { return colors_; }
+
+    static int bitsPerIndex(int palette_size);
+    static size_t packedRowSize(int width, int bits_per_index);
+
+    // The size of the colors and the packed rows of the area.
+    size_t encodedSize(int width, int height) const;
+
+    void packRow(const uint8_t* pixels, int width, uint8_t* packed) const;
+
+    // The indexes outside of the palette are unpacked as zero pixels.
+    void unpackRow(const uint8_t* packed, int width, uint8_t* pixels) const;
+
+private:
+    uint32_t pixel(const uint8_t* data) const;
+
+    // Returns the position of the first pixel after |x| which is not equal to |color|.
+    int skipRun(const uint8_t* row, int x, int width, uint32_t color) const;
+
+    // Returns the slot of the hash table for |color|.
+    int find(uint32_t color) const;
+
+    // The hash table of the colors. It has 4 times more slots than the palette can have colors,
+    // so the chains are short.
+    static const int kHashSize = kMaxSize * 4;
+
+    const int bytes_per_pixel_;
+    int size_ = 0;
+
+    uint8_t colors_[kMaxSize * 4] = { 0 };
+    uint32_t hash_colors_[kHashSize];
+    int16_t hash_indexes_[kHashSize];
+
+    DISALLOW_COPY_AND_ASSIGN(PixelPalette);
+};
+
+} // namespace codec
+
+#endif // CODEC__PIXEL_PALETTE_H
@@ -0,0 +1,170 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_palette.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace codec {
+
+namespace {
+
+// Creates the pixels of |width| x |height| with the colors from |palette|. The rows have the
+// padding at the end.
+std::vector<uint8_t> createPixels(const std::vector<uint32_t>& palette, int bytes_per_pixel,
+                                  int width, int height, int stride, std::mt19937* random)
+{
+    std::vector<uint8_t> pixels(stride * height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            // Mostly the runs of the same color, sometimes a random color of the palette.
+            const uint32_t color = ((*random)() % 5 == 0) ?
+                palette[(*random)() % palette.size()] : palette[(x / 4) % palette.size()];
+
+            memcpy(&pixels[y * stride + x * bytes_per_pixel], &color, bytes_per_pixel);
+        }
+    }
+
+    return pixels;
+}
+
+int countColors(const std::vector<uint8_t>& pixels, int bytes_per_pixel,
+                int width, int height, int stride)
+{
+    std::set<uint32_t> colors;
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            uint32_t color = 0;
+            memcpy(&color, &pixels[y * stride + x * bytes_per_pixel], bytes_per_pixel);
+            colors.insert(color);
+        }
+    }
+
+    return static_cast<int>(colors.size());
+}
+
+} // namespace
+
+TEST(pixel_palette_test, bits_per_index)
+{
+    EXPECT_EQ(PixelPalette::bitsPerIndex(1), 1);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(2), 1);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(3), 2);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(4), 2);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(5), 4);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(16), 4);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(17), 8);
+    EXPECT_EQ(PixelPalette::bitsPerIndex(256), 8);
+
+    // Each row starts from a new byte.
+    EXPECT_EQ(PixelPalette::packedRowSize(1, 1), 1U);
+    EXPECT_EQ(PixelPalette::packedRowSize(9, 1), 2U);
+    EXPECT_EQ(PixelPalette::packedRowSize(5, 2), 2U);
+    EXPECT_EQ(PixelPalette::packedRowSize(3, 4), 2U);
+    EXPECT_EQ(PixelPalette::packedRowSize(7, 8), 7U);
+}
+
+TEST(pixel_palette_test, pack_unpack)
+{
+    std::mt19937 random(21);
+
+    for (int bytes_per_pixel : { 1, 2, 4 })
+    {
+        const uint32_t mask = (bytes_per_pixel == 4) ?
+            0xFFFFFFFF : ((1U << (bytes_per_pixel * 8)) - 1);
+
+        for (int color_count : { 1, 2, 3, 4, 5, 16, 17, 200, 256, 257 })
+        {
+            for (int width : { 1, 3, 7, 16, 33, 100 })
+            {
+                std::vector<uint32_t> palette(color_count);
+                for (auto& color : palette)
+                    color = random() & mask;
+
+                const int height = 9;
+                const int stride = width * bytes_per_pixel + 5;
+
+                std::vector<uint8_t> pixels = createPixels(
+                    palette, bytes_per_pixel, width, height, stride, &random);
+                const int colors = countColors(pixels, bytes_per_pixel, width, height, stride);
+
+                PixelPalette encoder_palette(bytes_per_pixel);
+
+                const bool built = encoder_palette.build(pixels.data(), stride, width, height);
+                ASSERT_EQ(built, colors <= PixelPalette::kMaxSize);
+                if (!built)
+                    continue;
+
+                ASSERT_EQ(encoder_palette.size(), colors);
+
+                PixelPalette decoder_palette(bytes_per_pixel);
+                decoder_palette.setColors(encoder_palette.colors(), encoder_palette.size());
+
+                const int bits_per_index = PixelPalette::bitsPerIndex(encoder_palette.size());
+                std::vector<uint8_t> packed(PixelPalette::packedRowSize(width, bits_per_index));
+                std::vector<uint8_t> row(width * bytes_per_pixel);
+
+                for (int y = 0; y < height; ++y)
+                {
+                    encoder_palette.packRow(&pixels[y * stride], width, packed.data());
+                    decoder_palette.unpackRow(packed.data(), width, row.data());
+
+                    ASSERT_EQ(memcmp(row.data(), &pixels[y * stride], row.size()), 0)
+                        << "bytes per pixel " << bytes_per_pixel << ", colors " << color_count
+                        << ", width " << width << ", row " << y;
+                }
+            }
+        }
+    }
+}
+
+TEST(pixel_palette_test, rebuild)
+{
+    std::mt19937 random(3);
+
+    const std::vector<uint32_t> first = { 0xFF000000, 0xFFFFFFFF, 0xFF3050A0 };
+    const std::vector<uint32_t> second = { 0xFF202020, 0xFFE0E0E0 };
+
+    const int width = 64;
+    const int height = 4;
+    const int stride = width * 4;
+
+    PixelPalette palette(4);
+
+    std::vector<uint8_t> pixels = createPixels(first, 4, width, height, stride, &random);
+    ASSERT_TRUE(palette.build(pixels.data(), stride, width, height));
+    EXPECT_EQ(palette.size(), 3);
+
+    // The colors of the previous area are not kept.
+    pixels = createPixels(second, 4, width, height, stride, &random);
+    ASSERT_TRUE(palette.build(pixels.data(), stride, width, height));
+    EXPECT_EQ(palette.size(), 2);
+}
+
+} // namespace codec
@@ -0,0 +1,147 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/scale_reducer.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <libyuv/scale_argb.h>
+
+#include <algorithm>
+
+namespace codec {
+
+ScaleReducer::~ScaleReducer() = default;
+
+const desktop::Frame* ScaleReducer::scaleFrame(const desktop::Frame* source_frame,
+                                               const desktop::Size& max_size)
+{
+    DCHECK(source_frame);
+
+    const desktop::Size& source_size = source_frame->size();
+    const desktop::Size target_size = scaledSize(source_size, max_size);
+
+    if (target_size == source_size)
+    {
+        target_frame_.reset();
+        return source_frame;
+    }
+
+    if (source_frame->format().bitsPerPixel() != 32)
+    {
+        LOG(LS_WARNING) << "Unsupported pixel format for scaling";
+        return source_frame;
+    }
+
+    desktop::Region* updated_region;
+
+    if (!target_frame_ || target_frame_->size() != target_size || source_size_ != source_size)
+    {
+        target_frame_ = desktop::FrameAligned::create(target_size, source_frame->format(), 32);
+        source_size_ = source_size;
+
+        // The new frame does not contain anything yet, so it is scaled completely.
+        updated_region = target_frame_->updatedRegion();
+        updated_region->setRect(desktop::Rect::makeSize(target_size));
+    }
+    else
+    {
+        updated_region = target_frame_->updatedRegion();
+        updated_region->clear();
+
+        for (desktop::Region::Iterator it(source_frame->constUpdatedRegion());
+             !it.isAtEnd(); it.advance())
+        {
+            updated_region->addRect(scaledRect(it.rect(), source_size, target_size));
+        }
+    }
+
+    // ARGBScaleClip scales the whole source frame but writes only the clip rectangle. The pixels
+    // of the scaled rectangles are exactly the same as if the whole frame had been scaled.
+    for (desktop::Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        libyuv::ARGBScaleClip(source_frame->frameData(),
+                              source_frame->stride(),
+                              source_size.width(),
+                              source_size.height(),
+                              target_frame_->frameData(),
+                              target_frame_->stride(),
+                              target_size.width(),
+                              target_size.height(),
+                              rect.x(),
+                              rect.y(),
+                              rect.width(),
+                              rect.height(),
+                              libyuv::kFilterBilinear);
+    }
+
+    target_frame_->setTopLeft(source_frame->topLeft());
+    return target_frame_.get();
+}
+
+// static
+desktop::Size ScaleReducer::scaledSize(const desktop::Size& source_size,
+                                       const desktop::Size& max_size)
+{
+    if (max_size.isEmpty())
+        return source_size;
+
+    if (source_size.width() <= max_size.width() && source_size.height() <= max_size.height())
+        return source_size;
+
+    const int64_t source_width = source_size.width();
+    const int64_t source_height = source_size.height();
+
+    // Compare width / height ratios without rounding.
+    if (source_width * max_size.height() > source_height * max_size.width())
+    {
+        return desktop::Size(
+            max_size.width(),
+            std::max(static_cast<int>(source_height * max_size.width() / source_width), 1));
+    }
+
+    return desktop::Size(
+        std::max(static_cast<int>(source_width * max_size.height() / source_height), 1),
+        max_size.height());
+}
+
+// static
+desktop::Rect ScaleReducer::scaledRect(const desktop::Rect& source_rect,
+                                       const desktop::Size& source_size,
+                                       const desktop::Size& target_size)
+{
+    const int64_t source_width = source_size.width();
+    const int64_t source_height = source_size.height();
+    const int64_t target_width = target_size.width();
+    const int64_t target_height = target_size.height();
+
+    const int left = static_cast<int>(source_rect.left() * target_width / source_width) - 1;
+    const int top = static_cast<int>(source_rect.top() * target_height / source_height) - 1;
+    const int right = static_cast<int>(
+        (source_rect.right() * target_width + source_width - 1) / source_width) + 1;
+    const int bottom = static_cast<int>(
+        (source_rect.bottom() * target_height + source_height - 1) / source_height) + 1;
+
+    desktop::Rect rect = desktop::Rect::makeLTRB(left, top, right, bottom);
+    rect.intersectWith(desktop::Rect::makeSize(target_size));
+    return rect;
+}
+
+} // namespace codec
@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__SCALE_REDUCER_H
+#define CODEC__SCALE_REDUCER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <memory>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// Scales down the captured frames for the clients whose screens are smaller than the screen of
+// the host. Only the updated region of the source frame is scaled, the rest of the scaled frame
+// is kept from the previous calls.
+class ScaleReducer
+{
+public:
+    ScaleReducer() = default;
+    ~ScaleReducer();
+
+    // Returns |source_frame| if it fits into |max_size| (an empty size means no limit) or a frame
+    // scaled down with the aspect ratio preserved. The returned frame is valid until the next
+    // call. The source frame must be in ARGB format.
+    const desktop::Frame* scaleFrame(const desktop::Frame* source_frame,
+                                     const desktop::Size& max_size);
+
+    // Returns the size of the frames to which the frames of |source_size| are scaled.
+    static desktop::Size scaledSize(const desktop::Size& source_size,
+                                    const desktop::Size& max_size);
+
+    // Returns the rectangle of the scaled frame which is affected by |source_rect| of the source
+    // frame. The filter reads the neighboring pixels, so the rectangle is extended by one pixel.
+    static desktop::Rect scaledRect(const desktop::Rect& source_rect,
+                                    const desktop::Size& source_size,
+                                    const desktop::Size& target_size);
+
+private:
+    std::unique_ptr<desktop::Frame> target_frame_;
+    desktop::Size source_size_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScaleReducer);
+};
+
+} // namespace codec
+
+#endif // CODEC__SCALE_REDUCER_H
@@ -0,0 +1,43 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/scoped_aom_codec.h"
+#include "base/logging.h"
+
+#include <aom/aom_codec.h>
+#include <aom/aom_image.h>
+
+namespace codec {
+
+void AomCodecDeleter::operator()(aom_codec_ctx_t* codec)
+{
+    if (codec)
+    {
+        aom_codec_err_t ret = aom_codec_destroy(codec);
+        DCHECK_EQ(ret, AOM_CODEC_OK);
+        delete codec;
+    }
+}
+
+void AomImageDeleter::operator()(aom_image_t* image)
+{
+    if (image)
+        aom_img_free(image);
+}
+
+} // namespace codec
@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__SESSION_FILE_H
+#define CODEC__SESSION_FILE_H
+
+#include <cstdint>
+
+namespace codec {
+
+// The layout of the session recording files (little-endian). The file is written sequentially
+// and consists of the header and the records:
+//
+//   FileHeader
+//   RecordHeader + payload
+//   ...
+//   RecordHeader (INDEX) + IndexEntry * count
+//   FileTrailer
+//
+// MESSAGE records contain the serialized proto::desktop::HostToClient messages as they were sent
+// to the client. A KEY_POINT record is written before each message with a video key frame. Its
+// payload contains the cursor shapes (uint32 size + serialized proto::desktop::CursorShape) which
+// restore the state of the cursor decoder at this point.
+//
+// The index and the trailer are written when the recording is finished. If the recording was
+// interrupted, the index can be restored by reading the records.
+namespace session_file {
+
+const uint32_t kFileMagic = 0x52534141; // "AASR"
+const uint32_t kIndexMagic = 0x58444941; // "AIDX"
+const uint32_t kVersion = 1;
+
+enum RecordType : uint32_t
+{
+    MESSAGE = 1,
+    KEY_POINT = 2,
+    INDEX = 3
+};
+
+#pragma pack(push, 1)
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct RecordHeader
+{
+    uint32_t type;
+    uint32_t size;
+
+    // Milliseconds from the beginning of the recording.
+    int64_t time;
+};
+
+struct IndexEntry
+{
+    int64_t time;
+
+    // The offset of the KEY_POINT record from the beginning of the file.
+    uint64_t offset;
+};
+
+struct FileTrailer
+{
+    // The offset of the INDEX record from the beginning of the file.
+    uint64_t index_offset;
+    uint32_t magic;
+};
+
+#pragma pack(pop)
+
+} // namespace session_file
+
+} // namespace codec
+
+#endif // CODEC__SESSION_FILE_H
@@ -0,0 +1,335 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/session_player.h"
+#include "base/logging.h"
+#include "codec/cursor_decoder.h"
+#include "codec/video_decoder.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "desktop/mouse_cursor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace codec {
+
+namespace {
+
+// The same limit as the client uses.
+const int kMaxScreenSize = std::numeric_limits<uint16_t>::max();
+
+template <typename T>
+T readValue(const uint8_t* data)
+{
+    // The data in the file is not aligned.
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+SessionPlayer::~SessionPlayer() = default;
+
+// static
+std::unique_ptr<SessionPlayer> SessionPlayer::open(const std::filesystem::path& file_path)
+{
+    std::unique_ptr<SessionPlayer> player(new SessionPlayer());
+
+    if (!player->file_.initialize(file_path))
+        return nullptr;
+
+    if (player->file_.length() < sizeof(session_file::FileHeader))
+    {
+        LOG(LS_WARNING) << "Invalid recording file";
+        return nullptr;
+    }
+
+    const session_file::FileHeader header =
+        readValue<session_file::FileHeader>(player->file_.data());
+
+    if (header.magic != session_file::kFileMagic || header.version != session_file::kVersion)
+    {
+        LOG(LS_WARNING) << "Unsupported recording file";
+        return nullptr;
+    }
+
+    if (!player->readIndex())
+    {
+        // The recording was interrupted and the index was not written.
+        LOG(LS_INFO) << "Index not found. Reading all records";
+        player->restoreIndex();
+    }
+
+    player->offset_ = sizeof(session_file::FileHeader);
+    return player;
+}
+
+bool SessionPlayer::seek(std::chrono::milliseconds time)
+{
+    if (index_.empty())
+        return false;
+
+    // The last key point which is not later than |time|.
+    auto key_point = std::upper_bound(
+        index_.begin(), index_.end(), time.count(),
+        [](int64_t time, const session_file::IndexEntry& entry)
+    {
+        return time < entry.time;
+    });
+
+    if (key_point != index_.begin())
+        --key_point;
+
+    // The state of the decoders is restored from the key point.
+    video_encoding_ = proto::desktop::VIDEO_ENCODING_UNKNOWN;
+    video_decoder_.reset();
+    cursor_decoder_.reset();
+    frame_.reset();
+    mouse_cursor_.reset();
+
+    session_file::RecordHeader header;
+    const uint8_t* data;
+
+    if (!readRecord(key_point->offset, &header, &data) || header.type != session_file::KEY_POINT)
+    {
+        LOG(LS_WARNING) << "Invalid key point";
+        return false;
+    }
+
+    if (!applyKeyPoint(data, header.size))
+        return false;
+
+    offset_ = key_point->offset + sizeof(header) + header.size;
+    position_ = header.time;
+
+    while (readRecord(offset_, &header, &data) && header.time <= time.count())
+    {
+        if (!readNextMessage())
+            return false;
+    }
+
+    return true;
+}
+
+bool SessionPlayer::readNextMessage()
+{
+    session_file::RecordHeader header;
+    const uint8_t* data;
+
+    while (readRecord(offset_, &header, &data))
+    {
+        offset_ += sizeof(header) + header.size;
+
+        // When the messages are decoded one by one, the state of the decoders is already the
+        // same as the key point contains.
+        if (header.type != session_file::MESSAGE)
+            continue;
+
+        position_ = header.time;
+        return decodeMessage(data, header.size);
+    }
+
+    return false;
+}
+
+bool SessionPlayer::readIndex()
+{
+    const size_t file_size = file_.length();
+
+    if (file_size < sizeof(session_file::FileHeader) + sizeof(session_file::FileTrailer))
+        return false;
+
+    const session_file::FileTrailer trailer = readValue<session_file::FileTrailer>(
+        file_.data() + file_size - sizeof(session_file::FileTrailer));
+
+    if (trailer.magic != session_file::kIndexMagic ||
+        trailer.index_offset < sizeof(session_file::FileHeader))
+    {
+        return false;
+    }
+
+    records_end_ = file_size - sizeof(session_file::FileTrailer);
+
+    session_file::RecordHeader header;
+    const uint8_t* data;
+
+    if (!readRecord(trailer.index_offset, &header, &data) ||
+        header.type != session_file::INDEX ||
+        header.size % sizeof(session_file::IndexEntry) != 0 ||
+        trailer.index_offset + sizeof(header) + header.size != records_end_)
+    {
+        return false;
+    }
+
+    const size_t count = header.size / sizeof(session_file::IndexEntry);
+    index_.resize(count);
+    memcpy(index_.data(), data, header.size);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (index_[i].offset >= trailer.index_offset ||
+            (i != 0 && index_[i].time < index_[i - 1].time))
+        {
+            index_.clear();
+            return false;
+        }
+    }
+
+    records_end_ = trailer.index_offset;
+    duration_ = header.time;
+    return true;
+}
+
+void SessionPlayer::restoreIndex()
+{
+    index_.clear();
+    duration_ = 0;
+
+    // Only the complete records are used.
+    records_end_ = file_.length();
+
+    size_t offset = sizeof(session_file::FileHeader);
+    session_file::RecordHeader header;
+    const uint8_t* data;
+
+    while (readRecord(offset, &header, &data) && header.type != session_file::INDEX)
+    {
+        if (header.type == session_file::KEY_POINT)
+            index_.push_back({ header.time, offset });
+
+        duration_ = header.time;
+        offset += sizeof(header) + header.size;
+    }
+
+    records_end_ = offset;
+}
+
+bool SessionPlayer::readRecord(
+    size_t offset, session_file::RecordHeader* header, const uint8_t** data) const
+{
+    if (offset > records_end_ || records_end_ - offset < sizeof(session_file::RecordHeader))
+        return false;
+
+    *header = readValue<session_file::RecordHeader>(file_.data() + offset);
+
+    if (records_end_ - offset - sizeof(session_file::RecordHeader) < header->size)
+        return false;
+
+    *data = file_.data() + offset + sizeof(session_file::RecordHeader);
+    return true;
+}
+
+bool SessionPlayer::applyKeyPoint(const uint8_t* data, size_t size)
+{
+    proto::desktop::CursorShape cursor_shape;
+
+    while (size)
+    {
+        if (size < sizeof(uint32_t))
+            return false;
+
+        const uint32_t shape_size = readValue<uint32_t>(data);
+        data += sizeof(uint32_t);
+        size -= sizeof(uint32_t);
+
+        if (size < shape_size || !cursor_shape.ParseFromArray(data, static_cast<int>(shape_size)))
+        {
+            LOG(LS_WARNING) << "Invalid cursor shape";
+            return false;
+        }
+
+        data += shape_size;
+        size -= shape_size;
+
+        if (!cursor_decoder_)
+            cursor_decoder_ = std::make_unique<CursorDecoder>();
+
+        mouse_cursor_ = cursor_decoder_->decode(cursor_shape);
+    }
+
+    return true;
+}
+
+bool SessionPlayer::decodeMessage(const uint8_t* data, size_t size)
+{
+    if (!message_.ParseFromArray(data, static_cast<int>(size)))
+    {
+        LOG(LS_WARNING) << "Invalid message";
+        return false;
+    }
+
+    if (message_.has_video_packet())
+    {
+        const proto::desktop::VideoPacket& packet = message_.video_packet();
+
+        if (video_encoding_ != packet.encoding())
+        {
+            video_decoder_ = VideoDecoder::create(packet.encoding());
+            video_encoding_ = packet.encoding();
+        }
+
+        if (!video_decoder_)
+        {
+            LOG(LS_WARNING) << "Video decoder not initialized";
+            return false;
+        }
+
+        if (packet.has_format())
+        {
+            const desktop::Size screen_size =
+                VideoUtil::fromVideoRect(packet.format().screen_rect()).size();
+
+            if (screen_size.width() <= 0 || screen_size.width() >= kMaxScreenSize ||
+                screen_size.height() <= 0 || screen_size.height() >= kMaxScreenSize)
+            {
+                LOG(LS_WARNING) << "Wrong video frame size";
+                return false;
+            }
+
+            frame_ = desktop::FrameAligned::create(screen_size, desktop::PixelFormat::ARGB(), 32);
+        }
+
+        // The packets before the first key frame can not be decoded.
+        if (!frame_)
+            return false;
+
+        if (!video_decoder_->decode(packet, frame_.get()))
+        {
+            LOG(LS_WARNING) << "The video packet could not be decoded";
+            return false;
+        }
+    }
+
+    if (message_.has_cursor_shape())
+    {
+        if (!cursor_decoder_)
+            cursor_decoder_ = std::make_unique<CursorDecoder>();
+
+        std::shared_ptr<desktop::MouseCursor> mouse_cursor =
+            cursor_decoder_->decode(message_.cursor_shape());
+        if (mouse_cursor)
+            mouse_cursor_ = std::move(mouse_cursor);
+    }
+
+    return true;
+}
+
+} // namespace codec
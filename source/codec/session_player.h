@@ -0,0 +1,107 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__SESSION_PLAYER_H
+#define CODEC__SESSION_PLAYER_H
+
+#include "base/macros_magic.h"
+#include "base/memory_mapped_file.h"
+#include "codec/session_file.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace desktop {
+class Frame;
+class MouseCursor;
+} // namespace desktop
+
+namespace codec {
+
+class CursorDecoder;
+class VideoDecoder;
+
+// Plays the files written by SessionRecorder. The file is mapped into memory and the messages
+// are decoded with the same decoders as the client uses.
+class SessionPlayer
+{
+public:
+    ~SessionPlayer();
+
+    static std::unique_ptr<SessionPlayer> open(const std::filesystem::path& file_path);
+
+    std::chrono::milliseconds duration() const { return std::chrono::milliseconds(duration_); }
+    size_t keyPointCount() const { return index_.size(); }
+
+    // Moves to |time|. The decoding starts from the last key point before |time| (found with the
+    // binary search in the index), so only the messages between the key point and |time| are
+    // decoded.
+    bool seek(std::chrono::milliseconds time);
+
+    // Decodes the next message. Returns false at the end of the recording or if the message can
+    // not be decoded.
+    bool readNextMessage();
+
+    // The time of the last decoded message.
+    std::chrono::milliseconds position() const { return std::chrono::milliseconds(position_); }
+
+    // The last decoded message.
+    const proto::desktop::HostToClient& message() const { return message_; }
+
+    // The frame and the cursor after the last decoded message. They are null until the first
+    // video packet and the first cursor shape.
+    const desktop::Frame* frame() const { return frame_.get(); }
+    std::shared_ptr<desktop::MouseCursor> mouseCursor() const { return mouse_cursor_; }
+
+private:
+    SessionPlayer() = default;
+
+    bool readIndex();
+    void restoreIndex();
+    bool readRecord(size_t offset, session_file::RecordHeader* header, const uint8_t** data) const;
+    bool applyKeyPoint(const uint8_t* data, size_t size);
+    bool decodeMessage(const uint8_t* data, size_t size);
+
+    base::MemoryMappedFile file_;
+
+    // The end of the records (the INDEX record is not included).
+    size_t records_end_ = 0;
+
+    std::vector<session_file::IndexEntry> index_;
+    int64_t duration_ = 0;
+
+    // The offset of the next record and the time of the last decoded message.
+    size_t offset_ = 0;
+    int64_t position_ = 0;
+
+    proto::desktop::HostToClient message_;
+    proto::desktop::VideoEncoding video_encoding_ = proto::desktop::VIDEO_ENCODING_UNKNOWN;
+
+    std::unique_ptr<VideoDecoder> video_decoder_;
+    std::unique_ptr<CursorDecoder> cursor_decoder_;
+    std::unique_ptr<desktop::Frame> frame_;
+    std::shared_ptr<desktop::MouseCursor> mouse_cursor_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionPlayer);
+};
+
+} // namespace codec
+
+#endif // CODEC__SESSION_PLAYER_H
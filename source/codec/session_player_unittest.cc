@@ -0,0 +1,283 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/session_player.h"
+#include "codec/cursor_encoder.h"
+#include "codec/session_recorder.h"
+#include "codec/video_encoder_zstd.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "desktop/mouse_cursor.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace codec {
+
+namespace {
+
+// The number of key frames and the number of the changed frames after each key frame.
+const int kKeyFrameCount = 3;
+const int kFramesPerKeyFrame = 3;
+
+std::unique_ptr<desktop::MouseCursor> createCursor(uint8_t value)
+{
+    const desktop::Size size(32, 32);
+    const size_t data_size = size.width() * size.height() * 4;
+
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(data_size);
+    memset(data.get(), value, data_size);
+
+    return std::make_unique<desktop::MouseCursor>(std::move(data), size, desktop::Point(1, 2));
+}
+
+// The state of the client after a recorded message.
+struct ClientState
+{
+    std::vector<uint8_t> frame;
+    uint8_t cursor;
+};
+
+class Recording
+{
+public:
+    explicit Recording(const std::filesystem::path& file_path)
+        : file_path_(file_path),
+          host_frame_(desktop::FrameAligned::create(
+              desktop::Size(640, 480), desktop::PixelFormat::ARGB(), 32))
+    {
+        std::unique_ptr<SessionRecorder> recorder = SessionRecorder::create(file_path_);
+        EXPECT_TRUE(recorder);
+        if (!recorder)
+            return;
+
+        std::unique_ptr<VideoEncoderZstd> video_encoder(
+            VideoEncoderZstd::create(desktop::PixelFormat::ARGB(), 6));
+        CursorEncoder cursor_encoder;
+
+        drawRect(desktop::Rect::makeSize(host_frame_->size()));
+
+        uint8_t cursor = 0;
+
+        for (int i = 0; i < kKeyFrameCount; ++i)
+        {
+            // The first two cursors are added to the cache and the third is taken from it.
+            cursor = (i % 2) ? 0x40 : 0x80;
+
+            proto::desktop::HostToClient message;
+            EXPECT_TRUE(cursor_encoder.encode(createCursor(cursor),
+                                              message.mutable_cursor_shape()));
+            addMessage(recorder.get(), message, cursor);
+
+            video_encoder->requestKeyFrame();
+
+            for (int j = 0; j <= kFramesPerKeyFrame; ++j)
+            {
+                drawRandomRect();
+
+                message.Clear();
+                video_encoder->encode(host_frame_.get(), message.mutable_video_packet());
+                host_frame_->updatedRegion()->clear();
+
+                EXPECT_EQ(message.video_packet().has_format(), j == 0);
+                addMessage(recorder.get(), message, cursor);
+            }
+        }
+
+        recorder->finish();
+    }
+
+    ~Recording()
+    {
+        std::error_code ignored_error;
+        std::filesystem::remove(file_path_, ignored_error);
+    }
+
+    const std::vector<ClientState>& states() const { return states_; }
+
+private:
+    void drawRandomRect()
+    {
+        const desktop::Size& size = host_frame_->size();
+        drawRect(desktop::Rect::makeXYWH(
+            random_() % (size.width() / 2), random_() % (size.height() / 2),
+            1 + random_() % (size.width() / 2), 1 + random_() % (size.height() / 2)));
+    }
+
+    void drawRect(const desktop::Rect& rect)
+    {
+        // The alpha channel is not sent.
+        const uint32_t color = random_() & 0xFFFFFF;
+
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            uint32_t* row =
+                reinterpret_cast<uint32_t*>(host_frame_->frameDataAtPos(rect.left(), y));
+            std::fill(row, row + rect.width(), color);
+        }
+
+        host_frame_->updatedRegion()->addRect(rect);
+    }
+
+    void addMessage(SessionRecorder* recorder, const proto::desktop::HostToClient& message,
+                    uint8_t cursor)
+    {
+        // The messages must have different times, so the player can seek to each of them.
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        const std::string serialized = message.SerializeAsString();
+        recorder->addMessage(reinterpret_cast<const uint8_t*>(serialized.data()),
+                             serialized.size());
+
+        const uint8_t* frame_data = host_frame_->frameData();
+        states_.push_back({ std::vector<uint8_t>(
+            frame_data, frame_data + host_frame_->stride() * host_frame_->size().height()),
+            cursor });
+    }
+
+    const std::filesystem::path file_path_;
+    std::mt19937 random_;
+    std::unique_ptr<desktop::Frame> host_frame_;
+    std::vector<ClientState> states_;
+
+    DISALLOW_COPY_AND_ASSIGN(Recording);
+};
+
+void expectState(const SessionPlayer& player, const ClientState& state)
+{
+    ASSERT_TRUE(player.frame());
+    ASSERT_TRUE(player.mouseCursor());
+
+    const desktop::Frame* frame = player.frame();
+    ASSERT_EQ(frame->stride() * frame->size().height(), static_cast<int>(state.frame.size()));
+    EXPECT_EQ(memcmp(frame->frameData(), state.frame.data(), state.frame.size()), 0);
+
+    const desktop::MouseCursor* cursor = player.mouseCursor().get();
+    EXPECT_EQ(cursor->size(), desktop::Size(32, 32));
+    EXPECT_EQ(cursor->hotSpot(), desktop::Point(1, 2));
+    EXPECT_EQ(cursor->data()[0], state.cursor);
+}
+
+// Plays the whole recording and returns the times of the messages.
+std::vector<std::chrono::milliseconds> play(SessionPlayer* player,
+                                            const std::vector<ClientState>& states)
+{
+    std::vector<std::chrono::milliseconds> positions;
+
+    while (player->readNextMessage())
+    {
+        EXPECT_LT(positions.size(), states.size());
+        if (positions.size() >= states.size())
+            break;
+
+        if (!positions.empty())
+            EXPECT_GT(player->position(), positions.back());
+
+        positions.push_back(player->position());
+
+        // The first message contains only the cursor.
+        if (positions.size() > 1)
+            expectState(*player, states[positions.size() - 1]);
+    }
+
+    return positions;
+}
+
+} // namespace
+
+TEST(session_player_test, play_and_seek)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_session_player_test.rec";
+
+    const Recording recording(file_path);
+    const std::vector<ClientState>& states = recording.states();
+
+    std::unique_ptr<SessionPlayer> player = SessionPlayer::open(file_path);
+    ASSERT_TRUE(player);
+    EXPECT_EQ(player->keyPointCount(), static_cast<size_t>(kKeyFrameCount));
+
+    const std::vector<std::chrono::milliseconds> positions = play(player.get(), states);
+    ASSERT_EQ(positions.size(), states.size());
+    EXPECT_EQ(player->duration(), positions.back());
+
+    // Seeking backward and forward restores the frame and the cursor from the key points.
+    for (size_t i : { states.size() - 1, size_t(kFramesPerKeyFrame + 3), size_t(3),
+                      states.size() - 2 })
+    {
+        ASSERT_TRUE(player->seek(positions[i])) << i;
+        EXPECT_EQ(player->position(), positions[i]);
+        expectState(*player, states[i]);
+    }
+
+    // The playback continues after the seek.
+    ASSERT_TRUE(player->seek(positions[2]));
+    ASSERT_TRUE(player->readNextMessage());
+    EXPECT_EQ(player->position(), positions[3]);
+    expectState(*player, states[3]);
+}
+
+TEST(session_player_test, interrupted_recording)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_session_player_interrupted.rec";
+
+    const Recording recording(file_path);
+    const std::vector<ClientState>& states = recording.states();
+
+    // The index and the trailer are not written and the last message is incomplete.
+    const uintmax_t index_size = sizeof(session_file::RecordHeader) +
+        kKeyFrameCount * sizeof(session_file::IndexEntry) + sizeof(session_file::FileTrailer);
+    std::filesystem::resize_file(file_path, std::filesystem::file_size(file_path) - index_size - 1);
+
+    std::unique_ptr<SessionPlayer> player = SessionPlayer::open(file_path);
+    ASSERT_TRUE(player);
+
+    // The index is restored from the records.
+    EXPECT_EQ(player->keyPointCount(), static_cast<size_t>(kKeyFrameCount));
+
+    const std::vector<std::chrono::milliseconds> positions = play(player.get(), states);
+    ASSERT_EQ(positions.size(), states.size() - 1);
+    EXPECT_EQ(player->duration(), positions.back());
+
+    ASSERT_TRUE(player->seek(positions[kFramesPerKeyFrame + 3]));
+    expectState(*player, states[kFramesPerKeyFrame + 3]);
+}
+
+TEST(session_player_test, invalid_file)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_session_player_invalid.rec";
+
+    {
+        std::ofstream file_stream(file_path, std::ofstream::binary);
+        file_stream << "not a recording";
+    }
+
+    EXPECT_FALSE(SessionPlayer::open(file_path));
+    EXPECT_FALSE(SessionPlayer::open(file_path / "missing"));
+
+    std::error_code ignored_error;
+    std::filesystem::remove(file_path, ignored_error);
+}
+
+} // namespace codec
@@ -0,0 +1,263 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/session_recorder.h"
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace codec {
+
+namespace {
+
+const uint32_t kCursorCacheIndexMask = 0x1F;
+
+} // namespace
+
+SessionRecorder::SessionRecorder(std::ofstream&& file_stream)
+    : file_stream_(std::move(file_stream)),
+      start_time_(std::chrono::steady_clock::now())
+{
+    const session_file::FileHeader header = { session_file::kFileMagic, session_file::kVersion };
+
+    file_stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    offset_ = sizeof(header);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    finish();
+}
+
+// static
+std::unique_ptr<SessionRecorder> SessionRecorder::create(const std::filesystem::path& file_path)
+{
+    std::ofstream file_stream;
+
+    file_stream.open(file_path, std::ofstream::binary | std::ofstream::trunc);
+    if (!file_stream.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to create recording file: " << file_path;
+        return nullptr;
+    }
+
+    return std::unique_ptr<SessionRecorder>(new SessionRecorder(std::move(file_stream)));
+}
+
+void SessionRecorder::addMessage(const uint8_t* data, size_t size)
+{
+    if (!file_stream_.is_open())
+        return;
+
+    message_.Clear();
+
+    if (!message_.ParseFromArray(data, static_cast<int>(size)))
+    {
+        LOG(LS_WARNING) << "Invalid message";
+        return;
+    }
+
+    if (!message_.has_video_packet() && !message_.has_cursor_shape())
+        return;
+
+    last_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_).count();
+
+    // A packet with the format contains the whole frame and it can be decoded by a new decoder.
+    if (message_.video_packet().has_format())
+        writeKeyPoint(last_time_);
+
+    if (message_.has_cursor_shape())
+        updateCursorCache(message_.cursor_shape());
+
+    writeRecord(session_file::MESSAGE, last_time_, data, size);
+}
+
+void SessionRecorder::finish()
+{
+    if (!file_stream_.is_open())
+        return;
+
+    const uint64_t index_offset = offset_;
+
+    writeRecord(session_file::INDEX, last_time_,
+                index_.data(), index_.size() * sizeof(session_file::IndexEntry));
+
+    const session_file::FileTrailer trailer = { index_offset, session_file::kIndexMagic };
+    file_stream_.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+    file_stream_.close();
+}
+
+void SessionRecorder::writeRecord(
+    session_file::RecordType type, int64_t time, const void* data, size_t size)
+{
+    const session_file::RecordHeader header = { type, static_cast<uint32_t>(size), time };
+
+    file_stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_stream_.write(reinterpret_cast<const char*>(data), size);
+
+    if (file_stream_.fail())
+    {
+        LOG(LS_WARNING) << "Unable to write recording file. Recording stopped";
+        file_stream_.close();
+        return;
+    }
+
+    offset_ += sizeof(header) + size;
+}
+
+void SessionRecorder::writeKeyPoint(int64_t time)
+{
+    key_point_buffer_.clear();
+
+    auto append_shape = [this](const proto::desktop::CursorShape& cursor_shape)
+    {
+        const std::string serialized = cursor_shape.SerializeAsString();
+        const uint32_t size = static_cast<uint32_t>(serialized.size());
+
+        key_point_buffer_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        key_point_buffer_.append(serialized);
+    };
+
+    // The cached images are sent again in the same order, so a new decoder gets the same cache
+    // and the cache indexes in the following messages remain valid.
+    for (size_t i = 0; i < cursor_cache_.size(); ++i)
+    {
+        proto::desktop::CursorShape cursor_shape(cursor_cache_[i]);
+
+        cursor_shape.clear_cache_size();
+        cursor_shape.clear_cache_index();
+
+        if (i != 0)
+        {
+            cursor_shape.set_flags(0);
+        }
+        else if (large_cursor_cache_)
+        {
+            cursor_shape.set_flags(proto::desktop::CursorShape::RESET_CACHE);
+            cursor_shape.set_cache_size(static_cast<uint32_t>(cursor_cache_size_));
+        }
+        else
+        {
+            cursor_shape.set_flags(proto::desktop::CursorShape::RESET_CACHE |
+                                   static_cast<uint32_t>(cursor_cache_size_));
+        }
+
+        append_shape(cursor_shape);
+    }
+
+    // The FIFO cache needs only the current cursor. For the LRU cache, the order of use is
+    // restored, so the same cursors are evicted later.
+    const size_t first_used = (large_cursor_cache_ || cursor_order_.empty()) ?
+        0 : cursor_order_.size() - 1;
+
+    for (size_t i = first_used; i < cursor_order_.size(); ++i)
+    {
+        proto::desktop::CursorShape cursor_shape;
+
+        if (large_cursor_cache_)
+        {
+            cursor_shape.set_flags(proto::desktop::CursorShape::CACHE);
+            cursor_shape.set_cache_index(static_cast<uint32_t>(cursor_order_[i]));
+        }
+        else
+        {
+            cursor_shape.set_flags(proto::desktop::CursorShape::CACHE |
+                                   static_cast<uint32_t>(cursor_order_[i]));
+        }
+
+        append_shape(cursor_shape);
+    }
+
+    index_.push_back({ time, offset_ });
+
+    writeRecord(session_file::KEY_POINT, time, key_point_buffer_.data(), key_point_buffer_.size());
+}
+
+void SessionRecorder::updateCursorCache(const proto::desktop::CursorShape& cursor_shape)
+{
+    // Repeats the changes of the cache of the cursor decoder.
+    if (cursor_shape.flags() & proto::desktop::CursorShape::CACHE)
+    {
+        const size_t index = large_cursor_cache_ ?
+            cursor_shape.cache_index() : (cursor_shape.flags() & kCursorCacheIndexMask);
+
+        if (index < cursor_cache_.size())
+            touchCursor(index);
+        return;
+    }
+
+    if (cursor_shape.flags() & proto::desktop::CursorShape::RESET_CACHE)
+    {
+        cursor_cache_.clear();
+        cursor_order_.clear();
+        cursor_cache_size_ = cursor_shape.flags() & kCursorCacheIndexMask;
+        large_cursor_cache_ = (cursor_cache_size_ == 0);
+
+        if (large_cursor_cache_)
+            cursor_cache_size_ = cursor_shape.cache_size();
+    }
+
+    if (!cursor_cache_size_)
+        return;
+
+    if (large_cursor_cache_)
+    {
+        // The least recently used cursor is replaced.
+        size_t index = cursor_cache_.size();
+
+        if (index < cursor_cache_size_)
+        {
+            cursor_cache_.push_back(cursor_shape);
+        }
+        else
+        {
+            index = cursor_order_.front();
+            cursor_cache_[index] = cursor_shape;
+        }
+
+        touchCursor(index);
+        return;
+    }
+
+    cursor_cache_.push_back(cursor_shape);
+
+    if (cursor_cache_.size() > cursor_cache_size_)
+        cursor_cache_.pop_front();
+
+    // Only the current cursor is tracked for the FIFO cache.
+    cursor_order_.assign(1, cursor_cache_.size() - 1);
+}
+
+void SessionRecorder::touchCursor(size_t index)
+{
+    if (!large_cursor_cache_)
+    {
+        cursor_order_.assign(1, index);
+        return;
+    }
+
+    auto it = std::find(cursor_order_.begin(), cursor_order_.end(), index);
+    if (it != cursor_order_.end())
+        cursor_order_.erase(it);
+
+    cursor_order_.push_back(index);
+}
+
+} // namespace codec
@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__SESSION_RECORDER_H
+#define CODEC__SESSION_RECORDER_H
+
+#include "base/macros_magic.h"
+#include "codec/session_file.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace codec {
+
+// Writes the messages sent to the client (video packets and cursor shapes) to the session
+// recording file without decoding or encoding them again. The file can be played with
+// SessionPlayer. See session_file.h for the file layout.
+class SessionRecorder
+{
+public:
+    ~SessionRecorder();
+
+    // While recording, the host should send key frames with this interval. The recording can be
+    // played only from the key frames.
+    static constexpr std::chrono::seconds kKeyFrameInterval{ 10 };
+
+    static std::unique_ptr<SessionRecorder> create(const std::filesystem::path& file_path);
+
+    // Adds the serialized proto::desktop::HostToClient message. The messages without video
+    // packets and cursor shapes are skipped.
+    void addMessage(const uint8_t* data, size_t size);
+
+    // Writes the index of the key points. After this call, the messages are not added anymore.
+    void finish();
+
+private:
+    explicit SessionRecorder(std::ofstream&& file_stream);
+
+    void writeRecord(session_file::RecordType type, int64_t time, const void* data, size_t size);
+    void writeKeyPoint(int64_t time);
+    void updateCursorCache(const proto::desktop::CursorShape& cursor_shape);
+    void touchCursor(size_t index);
+
+    std::ofstream file_stream_;
+    uint64_t offset_ = 0;
+
+    const std::chrono::steady_clock::time_point start_time_;
+    int64_t last_time_ = 0;
+
+    std::vector<session_file::IndexEntry> index_;
+    proto::desktop::HostToClient message_;
+
+    // The cursor images in the cache of the client and the order of their use (the current
+    // cursor is the last). They are written at each key point, so the cursor decoder can be
+    // restored without the previous messages.
+    std::deque<proto::desktop::CursorShape> cursor_cache_;
+    std::vector<size_t> cursor_order_;
+    size_t cursor_cache_size_ = 0;
+    bool large_cursor_cache_ = false;
+    std::string key_point_buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionRecorder);
+};
+
+} // namespace codec
+
+#endif // CODEC__SESSION_RECORDER_H
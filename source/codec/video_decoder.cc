@@ -17,6 +17,8 @@
 //
 
 #include "codec/video_decoder.h"
+#include "codec/video_decoder_av1.h"
+#include "codec/video_decoder_hybrid.h"
 #include "codec/video_decoder_vpx.h"
 #include "codec/video_decoder_zstd.h"
 
@@ -36,6 +38,12 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::desktop::VideoEncoding
         case proto::desktop::VIDEO_ENCODING_VP9:
             return VideoDecoderVPX::createVP9();
 
+        case proto::desktop::VIDEO_ENCODING_HYBRID:
+            return VideoDecoderHybrid::create();
+
+        case proto::desktop::VIDEO_ENCODING_AV1:
+            return VideoDecoderAV1::create();
+
         default:
             return nullptr;
     }
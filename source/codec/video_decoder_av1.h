@@ -0,0 +1,47 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_DECODER_AV1_H
+#define CODEC__VIDEO_DECODER_AV1_H
+
+#include "base/macros_magic.h"
+#include "codec/scoped_aom_codec.h"
+#include "codec/video_decoder.h"
+
+namespace codec {
+
+class VideoDecoderAV1 : public VideoDecoder
+{
+public:
+    ~VideoDecoderAV1() = default;
+
+    static std::unique_ptr<VideoDecoderAV1> create();
+
+    bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame) override;
+
+private:
+    VideoDecoderAV1();
+
+    ScopedAomCodec codec_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderAV1);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_DECODER_AV1_H
@@ -0,0 +1,62 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_decoder_hybrid.h"
+#include "base/logging.h"
+#include "codec/video_decoder_vpx.h"
+#include "codec/video_decoder_zstd.h"
+
+namespace codec {
+
+VideoDecoderHybrid::VideoDecoderHybrid()
+    : lossless_decoder_(VideoDecoderZstd::create()),
+      video_decoder_(VideoDecoderVPX::createVP9())
+{
+    // Nothing
+}
+
+VideoDecoderHybrid::~VideoDecoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoDecoderHybrid> VideoDecoderHybrid::create()
+{
+    return std::unique_ptr<VideoDecoderHybrid>(new VideoDecoderHybrid());
+}
+
+bool VideoDecoderHybrid::decode(const proto::desktop::VideoPacket& packet,
+                                desktop::Frame* frame)
+{
+    if (!lossless_decoder_->decode(packet, frame))
+        return false;
+
+    if (!packet.has_video_layer())
+        return true;
+
+    const proto::desktop::VideoPacket& video_layer = packet.video_layer();
+
+    if (video_layer.encoding() != proto::desktop::VIDEO_ENCODING_VP9 ||
+        video_layer.has_video_layer())
+    {
+        LOG(LS_WARNING) << "Invalid video layer";
+        return false;
+    }
+
+    return video_decoder_->decode(video_layer, frame);
+}
+
+} // namespace codec
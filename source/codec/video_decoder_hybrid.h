@@ -0,0 +1,51 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_DECODER_HYBRID_H
+#define CODEC__VIDEO_DECODER_HYBRID_H
+
+#include "base/macros_magic.h"
+#include "codec/video_decoder.h"
+
+namespace codec {
+
+class VideoDecoderVPX;
+class VideoDecoderZstd;
+
+// Decodes the packets of VideoEncoderHybrid. The VP9 layer is drawn over the lossless part.
+class VideoDecoderHybrid : public VideoDecoder
+{
+public:
+    ~VideoDecoderHybrid();
+
+    static std::unique_ptr<VideoDecoderHybrid> create();
+
+    bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame) override;
+
+private:
+    VideoDecoderHybrid();
+
+    std::unique_ptr<VideoDecoderZstd> lossless_decoder_;
+    std::unique_ptr<VideoDecoderVPX> video_decoder_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderHybrid);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_DECODER_HYBRID_H
@@ -18,22 +18,31 @@
 
 #include "codec/video_decoder_vpx.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "codec/video_util.h"
 #include "desktop/desktop_frame.h"
 
 #include <libyuv/convert_from.h>
 #include <libyuv/convert_argb.h>
 
+#include <algorithm>
+
 namespace codec {
 
 namespace {
 
+// The encoder uses up to 8 VP9 tile columns, which are decoded in parallel.
+const int kMaxThreadCount = 8;
+
 bool convertImage(const proto::desktop::VideoPacket& packet,
                   vpx_image_t* image,
                   desktop::Frame* frame)
 {
-    if (image->fmt != VPX_IMG_FMT_I420)
+    if (image->fmt != VPX_IMG_FMT_I420 && image->fmt != VPX_IMG_FMT_I444)
+    {
+        LOG(LS_WARNING) << "Unsupported image format: " << image->fmt;
         return false;
+    }
 
     desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
 
@@ -55,15 +64,31 @@ bool convertImage(const proto::desktop::VideoPacket& packet,
         }
 
         int y_offset = y_stride * rect.y() + rect.x();
-        int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
-
-        libyuv::I420ToARGB(y_data + y_offset, y_stride,
-                           u_data + uv_offset, uv_stride,
-                           v_data + uv_offset, uv_stride,
-                           frame->frameDataAtPos(rect.topLeft()),
-                           frame->stride(),
-                           rect.width(),
-                           rect.height());
+
+        if (image->fmt == VPX_IMG_FMT_I444)
+        {
+            int uv_offset = uv_stride * rect.y() + rect.x();
+
+            libyuv::I444ToARGB(y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               rect.width(),
+                               rect.height());
+        }
+        else
+        {
+            int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
+            libyuv::I420ToARGB(y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               rect.width(),
+                               rect.height());
+        }
     }
 
     return true;
@@ -93,7 +118,7 @@ VideoDecoderVPX::VideoDecoderVPX(proto::desktop::VideoEncoding encoding)
 
     config.w = 0;
     config.h = 0;
-    config.threads = 2;
+    config.threads = std::min(base::ThreadPool::hardwareConcurrency(), kMaxThreadCount);
 
     vpx_codec_iface_t* algo;
 
@@ -114,10 +139,25 @@ VideoDecoderVPX::VideoDecoderVPX(proto::desktop::VideoEncoding encoding)
 
     int ret = vpx_codec_dec_init(codec_.get(), algo, &config, 0);
     CHECK_EQ(ret, VPX_CODEC_OK);
+
+    if (encoding == proto::desktop::VIDEO_ENCODING_VP9)
+    {
+        // The threads also share the rows of the tiles, so the frames with fewer tile columns than
+        // threads are decoded in parallel too.
+        ret = vpx_codec_control(codec_.get(), VP9D_SET_ROW_MT, 1);
+        DCHECK_EQ(ret, VPX_CODEC_OK);
+    }
 }
 
 bool VideoDecoderVPX::decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame)
 {
+    // The reference frames of the codec can not be moved.
+    if (packet.copy_rect_size())
+    {
+        LOG(LS_WARNING) << "Copy rects are not supported by VPX decoder";
+        return false;
+    }
+
     // Do the actual decoding.
     vpx_codec_err_t ret =
         vpx_codec_decode(codec_.get(),
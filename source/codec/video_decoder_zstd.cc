@@ -17,19 +17,34 @@
 //
 
 #include "codec/video_decoder_zstd.h"
+#include "base/aligned_memory.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
+#include "codec/pixel_palette.h"
 #include "codec/pixel_translator.h"
 #include "codec/video_util.h"
+#include "codec/zstd_dictionary.h"
 #include "desktop/desktop_frame_aligned.h"
+#include "desktop/tile_cache.h"
+
+#include <algorithm>
+#include <atomic>
 
 namespace codec {
 
+namespace {
+
+const int kMaxThreadCount = 4;
+
+} // namespace
+
 VideoDecoderZstd::VideoDecoderZstd()
-    : stream_(ZSTD_createDStream())
 {
-    // Nothing
+    streams_.emplace_back(ZSTD_createDStream());
 }
 
+VideoDecoderZstd::~VideoDecoderZstd() = default;
+
 // static
 std::unique_ptr<VideoDecoderZstd> VideoDecoderZstd::create()
 {
@@ -43,60 +58,285 @@ bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
     {
         const proto::desktop::VideoPacketFormat& format = packet.format();
 
-        source_frame_ = desktop::FrameAligned::create(
-            desktop::Size(format.screen_rect().width(), format.screen_rect().height()),
-            VideoUtil::fromVideoPixelFormat(format.pixel_format()), 32);
+        const desktop::Size size(format.screen_rect().width(), format.screen_rect().height());
+        const desktop::PixelFormat pixel_format =
+            VideoUtil::fromVideoPixelFormat(format.pixel_format());
+
+        const size_t previous_size_class = source_frame_ ?
+            base::AlignedMemoryPool::blockSizeClass(source_frame_->frameData()) : 0;
+
+        source_frame_ = desktop::FrameAligned::create(size, pixel_format, 32);
+
+        // The blocks of the previous resolution or format are not requested anymore.
+        if (previous_size_class &&
+            previous_size_class != base::AlignedMemoryPool::blockSizeClass(
+                source_frame_->frameData()))
+        {
+            base::AlignedMemoryPool::instance()->trim(previous_size_class);
+        }
 
         translator_ = PixelTranslator::create(source_frame_->format(), target_frame->format());
     }
 
-    DCHECK(source_frame_->size() == target_frame->size());
-
     if (!source_frame_ || !translator_)
     {
         LOG(LS_WARNING) << "A packet with image information was not received";
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    DCHECK(source_frame_->size() == target_frame->size());
 
     desktop::Rect frame_rect = desktop::Rect::makeSize(source_frame_->size());
-    ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
 
-    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    // The moved areas are applied before the changed rectangles.
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
     {
-        desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(i));
+        const proto::desktop::CopyRect& copy_rect = packet.copy_rect(i);
+
+        desktop::Rect dest_rect = VideoUtil::fromVideoRect(copy_rect.dest_rect());
+        desktop::Point source_pos(copy_rect.source_x(), copy_rect.source_y());
+
+        if (!frame_rect.containsRect(dest_rect) ||
+            !frame_rect.containsRect(desktop::Rect::makeXYWH(source_pos, dest_rect.size())))
+        {
+            LOG(LS_WARNING) << "The copy rectangle is outside the screen area";
+            return false;
+        }
+
+        source_frame_->movePixels(source_pos, dest_rect);
+        target_frame->movePixels(source_pos, dest_rect);
+    }
+
+    if (packet.tile_cache_size() && !tile_store_.reset(packet.tile_cache_size()))
+        return false;
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::desktop::CacheTile& tile = packet.cached_tile(i);
+        const desktop::Point pos(tile.x(), tile.y());
+
+        if (!tile_store_.restore(tile.slot(), pos, source_frame_.get()))
+            return false;
+
+        translator_->translate(source_frame_->frameDataAtPos(pos),
+                               source_frame_->stride(),
+                               target_frame->frameDataAtPos(pos),
+                               target_frame->stride(),
+                               desktop::TileCache::kTileSize,
+                               desktop::TileCache::kTileSize);
+    }
+
+    if (packet.filter() == proto::desktop::VIDEO_FILTER_DELTA && packet.has_format())
+    {
+        LOG(LS_WARNING) << "The delta filter is used for the new frame";
+        return false;
+    }
+
+    if (packet.filter() > proto::desktop::VIDEO_FILTER_DELTA)
+    {
+        LOG(LS_WARNING) << "Unsupported filter: " << packet.filter();
+        return false;
+    }
+
+    if (packet.palette_size_size() && packet.palette_size_size() != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Invalid number of palettes";
+        return false;
+    }
 
-        if (!frame_rect.containsRect(rect))
+    for (uint32_t palette_size : packet.palette_size())
+    {
+        if (palette_size > PixelPalette::kMaxSize)
+        {
+            LOG(LS_WARNING) << "Invalid palette size: " << palette_size;
+            return false;
+        }
+    }
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        if (!frame_rect.containsRect(VideoUtil::fromVideoRect(packet.dirty_rect(i))))
         {
             LOG(LS_WARNING) << "The rectangle is outside the screen area";
             return false;
         }
+    }
+
+    if (packet.data_tile_size())
+    {
+        // The tiles use the streams independently.
+        stream_started_ = false;
+
+        if (!decodeTiles(packet, target_frame))
+            return false;
+    }
+    else if (packet.dirty_rect_size())
+    {
+        ZSTD_DStream* stream = streams_.front().get();
+
+        if (!packet.continue_stream())
+        {
+            if (!selectDictionary(packet.data()))
+                return false;
+
+            resetStream(stream);
+            stream_started_ = true;
+        }
+        else if (!stream_started_)
+        {
+            LOG(LS_WARNING) << "The packet continues the stream which was not started";
+            return false;
+        }
+
+        ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
+
+        if (!decodeRects(packet, 0, packet.dirty_rect_size(), stream, &input, target_frame))
+        {
+            stream_started_ = false;
+            return false;
+        }
+    }
+
+    // The tiles are stored after all changes of the frame are applied.
+    for (int i = 0; i < packet.stored_tile_size(); ++i)
+    {
+        const proto::desktop::CacheTile& tile = packet.stored_tile(i);
+
+        if (!tile_store_.store(tile.slot(), desktop::Point(tile.x(), tile.y()), *source_frame_))
+            return false;
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::selectDictionary(const std::string& data)
+{
+    // The frame header contains the ID of the dictionary used by the encoder.
+    const uint32_t dictionary_id = ZSTD_getDictID_fromFrame(data.data(), data.size());
+
+    if (!dictionary_id)
+    {
+        dictionary_.reset();
+        ddict_.reset();
+        return true;
+    }
+
+    if (dictionary_ && dictionary_->id() == dictionary_id)
+        return true;
+
+    dictionary_ = ZstdDictionaryStore::instance()->find(dictionary_id);
+    if (!dictionary_)
+    {
+        LOG(LS_WARNING) << "Dictionary not found: " << dictionary_id;
+        ddict_.reset();
+        return false;
+    }
+
+    ddict_.reset(ZSTD_createDDict(dictionary_->data().data(), dictionary_->data().size()));
+    return true;
+}
+
+void VideoDecoderZstd::resetStream(ZSTD_DStream* stream)
+{
+    size_t ret = ZSTD_DCtx_reset(stream, ZSTD_reset_session_and_parameters);
+    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+    if (ddict_)
+    {
+        ret = ZSTD_DCtx_refDDict(stream, ddict_.get());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+}
+
+// static
+bool VideoDecoderZstd::decompress(ZSTD_DStream* stream,
+                                  ZSTD_inBuffer* input,
+                                  uint8_t* data,
+                                  size_t size)
+{
+    ZSTD_outBuffer output = { data, size, 0 };
+
+    while (output.pos < output.size)
+    {
+        size_t ret = ZSTD_decompressStream(stream, &output, input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (output.pos < output.size && input->pos == input->size)
+        {
+            LOG(LS_WARNING) << "Not enough data for the rectangle";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::decodeRects(const proto::desktop::VideoPacket& packet,
+                                   int first_rect,
+                                   int rect_count,
+                                   ZSTD_DStream* stream,
+                                   ZSTD_inBuffer* input,
+                                   desktop::Frame* target_frame)
+{
+    const int bytes_per_pixel = source_frame_->format().bytesPerPixel();
+    const bool delta = packet.filter() == proto::desktop::VIDEO_FILTER_DELTA;
+
+    PixelPalette palette(bytes_per_pixel);
+    uint8_t colors[PixelPalette::kMaxSize * 4];
+
+    // The packed rows of the palettes and the rows of the delta filter are decompressed here.
+    std::vector<uint8_t> row;
+
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
+    {
+        desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(i));
 
         uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
-        const size_t output_size = rect.width() * source_frame_->format().bytesPerPixel();
+        const size_t output_size = rect.width() * bytes_per_pixel;
+        const int palette_size = packet.palette_size_size() ? packet.palette_size(i) : 0;
 
-        ZSTD_outBuffer output = { output_data, output_size, 0 };
-        int row_y = 0;
+        if (palette_size)
+        {
+            if (!decompress(stream, input, colors, palette_size * bytes_per_pixel))
+                return false;
 
-        while (row_y < rect.height())
+            palette.setColors(colors, palette_size);
+            row.resize(PixelPalette::packedRowSize(
+                rect.width(), PixelPalette::bitsPerIndex(palette_size)));
+        }
+        else if (delta)
         {
-            ret = ZSTD_decompressStream(stream_.get(), &output, &input);
-            if (ZSTD_isError(ret))
+            row.resize(output_size);
+        }
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            if (palette_size)
             {
-                LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
-                return false;
+                if (!decompress(stream, input, row.data(), row.size()))
+                    return false;
+
+                palette.unpackRow(row.data(), rect.width(), output_data);
             }
+            else if (delta)
+            {
+                if (!decompress(stream, input, row.data(), output_size))
+                    return false;
 
-            // If we completely unpacked the row in the rectangle.
-            if (output.pos == output.size)
+                for (size_t x = 0; x < output_size; ++x)
+                    output_data[x] += row[x];
+            }
+            else
             {
-                ++row_y;
-                output_data += source_frame_->stride();
-                output.dst = output_data;
-                output.pos = 0;
+                if (!decompress(stream, input, output_data, output_size))
+                    return false;
             }
+
+            output_data += source_frame_->stride();
         }
 
         translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
@@ -110,4 +350,85 @@ bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
     return true;
 }
 
+bool VideoDecoderZstd::decodeTiles(const proto::desktop::VideoPacket& packet,
+                                   desktop::Frame* target_frame)
+{
+    const int tile_count = packet.data_tile_size();
+    const size_t data_size = packet.data().size();
+
+    int64_t rect_count = 0;
+
+    for (int i = 0; i < tile_count; ++i)
+    {
+        const size_t begin = packet.data_tile(i).offset();
+        const size_t end = (i + 1 < tile_count) ? packet.data_tile(i + 1).offset() : data_size;
+
+        if (begin > end || end > data_size)
+        {
+            LOG(LS_WARNING) << "Invalid tile offset";
+            return false;
+        }
+
+        rect_count += packet.data_tile(i).rect_count();
+    }
+
+    if (rect_count != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Invalid number of rectangles in the tiles";
+        return false;
+    }
+
+    // The tasks write the rectangles of different tiles at the same time.
+    if (tile_count > 1 && VideoUtil::hasOverlappingRects(packet))
+    {
+        LOG(LS_WARNING) << "The rectangles of the tiles overlap";
+        return false;
+    }
+
+    if (!thread_pool_)
+    {
+        thread_pool_ = std::make_unique<base::ThreadPool>(
+            std::min(base::ThreadPool::hardwareConcurrency(), kMaxThreadCount));
+    }
+
+    if (!selectDictionary(packet.data()))
+        return false;
+
+    const int task_count = std::min(thread_pool_->threadCount(), tile_count);
+
+    while (streams_.size() < static_cast<size_t>(task_count))
+        streams_.emplace_back(ZSTD_createDStream());
+
+    std::vector<int> first_rects(tile_count);
+    for (int i = 1; i < tile_count; ++i)
+        first_rects[i] = first_rects[i - 1] + packet.data_tile(i - 1).rect_count();
+
+    std::atomic_bool failed = false;
+
+    // Each task uses its own stream and decompresses every |task_count|-th tile. The dirty rects
+    // are checked above not to overlap, so the tiles are written to the frames independently.
+    thread_pool_->run(task_count, [&](int index)
+    {
+        ZSTD_DStream* stream = streams_[index].get();
+
+        for (int i = index; i < tile_count && !failed; i += task_count)
+        {
+            const size_t begin = packet.data_tile(i).offset();
+            const size_t end =
+                (i + 1 < tile_count) ? packet.data_tile(i + 1).offset() : data_size;
+
+            resetStream(stream);
+            ZSTD_inBuffer input = { packet.data().data() + begin, end - begin, 0 };
+
+            if (!decodeRects(packet, first_rects[i], packet.data_tile(i).rect_count(),
+                             stream, &input, target_frame))
+            {
+                failed = true;
+            }
+        }
+    });
+
+    return !failed;
+}
+
 } // namespace codec
@@ -22,15 +22,23 @@
 #include "base/macros_magic.h"
 #include "codec/scoped_zstd_stream.h"
 #include "codec/video_decoder.h"
+#include "desktop/tile_store.h"
+
+#include <vector>
+
+namespace base {
+class ThreadPool;
+} // namespace base
 
 namespace codec {
 
 class PixelTranslator;
+class ZstdDictionary;
 
 class VideoDecoderZstd : public VideoDecoder
 {
 public:
-    ~VideoDecoderZstd() = default;
+    ~VideoDecoderZstd();
 
     static std::unique_ptr<VideoDecoderZstd> create();
 
@@ -39,10 +47,40 @@ public:
 private:
     VideoDecoderZstd();
 
-    ScopedZstdDStream stream_;
+    // Finds the dictionary by the ID in the frame header of |data|. The dictionary is used by the
+    // streams reset after the call.
+    bool selectDictionary(const std::string& data);
+    void resetStream(ZSTD_DStream* stream);
+
+    // Decompresses exactly |size| bytes from |input|.
+    static bool decompress(ZSTD_DStream* stream,
+                           ZSTD_inBuffer* input,
+                           uint8_t* data,
+                           size_t size);
+
+    // Decompresses |rect_count| dirty rects of |packet| starting from |first_rect| and
+    // translates them to |target_frame|.
+    bool decodeRects(const proto::desktop::VideoPacket& packet,
+                     int first_rect,
+                     int rect_count,
+                     ZSTD_DStream* stream,
+                     ZSTD_inBuffer* input,
+                     desktop::Frame* target_frame);
+    bool decodeTiles(const proto::desktop::VideoPacket& packet, desktop::Frame* target_frame);
+
+    // The first stream is used for the packets without tiles.
+    std::vector<ScopedZstdDStream> streams_;
+    std::unique_ptr<base::ThreadPool> thread_pool_;
+
+    std::shared_ptr<const ZstdDictionary> dictionary_;
+    ScopedZstdDDict ddict_;
+
+    // True if the packets can continue the stream of the previous packet.
+    bool stream_started_ = false;
 
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<desktop::Frame> source_frame_;
+    desktop::TileStore tile_store_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
@@ -27,9 +27,13 @@ void VideoEncoder::fillPacketInfo(proto::desktop::VideoEncoding encoding,
 {
     packet->set_encoding(encoding);
 
-    if (screen_settings_tracker_.isRectChanged(
-        desktop::Rect::makeXYWH(frame->topLeft(), frame->size())))
+    const bool rect_changed = screen_settings_tracker_.isRectChanged(
+        desktop::Rect::makeXYWH(frame->topLeft(), frame->size()));
+
+    if (rect_changed || key_frame_requested_)
     {
+        key_frame_requested_ = false;
+
         proto::desktop::Rect* rect = packet->mutable_format()->mutable_screen_rect();
 
         rect->set_x(frame->topLeft().x());
@@ -35,6 +35,20 @@ public:
 
     virtual void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) = 0;
 
+    // The next packet will contain the format and the whole frame, so it can be decoded without
+    // the previous packets. The frame is encoded even if it has no updated region.
+    void requestKeyFrame() { key_frame_requested_ = true; }
+    bool isKeyFrameRequested() const { return key_frame_requested_; }
+
+    // Returns true if the encoder has to send the areas which are not in the updated region, for
+    // example the lossless image of the areas sent lossy before. The frame is encoded even if it
+    // has no updated region.
+    virtual bool hasPendingRefresh() const { return false; }
+
+    // Sets the bitrate which the outgoing channel can carry, in kilobits per second. The encoders
+    // without the rate control ignore it.
+    virtual void setTargetBitrate(uint32_t /* kbps */) {}
+
 protected:
     void fillPacketInfo(proto::desktop::VideoEncoding encoding,
                         const desktop::Frame* frame,
@@ -42,6 +56,7 @@ protected:
 
 private:
     desktop::ScreenSettingsTracker screen_settings_tracker_;
+    bool key_frame_requested_ = false;
 };
 
 } // namespace codec
@@ -0,0 +1,304 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_av1.h"
+#include "base/logging.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+
+#include <libyuv/convert.h>
+#include <libyuv/convert_from_argb.h>
+
+#include <algorithm>
+
+namespace codec {
+
+namespace {
+
+// The active map of libaom consists of 16x16 blocks.
+const int kMacroBlockSize = 16;
+
+// The loop filters of AV1 use up to 8 pixels around a changed pixel (see VideoEncoderVPX).
+const int kPadding = 8;
+
+// Limits for the target bitrate in kilobits per second.
+const uint32_t kMinBitrate = 100;
+const uint32_t kMaxBitrate = 100000;
+
+// The quantizers are limited the same way as in the real time mode of WebRTC.
+const unsigned int kMinQuantizer = 10;
+const unsigned int kMaxQuantizer = 56;
+
+// The real time mode uses the speeds from 5 to 10. The higher speeds use less CPU and produce
+// larger frames.
+const int kCpuUsed = 8;
+
+// Magic encoder constant for adaptive quantization strategy.
+const int kAqModeCyclicRefresh = 3;
+
+desktop::Rect alignRect(const desktop::Rect& rect)
+{
+    return desktop::Rect::makeLTRB(rect.left() & ~1, rect.top() & ~1,
+                                   (rect.right() + 1) & ~1, (rect.bottom() + 1) & ~1);
+}
+
+} // namespace
+
+VideoEncoderAV1::VideoEncoderAV1()
+{
+    memset(&config_, 0, sizeof(config_));
+    memset(&active_map_, 0, sizeof(active_map_));
+}
+
+// static
+VideoEncoderAV1* VideoEncoderAV1::create()
+{
+    return new VideoEncoderAV1();
+}
+
+void VideoEncoderAV1::createCodec(const desktop::Size& size)
+{
+    codec_.reset(new aom_codec_ctx_t());
+
+    memset(&config_, 0, sizeof(config_));
+
+    aom_codec_iface_t* algo = aom_codec_av1_cx();
+
+    aom_codec_err_t ret = aom_codec_enc_config_default(algo, &config_, AOM_USAGE_REALTIME);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    // Use millisecond granularity time base.
+    config_.g_timebase.num = 1;
+    config_.g_timebase.den = 1000;
+
+    config_.g_w = size.width();
+    config_.g_h = size.height();
+    config_.g_pass = AOM_RC_ONE_PASS;
+    config_.g_threads = VideoUtil::encoderThreadCount(size);
+
+    // Start emitting packets immediately.
+    config_.g_lag_in_frames = 0;
+
+    // The transport layer is reliable, so the key frames are sent only when the format changes.
+    config_.kf_mode = AOM_KF_DISABLED;
+
+    config_.rc_end_usage = AOM_CBR;
+    config_.rc_min_quantizer = kMinQuantizer;
+    config_.rc_max_quantizer = kMaxQuantizer;
+
+    // Until the speed of the channel is estimated set the target bitrate to a conservative
+    // default.
+    config_.rc_target_bitrate = std::clamp(target_bitrate_ ? target_bitrate_ : 500,
+                                           kMinBitrate, kMaxBitrate);
+
+    ret = aom_codec_enc_init(codec_.get(), algo, &config_, 0);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AOME_SET_CPUUSED, kCpuUsed);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    // The screen content tuning enables the palette mode and the intra block copy in the
+    // bitstream. The tools are also enabled explicitly, because the speed presets may turn them
+    // off.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_TUNE_CONTENT, AOM_CONTENT_SCREEN);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_PALETTE, 1);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_INTRABC, 1);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    // The cyclic refresh improves the quality of the static areas over time.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_AQ_MODE, kAqModeCyclicRefresh);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_TILE_COLUMNS,
+                            VideoUtil::tileColumnsLog2(static_cast<int>(config_.g_threads)));
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ROW_MT, 1);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+}
+
+void VideoEncoderAV1::createActiveMap(const desktop::Size& size)
+{
+    active_map_.cols = (size.width() + kMacroBlockSize - 1) / kMacroBlockSize;
+    active_map_.rows = (size.height() + kMacroBlockSize - 1) / kMacroBlockSize;
+    active_map_size_ = active_map_.cols * active_map_.rows;
+    active_map_buffer_ = std::make_unique<uint8_t[]>(active_map_size_);
+
+    memset(active_map_buffer_.get(), 0, active_map_size_);
+    active_map_.active_map = active_map_buffer_.get();
+}
+
+void VideoEncoderAV1::setActiveMap(const desktop::Rect& rect)
+{
+    const int left   = rect.left() / kMacroBlockSize;
+    const int top    = rect.top() / kMacroBlockSize;
+    const int right  = (rect.right() - 1) / kMacroBlockSize;
+    const int bottom = (rect.bottom() - 1) / kMacroBlockSize;
+
+    uint8_t* map = active_map_.active_map + top * active_map_.cols;
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        memset(map + left, 1, right - left + 1);
+        map += active_map_.cols;
+    }
+}
+
+void VideoEncoderAV1::prepareImageAndActiveMap(const desktop::Frame* frame,
+                                               const desktop::Region& region,
+                                               proto::desktop::VideoPacket* packet)
+{
+    desktop::Region updated_region;
+
+    // The padded rectangles have even coordinates, as the conversion to I420 requires.
+    for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        updated_region.addRect(
+            alignRect(desktop::Rect::makeLTRB(rect.left() - kPadding, rect.top() - kPadding,
+                                              rect.right() + kPadding, rect.bottom() + kPadding)));
+    }
+
+    updated_region.intersectWith(desktop::Rect::makeSize(frame->size()));
+
+    memset(active_map_.active_map, 0, active_map_size_);
+
+    const int y_stride = image_->stride[AOM_PLANE_Y];
+    const int uv_stride = image_->stride[AOM_PLANE_U];
+    uint8_t* y_data = image_->planes[AOM_PLANE_Y];
+    uint8_t* u_data = image_->planes[AOM_PLANE_U];
+    uint8_t* v_data = image_->planes[AOM_PLANE_V];
+
+    const int bits_per_pixel = frame->format().bitsPerPixel();
+
+    for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        const int y_offset = y_stride * rect.y() + rect.x();
+        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
+        if (bits_per_pixel == 32)
+        {
+            libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               rect.width(),
+                               rect.height());
+        }
+        else if (bits_per_pixel == 16)
+        {
+            libyuv::RGB565ToI420(frame->frameDataAtPos(rect.topLeft()),
+                                 frame->stride(),
+                                 y_data + y_offset, y_stride,
+                                 u_data + uv_offset, uv_stride,
+                                 v_data + uv_offset, uv_stride,
+                                 rect.width(),
+                                 rect.height());
+        }
+        else
+        {
+            NOTREACHED();
+        }
+
+        VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
+        setActiveMap(rect);
+    }
+}
+
+void VideoEncoderAV1::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
+{
+    fillPacketInfo(proto::desktop::VIDEO_ENCODING_AV1, frame, packet);
+
+    desktop::Region region = frame->constUpdatedRegion();
+
+    // The codec and the image are created again when the format changes, so the whole frame is
+    // encoded.
+    if (packet->has_format())
+    {
+        const desktop::Size& screen_size = frame->size();
+
+        image_.reset(aom_img_alloc(nullptr, AOM_IMG_FMT_I420,
+                                   screen_size.width(), screen_size.height(), 32));
+        createActiveMap(screen_size);
+        createCodec(screen_size);
+
+        start_time_ = std::chrono::steady_clock::now();
+        last_pts_ = -1;
+
+        region.setRect(desktop::Rect::makeSize(screen_size));
+    }
+
+    prepareImageAndActiveMap(frame, region, packet);
+
+    aom_codec_err_t ret = aom_codec_control(codec_.get(), AOME_SET_ACTIVEMAP, &active_map_);
+    DCHECK_EQ(ret, AOM_CODEC_OK);
+
+    // The timestamps are in milliseconds and must increase.
+    const aom_codec_pts_t pts = std::max<aom_codec_pts_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time_).count(),
+        last_pts_ + 1);
+
+    const unsigned long duration = static_cast<unsigned long>(pts - last_pts_);
+    last_pts_ = pts;
+
+    ret = aom_codec_encode(codec_.get(), image_.get(), pts, duration, 0);
+    DCHECK_EQ(ret, AOM_CODEC_OK);
+
+    aom_codec_iter_t iter = nullptr;
+
+    while (true)
+    {
+        const aom_codec_cx_pkt_t* pkt = aom_codec_get_cx_data(codec_.get(), &iter);
+        if (!pkt)
+            break;
+
+        if (pkt->kind == AOM_CODEC_CX_FRAME_PKT)
+        {
+            packet->set_data(pkt->data.frame.buf, pkt->data.frame.sz);
+            break;
+        }
+    }
+}
+
+void VideoEncoderAV1::setTargetBitrate(uint32_t kbps)
+{
+    if (kbps == target_bitrate_)
+        return;
+
+    target_bitrate_ = kbps;
+
+    // The codec is created with the current bitrate when the first frame is encoded.
+    if (!codec_)
+        return;
+
+    config_.rc_target_bitrate = std::clamp(target_bitrate_, kMinBitrate, kMaxBitrate);
+
+    aom_codec_err_t ret = aom_codec_enc_config_set(codec_.get(), &config_);
+    DCHECK_EQ(ret, AOM_CODEC_OK);
+}
+
+} // namespace codec
@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_ENCODER_AV1_H
+#define CODEC__VIDEO_ENCODER_AV1_H
+
+#include "base/macros_magic.h"
+#include "codec/scoped_aom_codec.h"
+#include "codec/video_encoder.h"
+
+#include <aom/aom_encoder.h>
+#include <aom/aomcx.h>
+
+#include <chrono>
+
+namespace desktop {
+class Region;
+} // namespace desktop
+
+namespace codec {
+
+// Encodes the frames with libaom in the real time mode. The screen content tools (the palette
+// mode and the intra block copy) are enabled. Like VideoEncoderVPX, only the updated region is
+// converted and the rest of the frame is marked inactive in the active map.
+class VideoEncoderAV1 : public VideoEncoder
+{
+public:
+    ~VideoEncoderAV1() = default;
+
+    static VideoEncoderAV1* create();
+
+    void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
+    void setTargetBitrate(uint32_t kbps) override;
+
+private:
+    VideoEncoderAV1();
+
+    void createCodec(const desktop::Size& size);
+    void createActiveMap(const desktop::Size& size);
+    void prepareImageAndActiveMap(const desktop::Frame* frame,
+                                  const desktop::Region& region,
+                                  proto::desktop::VideoPacket* packet);
+    void setActiveMap(const desktop::Rect& rect);
+
+    ScopedAomCodec codec_;
+    aom_codec_enc_cfg_t config_;
+
+    // The bitrate is changed at runtime. Zero until the speed of the channel is known.
+    uint32_t target_bitrate_ = 0;
+
+    std::chrono::steady_clock::time_point start_time_;
+    aom_codec_pts_t last_pts_ = 0;
+
+    size_t active_map_size_ = 0;
+
+    aom_active_map_t active_map_;
+    std::unique_ptr<uint8_t[]> active_map_buffer_;
+
+    ScopedAomImage image_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderAV1);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_ENCODER_AV1_H
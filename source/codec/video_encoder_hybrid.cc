@@ -0,0 +1,84 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_hybrid.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd.h"
+#include "desktop/desktop_frame.h"
+
+namespace codec {
+
+VideoEncoderHybrid::VideoEncoderHybrid(const desktop::PixelFormat& target_format,
+                                       int compression_ratio)
+    : lossless_encoder_(VideoEncoderZstd::create(target_format, compression_ratio)),
+      video_encoder_(VideoEncoderVPX::createVP9())
+{
+    // Nothing
+}
+
+VideoEncoderHybrid::~VideoEncoderHybrid() = default;
+
+// static
+VideoEncoderHybrid* VideoEncoderHybrid::create(const desktop::PixelFormat& target_format,
+                                               int compression_ratio)
+{
+    return new VideoEncoderHybrid(target_format, compression_ratio);
+}
+
+void VideoEncoderHybrid::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
+{
+    fillPacketInfo(proto::desktop::VIDEO_ENCODING_HYBRID, frame, packet);
+
+    lossless_region_ = frame->constUpdatedRegion();
+    video_region_.clear();
+
+    if (packet->has_format())
+    {
+        // The client creates a new frame, so the whole frame is sent losslessly. The VP9 codec
+        // starts with a key frame the next time it is used.
+        classifier_.reset();
+        lossless_encoder_->requestKeyFrame();
+        video_encoder_->requestKeyFrame();
+    }
+    else
+    {
+        classifier_.classify(frame, &lossless_region_, &video_region_);
+    }
+
+    lossless_encoder_->encodeRegion(frame, lossless_region_, packet);
+
+    // The lossless encoder sets its own encoding.
+    packet->set_encoding(proto::desktop::VIDEO_ENCODING_HYBRID);
+
+    if (!video_region_.isEmpty())
+        video_encoder_->encodeRegion(frame, video_region_, packet->mutable_video_layer());
+}
+
+void VideoEncoderHybrid::setTargetBitrate(uint32_t kbps)
+{
+    video_encoder_->setTargetBitrate(kbps);
+}
+
+bool VideoEncoderHybrid::hasPendingRefresh() const
+{
+    // The video blocks become lossless only after they stop changing, even if the whole screen
+    // does not change anymore.
+    return classifier_.hasVideoBlocks();
+}
+
+} // namespace codec
@@ -0,0 +1,69 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_ENCODER_HYBRID_H
+#define CODEC__VIDEO_ENCODER_HYBRID_H
+
+#include "base/macros_magic.h"
+#include "codec/video_encoder.h"
+#include "desktop/content_classifier.h"
+#include "desktop/pixel_format.h"
+
+#include <memory>
+
+namespace codec {
+
+class VideoEncoderVPX;
+class VideoEncoderZstd;
+
+// Sends the video areas of the screen (see desktop::ContentClassifier) with VP9 and the rest of
+// the screen losslessly with ZSTD. The packet contains the ZSTD part in its own fields and the
+// VP9 part in |video_layer|.
+class VideoEncoderHybrid : public VideoEncoder
+{
+public:
+    ~VideoEncoderHybrid();
+
+    static VideoEncoderHybrid* create(
+        const desktop::PixelFormat& target_format, int compression_ratio);
+
+    // The encoder of the lossless part. It is configured the same way as the ZSTD encoder, except
+    // the tile cache and the copy rects which must stay disabled: the client has lossy or stale
+    // pixels in the video areas, and the move detector does not see the changes there.
+    VideoEncoderZstd* losslessEncoder() { return lossless_encoder_.get(); }
+
+    void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
+    void setTargetBitrate(uint32_t kbps) override;
+    bool hasPendingRefresh() const override;
+
+private:
+    VideoEncoderHybrid(const desktop::PixelFormat& target_format, int compression_ratio);
+
+    std::unique_ptr<VideoEncoderZstd> lossless_encoder_;
+    std::unique_ptr<VideoEncoderVPX> video_encoder_;
+    desktop::ContentClassifier classifier_;
+
+    desktop::Region lossless_region_;
+    desktop::Region video_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderHybrid);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_ENCODER_HYBRID_H
@@ -24,7 +24,7 @@
 #include <libyuv/convert.h>
 #include <libyuv/convert_from_argb.h>
 
-#include <thread>
+#include <algorithm>
 
 namespace codec {
 
@@ -33,13 +33,38 @@ namespace {
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
-// Magic encoder profile numbers for I444 input formats.
+// Magic encoder profile numbers for I420 and I444 input formats.
 const int kVp9I420ProfileNumber = 0;
+const int kVp9I444ProfileNumber = 1;
 
 // Magic encoder constant for adaptive quantization strategy.
 const int kVp9AqModeCyclicRefresh = 3;
 
-void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size& size)
+// Limits for the target bitrate in kilobits per second.
+const uint32_t kMinBitrate = 100;
+const uint32_t kMaxBitrate = 100000;
+
+struct QuantizerRange
+{
+    double min_bits_per_pixel;
+    unsigned int min_quantizer;
+    unsigned int max_quantizer;
+};
+
+// Quantizer ranges for the bitrate per pixel of the screen per second. At a low bitrate the rate
+// control needs the coarse quantizers to keep the bitrate, and at a high bitrate the fine ones
+// make the text sharper.
+const QuantizerRange kQuantizerRanges[] =
+{
+    { 8.0, 4,  24 },
+    { 2.0, 10, 30 },
+    { 0.5, 20, 40 },
+    { 0.0, 30, 56 }
+};
+
+void setCommonCodecParameters(vpx_codec_enc_cfg_t* config,
+                              const desktop::Size& size,
+                              int thread_count)
 {
     // Use millisecond granularity time base.
     config->g_timebase.num = 1;
@@ -58,17 +83,39 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size&
     config->kf_min_dist = 10000;
     config->kf_max_dist = 10000;
 
-    // Using 2 threads gives a great boost in performance for most systems with
-    // adequate processing power. NB: Going to multiple threads on low end
-    // windows systems can really hurt performance.
-    // http://crbug.com/99179
-    config->g_threads = (std::thread::hardware_concurrency() > 2) ? 2 : 1;
+    config->g_threads = thread_count;
+}
+
+void setRateControlParameters(vpx_codec_enc_cfg_t* config, uint32_t target_bitrate)
+{
+    config->rc_target_bitrate = std::clamp(target_bitrate, kMinBitrate, kMaxBitrate);
+
+    const double bits_per_pixel = config->rc_target_bitrate * 1000.0 /
+        (static_cast<double>(config->g_w) * static_cast<double>(config->g_h));
+
+    for (const QuantizerRange& range : kQuantizerRanges)
+    {
+        if (bits_per_pixel >= range.min_bits_per_pixel)
+        {
+            config->rc_min_quantizer = range.min_quantizer;
+            config->rc_max_quantizer = range.max_quantizer;
+            break;
+        }
+    }
 }
 
 void createImage(const desktop::Size& size,
+                 bool i444,
                  std::unique_ptr<vpx_image_t>* out_image,
-                 std::unique_ptr<uint8_t[]>* out_image_buffer)
+                 std::unique_ptr<uint8_t[], base::AlignedPoolDeleter>* out_image_buffer)
 {
+    const size_t previous_size_class = *out_image_buffer ?
+        base::AlignedMemoryPool::blockSizeClass(out_image_buffer->get()) : 0;
+
+    // The previous buffer is returned to the pool first, so it can be reused if the size class
+    // is the same.
+    out_image_buffer->reset();
+
     std::unique_ptr<vpx_image_t> image = std::make_unique<vpx_image_t>();
 
     memset(image.get(), 0, sizeof(vpx_image_t));
@@ -76,9 +123,18 @@ void createImage(const desktop::Size& size,
     image->d_w = image->w = size.width();
     image->d_h = image->h = size.height();
 
-    image->fmt = VPX_IMG_FMT_YV12;
-    image->x_chroma_shift = 1;
-    image->y_chroma_shift = 1;
+    if (i444)
+    {
+        image->fmt = VPX_IMG_FMT_I444;
+        image->x_chroma_shift = 0;
+        image->y_chroma_shift = 0;
+    }
+    else
+    {
+        image->fmt = VPX_IMG_FMT_YV12;
+        image->x_chroma_shift = 1;
+        image->y_chroma_shift = 1;
+    }
 
     // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
     // planes' strides to multiples of 16 bytes.
@@ -98,7 +154,8 @@ void createImage(const desktop::Size& size,
     // Allocate a YUV buffer large enough for the aligned data & padding.
     const int buffer_size = y_stride * y_rows + (2 * uv_stride) * uv_rows;
 
-    std::unique_ptr<uint8_t[]> image_buffer = std::make_unique<uint8_t[]>(buffer_size);
+    std::unique_ptr<uint8_t[], base::AlignedPoolDeleter> image_buffer(static_cast<uint8_t*>(
+        base::AlignedMemoryPool::instance()->allocate(buffer_size, 32)));
 
     // Reset image value to 128 so we just need to fill in the y plane.
     memset(image_buffer.get(), 128, buffer_size);
@@ -113,6 +170,13 @@ void createImage(const desktop::Size& size,
 
     *out_image = std::move(image);
     *out_image_buffer = std::move(image_buffer);
+
+    // The blocks of the previous resolution or format are not requested anymore.
+    if (previous_size_class &&
+        previous_size_class != base::AlignedMemoryPool::blockSizeClass(out_image_buffer->get()))
+    {
+        base::AlignedMemoryPool::instance()->trim(previous_size_class);
+    }
 }
 
 int roundToTwosMultiple(int x)
@@ -147,10 +211,39 @@ VideoEncoderVPX* VideoEncoderVPX::createVP9()
 VideoEncoderVPX::VideoEncoderVPX(proto::desktop::VideoEncoding encoding)
     : encoding_(encoding)
 {
+    memset(&config_, 0, sizeof(config_));
     memset(&active_map_, 0, sizeof(active_map_));
     memset(&image_, 0, sizeof(image_));
 }
 
+void VideoEncoderVPX::setThreadCount(int thread_count)
+{
+    DCHECK_GE(thread_count, kAutoThreadCount);
+    thread_count_ = thread_count;
+}
+
+void VideoEncoderVPX::setI444Enabled(bool enable)
+{
+    DCHECK_EQ(encoding_, proto::desktop::VIDEO_ENCODING_VP9);
+    DCHECK(!codec_);
+    i444_enabled_ = enable;
+}
+
+void VideoEncoderVPX::setLosslessEnabled(bool enable)
+{
+    DCHECK_EQ(encoding_, proto::desktop::VIDEO_ENCODING_VP9);
+    DCHECK(!codec_);
+    lossless_enabled_ = enable;
+}
+
+int VideoEncoderVPX::threadCount(const desktop::Size& size) const
+{
+    if (thread_count_ == kAutoThreadCount)
+        return VideoUtil::encoderThreadCount(size);
+
+    return thread_count_;
+}
+
 void VideoEncoderVPX::createActiveMap(const desktop::Size& size)
 {
     active_map_.cols = (size.width() + kMacroBlockSize - 1) / kMacroBlockSize;
@@ -166,29 +259,33 @@ void VideoEncoderVPX::createVp8Codec(const desktop::Size& size)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
-    vpx_codec_enc_cfg_t config = { 0 };
+    memset(&config_, 0, sizeof(config_));
 
     // Configure the encoder.
     vpx_codec_iface_t* algo = vpx_codec_vp8_cx();
 
-    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config, 0);
+    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Adjust default target bit-rate to account for actual desktop size.
-    config.rc_target_bitrate = size.width() * size.height() *
-        config.rc_target_bitrate / config.g_w / config.g_h;
+    config_.rc_target_bitrate = size.width() * size.height() *
+        config_.rc_target_bitrate / config_.g_w / config_.g_h;
 
-    setCommonCodecParameters(&config, size);
+    setCommonCodecParameters(&config_, size, threadCount(size));
 
     // Value of 2 means using the real time profile. This is basically a redundant option since we
     // explicitly select real time mode when doing encoding.
-    config.g_profile = 2;
+    config_.g_profile = 2;
 
     // Clamping the quantizer constrains the worst-case quality and CPU usage.
-    config.rc_min_quantizer = 20;
-    config.rc_max_quantizer = 30;
+    config_.rc_min_quantizer = 20;
+    config_.rc_max_quantizer = 30;
+    config_.rc_end_usage = VPX_CBR;
 
-    ret = vpx_codec_enc_init(codec_.get(), algo, &config, 0);
+    if (target_bitrate_)
+        setRateControlParameters(&config_, target_bitrate_);
+
+    ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Value of 16 will have the smallest CPU load. This turns off subpixel motion search.
@@ -208,32 +305,50 @@ void VideoEncoderVPX::createVp9Codec(const desktop::Size& size)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
-    vpx_codec_enc_cfg_t config = { 0 };
+    memset(&config_, 0, sizeof(config_));
 
     // Configure the encoder.
     vpx_codec_iface_t* algo = vpx_codec_vp9_cx();
 
-    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config, 0);
+    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
-    setCommonCodecParameters(&config, size);
+    setCommonCodecParameters(&config_, size, threadCount(size));
+
+    // Configure VP9 for I420 or I444 source frames.
+    config_.g_profile =
+        (image_->fmt == VPX_IMG_FMT_I444) ? kVp9I444ProfileNumber : kVp9I420ProfileNumber;
 
-    // Configure VP9 for I420 source frames.
-    config.g_profile = kVp9I420ProfileNumber;
-    config.rc_min_quantizer = 20;
-    config.rc_max_quantizer = 30;
-    config.rc_end_usage = VPX_CBR;
+    if (lossless_enabled_)
+    {
+        // The lossless mode ignores the bitrate.
+        config_.rc_min_quantizer = 0;
+        config_.rc_max_quantizer = 0;
+        config_.rc_end_usage = VPX_VBR;
+    }
+    else
+    {
+        config_.rc_min_quantizer = 20;
+        config_.rc_max_quantizer = 30;
+        config_.rc_end_usage = VPX_CBR;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config.rc_target_bitrate = 500;
+        // Until the speed of the channel is estimated set the target bitrate to a conservative
+        // default.
+        config_.rc_target_bitrate = 500;
+
+        if (target_bitrate_)
+            setRateControlParameters(&config_, target_bitrate_);
+    }
 
-    ret = vpx_codec_enc_init(codec_.get(), algo, &config, 0);
+    ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Request the lowest-CPU usage that VP9 supports, which depends on whether we are encoding
     // lossy or lossless.
-    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, 6);
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, lossless_enabled_ ? 5 : 6);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_LOSSLESS, lossless_enabled_ ? 1 : 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     ret = vpx_codec_control(codec_.get(), VP9E_SET_TUNE_CONTENT, VP9E_CONTENT_SCREEN);
@@ -245,7 +360,17 @@ void VideoEncoderVPX::createVp9Codec(const desktop::Size& size)
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Set cyclic refresh (aka "top-off") only for lossy encoding.
-    ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE, kVp9AqModeCyclicRefresh);
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE,
+                            lossless_enabled_ ? 0 : kVp9AqModeCyclicRefresh);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    // The tile columns are encoded in parallel, and the row based multithreading lets the threads
+    // also share the rows of a tile. The client decodes the tile columns in parallel as well.
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS,
+                            VideoUtil::tileColumnsLog2(static_cast<int>(config_.g_threads)));
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_ROW_MT, 1);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 }
 
@@ -269,13 +394,15 @@ void VideoEncoderVPX::setActiveMap(const desktop::Rect& rect)
     }
 }
 
-void VideoEncoderVPX::prepareImageAndActiveMap(
-    const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
+void VideoEncoderVPX::prepareImageAndActiveMap(const desktop::Frame* frame,
+                                               const desktop::Region& region,
+                                               bool exact_region,
+                                               proto::desktop::VideoPacket* packet)
 {
     const int padding = ((encoding_ == proto::desktop::VIDEO_ENCODING_VP9) ? 8 : 3);
     desktop::Region updated_region;
 
-    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
     {
         const desktop::Rect& rect = it.rect();
 
@@ -293,7 +420,8 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
     // Clip back to the screen dimensions, in case they're not macroblock aligned. The conversion
     // routines don't require even width & height, so this is safe even if the source dimensions
     // are not even.
-    updated_region.intersectWith(desktop::Rect::makeWH(image_->w, image_->h));
+    const desktop::Rect image_rect = desktop::Rect::makeWH(image_->w, image_->h);
+    updated_region.intersectWith(image_rect);
 
     memset(active_map_.active_map, 0, active_map_size_);
 
@@ -310,9 +438,23 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
         const desktop::Rect& rect = it.rect();
 
         const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+        const int uv_offset = uv_stride * (rect.y() >> image_->y_chroma_shift) +
+            (rect.x() >> image_->x_chroma_shift);
 
-        if (bits_per_pixel == 32)
+        if (image_->fmt == VPX_IMG_FMT_I444)
+        {
+            // The image is created in I444 format only for the 32 bit frames.
+            DCHECK_EQ(bits_per_pixel, 32);
+
+            libyuv::ARGBToI444(frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               rect.width(),
+                               rect.height());
+        }
+        else if (bits_per_pixel == 32)
         {
             libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
                                frame->stride(),
@@ -337,20 +479,60 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
             NOTREACHED();
         }
 
-        VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
+        if (!exact_region)
+            VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
+
         setActiveMap(rect);
     }
+
+    if (exact_region)
+    {
+        // The conversion to ARGB on the client requires even top-left coordinates.
+        desktop::Region dirty_region;
+
+        for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            dirty_region.addRect(alignRect(it.rect()));
+
+        dirty_region.intersectWith(image_rect);
+
+        for (desktop::Region::Iterator it(dirty_region); !it.isAtEnd(); it.advance())
+            VideoUtil::toVideoRect(it.rect(), packet->add_dirty_rect());
+    }
 }
 
 void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
 {
     fillPacketInfo(encoding_, frame, packet);
 
+    // The codec and the image are created again when the format changes, so the whole frame is
+    // encoded.
+    if (packet->has_format())
+        encodeImage(frame, desktop::Region(desktop::Rect::makeSize(frame->size())), false, packet);
+    else
+        encodeImage(frame, frame->constUpdatedRegion(), false, packet);
+}
+
+void VideoEncoderVPX::encodeRegion(const desktop::Frame* frame,
+                                   const desktop::Region& region,
+                                   proto::desktop::VideoPacket* packet)
+{
+    fillPacketInfo(encoding_, frame, packet);
+    encodeImage(frame, region, true, packet);
+}
+
+void VideoEncoderVPX::encodeImage(const desktop::Frame* frame,
+                                  const desktop::Region& region,
+                                  bool exact_region,
+                                  proto::desktop::VideoPacket* packet)
+{
     if (packet->has_format())
     {
         const desktop::Size& screen_size = frame->size();
 
-        createImage(screen_size, &image_, &image_buffer_);
+        // libyuv has no conversion from RGB565 to I444.
+        const bool i444 = i444_enabled_ && frame->format().bitsPerPixel() == 32;
+
+        createImage(screen_size, i444, &image_, &image_buffer_);
         createActiveMap(screen_size);
 
         if (encoding_ == proto::desktop::VIDEO_ENCODING_VP8)
@@ -362,18 +544,30 @@ void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::desktop::VideoP
             DCHECK_EQ(encoding_, proto::desktop::VIDEO_ENCODING_VP9);
             createVp9Codec(screen_size);
         }
+
+        start_time_ = std::chrono::steady_clock::now();
+        last_pts_ = -1;
     }
 
     // Convert the updated capture data ready for encode.
     // Update active map based on updated region.
-    prepareImageAndActiveMap(frame, packet);
+    prepareImageAndActiveMap(frame, region, exact_region, packet);
 
     // Apply active map to the encoder.
     vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
     DCHECK_EQ(ret, VPX_CODEC_OK);
 
+    // The timestamps are in milliseconds and must increase.
+    const vpx_codec_pts_t pts = std::max<vpx_codec_pts_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time_).count(),
+        last_pts_ + 1);
+
+    const unsigned long duration = static_cast<unsigned long>(pts - last_pts_);
+    last_pts_ = pts;
+
     // Do the actual encoding.
-    ret = vpx_codec_encode(codec_.get(), image_.get(), 0, 1, 0, VPX_DL_REALTIME);
+    ret = vpx_codec_encode(codec_.get(), image_.get(), pts, duration, 0, VPX_DL_REALTIME);
     DCHECK_EQ(ret, VPX_CODEC_OK);
 
     // Read the encoded data.
@@ -393,4 +587,21 @@ void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::desktop::VideoP
     }
 }
 
+void VideoEncoderVPX::setTargetBitrate(uint32_t kbps)
+{
+    if (kbps == target_bitrate_)
+        return;
+
+    target_bitrate_ = kbps;
+
+    // The codec is created with the current bitrate when the first frame is encoded.
+    if (!codec_ || lossless_enabled_)
+        return;
+
+    setRateControlParameters(&config_, target_bitrate_);
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    DCHECK_EQ(ret, VPX_CODEC_OK);
+}
+
 } // namespace codec
@@ -19,14 +19,18 @@
 #ifndef CODEC__VIDEO_ENCODER_VPX_H
 #define CODEC__VIDEO_ENCODER_VPX_H
 
+#include "base/aligned_memory.h"
 #include "base/macros_magic.h"
 #include "codec/scoped_vpx_codec.h"
 #include "codec/video_encoder.h"
+#include "desktop/desktop_region.h"
 
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
 
+#include <chrono>
+
 namespace codec {
 
 class VideoEncoderVPX : public VideoEncoder
@@ -34,23 +38,74 @@ class VideoEncoderVPX : public VideoEncoder
 public:
     ~VideoEncoderVPX() = default;
 
+    // Passing this value to setThreadCount() selects the number of threads depending on the
+    // size of the screen and the number of the processor cores.
+    static const int kAutoThreadCount = 0;
+
     static VideoEncoderVPX* createVP8();
     static VideoEncoderVPX* createVP9();
 
     void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
 
+    // Encodes |region| of the frame instead of its updated region. Unlike encode(), only the
+    // region is sent together with the format, and the rest of the frame is left to the other
+    // codec (see VideoEncoderHybrid). The dirty rects of the packet do not include the padding
+    // around the region.
+    void encodeRegion(const desktop::Frame* frame,
+                      const desktop::Region& region,
+                      proto::desktop::VideoPacket* packet);
+    void setTargetBitrate(uint32_t kbps) override;
+
+    // Sets the number of the encoder threads. For VP9 it also sets the number of the tile
+    // columns. Applied when the codec is created, i.e. with the next frame that has the format.
+    void setThreadCount(int thread_count);
+
+    // Encodes the chroma planes in full resolution (VP9 profile 1), so colored text and thin
+    // lines keep their colors. Used only for the 32 bit frames. Only for VP9, and must be called
+    // before the first frame is encoded.
+    void setI444Enabled(bool enable);
+
+    // Encodes the frames without losses and ignores the target bitrate. Without I444 the chroma
+    // planes are still subsampled. Only for VP9, and must be called before the first frame is
+    // encoded.
+    void setLosslessEnabled(bool enable);
+
 private:
     VideoEncoderVPX(proto::desktop::VideoEncoding encoding);
 
+    int threadCount(const desktop::Size& size) const;
     void createActiveMap(const desktop::Size& size);
     void createVp8Codec(const desktop::Size& size);
     void createVp9Codec(const desktop::Size& size);
-    void prepareImageAndActiveMap(const desktop::Frame* frame, proto::desktop::VideoPacket* packet);
+
+    // The rectangles of |region| are padded for the loop filters. If |exact_region| is true, the
+    // dirty rects of the packet cover only |region| (aligned to even coordinates), so the client
+    // does not overwrite the pixels around it which are sent by the other codec.
+    void prepareImageAndActiveMap(const desktop::Frame* frame,
+                                  const desktop::Region& region,
+                                  bool exact_region,
+                                  proto::desktop::VideoPacket* packet);
+    void encodeImage(const desktop::Frame* frame,
+                     const desktop::Region& region,
+                     bool exact_region,
+                     proto::desktop::VideoPacket* packet);
     void setActiveMap(const desktop::Rect& rect);
 
     const proto::desktop::VideoEncoding encoding_;
 
     ScopedVpxCodec codec_ = nullptr;
+    vpx_codec_enc_cfg_t config_;
+
+    // The bitrate is changed at runtime. Zero until the speed of the channel is known.
+    uint32_t target_bitrate_ = 0;
+
+    int thread_count_ = kAutoThreadCount;
+    bool i444_enabled_ = false;
+    bool lossless_enabled_ = false;
+
+    // The timestamps of the frames let the rate control distribute the bitrate between them.
+    std::chrono::steady_clock::time_point start_time_;
+    vpx_codec_pts_t last_pts_ = 0;
 
     size_t active_map_size_ = 0;
 
@@ -59,7 +114,7 @@ private:
 
     // VPX image and buffer to hold the actual YUV planes.
     std::unique_ptr<vpx_image_t> image_;
-    std::unique_ptr<uint8_t[]> image_buffer_;
+    std::unique_ptr<uint8_t[], base::AlignedPoolDeleter> image_buffer_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderVPX);
 };
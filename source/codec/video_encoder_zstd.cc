@@ -18,14 +18,31 @@
 
 #include "codec/video_encoder_zstd.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
+#include "codec/pixel_palette.h"
 #include "codec/pixel_translator.h"
 #include "codec/video_util.h"
-#include "desktop/desktop_frame.h"
+#include "codec/zstd_dictionary.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <algorithm>
 
 namespace codec {
 
 namespace {
 
+// The number of 64x64 tiles in the tile cache (8 MB for 32 bit pixels).
+const size_t kTileCacheSize = 512;
+
+// The updated area is compressed in tiles of about this size (in the pixel format of the client).
+// The smaller tiles are compressed worse.
+const size_t kTileSize = 256 * 1024;
+
+const int kMaxAutoThreadCount = 4;
+
+// Every n-th row of the changed rectangles is used to choose the filter.
+const int kFilterEstimateRowStep = 4;
+
 // Retrieves a pointer to the output buffer in |update| used for storing the
 // encoded rectangle data. Will resize the buffer to |size|.
 uint8_t* outputBuffer(proto::desktop::VideoPacket* packet, size_t size)
@@ -34,15 +51,36 @@ uint8_t* outputBuffer(proto::desktop::VideoPacket* packet, size_t size)
     return reinterpret_cast<uint8_t*>(packet->mutable_data()->data());
 }
 
+void toCacheTile(const desktop::TileCache::Tile& from, proto::desktop::CacheTile* to)
+{
+    to->set_slot(static_cast<uint32_t>(from.slot));
+    to->set_x(from.pos.x());
+    to->set_y(from.pos.y());
+}
+
 } // namespace
 
 VideoEncoderZstd::VideoEncoderZstd(const desktop::PixelFormat& target_format,
                                    int compression_ratio)
     : target_format_(target_format),
-      compress_ratio_(compression_ratio),
-      stream_(ZSTD_createCStream())
+      compress_ratio_(compression_ratio)
 {
-    // Nothing
+    desktop::RegionCoalescer::CostModel cost_model;
+    cost_model.pixel_cost = target_format_.bytesPerPixel();
+    coalescer_.setCostModel(cost_model);
+}
+
+VideoEncoderZstd::~VideoEncoderZstd()
+{
+    const desktop::RegionCoalescer::Statistics& statistics = coalescer_.statistics();
+
+    if (statistics.regions)
+    {
+        LOG(LS_INFO) << "Coalesced " << statistics.regions << " regions: "
+                     << statistics.rects_before << " rects before, "
+                     << statistics.rects_after << " rects after, "
+                     << statistics.extra_pixels << " extra pixels";
+    }
 }
 
 // static
@@ -57,36 +95,514 @@ VideoEncoderZstd* VideoEncoderZstd::create(const desktop::PixelFormat& target_fo
     return new VideoEncoderZstd(target_format, compression_ratio);
 }
 
-void VideoEncoderZstd::compressPacket(proto::desktop::VideoPacket* packet,
-                                      const uint8_t* input_data,
-                                      size_t input_size)
+void VideoEncoderZstd::setCopyRectEnabled(bool enable)
+{
+    if (enable)
+        move_detector_ = std::make_unique<desktop::MoveDetector>();
+    else
+        move_detector_.reset();
+}
+
+void VideoEncoderZstd::setTileCacheEnabled(bool enable)
+{
+    if (enable)
+        tile_cache_ = std::make_unique<desktop::TileCache>(kTileCacheSize);
+    else
+        tile_cache_.reset();
+}
+
+void VideoEncoderZstd::setCoalescingCostModel(
+    const desktop::RegionCoalescer::CostModel& cost_model)
+{
+    coalescer_.setCostModel(cost_model);
+}
+
+const desktop::RegionCoalescer::Statistics& VideoEncoderZstd::coalescingStatistics() const
+{
+    return coalescer_.statistics();
+}
+
+void VideoEncoderZstd::setThreadCount(int thread_count)
+{
+    if (thread_count == kAutoThreadCount)
+        thread_count = std::min(base::ThreadPool::hardwareConcurrency(), kMaxAutoThreadCount);
+
+    if (thread_count > 1)
+        thread_pool_ = std::make_unique<base::ThreadPool>(thread_count);
+    else
+        thread_pool_.reset();
+}
+
+void VideoEncoderZstd::setDictionary(std::shared_ptr<const ZstdDictionary> dictionary)
+{
+    dictionary_ = std::move(dictionary);
+
+    if (dictionary_)
+    {
+        cdict_.reset(ZSTD_createCDict(
+            dictionary_->data().data(), dictionary_->data().size(), compress_ratio_));
+    }
+    else
+    {
+        cdict_.reset();
+    }
+
+    // The persistent stream starts again with the new dictionary.
+    stream_started_ = false;
+}
+
+void VideoEncoderZstd::setPersistentStreamEnabled(bool enable)
+{
+    persistent_stream_ = enable;
+    stream_started_ = false;
+}
+
+void VideoEncoderZstd::setDeltaFilterEnabled(bool enable)
+{
+    delta_filter_ = enable;
+
+    // The reference frame is created with the next key frame.
+    reference_frame_.reset();
+}
+
+void VideoEncoderZstd::setPaletteEnabled(bool enable)
+{
+    // The 8 bit pixels are already compressed better than the packed indexes, which break the
+    // byte repetitions.
+    palette_ = enable && target_format_.bytesPerPixel() > 1;
+}
+
+void VideoEncoderZstd::splitIntoTiles()
+{
+    const size_t bytes_per_pixel = target_format_.bytesPerPixel();
+
+    bands_.clear();
+    tiles_.clear();
+
+    Tile tile = { 0 };
+
+    for (const auto& rect : rects_)
+    {
+        const size_t row_size = rect.width() * bytes_per_pixel;
+        const int band_height = std::max(static_cast<int>(kTileSize / row_size), 1);
+
+        for (int top = rect.top(); top < rect.bottom(); top += band_height)
+        {
+            const desktop::Rect band = desktop::Rect::makeLTRB(
+                rect.left(), top, rect.right(), std::min(top + band_height, rect.bottom()));
+            const size_t band_size = band.height() * row_size;
+
+            if (tile.rect_count && tile.input_size + band_size > kTileSize)
+            {
+                tiles_.push_back(tile);
+
+                tile.first_rect = bands_.size();
+                tile.rect_count = 0;
+                tile.input_offset += tile.input_size;
+                tile.input_size = 0;
+            }
+
+            bands_.push_back(band);
+
+            ++tile.rect_count;
+            tile.input_size += band_size;
+        }
+    }
+
+    if (tile.rect_count)
+        tiles_.push_back(tile);
+
+    rects_.swap(bands_);
+}
+
+void VideoEncoderZstd::translateTile(const desktop::Frame* frame, const Tile& tile)
+{
+    uint8_t* translate_pos = translate_buffer_.get() + tile.input_offset;
+
+    for (size_t i = tile.first_rect; i < tile.first_rect + tile.rect_count; ++i)
+    {
+        const desktop::Rect& rect = rects_[i];
+        const int stride = rect.width() * target_format_.bytesPerPixel();
+
+        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               translate_pos,
+                               stride,
+                               rect.width(),
+                               rect.height());
+
+        translate_pos += rect.height() * stride;
+    }
+}
+
+void VideoEncoderZstd::translateTiles(const desktop::Frame* frame)
+{
+    if (thread_pool_)
+    {
+        thread_pool_->run(static_cast<int>(tiles_.size()), [&](int index)
+        {
+            translateTile(frame, tiles_[index]);
+        });
+    }
+    else
+    {
+        for (const auto& tile : tiles_)
+            translateTile(frame, tile);
+    }
+}
+
+void VideoEncoderZstd::updateReferenceFrame(const desktop::Frame* frame,
+                                            const proto::desktop::VideoPacket& packet)
+{
+    // The client creates a new frame when the format changes. The pixels of the new frame are
+    // not defined until the key frame is decoded.
+    if (packet.has_format())
+        reference_frame_ = desktop::FrameAligned::create(frame->size(), target_format_, 32);
+
+    if (!reference_frame_)
+        return;
+
+    for (const auto& copy_rect : packet.copy_rect())
+    {
+        reference_frame_->movePixels(
+            desktop::Point(copy_rect.source_x(), copy_rect.source_y()),
+            VideoUtil::fromVideoRect(copy_rect.dest_rect()));
+    }
+
+    // The cached tiles have the same pixels as the frame.
+    for (const auto& tile : packet.cached_tile())
+    {
+        const desktop::Point pos(tile.x(), tile.y());
+
+        translator_->translate(frame->frameDataAtPos(pos),
+                               frame->stride(),
+                               reference_frame_->frameDataAtPos(pos),
+                               reference_frame_->stride(),
+                               desktop::TileCache::kTileSize,
+                               desktop::TileCache::kTileSize);
+    }
+}
+
+bool VideoEncoderZstd::isDeltaFilterBetter() const
+{
+    const int bytes_per_pixel = target_format_.bytesPerPixel();
+
+    // The number of bytes equal to the previous byte of the same channel in the row is compared
+    // with the number of bytes equal to the previous frame. zstd compresses both kinds of
+    // repetitions well.
+    int64_t repeated_bytes = 0;
+    int64_t unchanged_bytes = 0;
+
+    const uint8_t* translate_pos = translate_buffer_.get();
+
+    for (const auto& rect : rects_)
+    {
+        const int stride = rect.width() * bytes_per_pixel;
+
+        for (int y = 0; y < rect.height(); y += kFilterEstimateRowStep)
+        {
+            const uint8_t* current = translate_pos + y * stride;
+            const uint8_t* previous = reference_frame_->frameDataAtPos(rect.left(), rect.top() + y);
+
+            for (int i = 0; i < stride; ++i)
+            {
+                if (i >= bytes_per_pixel && current[i] == current[i - bytes_per_pixel])
+                    ++repeated_bytes;
+
+                if (current[i] == previous[i])
+                    ++unchanged_bytes;
+            }
+        }
+
+        translate_pos += rect.height() * stride;
+    }
+
+    return unchanged_bytes > repeated_bytes;
+}
+
+void VideoEncoderZstd::filterRect(const desktop::Rect& rect, uint8_t* data, bool delta)
+{
+    const int stride = rect.width() * target_format_.bytesPerPixel();
+
+    uint8_t* reference_pos = reference_frame_->frameDataAtPos(rect.topLeft());
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        if (delta)
+        {
+            for (int x = 0; x < stride; ++x)
+            {
+                const uint8_t current = data[x];
+
+                data[x] = current - reference_pos[x];
+                reference_pos[x] = current;
+            }
+        }
+        else
+        {
+            memcpy(reference_pos, data, stride);
+        }
+
+        data += stride;
+        reference_pos += reference_frame_->stride();
+    }
+}
+
+void VideoEncoderZstd::packTile(Tile* tile, bool delta)
+{
+    const int bytes_per_pixel = target_format_.bytesPerPixel();
+
+    std::unique_ptr<PixelPalette> palette;
+    std::vector<uint8_t> palette_data;
+
+    if (palette_)
+        palette = std::make_unique<PixelPalette>(bytes_per_pixel);
+
+    uint8_t* read_pos = translate_buffer_.get() + tile->input_offset;
+    uint8_t* write_pos = read_pos;
+
+    for (size_t i = tile->first_rect; i < tile->first_rect + tile->rect_count; ++i)
+    {
+        const desktop::Rect& rect = rects_[i];
+        const int stride = rect.width() * bytes_per_pixel;
+        const size_t size = rect.height() * stride;
+
+        if (palette && palette->build(read_pos, stride, rect.width(), rect.height()) &&
+            palette->encodedSize(rect.width(), rect.height()) < size)
+        {
+            const int bits_per_index = PixelPalette::bitsPerIndex(palette->size());
+            const size_t colors_size = palette->size() * bytes_per_pixel;
+            const size_t row_size = PixelPalette::packedRowSize(rect.width(), bits_per_index);
+
+            palette_data.resize(palette->encodedSize(rect.width(), rect.height()));
+            memcpy(palette_data.data(), palette->colors(), colors_size);
+
+            for (int y = 0; y < rect.height(); ++y)
+            {
+                palette->packRow(read_pos + y * stride,
+                                 rect.width(),
+                                 palette_data.data() + colors_size + y * row_size);
+            }
+
+            palette_sizes_[i] = palette->size();
+        }
+
+        if (reference_frame_)
+            filterRect(rect, read_pos, delta && !palette_sizes_[i]);
+
+        // The data of the rectangle is never longer than its pixels, so it is moved towards the
+        // beginning of the tile without overwriting the next rectangles.
+        if (palette_sizes_[i])
+        {
+            memcpy(write_pos, palette_data.data(), palette_data.size());
+            write_pos += palette_data.size();
+        }
+        else
+        {
+            if (write_pos != read_pos)
+                memmove(write_pos, read_pos, size);
+
+            write_pos += size;
+        }
+
+        read_pos += size;
+    }
+
+    tile->input_size = write_pos - (translate_buffer_.get() + tile->input_offset);
+}
+
+void VideoEncoderZstd::packTiles(proto::desktop::VideoPacket* packet)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    // The pixels of the reference frame are not defined for the key frames.
+    const bool delta = reference_frame_ && !packet->has_format() && isDeltaFilterBetter();
+
+    if (delta)
+        packet->set_filter(proto::desktop::VIDEO_FILTER_DELTA);
+
+    palette_sizes_.assign(rects_.size(), 0);
+
+    if (thread_pool_)
+    {
+        thread_pool_->run(static_cast<int>(tiles_.size()), [&](int index)
+        {
+            packTile(&tiles_[index], delta);
+        });
+    }
+    else
+    {
+        for (auto& tile : tiles_)
+            packTile(&tile, delta);
+    }
+
+    if (std::any_of(palette_sizes_.begin(), palette_sizes_.end(),
+                    [](uint32_t palette_size) { return palette_size != 0; }))
+    {
+        for (uint32_t palette_size : palette_sizes_)
+            packet->add_palette_size(palette_size);
+    }
+}
+
+void VideoEncoderZstd::compressTile(ZSTD_CStream* stream, uint8_t* output_data, Tile* tile)
+{
+    const uint8_t* input_data = translate_buffer_.get() + tile->input_offset;
+
+    if (cdict_)
+    {
+        tile->output_size = ZSTD_compress_usingCDict(stream,
+                                                     output_data + tile->output_offset,
+                                                     tile->output_size,
+                                                     input_data,
+                                                     tile->input_size,
+                                                     cdict_.get());
+    }
+    else
+    {
+        tile->output_size = ZSTD_compressCCtx(stream,
+                                              output_data + tile->output_offset,
+                                              tile->output_size,
+                                              input_data,
+                                              tile->input_size,
+                                              compress_ratio_);
+    }
+}
+
+void VideoEncoderZstd::compressTiles(proto::desktop::VideoPacket* packet)
+{
+    // The tiles are compressed to the reserved parts of the output buffer and then moved
+    // together.
+    size_t output_size = 0;
+
+    for (auto& tile : tiles_)
+    {
+        tile.output_offset = output_size;
+        tile.output_size = ZSTD_compressBound(tile.input_size);
+
+        output_size += tile.output_size;
+    }
 
-    const size_t output_size = ZSTD_compressBound(input_size);
     uint8_t* output_data = outputBuffer(packet, output_size);
 
-    ZSTD_inBuffer input = { input_data, input_size, 0 };
-    ZSTD_outBuffer output = { output_data, output_size, 0 };
+    const int task_count = thread_pool_ ?
+        std::min(thread_pool_->threadCount(), static_cast<int>(tiles_.size())) : 1;
+
+    while (streams_.size() < static_cast<size_t>(task_count))
+        streams_.emplace_back(ZSTD_createCStream());
+
+    // Each task uses its own stream and compresses every |task_count|-th tile.
+    auto compress_tiles = [&](int index)
+    {
+        for (size_t i = index; i < tiles_.size(); i += task_count)
+            compressTile(streams_[index].get(), output_data, &tiles_[i]);
+    };
+
+    if (task_count > 1)
+        thread_pool_->run(task_count, compress_tiles);
+    else
+        compress_tiles(0);
+
+    size_t data_pos = 0;
 
-    while (input.pos < input.size)
+    for (const auto& tile : tiles_)
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
-        if (ZSTD_isError(ret))
+        if (ZSTD_isError(tile.output_size))
         {
-            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
+            LOG(LS_WARNING) << "ZSTD_compressCCtx failed: " << ZSTD_getErrorName(tile.output_size);
+            packet->clear_data();
             return;
         }
+
+        memmove(output_data + data_pos, output_data + tile.output_offset, tile.output_size);
+
+        // A single tile is sent as the plain stream.
+        if (tiles_.size() > 1)
+        {
+            proto::desktop::DataTile* data_tile = packet->add_data_tile();
+
+            data_tile->set_offset(static_cast<uint32_t>(data_pos));
+            data_tile->set_rect_count(static_cast<uint32_t>(tile.rect_count));
+        }
+
+        data_pos += tile.output_size;
     }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    packet->mutable_data()->resize(data_pos);
+}
+
+void VideoEncoderZstd::compressStream(proto::desktop::VideoPacket* packet)
+{
+    if (streams_.empty())
+        streams_.emplace_back(ZSTD_createCStream());
+
+    ZSTD_CStream* stream = streams_.front().get();
+
+    // The client starts a new stream together with a new frame.
+    if (!stream_started_ || packet->has_format())
+    {
+        ZSTD_CCtx_reset(stream, ZSTD_reset_session_and_parameters);
+
+        size_t ret = cdict_ ? ZSTD_CCtx_refCDict(stream, cdict_.get()) :
+            ZSTD_CCtx_setParameter(stream, ZSTD_c_compressionLevel, compress_ratio_);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        stream_started_ = true;
+    }
+    else
+    {
+        packet->set_continue_stream(true);
+    }
+
+    size_t input_size = 0;
+    for (const auto& tile : tiles_)
+        input_size += tile.input_size;
+
+    size_t output_size = ZSTD_compressBound(input_size);
+    ZSTD_outBuffer output = { outputBuffer(packet, output_size), output_size, 0 };
+
+    // The palettes make the data of the tiles shorter, so the tiles are not contiguous.
+    for (size_t i = 0; i < tiles_.size(); ++i)
+    {
+        ZSTD_inBuffer input =
+            { translate_buffer_.get() + tiles_[i].input_offset, tiles_[i].input_size, 0 };
+
+        // The data is flushed at the end of each packet, but the frame is not ended.
+        const ZSTD_EndDirective mode = (i + 1 == tiles_.size()) ? ZSTD_e_flush : ZSTD_e_continue;
+
+        while (true)
+        {
+            const size_t ret = ZSTD_compressStream2(stream, &output, &input, mode);
+            if (ZSTD_isError(ret))
+            {
+                LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+                packet->clear_data();
+                packet->clear_continue_stream();
+                stream_started_ = false;
+                return;
+            }
+
+            if (mode == ZSTD_e_flush ? !ret : input.pos == input.size)
+                break;
+
+            if (output.pos == output.size)
+            {
+                // The output buffer is full.
+                output_size *= 2;
+                output.dst = outputBuffer(packet, output_size);
+                output.size = output_size;
+            }
+        }
+    }
 
     packet->mutable_data()->resize(output.pos);
 }
 
 void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
+{
+    encodeRegion(frame, frame->constUpdatedRegion(), packet);
+}
+
+void VideoEncoderZstd::encodeRegion(const desktop::Frame* frame,
+                                    const desktop::Region& region,
+                                    proto::desktop::VideoPacket* packet)
 {
     fillPacketInfo(proto::desktop::VIDEO_ENCODING_ZSTD, frame, packet);
 
@@ -106,41 +622,87 @@ void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::Video
         }
     }
 
-    size_t data_size = 0;
+    desktop::Region updated_region(region);
 
-    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    // The client creates a new frame when the format changes, so the whole frame is sent.
+    if (packet->has_format())
+        updated_region.setRect(desktop::Rect::makeSize(frame->size()));
+
+    if (move_detector_)
     {
-        const desktop::Rect& rect = it.rect();
+        // The client creates a new frame when the format changes, so there is nothing to move.
+        if (packet->has_format())
+            move_detector_->reset();
 
-        data_size += rect.width() * rect.height() * target_format_.bytesPerPixel();
-        VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
+        desktop::MoveDetector::MoveList moves;
+        move_detector_->detect(frame, &updated_region, &moves);
+
+        for (const auto& move : moves)
+        {
+            proto::desktop::CopyRect* copy_rect = packet->add_copy_rect();
+
+            copy_rect->set_source_x(move.source_pos.x());
+            copy_rect->set_source_y(move.source_pos.y());
+            VideoUtil::toVideoRect(move.dest_rect, copy_rect->mutable_dest_rect());
+        }
     }
 
-    if (translate_buffer_size_ < data_size)
+    if (tile_cache_)
     {
-        translate_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
-        translate_buffer_size_ = data_size;
+        // The client clears the tile cache together with the frame.
+        if (packet->has_format())
+        {
+            tile_cache_->clear();
+            packet->set_tile_cache_size(static_cast<uint32_t>(tile_cache_->slotCount()));
+        }
+
+        cached_tiles_.clear();
+        stored_tiles_.clear();
+
+        tile_cache_->update(frame, &updated_region, &cached_tiles_, &stored_tiles_);
+
+        for (const auto& tile : cached_tiles_)
+            toCacheTile(tile, packet->add_cached_tile());
+
+        for (const auto& tile : stored_tiles_)
+            toCacheTile(tile, packet->add_stored_tile());
     }
 
-    uint8_t* translate_pos = translate_buffer_.get();
+    coalescer_.coalesce(updated_region, &rects_);
+    splitIntoTiles();
 
-    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
-    {
-        const desktop::Rect& rect = it.rect();
-        const int stride = rect.width() * target_format_.bytesPerPixel();
+    for (const auto& rect : rects_)
+        VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
 
-        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               translate_pos,
-                               stride,
-                               rect.width(),
-                               rect.height());
+    // The tiles are filtered and packed in parallel. The coalescer never returns overlapping
+    // rectangles, so the tiles never write the same pixels of the reference frame.
+    DCHECK(tiles_.size() < 2 || !VideoUtil::hasOverlappingRects(*packet));
 
-        translate_pos += rect.height() * stride;
+    if (delta_filter_)
+        updateReferenceFrame(frame, *packet);
+
+    if (tiles_.empty())
+        return;
+
+    const size_t data_size = tiles_.back().input_offset + tiles_.back().input_size;
+
+    if (translate_buffer_size_ < data_size)
+    {
+        translate_buffer_.reset();
+        translate_buffer_.reset(static_cast<uint8_t*>(
+            base::AlignedMemoryPool::instance()->allocate(data_size, 32)));
+        translate_buffer_size_ = base::AlignedMemoryPool::sizeClass(data_size);
     }
 
-    // Compress data with using Zstd compressor.
-    compressPacket(packet, translate_buffer_.get(), data_size);
+    translateTiles(frame);
+
+    if (reference_frame_ || palette_)
+        packTiles(packet);
+
+    if (persistent_stream_)
+        compressStream(packet);
+    else
+        compressTiles(packet);
 }
 
 } // namespace codec
@@ -22,35 +22,152 @@
 #include "base/aligned_memory.h"
 #include "codec/scoped_zstd_stream.h"
 #include "codec/video_encoder.h"
+#include "desktop/move_detector.h"
 #include "desktop/pixel_format.h"
+#include "desktop/region_coalescer.h"
+#include "desktop/tile_cache.h"
+
+#include <vector>
+
+namespace base {
+class ThreadPool;
+} // namespace base
 
 namespace codec {
 
 class PixelTranslator;
+class ZstdDictionary;
 
 class VideoEncoderZstd : public VideoEncoder
 {
 public:
-    ~VideoEncoderZstd() = default;
+    ~VideoEncoderZstd();
+
+    // Passing this value to setThreadCount() selects the number of threads depending on the
+    // number of processor cores.
+    static const int kAutoThreadCount = 0;
 
     static VideoEncoderZstd* create(
         const desktop::PixelFormat& target_format, int compression_ratio);
 
+    // Enables the search for the moved areas of the screen. The moved areas are sent as copy
+    // rects instead of pixels. The client must support copy rects.
+    void setCopyRectEnabled(bool enable);
+
+    // Enables the cache of the screen tiles. The tiles that were already sent are sent as
+    // references to the tile cache of the client. The client must support the tile cache.
+    void setTileCacheEnabled(bool enable);
+
+    // Before encoding, the fragmented updated region is replaced with fewer, larger rectangles
+    // when the cost of the extra pixels is less than the cost of the separate rectangles.
+    void setCoalescingCostModel(const desktop::RegionCoalescer::CostModel& cost_model);
+    const desktop::RegionCoalescer::Statistics& coalescingStatistics() const;
+
+    // Large updated areas are split into tiles which are compressed independently, so the client
+    // can decompress them in parallel. If |thread_count| is greater than 1, the tiles are also
+    // translated and compressed in parallel.
+    void setThreadCount(int thread_count);
+
+    // Sets the dictionary for the compression. The client must have the dictionary with the same
+    // ID. Passing nullptr disables the dictionary.
+    void setDictionary(std::shared_ptr<const ZstdDictionary> dictionary);
+
+    // Enables the stream which is not restarted for each packet, so its window contains the data
+    // of the previous packets. The stream starts again with the key frames. The updates are not
+    // split into tiles in this mode. The client must support the persistent streams.
+    void setPersistentStreamEnabled(bool enable);
+
+    // Enables the delta filter. The encoder keeps a copy of the frame of the client and sends the
+    // difference from it instead of the pixels when the difference is expected to be compressed
+    // better. The client must support the delta filter.
+    void setDeltaFilterEnabled(bool enable);
+
+    // Enables the palettes. The rectangles with few colors are sent as a palette and the indexes
+    // of the pixels packed to 1-8 bits when it is smaller than the pixels. The client must support
+    // the palettes.
+    void setPaletteEnabled(bool enable);
+
     void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
 
+    // Encodes |region| of the frame instead of its updated region. The whole frame is still
+    // encoded together with the format.
+    void encodeRegion(const desktop::Frame* frame,
+                      const desktop::Region& region,
+                      proto::desktop::VideoPacket* packet);
+
 private:
+    struct Tile
+    {
+        size_t first_rect;
+        size_t rect_count;
+
+        // Position of the translated pixels in the translate buffer.
+        size_t input_offset;
+        size_t input_size;
+
+        // Position of the compressed data in the output buffer.
+        size_t output_offset;
+        size_t output_size;
+    };
+
     VideoEncoderZstd(const desktop::PixelFormat& target_format, int compression_ratio);
-    void compressPacket(proto::desktop::VideoPacket* packet,
-                        const uint8_t* input_data,
-                        size_t input_size);
+
+    // Splits the large rectangles of |rects_| into horizontal bands and groups the rectangles
+    // into |tiles_|.
+    void splitIntoTiles();
+    void translateTile(const desktop::Frame* frame, const Tile& tile);
+    void translateTiles(const desktop::Frame* frame);
+
+    // Applies the copy rects and the cached tiles of |packet| to the reference frame the same way
+    // as the client does.
+    void updateReferenceFrame(const desktop::Frame* frame,
+                              const proto::desktop::VideoPacket& packet);
+
+    // Estimates on a part of the rows whether the difference from the reference frame is
+    // compressed better than the translated pixels.
+    bool isDeltaFilterBetter() const;
+
+    // Copies the translated pixels of the rectangle to the reference frame and, if |delta| is
+    // true, replaces them with the difference from the previous pixels of the reference frame.
+    void filterRect(const desktop::Rect& rect, uint8_t* data, bool delta);
+
+    // Replaces the pixels of the rectangles of the tile with the palettes where they are smaller
+    // and filters the other rectangles. The data of the tile becomes shorter if the palettes are
+    // used.
+    void packTile(Tile* tile, bool delta);
+    void packTiles(proto::desktop::VideoPacket* packet);
+
+    void compressTile(ZSTD_CStream* stream, uint8_t* output_data, Tile* tile);
+    void compressTiles(proto::desktop::VideoPacket* packet);
+    void compressStream(proto::desktop::VideoPacket* packet);
 
     // Client's pixel format
     desktop::PixelFormat target_format_;
     int compress_ratio_;
-    ScopedZstdCStream stream_;
+    std::unique_ptr<base::ThreadPool> thread_pool_;
+    std::vector<ScopedZstdCStream> streams_;
+    std::shared_ptr<const ZstdDictionary> dictionary_;
+    ScopedZstdCDict cdict_;
+    bool persistent_stream_ = false;
+    bool stream_started_ = false;
+    bool delta_filter_ = false;
+    bool palette_ = false;
+    std::vector<uint32_t> palette_sizes_;
+
+    // The frame of the client in its pixel format. Exists only if the delta filter is enabled.
+    std::unique_ptr<desktop::Frame> reference_frame_;
+
     std::unique_ptr<PixelTranslator> translator_;
-    std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer_;
+    std::unique_ptr<uint8_t[], base::AlignedPoolDeleter> translate_buffer_;
     size_t translate_buffer_size_ = 0;
+    std::unique_ptr<desktop::MoveDetector> move_detector_;
+    std::unique_ptr<desktop::TileCache> tile_cache_;
+    desktop::TileCache::TileList cached_tiles_;
+    desktop::TileCache::TileList stored_tiles_;
+    desktop::RegionCoalescer coalescer_;
+    std::vector<desktop::Rect> rects_;
+    std::vector<desktop::Rect> bands_;
+    std::vector<Tile> tiles_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
@@ -0,0 +1,485 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_palette.h"
+#include "codec/pixel_translator.h"
+#include "codec/video_decoder_zstd.h"
+#include "codec/video_encoder_zstd.h"
+#include "codec/zstd_dictionary.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <gtest/gtest.h>
+#include <zdict.h>
+#include <zstd.h>
+
+#include <random>
+
+namespace codec {
+
+namespace {
+
+// Fills |rect| of |frame| with the pixels of four colors, so the data is compressed, but not
+// too well.
+void drawPixels(desktop::Frame* frame, const desktop::Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = 0xFF000000 | (((*random)() % 4) * 0x3C3C3C);
+    }
+}
+
+std::unique_ptr<desktop::Frame> createFrame(const desktop::Size& size, std::mt19937* random)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameAligned::create(size, desktop::PixelFormat::ARGB(), 32);
+
+    drawPixels(frame.get(), desktop::Rect::makeSize(size), random);
+    return frame;
+}
+
+// Trains a dictionary on the rows of the pixels which look like the frames of the tests.
+std::shared_ptr<const ZstdDictionary> createDictionary()
+{
+    std::mt19937 random(1);
+    std::unique_ptr<desktop::Frame> frame = createFrame(desktop::Size(512, 1024), &random);
+
+    const size_t row_size = frame->size().width() * frame->format().bytesPerPixel();
+
+    std::string samples;
+    std::vector<size_t> sample_sizes;
+
+    for (int y = 0; y < frame->size().height(); ++y)
+    {
+        samples.append(reinterpret_cast<const char*>(frame->frameDataAtPos(0, y)), row_size);
+        sample_sizes.push_back(row_size);
+    }
+
+    std::string data(16 * 1024, 0);
+
+    const size_t size = ZDICT_trainFromBuffer(data.data(), data.size(), samples.data(),
+                                              sample_sizes.data(),
+                                              static_cast<unsigned>(sample_sizes.size()));
+    if (ZDICT_isError(size))
+        return nullptr;
+
+    data.resize(size);
+    return ZstdDictionary::create(std::move(data));
+}
+
+class RoundTrip
+{
+public:
+    RoundTrip(const desktop::PixelFormat& target_format, const desktop::Size& size)
+        : encoder(VideoEncoderZstd::create(target_format, 6)),
+          decoder(VideoDecoderZstd::create()),
+          target_format_(target_format),
+          host_frame(createFrame(size, &random)),
+          client_frame(desktop::FrameAligned::create(size, desktop::PixelFormat::ARGB(), 32))
+    {
+        // Nothing
+    }
+
+    // Encodes the updated region of the host frame, decodes the packet after the serialization
+    // and checks that the client frame has the same pixels (after the conversion to the target
+    // format). Returns the encoded packet.
+    proto::desktop::VideoPacket update()
+    {
+        proto::desktop::VideoPacket packet;
+        encoder->encode(host_frame.get(), &packet);
+
+        proto::desktop::VideoPacket received;
+        EXPECT_TRUE(received.ParseFromString(packet.SerializeAsString()));
+        EXPECT_TRUE(decoder->decode(received, client_frame.get()));
+
+        expectSameFrames();
+
+        host_frame->updatedRegion()->clear();
+        return packet;
+    }
+
+    // Changes |rect| of the host frame.
+    void draw(const desktop::Rect& rect)
+    {
+        drawPixels(host_frame.get(), rect, &random);
+        host_frame->updatedRegion()->addRect(rect);
+    }
+
+    // Slightly changes the color of every pixel of |rect| of the host frame, so the new pixels
+    // are close to the previous frame.
+    void recolor(const desktop::Rect& rect)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            for (int x = rect.left(); x < rect.right(); ++x)
+            {
+                uint8_t* pixel = host_frame->frameDataAtPos(x, y);
+                pixel[0] ^= 0x40;
+            }
+        }
+
+        host_frame->updatedRegion()->addRect(rect);
+    }
+
+    // Changes a few random rectangles of the host frame.
+    void drawRandomRects(int count)
+    {
+        const desktop::Size& size = host_frame->size();
+
+        for (int i = 0; i < count; ++i)
+        {
+            const int width = 1 + random() % (size.width() / 4);
+            const int height = 1 + random() % (size.height() / 4);
+
+            draw(desktop::Rect::makeXYWH(random() % (size.width() - width),
+                                         random() % (size.height() - height),
+                                         width, height));
+        }
+    }
+
+    std::unique_ptr<VideoEncoderZstd> encoder;
+    std::unique_ptr<VideoDecoderZstd> decoder;
+
+private:
+    void expectSameFrames()
+    {
+        const desktop::Size& size = host_frame->size();
+        const int bytes_per_pixel = target_format_.bytesPerPixel();
+        const int stride = size.width() * bytes_per_pixel;
+
+        std::vector<uint8_t> target(stride * size.height());
+        std::unique_ptr<desktop::Frame> expected =
+            desktop::FrameAligned::create(size, desktop::PixelFormat::ARGB(), 32);
+
+        PixelTranslator::create(desktop::PixelFormat::ARGB(), target_format_)->translate(
+            host_frame->frameData(), host_frame->stride(), target.data(), stride,
+            size.width(), size.height());
+        PixelTranslator::create(target_format_, desktop::PixelFormat::ARGB())->translate(
+            target.data(), stride, expected->frameData(), expected->stride(),
+            size.width(), size.height());
+
+        for (int y = 0; y < size.height(); ++y)
+        {
+            ASSERT_EQ(memcmp(expected->frameDataAtPos(0, y), client_frame->frameDataAtPos(0, y),
+                             size.width() * 4), 0) << "row " << y;
+        }
+    }
+
+    const desktop::PixelFormat target_format_;
+
+public:
+    std::mt19937 random;
+    std::unique_ptr<desktop::Frame> host_frame;
+    std::unique_ptr<desktop::Frame> client_frame;
+};
+
+} // namespace
+
+TEST(video_encoder_zstd_test, single_thread)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1280, 720));
+    round_trip.encoder->setThreadCount(1);
+
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+    EXPECT_TRUE(round_trip.update().has_format());
+
+    for (int i = 0; i < 4; ++i)
+    {
+        round_trip.drawRandomRects(6);
+        EXPECT_GT(round_trip.update().dirty_rect_size(), 0);
+    }
+}
+
+TEST(video_encoder_zstd_test, threads)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1920, 1080));
+    round_trip.encoder->setThreadCount(4);
+
+    // The key frame is split into the tiles, which are compressed independently.
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+    EXPECT_GT(round_trip.update().data_tile_size(), 1);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        round_trip.drawRandomRects(6);
+        round_trip.update();
+    }
+}
+
+TEST(video_encoder_zstd_test, threads_rgb565)
+{
+    RoundTrip round_trip(desktop::PixelFormat::RGB565(), desktop::Size(1366, 768));
+    round_trip.encoder->setThreadCount(3);
+
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+    EXPECT_GT(round_trip.update().data_tile_size(), 1);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        round_trip.drawRandomRects(6);
+        round_trip.update();
+    }
+}
+
+TEST(video_encoder_zstd_test, overlapping_tiles)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1920, 1080));
+    round_trip.encoder->setThreadCount(4);
+
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+
+    proto::desktop::VideoPacket packet = round_trip.update();
+    ASSERT_GT(packet.data_tile_size(), 1);
+    ASSERT_GT(packet.dirty_rect_size(), 2);
+
+    // The first two bands have the same size, so the data is decoded, but the tiles would write
+    // the same pixels.
+    ASSERT_EQ(packet.dirty_rect(0).height(), packet.dirty_rect(1).height());
+    packet.mutable_dirty_rect(1)->CopyFrom(packet.dirty_rect(0));
+
+    EXPECT_FALSE(round_trip.decoder->decode(packet, round_trip.client_frame.get()));
+}
+
+TEST(video_encoder_zstd_test, truncated_tiles)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1920, 1080));
+    round_trip.encoder->setThreadCount(4);
+
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+    round_trip.update();
+
+    round_trip.encoder->requestKeyFrame();
+
+    proto::desktop::VideoPacket packet;
+    round_trip.encoder->encode(round_trip.host_frame.get(), &packet);
+    packet.mutable_data()->resize(packet.data().size() / 2);
+
+    EXPECT_FALSE(round_trip.decoder->decode(packet, round_trip.client_frame.get()));
+}
+
+TEST(video_encoder_zstd_test, persistent_stream)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1024, 768));
+    round_trip.encoder->setPersistentStreamEnabled(true);
+
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+
+    const proto::desktop::VideoPacket key_packet = round_trip.update();
+    EXPECT_FALSE(key_packet.continue_stream());
+    EXPECT_EQ(key_packet.data_tile_size(), 0);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        round_trip.drawRandomRects(3);
+        EXPECT_TRUE(round_trip.update().continue_stream());
+    }
+
+    // The stream starts again with the key frame.
+    round_trip.encoder->requestKeyFrame();
+    EXPECT_FALSE(round_trip.update().continue_stream());
+
+    round_trip.drawRandomRects(3);
+
+    proto::desktop::VideoPacket packet;
+    round_trip.encoder->encode(round_trip.host_frame.get(), &packet);
+    ASSERT_TRUE(packet.continue_stream());
+
+    // A decoder which has not seen the start of the stream cannot continue it.
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    EXPECT_FALSE(decoder->decode(packet, round_trip.client_frame.get()));
+}
+
+TEST(video_encoder_zstd_test, dictionary)
+{
+    std::shared_ptr<const ZstdDictionary> dictionary = createDictionary();
+    ASSERT_TRUE(dictionary);
+
+    // The decoder finds the dictionary in the store by the ID from the compressed data.
+    ZstdDictionaryStore::instance()->add(dictionary);
+
+    for (bool persistent_stream : { false, true })
+    {
+        RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1280, 720));
+        round_trip.encoder->setThreadCount(3);
+        round_trip.encoder->setDictionary(dictionary);
+        round_trip.encoder->setPersistentStreamEnabled(persistent_stream);
+
+        round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+
+        proto::desktop::VideoPacket packet = round_trip.update();
+        EXPECT_EQ(ZSTD_getDictID_fromFrame(packet.data().data(), packet.data().size()),
+                  dictionary->id());
+
+        for (int i = 0; i < 4; ++i)
+        {
+            round_trip.drawRandomRects(3);
+            packet = round_trip.update();
+            EXPECT_EQ(packet.continue_stream(), persistent_stream);
+        }
+    }
+}
+
+namespace {
+
+void testDeltaFilter(const desktop::PixelFormat& target_format, int thread_count,
+                     bool persistent_stream)
+{
+    RoundTrip round_trip(target_format, desktop::Size(1280, 720));
+    round_trip.encoder->setThreadCount(thread_count);
+    round_trip.encoder->setPersistentStreamEnabled(persistent_stream);
+    round_trip.encoder->setDeltaFilterEnabled(true);
+
+    // The key frame has no previous frame.
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+    EXPECT_EQ(round_trip.update().filter(), proto::desktop::VIDEO_FILTER_NONE);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        round_trip.recolor(desktop::Rect::makeXYWH(50 + i, 60, 900, 500));
+        EXPECT_EQ(round_trip.update().filter(), proto::desktop::VIDEO_FILTER_DELTA);
+
+        round_trip.drawRandomRects(3);
+        round_trip.update();
+    }
+
+    round_trip.encoder->requestKeyFrame();
+    EXPECT_EQ(round_trip.update().filter(), proto::desktop::VIDEO_FILTER_NONE);
+
+    // The previous frame is the key frame.
+    round_trip.recolor(desktop::Rect::makeXYWH(100, 100, 600, 400));
+    EXPECT_EQ(round_trip.update().filter(), proto::desktop::VIDEO_FILTER_DELTA);
+}
+
+} // namespace
+
+TEST(video_encoder_zstd_test, delta_filter)
+{
+    testDeltaFilter(desktop::PixelFormat::ARGB(), 1, false);
+}
+
+TEST(video_encoder_zstd_test, delta_filter_threads)
+{
+    testDeltaFilter(desktop::PixelFormat::RGB332(), 3, false);
+}
+
+TEST(video_encoder_zstd_test, delta_filter_threads_persistent_stream)
+{
+    testDeltaFilter(desktop::PixelFormat::RGB565(), 4, true);
+}
+
+TEST(video_encoder_zstd_test, delta_filter_disabled)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1280, 720));
+
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+    round_trip.update();
+
+    round_trip.recolor(desktop::Rect::makeXYWH(50, 60, 900, 500));
+    EXPECT_EQ(round_trip.update().filter(), proto::desktop::VIDEO_FILTER_NONE);
+}
+
+namespace {
+
+void testPalette(const desktop::PixelFormat& target_format, int thread_count,
+                 bool persistent_stream, bool delta_filter)
+{
+    RoundTrip round_trip(target_format, desktop::Size(1280, 720));
+    round_trip.encoder->setThreadCount(thread_count);
+    round_trip.encoder->setPersistentStreamEnabled(persistent_stream);
+    round_trip.encoder->setDeltaFilterEnabled(delta_filter);
+    round_trip.encoder->setPaletteEnabled(true);
+
+    // The frame has few colors except for a photo-like area.
+    round_trip.draw(desktop::Rect::makeSize(round_trip.host_frame->size()));
+
+    const desktop::Rect photo_rect = desktop::Rect::makeXYWH(700, 400, 500, 300);
+    for (int y = photo_rect.top(); y < photo_rect.bottom(); ++y)
+    {
+        for (int x = photo_rect.left(); x < photo_rect.right(); ++x)
+        {
+            uint8_t* pixel = round_trip.host_frame->frameDataAtPos(x, y);
+            pixel[0] = static_cast<uint8_t>(round_trip.random());
+            pixel[1] = static_cast<uint8_t>(x);
+            pixel[2] = static_cast<uint8_t>(y);
+        }
+    }
+
+    int palettes = 0;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (i)
+        {
+            round_trip.drawRandomRects(3);
+            round_trip.host_frame->updatedRegion()->addRect(photo_rect);
+        }
+
+        const proto::desktop::VideoPacket packet = round_trip.update();
+
+        // Each rectangle has its palette size or there are no palette sizes at all.
+        if (packet.palette_size_size())
+            EXPECT_EQ(packet.palette_size_size(), packet.dirty_rect_size());
+
+        for (uint32_t palette_size : packet.palette_size())
+        {
+            EXPECT_LE(palette_size, static_cast<uint32_t>(PixelPalette::kMaxSize));
+
+            if (palette_size)
+                ++palettes;
+        }
+    }
+
+    EXPECT_GT(palettes, 0);
+}
+
+} // namespace
+
+TEST(video_encoder_zstd_test, palette)
+{
+    testPalette(desktop::PixelFormat::ARGB(), 1, false, false);
+}
+
+TEST(video_encoder_zstd_test, palette_delta_filter)
+{
+    testPalette(desktop::PixelFormat::ARGB(), 1, false, true);
+}
+
+TEST(video_encoder_zstd_test, palette_threads)
+{
+    testPalette(desktop::PixelFormat::ARGB(), 4, false, true);
+}
+
+TEST(video_encoder_zstd_test, palette_threads_persistent_stream)
+{
+    testPalette(desktop::PixelFormat::RGB565(), 4, true, true);
+}
+
+TEST(video_encoder_zstd_test, palette_disabled)
+{
+    RoundTrip round_trip(desktop::PixelFormat::ARGB(), desktop::Size(1280, 720));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        round_trip.drawRandomRects(3);
+        EXPECT_EQ(round_trip.update().palette_size_size(), 0);
+    }
+}
+
+} // namespace codec
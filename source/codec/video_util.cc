@@ -17,9 +17,32 @@
 //
 
 #include "codec/video_util.h"
+#include "base/thread_pool.h"
+#include "desktop/desktop_region.h"
 
 namespace codec {
 
+namespace {
+
+struct ThreadCountRule
+{
+    int min_pixels;
+    int min_cores;
+    int thread_count;
+};
+
+// Small screens are encoded faster with fewer threads, and a few cores are left for the capture
+// and the network.
+const ThreadCountRule kThreadCountRules[] =
+{
+    { 1920 * 1080, 9, 8 },
+    { 1280 * 720,  5, 4 },
+    { 640 * 360,   3, 2 },
+    { 0,           1, 1 }
+};
+
+} // namespace
+
 desktop::Rect VideoUtil::fromVideoRect(const proto::desktop::Rect& rect)
 {
     return desktop::Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height());
@@ -33,6 +56,27 @@ void VideoUtil::toVideoRect(const desktop::Rect& from, proto::desktop::Rect* to)
     to->set_height(from.height());
 }
 
+// static
+bool VideoUtil::hasOverlappingRects(const proto::desktop::VideoPacket& packet)
+{
+    desktop::Region region;
+    int64_t rects_area = 0;
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        const desktop::Rect rect = fromVideoRect(packet.dirty_rect(i));
+
+        region.addRect(rect);
+        rects_area += static_cast<int64_t>(rect.width()) * rect.height();
+    }
+
+    // The area of the region is smaller than the sum of the areas if some rectangles overlap.
+    for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        rects_area -= static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    return rects_area != 0;
+}
+
 desktop::PixelFormat VideoUtil::fromVideoPixelFormat(const proto::desktop::PixelFormat& format)
 {
     return desktop::PixelFormat(
@@ -59,4 +103,28 @@ void VideoUtil::toVideoPixelFormat(
     to->set_blue_shift(from.blueShift());
 }
 
+int VideoUtil::encoderThreadCount(const desktop::Size& size)
+{
+    const int pixels = size.width() * size.height();
+    const int cores = base::ThreadPool::hardwareConcurrency();
+
+    for (const ThreadCountRule& rule : kThreadCountRules)
+    {
+        if (pixels >= rule.min_pixels && cores >= rule.min_cores)
+            return rule.thread_count;
+    }
+
+    return 1;
+}
+
+int VideoUtil::tileColumnsLog2(int thread_count)
+{
+    int log2 = 0;
+
+    while ((2 << log2) <= thread_count)
+        ++log2;
+
+    return log2;
+}
+
 } // namespace codec
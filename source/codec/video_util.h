@@ -32,12 +32,25 @@ public:
     static desktop::Rect fromVideoRect(const proto::desktop::Rect& rect);
     static void toVideoRect(const desktop::Rect& from, proto::desktop::Rect* to);
 
+    // Returns true if some of the dirty rectangles of |packet| overlap. The tiles of the ZSTD
+    // packets are decoded in parallel, so their rectangles must not overlap.
+    static bool hasOverlappingRects(const proto::desktop::VideoPacket& packet);
+
     static desktop::PixelFormat fromVideoPixelFormat(
         const proto::desktop::PixelFormat& format);
 
     static void toVideoPixelFormat(
         const desktop::PixelFormat& from, proto::desktop::PixelFormat* to);
 
+    // Returns the number of the threads of the VPX and AV1 encoders for the screen of |size| on
+    // this computer. The number is a power of two, so each thread gets its own tile column.
+    static int encoderThreadCount(const desktop::Size& size);
+
+    // Returns the base 2 logarithm of the number of the tile columns for |thread_count| threads,
+    // as VP9E_SET_TILE_COLUMNS and AV1E_SET_TILE_COLUMNS take it. The encoders reduce it if the
+    // tile columns would be too narrow.
+    static int tileColumnsLog2(int thread_count);
+
 private:
     DISALLOW_COPY_AND_ASSIGN(VideoUtil);
 };
@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/zstd_dictionary.h"
+#include "base/base_paths.h"
+#include "base/logging.h"
+
+#include <zstd.h>
+
+#include <fstream>
+
+namespace codec {
+
+namespace {
+
+// Dictionaries larger than this size are not loaded.
+constexpr size_t kMaxDictionarySize = 16 * 1024 * 1024;
+
+} // namespace
+
+// static
+const wchar_t ZstdDictionaryStore::kFileExtension[] = L".dict";
+
+ZstdDictionary::ZstdDictionary(uint32_t id, std::string&& data)
+    : id_(id),
+      data_(std::move(data))
+{
+    // Nothing
+}
+
+// static
+std::shared_ptr<const ZstdDictionary> ZstdDictionary::create(std::string&& data)
+{
+    // Raw content dictionaries have no ID, so the decoder could not find them.
+    const uint32_t id = ZSTD_getDictID_fromDict(data.data(), data.size());
+    if (!id)
+        return nullptr;
+
+    return std::shared_ptr<const ZstdDictionary>(new ZstdDictionary(id, std::move(data)));
+}
+
+// static
+std::shared_ptr<const ZstdDictionary> ZstdDictionary::load(const std::filesystem::path& file_path)
+{
+    std::error_code error_code;
+
+    const uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
+    if (error_code || !file_size || file_size > kMaxDictionarySize)
+    {
+        LOG(LS_WARNING) << "Invalid dictionary file size: " << file_path;
+        return nullptr;
+    }
+
+    std::ifstream file_stream(file_path, std::ifstream::binary);
+    if (!file_stream.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to open dictionary file: " << file_path;
+        return nullptr;
+    }
+
+    std::string data(static_cast<size_t>(file_size), 0);
+    if (!file_stream.read(data.data(), data.size()))
+    {
+        LOG(LS_WARNING) << "Unable to read dictionary file: " << file_path;
+        return nullptr;
+    }
+
+    std::shared_ptr<const ZstdDictionary> dictionary = create(std::move(data));
+    if (!dictionary)
+        LOG(LS_WARNING) << "Invalid dictionary: " << file_path;
+
+    return dictionary;
+}
+
+// static
+ZstdDictionaryStore* ZstdDictionaryStore::instance()
+{
+    static ZstdDictionaryStore* store = []()
+    {
+        ZstdDictionaryStore* store = new ZstdDictionaryStore();
+
+        std::filesystem::path directory;
+        if (base::BasePaths::currentExecDir(&directory))
+            store->load(directory / L"dictionaries");
+
+        return store;
+    }();
+
+    return store;
+}
+
+size_t ZstdDictionaryStore::load(const std::filesystem::path& directory)
+{
+    std::error_code error_code;
+    size_t count = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error_code))
+    {
+        if (!entry.is_regular_file(error_code) || entry.path().extension() != kFileExtension)
+            continue;
+
+        std::shared_ptr<const ZstdDictionary> dictionary = ZstdDictionary::load(entry.path());
+        if (!dictionary)
+            continue;
+
+        LOG(LS_INFO) << "Dictionary " << dictionary->id() << " loaded: " << entry.path();
+
+        add(std::move(dictionary));
+        ++count;
+    }
+
+    return count;
+}
+
+void ZstdDictionaryStore::add(std::shared_ptr<const ZstdDictionary> dictionary)
+{
+    DCHECK(dictionary);
+
+    std::scoped_lock lock(lock_);
+    dictionaries_[dictionary->id()] = std::move(dictionary);
+}
+
+std::shared_ptr<const ZstdDictionary> ZstdDictionaryStore::find(uint32_t id) const
+{
+    std::scoped_lock lock(lock_);
+
+    auto result = dictionaries_.find(id);
+    if (result == dictionaries_.end())
+        return nullptr;
+
+    return result->second;
+}
+
+std::vector<uint32_t> ZstdDictionaryStore::ids() const
+{
+    std::scoped_lock lock(lock_);
+
+    std::vector<uint32_t> ids;
+    ids.reserve(dictionaries_.size());
+
+    for (const auto& dictionary : dictionaries_)
+        ids.push_back(dictionary.first);
+
+    return ids;
+}
+
+} // namespace codec
@@ -0,0 +1,92 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__ZSTD_DICTIONARY_H
+#define CODEC__ZSTD_DICTIONARY_H
+
+#include "base/macros_magic.h"
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace codec {
+
+// A zstd dictionary trained on the screen content (see tools/dictionary_trainer.cc). The small
+// updates compressed with the dictionary do not start from an empty window.
+class ZstdDictionary
+{
+public:
+    ~ZstdDictionary() = default;
+
+    // Returns nullptr if |data| is not a zstd dictionary with an ID.
+    static std::shared_ptr<const ZstdDictionary> create(std::string&& data);
+    static std::shared_ptr<const ZstdDictionary> load(const std::filesystem::path& file_path);
+
+    uint32_t id() const { return id_; }
+    const std::string& data() const { return data_; }
+
+private:
+    ZstdDictionary(uint32_t id, std::string&& data);
+
+    const uint32_t id_;
+    const std::string data_;
+
+    DISALLOW_COPY_AND_ASSIGN(ZstdDictionary);
+};
+
+// The dictionaries available to the process.
+// The client sends the IDs of its dictionaries in the config, and the host compresses the video
+// with one of them if it has a dictionary with the same ID. The compressed data contains the ID
+// of the dictionary, so the decoder finds the dictionary in the store by the ID.
+class ZstdDictionaryStore
+{
+public:
+    ZstdDictionaryStore() = default;
+    ~ZstdDictionaryStore() = default;
+
+    // The dictionaries are loaded from the files with this extension.
+    static const wchar_t kFileExtension[];
+
+    // Returns the store with the dictionaries from the "dictionaries" directory next to the
+    // executable file.
+    static ZstdDictionaryStore* instance();
+
+    // Loads all dictionaries from |directory|. Returns the number of the loaded dictionaries.
+    size_t load(const std::filesystem::path& directory);
+
+    void add(std::shared_ptr<const ZstdDictionary> dictionary);
+
+    // Returns nullptr if there is no dictionary with |id|.
+    std::shared_ptr<const ZstdDictionary> find(uint32_t id) const;
+
+    std::vector<uint32_t> ids() const;
+
+private:
+    mutable std::mutex lock_;
+    std::map<uint32_t, std::shared_ptr<const ZstdDictionary>> dictionaries_;
+
+    DISALLOW_COPY_AND_ASSIGN(ZstdDictionaryStore);
+};
+
+} // namespace codec
+
+#endif // CODEC__ZSTD_DICTIONARY_H
@@ -34,6 +34,7 @@ const char kSupportedExtensionsForView[] =
 
 const uint32_t kSupportedVideoEncodings =
     proto::desktop::VIDEO_ENCODING_VP8 | proto::desktop::VIDEO_ENCODING_VP9 |
-    proto::desktop::VIDEO_ENCODING_ZSTD;
+    proto::desktop::VIDEO_ENCODING_ZSTD | proto::desktop::VIDEO_ENCODING_HYBRID |
+    proto::desktop::VIDEO_ENCODING_AV1;
 
 } // namespace common
@@ -51,9 +51,11 @@ void ComputerDialogDesktop::restoreSettings(
     proto::SessionType session_type, const proto::desktop::Config& config)
 {
     QComboBox* combo_codec = ui.combo_codec;
+    combo_codec->addItem(QLatin1String("AV1"), proto::desktop::VIDEO_ENCODING_AV1);
     combo_codec->addItem(QLatin1String("VP9"), proto::desktop::VIDEO_ENCODING_VP9);
     combo_codec->addItem(QLatin1String("VP8"), proto::desktop::VIDEO_ENCODING_VP8);
     combo_codec->addItem(QLatin1String("ZSTD"), proto::desktop::VIDEO_ENCODING_ZSTD);
+    combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::desktop::VIDEO_ENCODING_HYBRID);
 
     QComboBox* combo_color_depth = ui.combo_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
@@ -69,6 +71,12 @@ void ComputerDialogDesktop::restoreSettings(
     combo_codec->setCurrentIndex(current_codec);
     onCodecChanged(current_codec);
 
+    if (config.flags() & proto::desktop::ENABLE_VP9_I444)
+        ui.checkbox_vp9_i444->setChecked(true);
+
+    if (config.flags() & proto::desktop::ENABLE_VP9_LOSSLESS)
+        ui.checkbox_vp9_lossless->setChecked(true);
+
     desktop::PixelFormat pixel_format =
         codec::VideoUtil::fromVideoPixelFormat(config.pixel_format());
 
@@ -128,7 +136,8 @@ void ComputerDialogDesktop::saveSettings(proto::desktop::Config* config)
 
     config->set_video_encoding(video_encoding);
 
-    if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD)
+    if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+        video_encoding == proto::desktop::VIDEO_ENCODING_HYBRID)
     {
         desktop::PixelFormat pixel_format;
 
@@ -183,13 +192,21 @@ void ComputerDialogDesktop::saveSettings(proto::desktop::Config* config)
     if (ui.checkbox_block_remote_input->isChecked())
         flags |= proto::desktop::BLOCK_REMOTE_INPUT;
 
+    if (ui.checkbox_vp9_i444->isChecked() && ui.checkbox_vp9_i444->isEnabled())
+        flags |= proto::desktop::ENABLE_VP9_I444;
+
+    if (ui.checkbox_vp9_lossless->isChecked() && ui.checkbox_vp9_lossless->isEnabled())
+        flags |= proto::desktop::ENABLE_VP9_LOSSLESS;
+
     config->set_flags(flags);
 }
 
 void ComputerDialogDesktop::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::desktop::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+
+    bool has_pixel_format = (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::desktop::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -197,6 +214,11 @@ void ComputerDialogDesktop::onCodecChanged(int item_index)
     ui.slider_compression_ratio->setEnabled(has_pixel_format);
     ui.label_fast->setEnabled(has_pixel_format);
     ui.label_best->setEnabled(has_pixel_format);
+
+    const bool is_vp9 = (video_encoding == proto::desktop::VIDEO_ENCODING_VP9);
+
+    ui.checkbox_vp9_i444->setEnabled(is_vp9);
+    ui.checkbox_vp9_lossless->setEnabled(is_vp9);
 }
 
 void ComputerDialogDesktop::onCompressionRatioChanged(int value)
@@ -18,8 +18,54 @@
 
 #include "desktop/capture_scheduler.h"
 
+#include <algorithm>
+
 namespace desktop {
 
+namespace {
+
+// The shortest interval between the captures while the user interacts with the desktop.
+constexpr std::chrono::milliseconds kMinInterval{ 15 };
+
+// The user input makes the frame rate higher for this time.
+constexpr std::chrono::milliseconds kInteractionTimeout{ 500 };
+
+// If the screen does not change for this time, the interval is increased after each capture
+// until it reaches kMaxIdleInterval.
+constexpr std::chrono::milliseconds kIdleTimeout{ 1000 };
+constexpr std::chrono::milliseconds kMaxIdleInterval{ 250 };
+
+// The capture and encoding of the frames may take at most this part of the time.
+constexpr double kMaxCpuConsumption = 0.5;
+
+// The weight of a new sample in the average values.
+constexpr double kSampleWeight = 0.25;
+
+// The data in the outgoing queue should be sent within this time.
+constexpr std::chrono::milliseconds kLatencyBudget{ 200 };
+
+// The longest wait for the outgoing queue. After that, the speed of the channel is checked again
+// with a new frame.
+constexpr std::chrono::milliseconds kMaxNetworkDelay{ 1000 };
+
+// The reported speed of the network channel is limited to this range (64 kbit/s - 10 Gbit/s).
+constexpr int64_t kMinNetworkBandwidth = 8 * 1000;
+constexpr int64_t kMaxNetworkBandwidth = 1250 * 1000 * 1000;
+
+// Used until the first message is written (1 Mbit/s).
+constexpr double kDefaultBytesPerMs = 125.0;
+
+template <typename T>
+T average(const T& average, const T& sample)
+{
+    if (average == T())
+        return sample;
+
+    return average * (1.0 - kSampleWeight) + sample * kSampleWeight;
+}
+
+} // namespace
+
 CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
     : update_interval_(update_interval)
 {
@@ -28,23 +74,165 @@ CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_inter
 
 void CaptureScheduler::beginCapture()
 {
-    begin_time_ = std::chrono::high_resolution_clock::now();
+    std::scoped_lock lock(lock_);
+    begin_time_ = now();
 }
 
 void CaptureScheduler::endCapture()
 {
-    end_time_ = std::chrono::high_resolution_clock::now();
+    std::scoped_lock lock(lock_);
+
+    last_processing_time_ = now() - begin_time_;
+    average_processing_time_ = average(average_processing_time_, last_processing_time_);
+}
+
+void CaptureScheduler::beginEncode()
+{
+    std::scoped_lock lock(lock_);
+    encode_begin_time_ = now();
+}
+
+void CaptureScheduler::endEncode()
+{
+    std::scoped_lock lock(lock_);
+    average_encode_time_ = average(average_encode_time_, Milliseconds(now() - encode_begin_time_));
+}
+
+void CaptureScheduler::onFrameCaptured(bool changed)
+{
+    std::scoped_lock lock(lock_);
+
+    const Clock::time_point time = now();
+
+    if (changed || last_change_time_ == Clock::time_point())
+    {
+        last_change_time_ = time;
+        idle_interval_ = Milliseconds::zero();
+        return;
+    }
+
+    if (time - last_change_time_ < kIdleTimeout)
+        return;
+
+    // The interval is doubled after each capture of the idle screen.
+    if (idle_interval_ == Milliseconds::zero())
+        idle_interval_ = update_interval_;
+
+    idle_interval_ = std::min(idle_interval_ * 2, Milliseconds(kMaxIdleInterval));
 }
 
 std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
 {
-    std::chrono::milliseconds diff_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
+    std::scoped_lock lock(lock_);
+
+    Milliseconds delay = targetInterval(now()) - last_processing_time_;
+
+    // Leave the processor for the other tasks if the capture or the encoding is slow.
+    const Milliseconds processing_time = std::max(average_processing_time_, average_encode_time_);
+    delay = std::max(delay, processing_time * (1.0 / kMaxCpuConsumption - 1.0));
+
+    // Do not add the frames to the queue which cannot be sent in time.
+    delay = std::max(delay, networkDelay());
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::max(delay, Milliseconds::zero()));
+}
+
+bool CaptureScheduler::onUserInput()
+{
+    std::scoped_lock lock(lock_);
+
+    has_input_ = true;
+    last_input_time_ = now();
+
+    if (idle_interval_ == Milliseconds::zero())
+        return false;
+
+    // The input usually changes the screen soon.
+    last_change_time_ = last_input_time_;
+    idle_interval_ = Milliseconds::zero();
+    return true;
+}
+
+void CaptureScheduler::setPendingBytes(size_t pending_bytes)
+{
+    std::scoped_lock lock(lock_);
+    bandwidth_estimator_.setPendingBytes(pending_bytes, now());
+}
+
+bool CaptureScheduler::onMessageWritten(size_t message_size, size_t pending_bytes)
+{
+    std::scoped_lock lock(lock_);
+
+    const bool was_congested = networkDelay() > Milliseconds::zero();
+
+    bandwidth_estimator_.onMessageWritten(message_size, pending_bytes, now());
+
+    return was_congested && networkDelay() == Milliseconds::zero();
+}
+
+bool CaptureScheduler::isCongested() const
+{
+    std::scoped_lock lock(lock_);
+    return networkDelay() > Milliseconds::zero();
+}
+
+void CaptureScheduler::setNetworkBandwidth(int64_t bandwidth)
+{
+    // The value comes from another process and may be wrong. Zero means that the speed is
+    // unknown.
+    if (bandwidth > 0)
+        bandwidth = std::clamp(bandwidth, kMinNetworkBandwidth, kMaxNetworkBandwidth);
+    else
+        bandwidth = 0;
+
+    std::scoped_lock lock(lock_);
+    network_bandwidth_ = bandwidth;
+}
+
+int64_t CaptureScheduler::bandwidth() const
+{
+    std::scoped_lock lock(lock_);
+    return network_bandwidth_;
+}
+
+CaptureScheduler::Clock::time_point CaptureScheduler::now() const
+{
+    return Clock::now();
+}
+
+CaptureScheduler::Milliseconds CaptureScheduler::targetInterval(
+    const Clock::time_point& time) const
+{
+    // The interaction raises the frame rate, but never lowers it below the configured one.
+    if (has_input_ && time - last_input_time_ < kInteractionTimeout)
+    {
+        return std::min(update_interval_,
+                        std::max(update_interval_ / 2, Milliseconds(kMinInterval)));
+    }
+
+    return std::max(update_interval_, idle_interval_);
+}
+
+CaptureScheduler::Milliseconds CaptureScheduler::networkDelay() const
+{
+    const size_t pending_bytes = bandwidth_estimator_.pendingBytes();
+    if (!pending_bytes)
+        return Milliseconds::zero();
+
+    // The queue is sent no faster than the network. The speed of the queue itself is used until
+    // the speed of the network is known.
+    const int64_t bandwidth =
+        (network_bandwidth_ != 0) ? network_bandwidth_ : bandwidth_estimator_.bandwidth();
+
+    const double bytes_per_ms =
+        (bandwidth != 0) ? static_cast<double>(bandwidth) / 1000.0 : kDefaultBytesPerMs;
+    const Milliseconds queue_time(static_cast<double>(pending_bytes) / bytes_per_ms);
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+    if (queue_time <= kLatencyBudget)
+        return Milliseconds::zero();
 
-    return update_interval_ - diff_time;
+    return std::min(queue_time - kLatencyBudget, Milliseconds(kMaxNetworkDelay));
 }
 
 } // namespace desktop
@@ -19,26 +19,98 @@
 #ifndef DESKTOP__CAPTURE_SCHEDULER_H
 #define DESKTOP__CAPTURE_SCHEDULER_H
 
+#include "base/bandwidth_estimator.h"
 #include "base/macros_magic.h"
 
 #include <chrono>
+#include <mutex>
 
 namespace desktop {
 
+// Chooses the delay between the captures of the screen.
+// The frame rate is raised while the user interacts with the desktop and is lowered while the
+// screen does not change. The delay is never shorter than the time of capturing or encoding a
+// frame, so the capture and the encode threads take at most half of the processor core each. If
+// the outgoing queue contains more data than can be sent within the latency budget, the next
+// capture waits until the queue is drained.
 class CaptureScheduler
 {
 public:
+    using Clock = std::chrono::steady_clock;
+
     explicit CaptureScheduler(const std::chrono::milliseconds& update_interval);
-    ~CaptureScheduler() = default;
+    virtual ~CaptureScheduler() = default;
 
+    // The methods are called by the capture thread before and after capturing a frame.
     void beginCapture();
     void endCapture();
+
+    // The methods are called by the encode thread before and after encoding a frame.
+    void beginEncode();
+    void endEncode();
+
+    // Called after encoding a frame. |changed| is false if the frame did not contain any
+    // changes.
+    void onFrameCaptured(bool changed);
+
+    // Returns the delay before the next capture.
     std::chrono::milliseconds nextCaptureDelay() const;
 
+    // The methods below can be called from any thread.
+
+    // Called when the user input is received from the client. Returns true if the scheduler was
+    // waiting for the changes of the idle screen, and the current wait should be interrupted.
+    bool onUserInput();
+
+    // Called when a message is added to the outgoing queue. |pending_bytes| is the number of
+    // bytes in the queue.
+    void setPendingBytes(size_t pending_bytes);
+
+    // Called when a message of |message_size| bytes is written from the outgoing queue.
+    // Returns true if the queue has become small enough to be sent within the latency budget.
+    bool onMessageWritten(size_t message_size, size_t pending_bytes);
+
+    // Returns true if the outgoing queue cannot be sent within the latency budget. The new frames
+    // should not be added to the queue in this case.
+    bool isCongested() const;
+
+    // Called when the speed of the network channel is measured. The outgoing queue may be written
+    // into a local channel, which is much faster than the network, so its own writes do not show
+    // the speed of the network. The value is limited to the range of the real networks.
+    void setNetworkBandwidth(int64_t bandwidth);
+
+    // Returns the speed of the network channel in bytes per second or 0 if it is unknown yet.
+    int64_t bandwidth() const;
+
+protected:
+    virtual Clock::time_point now() const;
+
 private:
-    std::chrono::milliseconds update_interval_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    Milliseconds targetInterval(const Clock::time_point& time) const;
+    Milliseconds networkDelay() const;
+
+    const Milliseconds update_interval_;
+
+    mutable std::mutex lock_;
+
+    Clock::time_point begin_time_;
+    Milliseconds last_processing_time_{ 0 };
+    Milliseconds average_processing_time_{ 0 };
+
+    Clock::time_point encode_begin_time_;
+    Milliseconds average_encode_time_{ 0 };
+
+    // The interval is increased while the screen does not change.
+    Clock::time_point last_change_time_;
+    Milliseconds idle_interval_{ 0 };
+
+    bool has_input_ = false;
+    Clock::time_point last_input_time_;
+
+    base::BandwidthEstimator bandwidth_estimator_;
+    int64_t network_bandwidth_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(CaptureScheduler);
 };
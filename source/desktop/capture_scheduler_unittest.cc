@@ -0,0 +1,246 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/capture_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace desktop {
+
+namespace {
+
+class FakeCaptureScheduler : public CaptureScheduler
+{
+public:
+    explicit FakeCaptureScheduler(const std::chrono::milliseconds& update_interval)
+        : CaptureScheduler(update_interval)
+    {
+        // Nothing
+    }
+
+    void advance(const std::chrono::milliseconds& time) { time_ += time; }
+
+    // Emulates the capture and the encoding of one frame.
+    void captureFrame(const std::chrono::milliseconds& processing_time, bool changed)
+    {
+        beginCapture();
+        advance(processing_time);
+        endCapture();
+        onFrameCaptured(changed);
+    }
+
+protected:
+    Clock::time_point now() const override { return time_; }
+
+private:
+    Clock::time_point time_ = Clock::time_point() + std::chrono::hours(1);
+};
+
+} // namespace
+
+TEST(capture_scheduler_test, update_interval)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    scheduler.captureFrame(std::chrono::milliseconds(10), true);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(20));
+
+    scheduler.captureFrame(std::chrono::milliseconds(5), true);
+    EXPECT_LE(scheduler.nextCaptureDelay(), std::chrono::milliseconds(25));
+    EXPECT_GE(scheduler.nextCaptureDelay(), std::chrono::milliseconds(24));
+}
+
+TEST(capture_scheduler_test, user_input)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(40));
+
+    scheduler.captureFrame(std::chrono::milliseconds(5), true);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(35));
+
+    // The frame rate is raised while the user interacts with the desktop.
+    EXPECT_FALSE(scheduler.onUserInput());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(15));
+
+    // And returns back after the input stops.
+    scheduler.advance(std::chrono::seconds(1));
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(35));
+}
+
+TEST(capture_scheduler_test, user_input_short_interval)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(10));
+
+    scheduler.captureFrame(std::chrono::milliseconds(2), true);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(8));
+
+    // The interval is already shorter than the minimum for the interaction, so it is kept.
+    EXPECT_FALSE(scheduler.onUserInput());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(8));
+}
+
+TEST(capture_scheduler_test, idle_screen)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    scheduler.captureFrame(std::chrono::milliseconds(1), true);
+
+    std::chrono::milliseconds delay = scheduler.nextCaptureDelay();
+    EXPECT_EQ(delay, std::chrono::milliseconds(29));
+
+    // The delay grows while the screen does not change.
+    for (int i = 0; i < 100; ++i)
+    {
+        scheduler.advance(delay);
+        scheduler.captureFrame(std::chrono::milliseconds(1), false);
+
+        std::chrono::milliseconds next_delay = scheduler.nextCaptureDelay();
+        EXPECT_GE(next_delay, delay);
+        delay = next_delay;
+    }
+
+    EXPECT_EQ(delay, std::chrono::milliseconds(249));
+
+    // The input interrupts the idle wait.
+    EXPECT_TRUE(scheduler.onUserInput());
+    EXPECT_FALSE(scheduler.onUserInput());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(14));
+
+    // The change of the screen resets the idle state.
+    scheduler.advance(std::chrono::seconds(2));
+    scheduler.captureFrame(std::chrono::milliseconds(1), false);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(59));
+
+    scheduler.captureFrame(std::chrono::milliseconds(1), true);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(29));
+}
+
+TEST(capture_scheduler_test, slow_encoding)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    // The capture thread does not take more than half of the time.
+    for (int i = 0; i < 20; ++i)
+        scheduler.captureFrame(std::chrono::milliseconds(50), true);
+
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(50));
+}
+
+TEST(capture_scheduler_test, slow_encoding_thread)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    // The frames are encoded in a separate thread and the encoding is slower than the capture.
+    for (int i = 0; i < 20; ++i)
+    {
+        scheduler.captureFrame(std::chrono::milliseconds(5), true);
+
+        scheduler.beginEncode();
+        scheduler.advance(std::chrono::milliseconds(40));
+        scheduler.endEncode();
+    }
+
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(40));
+}
+
+TEST(capture_scheduler_test, outgoing_queue)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    scheduler.captureFrame(std::chrono::milliseconds(10), true);
+
+    EXPECT_EQ(scheduler.bandwidth(), 0);
+
+    // 100 bytes per millisecond. The writes of the outgoing queue do not show the speed of the
+    // network.
+    scheduler.setPendingBytes(1000);
+    scheduler.advance(std::chrono::milliseconds(10));
+    scheduler.onMessageWritten(1000, 0);
+    EXPECT_EQ(scheduler.bandwidth(), 0);
+
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(20));
+
+    // The queue can be sent within the latency budget.
+    scheduler.setPendingBytes(15000);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(20));
+    EXPECT_FALSE(scheduler.isCongested());
+
+    // The capture waits until the queue is drained to the latency budget.
+    scheduler.setPendingBytes(50000);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(300));
+    EXPECT_TRUE(scheduler.isCongested());
+
+    scheduler.advance(std::chrono::milliseconds(100));
+    EXPECT_FALSE(scheduler.onMessageWritten(10000, 40000));
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(200));
+    EXPECT_TRUE(scheduler.isCongested());
+
+    // The wait is limited.
+    scheduler.setPendingBytes(10000000);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::seconds(1));
+
+    EXPECT_TRUE(scheduler.onMessageWritten(10000, 0));
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(20));
+    EXPECT_FALSE(scheduler.isCongested());
+
+    // The queue was not congested.
+    scheduler.setPendingBytes(1000);
+    EXPECT_FALSE(scheduler.onMessageWritten(1000, 0));
+}
+
+TEST(capture_scheduler_test, network_bandwidth)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    scheduler.captureFrame(std::chrono::milliseconds(10), true);
+
+    // The local channel is written with the speed of 1000 bytes per millisecond.
+    scheduler.setPendingBytes(10000);
+    scheduler.advance(std::chrono::milliseconds(10));
+    scheduler.onMessageWritten(10000, 0);
+
+    scheduler.setPendingBytes(50000);
+    EXPECT_FALSE(scheduler.isCongested());
+
+    // The network is ten times slower.
+    scheduler.setNetworkBandwidth(100000);
+    EXPECT_EQ(scheduler.bandwidth(), 100000);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(300));
+    EXPECT_TRUE(scheduler.isCongested());
+
+    EXPECT_TRUE(scheduler.onMessageWritten(40000, 10000));
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(20));
+}
+
+TEST(capture_scheduler_test, network_bandwidth_range)
+{
+    FakeCaptureScheduler scheduler(std::chrono::milliseconds(30));
+
+    scheduler.setNetworkBandwidth(1);
+    EXPECT_EQ(scheduler.bandwidth(), 8000);
+
+    scheduler.setNetworkBandwidth(std::numeric_limits<int64_t>::max());
+    EXPECT_EQ(scheduler.bandwidth(), 1250000000);
+
+    // The speed of the queue is used again.
+    scheduler.setNetworkBandwidth(-1);
+    EXPECT_EQ(scheduler.bandwidth(), 0);
+}
+
+} // namespace desktop
@@ -0,0 +1,201 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/content_classifier.h"
+#include "desktop/desktop_frame.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+// A block becomes video if it was changed in this number of the last 16 frames.
+const size_t kMinVideoChanges = 10;
+
+// A video block stops being video if it was changed in this number of the last 16 frames or less.
+const size_t kMaxStaticChanges = 3;
+
+// Every n-th pixel of every n-th row of the block is used to count the colors.
+const int kSampleStep = 4;
+
+// The minimum number of different colors in the samples of a photographic block (of 256 samples
+// for a whole block). Text with anti-aliasing and user interface usually have fewer colors.
+const size_t kMinPhotoColors = 48;
+
+size_t changeCount(uint16_t history)
+{
+    return std::bitset<16>(history).count();
+}
+
+} // namespace
+
+void ContentClassifier::classify(const Frame* frame, Region* dirty_region, Region* video_region)
+{
+    video_region->clear();
+
+    if (frame->size() != size_)
+    {
+        size_ = frame->size();
+        blocks_x_ = (size_.width() + kBlockSize - 1) / kBlockSize;
+        blocks_y_ = (size_.height() + kBlockSize - 1) / kBlockSize;
+
+        blocks_.assign(blocks_x_ * blocks_y_, Block());
+    }
+
+    changed_.assign(blocks_.size(), 0);
+
+    for (Region::Iterator it(*dirty_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        for (int y = rect.top() / kBlockSize; y <= (rect.bottom() - 1) / kBlockSize; ++y)
+        {
+            for (int x = rect.left() / kBlockSize; x <= (rect.right() - 1) / kBlockSize; ++x)
+                changed_[y * blocks_x_ + x] = 1;
+        }
+    }
+
+    Region video_blocks;
+    Region refresh_region;
+
+    for (int y = 0; y < blocks_y_; ++y)
+    {
+        // The adjacent blocks of a row are added to the regions as one rectangle.
+        int video_start = -1;
+        int refresh_start = -1;
+
+        for (int x = 0; x <= blocks_x_; ++x)
+        {
+            bool video = false;
+            bool refresh = false;
+
+            if (x < blocks_x_)
+            {
+                Block& block = blockAt(x, y);
+                const bool changed = changed_[y * blocks_x_ + x] != 0;
+
+                block.history = static_cast<uint16_t>((block.history << 1) | (changed ? 1 : 0));
+
+                const size_t changes = changeCount(block.history);
+
+                if (!block.video)
+                {
+                    block.video = changed && changes >= kMinVideoChanges &&
+                        isPhotographic(frame, blockRect(x, y));
+                }
+                else if (changes <= kMaxStaticChanges ||
+                         (changed && !isPhotographic(frame, blockRect(x, y))))
+                {
+                    // The client has the lossy image of the block.
+                    block.video = false;
+                    refresh = true;
+                }
+
+                video = block.video;
+            }
+
+            if (video && video_start < 0)
+            {
+                video_start = x;
+            }
+            else if (!video && video_start >= 0)
+            {
+                video_blocks.addRect(Rect::makeLTRB(video_start * kBlockSize, y * kBlockSize,
+                                                    x * kBlockSize, (y + 1) * kBlockSize));
+                video_start = -1;
+            }
+
+            if (refresh && refresh_start < 0)
+            {
+                refresh_start = x;
+            }
+            else if (!refresh && refresh_start >= 0)
+            {
+                refresh_region.addRect(Rect::makeLTRB(
+                    refresh_start * kBlockSize, y * kBlockSize, x * kBlockSize,
+                    (y + 1) * kBlockSize));
+                refresh_start = -1;
+            }
+        }
+    }
+
+    video_region->intersect(*dirty_region, video_blocks);
+    video_region->intersectWith(Rect::makeSize(size_));
+
+    dirty_region->subtract(video_blocks);
+    dirty_region->addRegion(refresh_region);
+    dirty_region->intersectWith(Rect::makeSize(size_));
+}
+
+bool ContentClassifier::hasVideoBlocks() const
+{
+    return std::any_of(blocks_.begin(), blocks_.end(), [](const Block& block)
+    {
+        return block.video;
+    });
+}
+
+void ContentClassifier::reset()
+{
+    size_ = Size();
+    blocks_x_ = 0;
+    blocks_y_ = 0;
+    blocks_.clear();
+}
+
+Rect ContentClassifier::blockRect(int x, int y) const
+{
+    Rect rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize, kBlockSize, kBlockSize);
+    rect.intersectWith(Rect::makeSize(size_));
+    return rect;
+}
+
+bool ContentClassifier::isPhotographic(const Frame* frame, const Rect& rect)
+{
+    const int bytes_per_pixel = frame->format().bytesPerPixel();
+
+    // The alpha channel does not matter.
+    const uint32_t color_mask = (bytes_per_pixel == 4) ? 0x00FFFFFF : 0xFFFFFFFF;
+
+    samples_.clear();
+
+    for (int y = rect.top() + kSampleStep / 2; y < rect.bottom(); y += kSampleStep)
+    {
+        const uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = kSampleStep / 2; x < rect.width(); x += kSampleStep)
+        {
+            uint32_t color = 0;
+            memcpy(&color, row + x * bytes_per_pixel, bytes_per_pixel);
+            samples_.push_back(color & color_mask);
+        }
+    }
+
+    if (samples_.size() < kMinPhotoColors)
+        return false;
+
+    std::sort(samples_.begin(), samples_.end());
+
+    const size_t colors = std::unique(samples_.begin(), samples_.end()) - samples_.begin();
+    return colors >= kMinPhotoColors;
+}
+
+} // namespace desktop
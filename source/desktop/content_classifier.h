@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__CONTENT_CLASSIFIER_H
+#define DESKTOP__CONTENT_CLASSIFIER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+
+// Splits the changed areas of the screen into video (areas that change in most frames and
+// contain many colors, like a playing movie or a game) and the rest (text, user interface,
+// static pictures). The video areas can be sent with a lossy codec and the rest losslessly.
+//
+// The screen is divided into blocks of kBlockSize pixels. For each block the classifier keeps
+// the history of changes in the last frames and the number of colors in the last change.
+class ContentClassifier
+{
+public:
+    static const int kBlockSize = 64;
+
+    ContentClassifier() = default;
+    ~ContentClassifier() = default;
+
+    // Classifies the blocks touched by |dirty_region| of |frame|. The parts of |dirty_region|
+    // located in the video blocks are moved to |video_region|. The blocks that stopped being
+    // video are added to |dirty_region| completely, so they are sent losslessly again.
+    void classify(const Frame* frame, Region* dirty_region, Region* video_region);
+
+    // Returns true if some blocks are video. The client has their lossy image until they are
+    // refreshed, so classify() must be called for the frames without changes too.
+    bool hasVideoBlocks() const;
+
+    // Forgets the history. All blocks become not video.
+    void reset();
+
+private:
+    struct Block
+    {
+        // A bit for each of the last 16 frames, set if the block was changed.
+        uint16_t history = 0;
+        bool video = false;
+    };
+
+    Block& blockAt(int x, int y) { return blocks_[y * blocks_x_ + x]; }
+    Rect blockRect(int x, int y) const;
+
+    // Returns true if the pixels of the block look like a photo or a video.
+    bool isPhotographic(const Frame* frame, const Rect& rect);
+
+    Size size_;
+    int blocks_x_ = 0;
+    int blocks_y_ = 0;
+    std::vector<Block> blocks_;
+
+    // Marks the blocks touched by the dirty region in the current frame.
+    std::vector<uint8_t> changed_;
+    std::vector<uint32_t> samples_;
+
+    DISALLOW_COPY_AND_ASSIGN(ContentClassifier);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__CONTENT_CLASSIFIER_H
@@ -0,0 +1,258 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/content_classifier.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(640, 480);
+
+// The area of the screen where the video is played. Aligned to the blocks.
+const Rect kVideoRect = Rect::makeXYWH(128, 64, 256, 192);
+
+std::unique_ptr<Frame> createFrame()
+{
+    std::unique_ptr<Frame> frame = FrameAligned::create(kScreenSize, PixelFormat::ARGB(), 32);
+    memset(frame->frameData(), 0xFF, frame->stride() * kScreenSize.height());
+    return frame;
+}
+
+void drawNoise(Frame* frame, const Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width() * frame->format().bytesPerPixel(); ++x)
+            row[x] = static_cast<uint8_t>((*random)());
+    }
+}
+
+// Draws the "text" of two colors.
+void drawText(Frame* frame, const Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = ((*random)() % 3) ? 0xFFFFFFFF : 0xFF000000;
+    }
+}
+
+} // namespace
+
+TEST(content_classifier_test, video)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(1);
+    ContentClassifier classifier;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        drawNoise(frame.get(), kVideoRect, &random);
+
+        Region dirty_region(kVideoRect);
+        Region video_region;
+
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+
+        // The block becomes video after it was changed in 10 frames.
+        if (i < 9)
+        {
+            EXPECT_TRUE(video_region.isEmpty()) << i;
+            EXPECT_TRUE(dirty_region.equals(Region(kVideoRect))) << i;
+        }
+        else
+        {
+            EXPECT_TRUE(video_region.equals(Region(kVideoRect))) << i;
+            EXPECT_TRUE(dirty_region.isEmpty()) << i;
+        }
+    }
+}
+
+TEST(content_classifier_test, text)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(2);
+    ContentClassifier classifier;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        drawText(frame.get(), kVideoRect, &random);
+
+        Region dirty_region(kVideoRect);
+        Region video_region;
+
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+
+        EXPECT_TRUE(video_region.isEmpty()) << i;
+        EXPECT_TRUE(dirty_region.equals(Region(kVideoRect))) << i;
+    }
+}
+
+TEST(content_classifier_test, mixed_update)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(3);
+    ContentClassifier classifier;
+
+    const Rect text_rect = Rect::makeXYWH(400, 300, 100, 20);
+
+    Region dirty_region;
+    Region video_region;
+
+    for (int i = 0; i < 12; ++i)
+    {
+        drawNoise(frame.get(), kVideoRect, &random);
+        drawText(frame.get(), text_rect, &random);
+
+        dirty_region.setRect(kVideoRect);
+        dirty_region.addRect(text_rect);
+
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+    }
+
+    EXPECT_TRUE(video_region.equals(Region(kVideoRect)));
+    EXPECT_TRUE(dirty_region.equals(Region(text_rect)));
+
+    // Only the part of the video block touched by the update is sent as video.
+    const Rect small_rect = Rect::makeXYWH(130, 70, 10, 10);
+    drawNoise(frame.get(), small_rect, &random);
+
+    dirty_region.setRect(small_rect);
+    classifier.classify(frame.get(), &dirty_region, &video_region);
+
+    EXPECT_TRUE(video_region.equals(Region(small_rect)));
+    EXPECT_TRUE(dirty_region.isEmpty());
+}
+
+TEST(content_classifier_test, refresh_after_video)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(4);
+    ContentClassifier classifier;
+
+    Region dirty_region;
+    Region video_region;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        drawNoise(frame.get(), kVideoRect, &random);
+        dirty_region.setRect(kVideoRect);
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+    }
+
+    EXPECT_FALSE(video_region.isEmpty());
+
+    // The video is paused. The blocks are sent losslessly once when they stop being video.
+    int refreshes = 0;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        dirty_region.clear();
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+
+        EXPECT_TRUE(video_region.isEmpty());
+
+        if (!dirty_region.isEmpty())
+        {
+            EXPECT_TRUE(dirty_region.equals(Region(kVideoRect)));
+            ++refreshes;
+        }
+    }
+
+    EXPECT_EQ(refreshes, 1);
+}
+
+TEST(content_classifier_test, video_stops_on_static_screen)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(6);
+    ContentClassifier classifier;
+
+    Region dirty_region;
+    Region video_region;
+
+    EXPECT_FALSE(classifier.hasVideoBlocks());
+
+    for (int i = 0; i < 16; ++i)
+    {
+        drawNoise(frame.get(), kVideoRect, &random);
+        dirty_region.setRect(kVideoRect);
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+    }
+
+    EXPECT_TRUE(classifier.hasVideoBlocks());
+
+    // The video stops and nothing else changes on the screen. The captures without changes are
+    // classified while there are video blocks, and the blocks are refreshed losslessly.
+    int idle_frames = 0;
+    Region refresh_region;
+
+    while (classifier.hasVideoBlocks() && idle_frames < 32)
+    {
+        dirty_region.clear();
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+
+        EXPECT_TRUE(video_region.isEmpty());
+        refresh_region.addRegion(dirty_region);
+        ++idle_frames;
+    }
+
+    EXPECT_FALSE(classifier.hasVideoBlocks());
+    EXPECT_LE(idle_frames, 16);
+    EXPECT_TRUE(refresh_region.equals(Region(kVideoRect)));
+}
+
+TEST(content_classifier_test, reset)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(5);
+    ContentClassifier classifier;
+
+    Region dirty_region;
+    Region video_region;
+
+    for (int i = 0; i < 12; ++i)
+    {
+        drawNoise(frame.get(), kVideoRect, &random);
+        dirty_region.setRect(kVideoRect);
+        classifier.classify(frame.get(), &dirty_region, &video_region);
+    }
+
+    EXPECT_FALSE(video_region.isEmpty());
+
+    classifier.reset();
+
+    drawNoise(frame.get(), kVideoRect, &random);
+    dirty_region.setRect(kVideoRect);
+    classifier.classify(frame.get(), &dirty_region, &video_region);
+
+    EXPECT_TRUE(video_region.isEmpty());
+    EXPECT_TRUE(dirty_region.equals(Region(kVideoRect)));
+}
+
+} // namespace desktop
@@ -56,6 +56,36 @@ void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const R
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+void Frame::movePixels(const Point& src_pos, const Rect& dest_rect)
+{
+    const Rect frame_rect = Rect::makeSize(size());
+
+    CHECK(frame_rect.containsRect(dest_rect));
+    CHECK(frame_rect.containsRect(Rect::makeXYWH(src_pos, dest_rect.size())));
+
+    const size_t bytes_per_row = format_.bytesPerPixel() * dest_rect.width();
+
+    uint8_t* src = frameDataAtPos(src_pos);
+    uint8_t* dest = frameDataAtPos(dest_rect.topLeft());
+    int stride = stride_;
+
+    // If the area moves down, the rows are copied from bottom to top so that the source rows are
+    // not overwritten before they are copied.
+    if (dest_rect.top() > src_pos.y())
+    {
+        src += stride * (dest_rect.height() - 1);
+        dest += stride * (dest_rect.height() - 1);
+        stride = -stride;
+    }
+
+    for (int y = 0; y < dest_rect.height(); ++y)
+    {
+        memmove(dest, src, bytes_per_row);
+        src += stride;
+        dest += stride;
+    }
+}
+
 uint8_t* Frame::frameDataAtPos(const Point& pos) const
 {
     return frameDataAtPos(pos.x(), pos.y());
@@ -41,6 +41,10 @@ public:
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Copies the pixels of the area with top-left corner at |src_pos| to |dest_rect| of the same
+    // frame. The areas may overlap.
+    void movePixels(const Point& src_pos, const Rect& dest_rect);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
@@ -29,7 +29,7 @@ FrameAligned::FrameAligned(const Size& size, const PixelFormat& format, int stri
 
 FrameAligned::~FrameAligned()
 {
-    base::alignedFree(data_);
+    base::AlignedMemoryPool::instance()->release(data_);
 }
 
 // static
@@ -38,8 +38,10 @@ std::unique_ptr<FrameAligned> FrameAligned::create(
 {
     int bytes_per_row = size.width() * format.bytesPerPixel();
 
-    uint8_t* data =
-        reinterpret_cast<uint8_t*>(base::alignedAlloc(bytes_per_row * size.height(), alignment));
+    // Frames are recreated every time the screen resolution or the pixel format is changed, so
+    // the memory is borrowed from the pool.
+    uint8_t* data = reinterpret_cast<uint8_t*>(base::AlignedMemoryPool::instance()->allocate(
+        bytes_per_row * size.height(), alignment));
     if (!data)
         return nullptr;
 
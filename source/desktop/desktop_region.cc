@@ -15,11 +15,12 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 //
-
 #include "desktop/desktop_region.h"
 
 #include <assert.h>
 #include <algorithm>
+#include <iterator>
+#include <limits>
 
 namespace desktop {
 
@@ -29,19 +30,12 @@ Region::RowSpan::RowSpan(int32_t left, int32_t right)
     // Nothing
 }
 
-Region::Row::Row(const Row&) = default;
-Region::Row::Row(Row&&) noexcept = default;
-
-Region::Row::Row(int32_t top, int32_t bottom) :
-    top(top), bottom(bottom)
+Region::Band::Band(int32_t top, int32_t bottom, int32_t first_span, int32_t last_span)
+    : top(top), bottom(bottom), first_span(first_span), last_span(last_span)
 {
     // Nothing
 }
 
-Region::Row::~Row() = default;
-
-Region::Row& Region::Row::operator=(const Row& other) = default;
-
 Region::Region() = default;
 
 Region::Region(const Rect& rect)
@@ -54,85 +48,57 @@ Region::Region(const Rect* rects, int count)
     addRects(rects, count);
 }
 
-Region::Region(const Region& other)
-{
-    *this = other;
-}
+Region::Region(const Region& other) = default;
 
 Region::Region(Region&& other)
 {
     *this = std::move(other);
 }
 
-Region::~Region()
-{
-    clear();
-}
-
-Region& Region::operator=(const Region& other)
-{
-    if (this == &other)
-        return *this;
-
-    clear();
-    rows_ = other.rows_;
-
-    for (Rows::iterator it = rows_.begin(); it != rows_.end(); ++it)
-    {
-        // Copy each row.
-        Row* row = it->second;
-        it->second = new Row(*row);
-    }
+Region::~Region() = default;
 
-    return *this;
-}
+Region& Region::operator=(const Region& other) = default;
 
 Region& Region::operator=(Region&& other)
 {
     if (this == &other)
         return *this;
 
-    clear();
-    rows_ = std::move(other.rows_);
+    bands_ = std::move(other.bands_);
+    spans_ = std::move(other.spans_);
+
+    other.clear();
     return *this;
 }
 
 bool Region::equals(const Region& region) const
 {
-    // Iterate over rows of the tow regions and compare each row.
-    Rows::const_iterator it1 = rows_.begin();
-    Rows::const_iterator it2 = region.rows_.begin();
+    if (bands_.size() != region.bands_.size() || spans_.size() != region.spans_.size())
+        return false;
 
-    while (it1 != rows_.end())
+    // The spans are stored without gaps in the order of the bands, so equal regions have equal
+    // arrays.
+    for (size_t i = 0; i < bands_.size(); ++i)
     {
-        if (it2 == region.rows_.end() || it1->first != it2->first)
-            return false;
+        const Band& band1 = bands_[i];
+        const Band& band2 = region.bands_[i];
 
-        const Row* row1 = it1->second;
-        const Row* row2 = it2->second;
-
-        if (row1->top != row2->top ||
-            row1->bottom != row2->bottom ||
-            row1->spans != row2->spans)
+        if (band1.top != band2.top ||
+            band1.bottom != band2.bottom ||
+            band1.first_span != band2.first_span ||
+            band1.last_span != band2.last_span)
         {
             return false;
         }
-
-        ++it1;
-        ++it2;
     }
 
-    return it2 == region.rows_.end();
+    return spans_ == region.spans_;
 }
 
 void Region::clear()
 {
-    for (Rows::iterator row = rows_.begin(); row != rows_.end(); ++row)
-    {
-        delete row->second;
-    }
-
-    rows_.clear();
+    bands_.clear();
+    spans_.clear();
 }
 
 void Region::setRect(const Rect& rect)
@@ -146,62 +112,17 @@ void Region::addRect(const Rect& rect)
     if (rect.isEmpty())
         return;
 
-    // Top of the part of the |rect| that hasn't been inserted yet. Increased as
-    // we iterate over the rows until it reaches |rect.bottom()|.
-    int top = rect.top();
-
-    // Iterate over all rows that may intersect with |rect| and add new rows when
-    // necessary.
-    Rows::iterator row = rows_.upper_bound(top);
-    while (top < rect.bottom())
+    // Rectangles are often added from top to bottom (for example, by the differ). If |rect| is
+    // below all the bands, it is simply appended.
+    if (bands_.empty() || rect.top() >= bands_.back().bottom)
     {
-        if (row == rows_.end() || top < row->second->top)
-        {
-            // If |top| is above the top of the current |row| then add a new row above
-            // the current one.
-            int32_t bottom = rect.bottom();
-
-            if (row != rows_.end() && row->second->top < bottom)
-                bottom = row->second->top;
-
-            row = rows_.insert(row, Rows::value_type(bottom, new Row(top, bottom)));
-        }
-        else if (top > row->second->top)
-        {
-            // If the |top| falls in the middle of the |row| then split |row| into
-            // two, at |top|, and leave |row| referring to the lower of the two,
-            // ready to insert a new span into.
-            assert(top <= row->second->bottom);
-            Rows::iterator new_row =
-                rows_.insert(row, Rows::value_type(top, new Row(row->second->top, top)));
-            row->second->top = top;
-            new_row->second->spans = row->second->spans;
-        }
-
-        if (rect.bottom() < row->second->bottom)
-        {
-            // If the bottom of the |rect| falls in the middle of the |row| split
-            // |row| into two, at |top|, and leave |row| referring to the upper of
-            // the two, ready to insert a new span into.
-            Rows::iterator new_row =
-                rows_.insert(row, Rows::value_type(rect.bottom(), new Row(top, rect.bottom())));
-            row->second->top = rect.bottom();
-            new_row->second->spans = row->second->spans;
-            row = new_row;
-        }
-
-        // Add a new span to the current row.
-        addSpanToRow(row->second, rect.left(), rect.right());
-        top = row->second->bottom;
-
-        mergeWithPrecedingRow(row);
-
-        // Move to the next row.
-        ++row;
+        const size_t first_span = spans_.size();
+        spans_.emplace_back(rect.left(), rect.right());
+        appendBand(rect.top(), rect.bottom(), first_span);
+        return;
     }
 
-    if (row != rows_.end())
-        mergeWithPrecedingRow(row);
+    combineWithRect(rect, Operation::UNION);
 }
 
 void Region::addRects(const Rect* rects, int count)
@@ -212,293 +133,415 @@ void Region::addRects(const Rect* rects, int count)
     }
 }
 
-void Region::mergeWithPrecedingRow(Rows::iterator row_it)
+void Region::addRegion(const Region& region)
 {
-    assert(row_it != rows_.end());
+    if (this == &region || region.isEmpty())
+        return;
 
-    if (row_it != rows_.begin())
+    if (isEmpty())
     {
-        Rows::iterator previous_row_it = row_it;
-        --previous_row_it;
-
-        Row* previous_row = previous_row_it->second;
-        Row* row = row_it->second;
-
-        // If |row| and |previous_row| are next to each other and contain the same
-        // set of spans then they can be merged.
-        if (previous_row->bottom == row->top &&
-            previous_row->spans == row->spans)
-        {
-            row->top = previous_row->top;
-            delete previous_row;
-            rows_.erase(previous_row_it);
-        }
+        *this = region;
+        return;
     }
+
+    combineWith(region.bandList(), Operation::UNION);
 }
 
-void Region::addRegion(const Region& region)
+void Region::intersect(const Region& region1, const Region& region2)
 {
-    // TODO(sergeyu): This function is not optimized - potentially it can iterate
-    // over rows of the two regions similar to how it works in Intersect().
-    for (Iterator it(region); !it.isAtEnd(); it.advance())
+    if (this == &region1)
+    {
+        intersectWith(region2);
+        return;
+    }
+
+    if (this == &region2)
     {
-        addRect(it.rect());
+        intersectWith(region1);
+        return;
     }
+
+    clear();
+    combine(region1.bandList(), region2.bandList(), Operation::INTERSECT);
 }
 
-void Region::intersect(const Region& region1, const Region& region2)
+void Region::intersectWith(const Region& region)
 {
-    clear();
+    if (this == &region)
+        return;
 
-    Rows::const_iterator it1 = region1.rows_.begin();
-    Rows::const_iterator end1 = region1.rows_.end();
-    Rows::const_iterator it2 = region2.rows_.begin();
-    Rows::const_iterator end2 = region2.rows_.end();
+    combineWith(region.bandList(), Operation::INTERSECT);
+}
 
-    if (it1 == end1 || it2 == end2)
+void Region::intersectWith(const Rect& rect)
+{
+    if (rect.isEmpty())
+    {
+        clear();
         return;
+    }
+
+    const Band rect_band(rect.top(), rect.bottom(), 0, 1);
+    const RowSpan rect_span(rect.left(), rect.right());
+
+    combineWith({ &rect_band, 1, &rect_span }, Operation::INTERSECT);
+}
 
-    while (it1 != end1 && it2 != end2)
+void Region::subtract(const Region& region)
+{
+    if (this == &region)
     {
-        // Arrange for |it1| to always be the top-most of the rows.
-        if (it2->second->top < it1->second->top)
-        {
-            std::swap(it1, it2);
-            std::swap(end1, end2);
-        }
+        clear();
+        return;
+    }
 
-        // Skip |it1| if it doesn't intersect |it2| at all.
-        if (it1->second->bottom <= it2->second->top)
-        {
-            ++it1;
-            continue;
-        }
+    if (isEmpty() || region.isEmpty())
+        return;
 
-        // Top of the |it1| row is above the top of |it2|, so top of the
-        // intersection is always the top of |it2|.
-        int32_t top = it2->second->top;
-        int32_t bottom = std::min(it1->second->bottom, it2->second->bottom);
+    combineWith(region.bandList(), Operation::SUBTRACT);
+}
+
+void Region::subtract(const Rect& rect)
+{
+    if (isEmpty() || rect.isEmpty())
+        return;
 
-        Rows::iterator new_row =
-            rows_.insert(rows_.end(), Rows::value_type(bottom, new Row(top, bottom)));
+    combineWithRect(rect, Operation::SUBTRACT);
+}
 
-        intersectRows(it1->second->spans, it2->second->spans, new_row->second->spans);
-        if (new_row->second->spans.empty())
+void Region::translate(int32_t dx, int32_t dy)
+{
+    if (dy != 0)
+    {
+        for (auto& band : bands_)
         {
-            delete new_row->second;
-            rows_.erase(new_row);
+            band.top += dy;
+            band.bottom += dy;
         }
-        else
+    }
+
+    if (dx != 0)
+    {
+        for (auto& span : spans_)
         {
-            mergeWithPrecedingRow(new_row);
+            span.left += dx;
+            span.right += dx;
         }
-
-        // If |it1| was completely consumed, move to the next one.
-        if (it1->second->bottom == bottom)
-            ++it1;
-        // If |it2| was completely consumed, move to the next one.
-        if (it2->second->bottom == bottom)
-            ++it2;
     }
 }
 
+void Region::swap(Region* region)
+{
+    bands_.swap(region->bands_);
+    spans_.swap(region->spans_);
+}
+
+Region::BandList Region::bandList() const
+{
+    return { bands_.data(), bands_.size(), spans_.data() };
+}
+
 // static
-void Region::intersectRows(const RowSpanSet& set1, const RowSpanSet& set2, RowSpanSet& output)
+Region& Region::scratchRegion()
 {
-    RowSpanSet::const_iterator it1 = set1.begin();
-    RowSpanSet::const_iterator end1 = set1.end();
-    RowSpanSet::const_iterator it2 = set2.begin();
-    RowSpanSet::const_iterator end2 = set2.end();
-    assert(it1 != end1 && it2 != end2);
+    // The buffers of the region keep their capacity, so in most cases the operations do not
+    // allocate memory.
+    thread_local Region region;
+    return region;
+}
 
-    do
+void Region::combine(const BandList& list1, const BandList& list2, Operation operation)
+{
+    size_t index1 = 0;
+    size_t index2 = 0;
+
+    int32_t top = std::numeric_limits<int32_t>::min();
+
+    while (index1 < list1.count || index2 < list2.count)
     {
-        // Arrange for |it1| to always be the left-most of the spans.
-        if (it2->left < it1->left)
-        {
-            std::swap(it1, it2);
-            std::swap(end1, end2);
-        }
+        const Band* band1 = (index1 < list1.count) ? &list1.bands[index1] : nullptr;
+        const Band* band2 = (index2 < list2.count) ? &list2.bands[index2] : nullptr;
 
-        // Skip |it1| if it doesn't intersect |it2| at all.
-        if (it1->right <= it2->left)
+        // The rest of the result is empty.
+        if (operation == Operation::INTERSECT && (!band1 || !band2))
+            break;
+        if (operation == Operation::SUBTRACT && !band1)
+            break;
+
+        // Skip the space where both lists have no bands.
+        int32_t next_top = std::numeric_limits<int32_t>::max();
+        if (band1)
+            next_top = band1->top;
+        if (band2)
+            next_top = std::min(next_top, band2->top);
+
+        top = std::max(top, next_top);
+
+        const bool inside1 = band1 && band1->top <= top;
+        const bool inside2 = band2 && band2->top <= top;
+
+        // The current piece ends where any of the bands starts or ends.
+        int32_t bottom = std::numeric_limits<int32_t>::max();
+        if (band1)
+            bottom = std::min(bottom, inside1 ? band1->bottom : band1->top);
+        if (band2)
+            bottom = std::min(bottom, inside2 ? band2->bottom : band2->top);
+
+        assert(top < bottom);
+
+        const RowSpan* begin1 = inside1 ? list1.spans + band1->first_span : nullptr;
+        const RowSpan* end1 = inside1 ? list1.spans + band1->last_span : nullptr;
+        const RowSpan* begin2 = inside2 ? list2.spans + band2->first_span : nullptr;
+        const RowSpan* end2 = inside2 ? list2.spans + band2->last_span : nullptr;
+
+        const size_t first_span = spans_.size();
+
+        switch (operation)
         {
-            ++it1;
-            continue;
+            case Operation::UNION:
+                unionSpans(begin1, end1, begin2, end2, spans_);
+                break;
+
+            case Operation::INTERSECT:
+                if (inside1 && inside2)
+                    intersectSpans(begin1, end1, begin2, end2, spans_);
+                break;
+
+            case Operation::SUBTRACT:
+                if (inside1)
+                    subtractSpans(begin1, end1, begin2, end2, spans_);
+                break;
         }
 
-        int32_t left = it2->left;
-        int32_t right = std::min(it1->right, it2->right);
-        assert(left < right);
+        appendBand(top, bottom, first_span);
 
-        output.emplace_back(left, right);
+        top = bottom;
 
-        // If |it1| was completely consumed, move to the next one.
-        if (it1->right == right)
-            ++it1;
-        // If |it2| was completely consumed, move to the next one.
-        if (it2->right == right)
-            ++it2;
+        if (band1 && band1->bottom <= top)
+            ++index1;
+        if (band2 && band2->bottom <= top)
+            ++index2;
     }
-    while (it1 != end1 && it2 != end2);
 }
 
-void Region::intersectWith(const Region& region)
+void Region::combineWith(const BandList& list, Operation operation)
 {
-    Region old_region;
-    swap(&old_region);
-    intersect(old_region, region);
-}
+    // The current content is moved to the scratch region and the memory of the scratch region
+    // is used for the result.
+    Region& current = scratchRegion();
+    swap(&current);
+    clear();
 
-void Region::intersectWith(const Rect& rect)
-{
-    Region region;
-    region.addRect(rect);
-    intersectWith(region);
+    combine(current.bandList(), list, operation);
 }
 
-void Region::subtract(const Region& region)
+void Region::combineWithRect(const Rect& rect, Operation operation)
 {
-    if (region.rows_.empty())
+    assert(operation == Operation::UNION || operation == Operation::SUBTRACT);
+
+    // Only the bands that intersect |rect| vertically can change. Find the first band that ends
+    // below the top of |rect| and the first band that starts at or below the bottom of |rect|.
+    Bands::iterator first_band = std::upper_bound(
+        bands_.begin(), bands_.end(), rect.top(), [](int32_t value, const Band& band)
+    {
+        return value < band.bottom;
+    });
+
+    Bands::iterator last_band = std::lower_bound(
+        first_band, bands_.end(), rect.bottom(), [](const Band& band, int32_t value)
+    {
+        return band.top < value;
+    });
+
+    if (first_band == last_band && operation == Operation::SUBTRACT)
+        return;
+
+    const size_t first_index = first_band - bands_.begin();
+    const size_t last_index = last_band - bands_.begin();
+
+    // Rectangles of the same row are often added from left to right. If |rect| matches an
+    // existing band vertically, the span is inserted into the band in place.
+    if (operation == Operation::UNION &&
+        last_index == first_index + 1 &&
+        first_band->top == rect.top() &&
+        first_band->bottom == rect.bottom())
+    {
+        addSpanToBand(first_index, rect.left(), rect.right());
+
+        mergeWithPrecedingBand(first_index + 1);
+        mergeWithPrecedingBand(first_index);
         return;
+    }
+
+    const Band rect_band(rect.top(), rect.bottom(), 0, 1);
+    const RowSpan rect_span(rect.left(), rect.right());
+
+    // Calculate the new bands in the scratch region.
+    Region& result = scratchRegion();
+    result.clear();
+    result.combine({ bands_.data() + first_index, last_index - first_index, spans_.data() },
+                   { &rect_band, 1, &rect_span },
+                   operation);
+
+    const int32_t first_span =
+        (first_band != bands_.end()) ? first_band->first_span : static_cast<int32_t>(spans_.size());
+    const int32_t last_span =
+        (last_band != bands_.end()) ? last_band->first_span : static_cast<int32_t>(spans_.size());
 
-    // |row_b| refers to the current row being subtracted.
-    Rows::const_iterator row_b = region.rows_.begin();
+    // Replace the spans.
+    const int32_t old_span_count = last_span - first_span;
+    const int32_t new_span_count = static_cast<int32_t>(result.spans_.size());
 
-    // Current vertical position at which subtraction is happening.
-    int top = row_b->second->top;
+    if (new_span_count > old_span_count)
+        spans_.insert(spans_.begin() + last_span, new_span_count - old_span_count, RowSpan());
+    else if (new_span_count < old_span_count)
+        spans_.erase(spans_.begin() + first_span + new_span_count, spans_.begin() + last_span);
 
-  // |row_a| refers to the current row we are subtracting from. Skip all rows
-  // above |top|.
-  Rows::iterator row_a = rows_.upper_bound(top);
+    std::copy(result.spans_.begin(), result.spans_.end(), spans_.begin() + first_span);
 
-    // Step through rows of the both regions subtracting content of |row_b| from
-    // |row_a|.
-    while (row_a != rows_.end() && row_b != region.rows_.end())
+    // Replace the bands.
+    const size_t old_band_count = last_index - first_index;
+    const size_t new_band_count = result.bands_.size();
+
+    if (new_band_count > old_band_count)
+        bands_.insert(bands_.begin() + last_index, new_band_count - old_band_count, Band());
+    else if (new_band_count < old_band_count)
+        bands_.erase(bands_.begin() + first_index + new_band_count, bands_.begin() + last_index);
+
+    for (size_t i = 0; i < new_band_count; ++i)
     {
-        // Skip |row_a| if it doesn't intersect with the |row_b|.
-        if (row_a->second->bottom <= top)
-        {
-            // Each output row is merged with previously-processed rows before further
-            // rows are processed.
-            mergeWithPrecedingRow(row_a);
-            ++row_a;
-            continue;
-        }
+        const Band& band = result.bands_[i];
 
-        if (top > row_a->second->top)
-        {
-            // If |top| falls in the middle of |row_a| then split |row_a| into two, at
-            // |top|, and leave |row_a| referring to the lower of the two, ready to
-            // subtract spans from.
-            assert(top <= row_a->second->bottom);
-            Rows::iterator new_row =
-                rows_.insert(row_a, Rows::value_type(top, new Row(row_a->second->top, top)));
-
-            row_a->second->top = top;
-            new_row->second->spans = row_a->second->spans;
-        }
-        else if (top < row_a->second->top)
-        {
-            // If the |top| is above |row_a| then skip the range between |top| and
-            // top of |row_a| because it's empty.
-            top = row_a->second->top;
-            if (top >= row_b->second->bottom)
-            {
-                ++row_b;
-                if (row_b != region.rows_.end())
-                    top = row_b->second->top;
-                continue;
-            }
-        }
+        bands_[first_index + i] = Band(band.top, band.bottom,
+                                       band.first_span + first_span,
+                                       band.last_span + first_span);
+    }
 
-        if (row_b->second->bottom < row_a->second->bottom)
+    // The spans of the following bands have been moved.
+    const int32_t span_shift = new_span_count - old_span_count;
+    if (span_shift != 0)
+    {
+        for (size_t i = first_index + new_band_count; i < bands_.size(); ++i)
         {
-            // If the bottom of |row_b| falls in the middle of the |row_a| split
-            // |row_a| into two, at |top|, and leave |row_a| referring to the upper of
-            // the two, ready to subtract spans from.
-            int bottom = row_b->second->bottom;
-            Rows::iterator new_row =
-                rows_.insert(row_a, Rows::value_type(bottom, new Row(top, bottom)));
-            row_a->second->top = bottom;
-            new_row->second->spans = row_a->second->spans;
-            row_a = new_row;
+            bands_[i].first_span += span_shift;
+            bands_[i].last_span += span_shift;
         }
+    }
 
-        // At this point the vertical range covered by |row_a| lays within the
-        // range covered by |row_b|. Subtract |row_b| spans from |row_a|.
-        RowSpanSet new_spans;
-        subtractRows(row_a->second->spans, row_b->second->spans, new_spans);
-        new_spans.swap(row_a->second->spans);
-        top = row_a->second->bottom;
+    // The new bands may be identical to the unchanged neighbours.
+    mergeWithPrecedingBand(first_index + new_band_count);
+    mergeWithPrecedingBand(first_index);
+}
 
-        if (top >= row_b->second->bottom)
-        {
-            ++row_b;
-            if (row_b != region.rows_.end())
-                top = row_b->second->top;
-        }
+void Region::addSpanToBand(size_t index, int32_t left, int32_t right)
+{
+    Band& band = bands_[index];
+
+    const RowSpans::iterator begin = spans_.begin() + band.first_span;
+    const RowSpans::iterator end = spans_.begin() + band.last_span;
+
+    int32_t shift;
+
+    if (left > std::prev(end)->right)
+    {
+        // The new span is located to the right of all existing spans.
+        spans_.emplace(end, left, right);
+        shift = 1;
+    }
+    else
+    {
+        // Find the first span that ends at or after |left|.
+        const RowSpans::iterator start = std::lower_bound(begin, end, left, compareSpanRight);
 
-        // Check if the row is empty after subtraction and delete it. Otherwise move
-        // to the next one.
-        if (row_a->second->spans.empty())
+        // Find the first span that starts after |right|.
+        const RowSpans::iterator stop = std::lower_bound(start, end, right + 1, compareSpanLeft);
+
+        if (start == stop)
         {
-            Rows::iterator row_to_delete = row_a;
-            ++row_a;
-            delete row_to_delete->second;
-            rows_.erase(row_to_delete);
+            // There are no overlaps. Just insert the new span at the correct position.
+            spans_.emplace(start, left, right);
+            shift = 1;
         }
         else
         {
-            mergeWithPrecedingRow(row_a);
-            ++row_a;
+            // Replace the range [start, stop) with the new span.
+            *start = RowSpan(std::min(left, start->left), std::max(right, std::prev(stop)->right));
+            spans_.erase(std::next(start), stop);
+            shift = 1 - static_cast<int32_t>(stop - start);
         }
     }
 
-    if (row_a != rows_.end())
-        mergeWithPrecedingRow(row_a);
-}
+    if (shift == 0)
+        return;
 
-void Region::subtract(const Rect& rect)
-{
-    Region region;
-    region.addRect(rect);
-    subtract(region);
+    band.last_span += shift;
+
+    for (size_t i = index + 1; i < bands_.size(); ++i)
+    {
+        bands_[i].first_span += shift;
+        bands_[i].last_span += shift;
+    }
 }
 
-void Region::translate(int32_t dx, int32_t dy)
+void Region::mergeWithPrecedingBand(size_t index)
 {
-    Rows new_rows;
+    if (index == 0 || index >= bands_.size())
+        return;
+
+    Band& previous_band = bands_[index - 1];
+    const Band& band = bands_[index];
 
-    for (Rows::iterator it = rows_.begin(); it != rows_.end(); ++it)
+    const int32_t span_count = band.last_span - band.first_span;
+
+    if (previous_band.bottom != band.top ||
+        previous_band.last_span - previous_band.first_span != span_count ||
+        !std::equal(spans_.begin() + previous_band.first_span,
+                    spans_.begin() + previous_band.last_span,
+                    spans_.begin() + band.first_span))
     {
-        Row* row = it->second;
+        return;
+    }
 
-        row->top += dy;
-        row->bottom += dy;
+    previous_band.bottom = band.bottom;
 
-        if (dx != 0)
-        {
-            // Translate each span.
-            for (RowSpanSet::iterator span = row->spans.begin();
-                 span != row->spans.end(); ++span)
-            {
-                span->left += dx;
-                span->right += dx;
-            }
-        }
+    spans_.erase(spans_.begin() + band.first_span, spans_.begin() + band.last_span);
+    bands_.erase(bands_.begin() + index);
 
-        if (dy != 0)
-            new_rows.insert(new_rows.end(), Rows::value_type(row->bottom, row));
+    for (size_t i = index; i < bands_.size(); ++i)
+    {
+        bands_[i].first_span -= span_count;
+        bands_[i].last_span -= span_count;
     }
-
-    if (dy != 0)
-        new_rows.swap(rows_);
 }
 
-void Region::swap(Region* region)
+void Region::appendBand(int32_t top, int32_t bottom, size_t first_span)
 {
-    rows_.swap(region->rows_);
+    const size_t last_span = spans_.size();
+    if (first_span == last_span)
+        return;
+
+    if (!bands_.empty())
+    {
+        Band& last_band = bands_.back();
+
+        // If the bands are next to each other and contain the same set of spans then they can
+        // be merged.
+        if (last_band.bottom == top &&
+            static_cast<size_t>(last_band.last_span - last_band.first_span) ==
+                last_span - first_span &&
+            std::equal(spans_.begin() + last_band.first_span,
+                       spans_.begin() + last_band.last_span,
+                       spans_.begin() + first_span))
+        {
+            last_band.bottom = bottom;
+            spans_.resize(first_span);
+            return;
+        }
+    }
+
+    bands_.emplace_back(top, bottom,
+                        static_cast<int32_t>(first_span),
+                        static_cast<int32_t>(last_span));
 }
 
 // static
@@ -513,90 +556,107 @@ bool Region::compareSpanLeft(const RowSpan& r, int32_t value)
     return r.left < value;
 }
 
+bool Region::isSpanInBand(const Band& band, const RowSpan& span) const
+{
+    // Find the first span that starts at or after |span.left| and then check if
+    // it's the same span.
+    const RowSpan* begin = spans_.data() + band.first_span;
+    const RowSpan* end = spans_.data() + band.last_span;
+    const RowSpan* it = std::lower_bound(begin, end, span.left, compareSpanLeft);
+
+    return it != end && *it == span;
+}
+
 // static
-void Region::addSpanToRow(Row* row, int32_t left, int32_t right)
+void Region::unionSpans(const RowSpan* begin1, const RowSpan* end1,
+                        const RowSpan* begin2, const RowSpan* end2,
+                        RowSpans& output)
 {
-    // First check if the new span is located to the right of all existing spans.
-    // This is an optimization to avoid binary search in the case when rectangles
-    // are inserted sequentially from left to right.
-    if (row->spans.empty() || left > row->spans.back().right)
+    const size_t first = output.size();
+
+    while (begin1 != end1 || begin2 != end2)
     {
-        row->spans.emplace_back(left, right);
-        return;
-    }
+        // Take the left-most of the spans.
+        const RowSpan* span;
 
-    // Find the first span that ends at or after |left|.
-    RowSpanSet::iterator start =
-        std::lower_bound(row->spans.begin(), row->spans.end(), left, compareSpanRight);
-    assert(start < row->spans.end());
+        if (begin2 == end2 || (begin1 != end1 && begin1->left <= begin2->left))
+            span = begin1++;
+        else
+            span = begin2++;
 
-    // Find the first span that starts after |right|.
-    RowSpanSet::iterator end =
-        std::lower_bound(start, row->spans.end(), right + 1, compareSpanLeft);
-    if (end == row->spans.begin())
-    {
-        // There are no overlaps. Just insert the new span at the beginning.
-        row->spans.insert(row->spans.begin(), RowSpan(left, right));
-        return;
+        // Overlapping and adjacent spans are coalesced.
+        if (output.size() > first && output.back().right >= span->left)
+            output.back().right = std::max(output.back().right, span->right);
+        else
+            output.emplace_back(*span);
     }
+}
 
-    // Move end to the left, so that it points the last span that ends at or
-    // before |right|.
-    --end;
+// static
+void Region::intersectSpans(const RowSpan* begin1, const RowSpan* end1,
+                            const RowSpan* begin2, const RowSpan* end2,
+                            RowSpans& output)
+{
+    const RowSpan* it1 = begin1;
+    const RowSpan* it2 = begin2;
+    assert(it1 != end1 && it2 != end2);
 
-    // At this point [start, end] is the range of spans that intersect with the
-    // new one.
-    if (end < start)
+    do
     {
-        // There are no overlaps. Just insert the new span at the correct position.
-        row->spans.insert(start, RowSpan(left, right));
-        return;
-    }
+        // Arrange for |it1| to always be the left-most of the spans.
+        if (it2->left < it1->left)
+        {
+            std::swap(it1, it2);
+            std::swap(end1, end2);
+        }
 
-    left = std::min(left, start->left);
-    right = std::max(right, end->right);
+        // Skip |it1| if it doesn't intersect |it2| at all.
+        if (it1->right <= it2->left)
+        {
+            ++it1;
+            continue;
+        }
 
-    // Replace range [start, end] with the new span.
-    *start = RowSpan(left, right);
-    ++start;
-    ++end;
-    if (start < end)
-        row->spans.erase(start, end);
-}
+        int32_t left = it2->left;
+        int32_t right = std::min(it1->right, it2->right);
+        assert(left < right);
 
-// static
-bool Region::isSpanInRow(const Row& row, const RowSpan& span)
-{
-    // Find the first span that starts at or after |span.left| and then check if
-    // it's the same span.
-    RowSpanSet::const_iterator it =
-        std::lower_bound(row.spans.begin(), row.spans.end(), span.left, compareSpanLeft);
+        output.emplace_back(left, right);
 
-    return it != row.spans.end() && *it == span;
+        // If |it1| was completely consumed, move to the next one.
+        if (it1->right == right)
+            ++it1;
+        // If |it2| was completely consumed, move to the next one.
+        if (it2->right == right)
+            ++it2;
+    }
+    while (it1 != end1 && it2 != end2);
 }
 
 // static
-void Region::subtractRows(const RowSpanSet& set_a, const RowSpanSet& set_b, RowSpanSet& output)
+void Region::subtractSpans(const RowSpan* begin_a, const RowSpan* end_a,
+                           const RowSpan* begin_b, const RowSpan* end_b,
+                           RowSpans& output)
 {
-    assert(!set_a.empty() && !set_b.empty());
+    assert(begin_a != end_a);
 
-    RowSpanSet::const_iterator it_b = set_b.begin();
+    const RowSpan* it_b = begin_b;
 
-    // Iterate over all spans in |set_a| adding parts of it that do not intersect
-    // with |set_b| to the |output|.
-    for (RowSpanSet::const_iterator it_a = set_a.begin(); it_a != set_a.end(); ++it_a)
+    // Iterate over all spans in |a| adding parts of it that do not intersect
+    // with |b| to the |output|.
+    for (const RowSpan* it_a = begin_a; it_a != end_a; ++it_a)
     {
         // If there is no intersection then append the current span and continue.
-        if (it_b == set_b.end() || it_a->right < it_b->left)
+        if (it_b == end_b || it_a->right < it_b->left)
         {
             output.emplace_back(*it_a);
             continue;
         }
 
-        // Iterate over |set_b| spans that may intersect with |it_a|.
+        // Iterate over |b| spans that may intersect with |it_a|.
         int pos = it_a->left;
 
-        while (it_b != set_b.end() && it_b->left < it_a->right)
+        while (it_b != end_b && it_b->left < it_a->right)
         {
             if (it_b->left > pos)
                 output.emplace_back(pos, it_b->left);
@@ -615,21 +675,18 @@ void Region::subtractRows(const RowSpanSet& set_a, const RowSpanSet& set_b, RowS
 }
 
 Region::Iterator::Iterator(const Region& region)
-    : region_(region),
-      row_(region.rows_.begin()),
-      previous_row_(region.rows_.end())
+    : region_(region)
 {
     if (!isAtEnd())
     {
-        assert(row_->second->spans.size() > 0);
-        row_span_ = row_->second->spans.begin();
+        span_ = region_.bands_[band_].first_span;
         updateCurrentRect();
     }
 }
 
 bool Region::Iterator::isAtEnd() const
 {
-    return row_ == region_.rows_.end();
+    return band_ >= region_.bands_.size();
 }
 
 void Region::Iterator::advance()
@@ -638,29 +695,30 @@ void Region::Iterator::advance()
 
     for (;;)
     {
-        ++row_span_;
-        if (row_span_ == row_->second->spans.end())
+        ++span_;
+        if (span_ == region_.bands_[band_].last_span)
         {
-            previous_row_ = row_;
-            ++row_;
-            if (row_ != region_.rows_.end())
-            {
-                assert(row_->second->spans.size() > 0);
-                row_span_ = row_->second->spans.begin();
-            }
-        }
+            ++band_;
+            if (isAtEnd())
+                return;
 
-        if (isAtEnd())
-            return;
+            span_ = region_.bands_[band_].first_span;
+        }
 
-        // If the same span exists on the previous row then skip it, as we've
+        // If the same span exists on the previous band then skip it, as we've
         // already returned this span merged into the previous one, via
-        // UpdateCurrentRect().
-        if (previous_row_ != region_.rows_.end() &&
-            previous_row_->second->bottom == row_->second->top &&
-            isSpanInRow(*previous_row_->second, *row_span_))
+        // updateCurrentRect().
+        const Band& band = region_.bands_[band_];
+
+        if (band_ != 0)
         {
-            continue;
+            const Band& previous_band = region_.bands_[band_ - 1];
+
+            if (previous_band.bottom == band.top &&
+                region_.isSpanInBand(previous_band, region_.spans_[span_]))
+            {
+                continue;
+            }
         }
 
         break;
@@ -672,20 +730,20 @@ void Region::Iterator::advance()
 
 void Region::Iterator::updateCurrentRect()
 {
-    // Merge the current rectangle with the matching spans from later rows.
-    int bottom;
-    Rows::const_iterator bottom_row = row_;
-    Rows::const_iterator previous;
-    do
+    const RowSpan& span = region_.spans_[span_];
+
+    // Merge the current rectangle with the matching spans from later bands.
+    size_t bottom_band = band_;
+
+    while (bottom_band + 1 < region_.bands_.size() &&
+           region_.bands_[bottom_band].bottom == region_.bands_[bottom_band + 1].top &&
+           region_.isSpanInBand(region_.bands_[bottom_band + 1], span))
     {
-        bottom = bottom_row->second->bottom;
-        previous = bottom_row;
-        ++bottom_row;
-    } while (bottom_row != region_.rows_.end() &&
-             previous->second->bottom == bottom_row->second->top &&
-             isSpanInRow(*bottom_row->second, *row_span_));
-
-    rect_ = Rect::makeLTRB(row_span_->left, row_->second->top, row_span_->right, bottom);
+        ++bottom_band;
+    }
+
+    rect_ = Rect::makeLTRB(span.left, region_.bands_[band_].top,
+                           span.right, region_.bands_[bottom_band].bottom);
 }
 
 } // namespace desktop
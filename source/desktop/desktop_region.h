@@ -25,27 +25,29 @@
 #include <tbb/scalable_allocator.h>
 #endif // defined(USE_TBB)
 
-#include <map>
 #include <vector>
 
 namespace desktop {
 
 // Region represents a region of the screen or window.
 //
-// Internally each region is stored as a set of rows where each row contains one
-// or more rectangles aligned vertically.
+// Internally each region is stored as a sorted list of bands where each band contains one or more
+// non-overlapping spans aligned vertically. The bands and the spans of all bands are kept in two
+// contiguous arrays, so the operations do not allocate memory per row and walk the memory
+// linearly. Adjacent bands with the same spans are always merged, so the representation of a
+// region is unique.
 class Region
 {
 private:
     // The following private types need to be declared first because they are used
     // in the public Iterator.
 
-    // RowSpan represents a horizontal span withing a single row.
+    // RowSpan represents a horizontal span withing a single band.
     struct RowSpan
     {
+        RowSpan() = default;
         RowSpan(int32_t left, int32_t right);
 
-        // Used by std::vector<>.
         bool operator==(const RowSpan& that) const
         {
             return left == that.left && right == that.right;
@@ -55,42 +57,29 @@ private:
         int32_t right;
     };
 
-#if defined(USE_TBB)
-    using RowSpanSetAllocator = tbb::scalable_allocator<RowSpan>;
-#else // defined(USE_TBB)
-    using RowSpanSetAllocator = std::allocator<RowSpan>;
-#endif // defined(USE_*)
-
-    using RowSpanSet = std::vector<RowSpan, RowSpanSetAllocator>;
-
-    // Row represents a single row of a region. A row is set of rectangles that
-    // have the same vertical position.
-    struct Row
+    // Band represents a set of rectangles that have the same vertical position. The spans of the
+    // band are stored in |spans_| at positions [first_span, last_span).
+    struct Band
     {
-        Row(const Row&);
-        Row(Row&&) noexcept;
-        Row(int32_t top, int32_t bottom);
-        ~Row();
-
-        Row& operator=(const Row& other);
+        Band() = default;
+        Band(int32_t top, int32_t bottom, int32_t first_span, int32_t last_span);
 
         int32_t top;
         int32_t bottom;
-
-        RowSpanSet spans;
+        int32_t first_span;
+        int32_t last_span;
     };
 
-    // Type used to store list of rows in the region. The bottom position of row
-    // is used as the key so that rows are always ordered by their position. The
-    // map stores pointers to make translate() more efficient.
-
 #if defined(USE_TBB)
-    using RowsAllocator = tbb::scalable_allocator<std::pair<const int, Row*>>;
+    using RowSpanAllocator = tbb::scalable_allocator<RowSpan>;
+    using BandAllocator = tbb::scalable_allocator<Band>;
 #else // defined(USE_TBB)
-    using RowsAllocator = std::allocator<std::pair<const int, Row*>>;
+    using RowSpanAllocator = std::allocator<RowSpan>;
+    using BandAllocator = std::allocator<Band>;
 #endif // defined(USE_*)
 
-    using Rows = std::map<const int, Row* , std::less<const int>, RowsAllocator>;
+    using RowSpans = std::vector<RowSpan, RowSpanAllocator>;
+    using Bands = std::vector<Band, BandAllocator>;
 
 public:
     // Iterator that can be used to iterate over rectangles of a Region.
@@ -109,14 +98,13 @@ public:
     private:
         const Region& region_;
 
-        // Updates |rect_| based on the current |row_| and |row_span_|. If
-        // |row_span_| matches spans on consecutive rows then they are also merged
-        // into |rect_|, to generate more efficient output.
+        // Updates |rect_| based on the current |band_| and |span_|. If |span_| matches spans on
+        // consecutive bands then they are also merged into |rect_|, to generate more efficient
+        // output.
         void updateCurrentRect();
 
-        Rows::const_iterator row_;
-        Rows::const_iterator previous_row_;
-        RowSpanSet::const_iterator row_span_;
+        size_t band_ = 0;
+        int32_t span_ = 0;
         Rect rect_;
     };
 
@@ -130,11 +118,11 @@ public:
     Region& operator=(const Region& other);
     Region& operator=(Region&& other);
 
-    bool isEmpty() const { return rows_.empty(); }
+    bool isEmpty() const { return bands_.empty(); }
 
     bool equals(const Region& region) const;
 
-    // Reset the region to be empty.
+    // Reset the region to be empty. The allocated memory is kept for reuse.
     void clear();
 
     // Reset region to contain just |rect|.
@@ -166,29 +154,67 @@ public:
     void swap(Region* region);
 
 private:
-    // Comparison functions used for std::lower_bound(). Compare left or right
-    // edges withs a given |value|.
-    static bool compareSpanLeft(const RowSpan& r, int32_t value);
-    static bool compareSpanRight(const RowSpan& r, int32_t value);
+    enum class Operation { UNION, INTERSECT, SUBTRACT };
 
-    // Adds a new span to the row, coalescing spans if necessary.
-    static void addSpanToRow(Row* row, int32_t left, int32_t right);
+    // Read-only view of the bands of a region or of a single rectangle.
+    struct BandList
+    {
+        const Band* bands;
+        size_t count;
+        const RowSpan* spans;
+    };
+
+    BandList bandList() const;
+
+    // Returns the region used as a temporary buffer by the operations of the current thread.
+    static Region& scratchRegion();
+
+    // Calculates |operation| for |list1| and |list2| and appends the result to the region. The
+    // bands of the lists must be below the last band of the region.
+    void combine(const BandList& list1, const BandList& list2, Operation operation);
+
+    // Same as above but replaces the content of the region with the result of |operation| for
+    // the current content and |list|.
+    void combineWith(const BandList& list, Operation operation);
 
-    // Returns true if the |span| exists in the given |row|.
-    static bool isSpanInRow(const Row& row, const RowSpan& rect);
+    // Calculates |operation| for the current content and |rect|. Only the bands that intersect
+    // |rect| vertically are recalculated, the rest of the bands are moved in place.
+    void combineWithRect(const Rect& rect, Operation operation);
 
-    // Calculates the intersection of two sets of spans.
-    static void intersectRows(const RowSpanSet& set1, const RowSpanSet& set2, RowSpanSet& output);
+    // Adds a new span to the band at |index|, coalescing spans if necessary.
+    void addSpanToBand(size_t index, int32_t left, int32_t right);
 
-    static void subtractRows(const RowSpanSet& set_a, const RowSpanSet& set_b, RowSpanSet& output);
+    // Merges the band at |index| with the band above it if they are adjacent and contain the
+    // same spans.
+    void mergeWithPrecedingBand(size_t index);
 
-    // Merges |row| with the row above it if they contain the same spans. Doesn't
-    // do anything if called with |row| set to rows_.begin() (i.e. first row of
-    // the region). If the rows were merged |row| remains a valid iterator to the
-    // merged row.
-    void mergeWithPrecedingRow(Rows::iterator row_it);
+    // Appends a band to the region. The spans of the band must be already appended to |spans_|
+    // starting from |first_span|. If there are no spans, nothing is added. If the band is
+    // adjacent to the last band and has the same spans, the last band is extended instead.
+    void appendBand(int32_t top, int32_t bottom, size_t first_span);
+
+    // Comparison functions used for std::lower_bound(). Compare left or right
+    // edges withs a given |value|.
+    static bool compareSpanLeft(const RowSpan& r, int32_t value);
+    static bool compareSpanRight(const RowSpan& r, int32_t value);
 
-    Rows rows_;
+    // Returns true if the |span| exists in the given |band|.
+    bool isSpanInBand(const Band& band, const RowSpan& span) const;
+
+    // Calculate the union, intersection and difference of two sets of spans and append the
+    // result to |output|.
+    static void unionSpans(const RowSpan* begin1, const RowSpan* end1,
+                           const RowSpan* begin2, const RowSpan* end2,
+                           RowSpans& output);
+    static void intersectSpans(const RowSpan* begin1, const RowSpan* end1,
+                               const RowSpan* begin2, const RowSpan* end2,
+                               RowSpans& output);
+    static void subtractSpans(const RowSpan* begin_a, const RowSpan* end_a,
+                              const RowSpan* begin_b, const RowSpan* end_b,
+                              RowSpans& output);
+
+    Bands bands_;
+    RowSpans spans_;
 };
 
 } // namespace desktop
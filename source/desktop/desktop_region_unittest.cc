@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <random>
 
 namespace desktop {
 
@@ -51,6 +52,58 @@ void compareRegion(const Region& region, const Rect rects[], int rects_size)
     EXPECT_TRUE(it.isAtEnd());
 }
 
+// Region of a small area stored as one flag per pixel. Used as the reference.
+class PixelRegion
+{
+public:
+    static const int kSize = 64;
+
+    explicit PixelRegion(const Region& region)
+    {
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+            EXPECT_FALSE(rect.isEmpty());
+
+            for (int y = rect.top(); y < rect.bottom(); ++y)
+            {
+                for (int x = rect.left(); x < rect.right(); ++x)
+                {
+                    // The rectangles of the iterator never overlap.
+                    EXPECT_FALSE(pixels_[y][x]);
+                    pixels_[y][x] = true;
+                }
+            }
+        }
+    }
+
+    void fill(const Rect& rect, bool value)
+    {
+        for (int y = std::max(rect.top(), 0); y < std::min(rect.bottom(), kSize); ++y)
+        {
+            for (int x = std::max(rect.left(), 0); x < std::min(rect.right(), kSize); ++x)
+                pixels_[y][x] = value;
+        }
+    }
+
+    void intersect(const Rect& rect)
+    {
+        for (int y = 0; y < kSize; ++y)
+        {
+            for (int x = 0; x < kSize; ++x)
+                pixels_[y][x] = pixels_[y][x] && rect.contains(x, y);
+        }
+    }
+
+    bool operator==(const PixelRegion& other) const
+    {
+        return memcmp(pixels_, other.pixels_, sizeof(pixels_)) == 0;
+    }
+
+private:
+    bool pixels_[kSize][kSize] = {};
+};
+
 } // namespace
 
 // Verify that regions are empty when created.
@@ -1152,6 +1205,80 @@ TEST(desktop_region_test, subtract_rect_on_same_col)
     }
 }
 
+TEST(desktop_region_test, random_operations)
+{
+    std::mt19937 random(1);
+
+    auto random_rect = [&]()
+    {
+        const int left = random() % (PixelRegion::kSize - 8);
+        const int top = random() % (PixelRegion::kSize - 8);
+
+        return Rect::makeLTRB(left, top, left + 1 + random() % 8, top + 1 + random() % 8);
+    };
+
+    for (int pass = 0; pass < 500; ++pass)
+    {
+        Region region;
+        PixelRegion expected(region);
+
+        for (int step = 0; step < 30; ++step)
+        {
+            SCOPED_TRACE(step);
+
+            const Rect rect = random_rect();
+
+            switch (random() % 6)
+            {
+                case 0:
+                case 1:
+                case 2:
+                    region.addRect(rect);
+                    expected.fill(rect, true);
+                    break;
+
+                case 3:
+                    region.subtract(rect);
+                    expected.fill(rect, false);
+                    break;
+
+                case 4:
+                {
+                    Region other(rect);
+                    other.addRect(random_rect());
+
+                    region.subtract(other);
+                    expected.fill(rect, false);
+
+                    for (Region::Iterator it(other); !it.isAtEnd(); it.advance())
+                        expected.fill(it.rect(), false);
+                }
+                break;
+
+                case 5:
+                {
+                    const Rect clip = Rect::makeLTRB(
+                        rect.left() / 2, rect.top() / 2, rect.right() * 2, rect.bottom() * 2);
+
+                    region.intersectWith(clip);
+                    expected.intersect(clip);
+                }
+                break;
+            }
+
+            ASSERT_TRUE(PixelRegion(region) == expected);
+
+            // The representation of a region is unique, so the region built from the output of
+            // the iterator must be equal to the source region.
+            Region rebuilt;
+            for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+                rebuilt.addRect(it.rect());
+
+            ASSERT_TRUE(rebuilt.equals(region));
+        }
+    }
+}
+
 TEST(desktop_region_test, performance)
 {
     for (int c = 0; c < 1000; ++c)
@@ -19,24 +19,49 @@
 #include "desktop/differ.h"
 
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "desktop/diff_block_16bpp_c.h"
 #include "desktop/diff_block_32bpp_avx2.h"
 #include "desktop/diff_block_32bpp_sse2.h"
 #include "desktop/diff_block_32bpp_sse3.h"
 #include "desktop/diff_block_32bpp_c.h"
+#include "desktop/hash_block.h"
 
 #include <libyuv/cpu_id.h>
 
+#include <algorithm>
+
 namespace desktop {
 
 namespace {
 
-const int kBlockSize = 8;
+const int kMinBlockSize = 8;
+const int kMaxBlockSize = 32;
+
+// The number of frames with changes after which the block size is reconsidered in the automatic
+// mode.
+const int kTuningFrames = 30;
+
+// If the regions contain more rectangles on average, the block size is increased. Each rectangle
+// costs the encoder and the network some overhead.
+const int kMaxRectsPerFrame = 128;
+
+// If the search takes longer on average, the block size is increased. Larger blocks are compared
+// with fewer calls and wider vector instructions.
+const std::chrono::microseconds kMaxDiffTime(4000);
+
+// The minimum number of block rows processed by one thread. For smaller screens the overhead of
+// the thread synchronization exceeds the gain.
+const int kMinBlockRowsPerThread = 32;
+
+// The maximum number of threads selected in the automatic mode. The rest of the processor cores
+// remain for the encoder.
+const int kMaxAutoThreadCount = 4;
 
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and height are multiples
-// of kBlockSize, then this will never be called.
+// of the block size, then this will never be called.
 uint8_t diffPartialBlock(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          int bytes_per_row,
@@ -55,52 +80,158 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
-
-
 } // namespace
 
-Differ::Differ(const Size& size, const PixelFormat& format)
-    : screen_rect_(Rect::makeSize(size)),
-      diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
-      diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
-      full_blocks_x_(size.width() / kBlockSize),
-      full_blocks_y_(size.height() / kBlockSize)
+Differ::Differ(const Size& size, const PixelFormat& format, int thread_count, int block_size)
+    : screen_rect_(Rect::makeSize(size))
 {
     bytes_per_pixel_ = format.bytesPerPixel();
     bytes_per_row_ = size.width() * bytes_per_pixel_;
-    bytes_per_block_ = kBlockSize * bytes_per_pixel_;
+
+    if (block_size == kAutoBlockSize)
+    {
+        auto_block_size_ = true;
+        block_size = autoBlockSize(size);
+    }
+
+    setBlockSize(block_size);
+    CHECK(diff_full_block_func_);
+
+    const int block_rows = diff_height_ - 1;
+
+    if (thread_count == kAutoThreadCount)
+        thread_count = autoThreadCount(block_rows);
+
+    thread_count = std::clamp(thread_count, 1, std::max(block_rows, 1));
+    if (thread_count > 1)
+    {
+        LOG(LS_INFO) << "Differ uses " << thread_count << " threads";
+        thread_pool_ = std::make_unique<base::ThreadPool>(thread_count);
+    }
+}
+
+Differ::~Differ() = default;
+
+int Differ::threadCount() const
+{
+    return thread_pool_ ? thread_pool_->threadCount() : 1;
+}
+
+// static
+int Differ::autoThreadCount(int block_rows)
+{
+    const int thread_count = std::min(base::ThreadPool::hardwareConcurrency(), kMaxAutoThreadCount);
+    return std::clamp(block_rows / kMinBlockRowsPerThread, 1, thread_count);
+}
+
+// static
+int Differ::autoBlockSize(const Size& size)
+{
+    const int64_t pixels = static_cast<int64_t>(size.width()) * size.height();
+
+    if (pixels >= 3840 * 2160)
+        return 32;
+
+    if (pixels >= 1920 * 1080)
+        return 16;
+
+    return 8;
+}
+
+// Calculates the layout of the blocks for |block_size|. The hashes calculated for the previous
+// block size become invalid.
+void Differ::setBlockSize(int block_size)
+{
+    DCHECK(block_size == 8 || block_size == 16 || block_size == 32);
+
+    const Size size = screen_rect_.size();
+
+    block_size_ = block_size;
+    bytes_per_block_ = block_size_ * bytes_per_pixel_;
+
+    diff_width_ = ((size.width() + block_size_ - 1) / block_size_) + 1;
+    diff_height_ = ((size.height() + block_size_ - 1) / block_size_) + 1;
+
+    full_blocks_x_ = size.width() / block_size_;
+    full_blocks_y_ = size.height() / block_size_;
 
     const int diff_info_size = diff_width_ * diff_height_;
 
     diff_info_ = std::make_unique<uint8_t[]>(diff_info_size);
     memset(diff_info_.get(), 0, diff_info_size);
 
+    if (block_hashes_)
+        block_hashes_ = std::make_unique<uint64_t[]>(diff_info_size);
+    block_hashes_valid_ = false;
+
     // Calc size of partial blocks which may be present on right and bottom edge.
-    partial_column_width_ = size.width() - (full_blocks_x_ * kBlockSize);
-    partial_row_height_ = size.height() - (full_blocks_y_ * kBlockSize);
+    partial_column_width_ = size.width() - (full_blocks_x_ * block_size_);
+    partial_row_height_ = size.height() - (full_blocks_y_ * block_size_);
 
     // Offset from the start of one block-row to the next.
-    block_stride_y_ = bytes_per_row_ * kBlockSize;
+    block_stride_y_ = bytes_per_row_ * block_size_;
 
-    switch (format.bitsPerPixel())
+    switch (bytes_per_pixel_)
     {
-        case 32:
-            diff_full_block_func_ = diffFunctionFor32bpp();
+        case 4:
+            diff_full_block_func_ = diffFunctionFor32bpp(block_size_);
             break;
 
-        case 16:
-            diff_full_block_func_ = diffFunctionFor16bpp();
+        case 2:
+            diff_full_block_func_ = diffFunctionFor16bpp(block_size_);
             break;
 
         default:
             break;
     }
+}
 
-    CHECK(diff_full_block_func_);
+// Accumulates the statistics of the last search and returns true if the block size has been
+// changed.
+bool Differ::tuneBlockSize(const std::chrono::microseconds& elapsed, int rect_count)
+{
+    // Frames without changes say nothing about the fragmentation.
+    if (!rect_count)
+        return false;
+
+    tuning_time_ += elapsed;
+    tuning_rects_ += rect_count;
+
+    if (++tuning_frames_ < kTuningFrames)
+        return false;
+
+    const std::chrono::microseconds average_time = tuning_time_ / tuning_frames_;
+    const int average_rects = tuning_rects_ / tuning_frames_;
+
+    tuning_frames_ = 0;
+    tuning_rects_ = 0;
+    tuning_time_ = std::chrono::microseconds::zero();
+
+    int block_size = block_size_;
+
+    if (average_rects > kMaxRectsPerFrame || average_time > kMaxDiffTime)
+    {
+        block_size = std::min(block_size_ * 2, kMaxBlockSize);
+    }
+    else if (average_rects < kMaxRectsPerFrame / 8 && average_time < kMaxDiffTime / 4)
+    {
+        // Smaller blocks give a more precise region. The thresholds are far enough from the
+        // thresholds above to avoid switching back and forth.
+        block_size = std::max(block_size_ / 2, kMinBlockSize);
+    }
+
+    if (block_size == block_size_)
+        return false;
+
+    LOG(LS_INFO) << "Differ block size changed from " << block_size_ << " to " << block_size
+                 << " (rects: " << average_rects << ", time: " << average_time.count() << "us)";
+
+    setBlockSize(block_size);
+    return true;
 }
 
 // static
-Differ::DiffFullBlockFunc Differ::diffFunctionFor32bpp()
+Differ::DiffFullBlockFunc Differ::diffFunctionFor32bpp(int block_size)
 {
     DiffFullBlockFunc func = nullptr;
 
@@ -108,44 +239,44 @@ Differ::DiffFullBlockFunc Differ::diffFunctionFor32bpp()
     {
         LOG(LS_INFO) << "AVX2 differ loaded (32bpp)";
 
-        if constexpr (kBlockSize == 8)
+        if (block_size == 8)
             func = diffFullBlock_32bpp_8x8_AVX2;
-        else if constexpr (kBlockSize == 16)
+        else if (block_size == 16)
             func = diffFullBlock_32bpp_16x16_AVX2;
-        else if constexpr (kBlockSize == 32)
+        else if (block_size == 32)
             func = diffFullBlock_32bpp_32x32_AVX2;
     }
     else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSSE3))
     {
         LOG(LS_INFO) << "SSE3 differ loaded (32bpp)";
 
-        if constexpr (kBlockSize == 8)
+        if (block_size == 8)
             func = diffFullBlock_32bpp_8x8_SSE3;
-        else if constexpr (kBlockSize == 16)
+        else if (block_size == 16)
             func = diffFullBlock_32bpp_16x16_SSE3;
-        else if constexpr (kBlockSize == 32)
+        else if (block_size == 32)
             func = diffFullBlock_32bpp_32x32_SSE3;
     }
     else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
     {
         LOG(LS_INFO) << "SSE2 differ loaded (32bpp)";
 
-        if constexpr (kBlockSize == 8)
+        if (block_size == 8)
             func = diffFullBlock_32bpp_8x8_SSE2;
-        else if constexpr (kBlockSize == 16)
+        else if (block_size == 16)
             func = diffFullBlock_32bpp_16x16_SSE2;
-        else if constexpr (kBlockSize == 32)
+        else if (block_size == 32)
             func = diffFullBlock_32bpp_32x32_SSE2;
     }
     else
     {
         LOG(LS_INFO) << "C differ loaded (32bpp)";
 
-        if constexpr (kBlockSize == 8)
+        if (block_size == 8)
             func = diffFullBlock_32bpp_8x8_C;
-        else if constexpr (kBlockSize == 16)
+        else if (block_size == 16)
             func = diffFullBlock_32bpp_16x16_C;
-        else if constexpr (kBlockSize == 32)
+        else if (block_size == 32)
             func = diffFullBlock_32bpp_32x32_C;
     }
 
@@ -153,34 +284,70 @@ Differ::DiffFullBlockFunc Differ::diffFunctionFor32bpp()
 }
 
 // static
-Differ::DiffFullBlockFunc Differ::diffFunctionFor16bpp()
+Differ::DiffFullBlockFunc Differ::diffFunctionFor16bpp(int block_size)
 {
     DiffFullBlockFunc func = nullptr;
 
     LOG(LS_INFO) << "C differ loaded (16bpp)";
 
-    if constexpr (kBlockSize == 8)
+    if (block_size == 8)
         func = diffFullBlock_16bpp_8x8_C;
-    else if constexpr (kBlockSize == 16)
+    else if (block_size == 16)
         func = diffFullBlock_16bpp_16x16_C;
-    else if constexpr (kBlockSize == 32)
+    else if (block_size == 32)
         func = diffFullBlock_16bpp_32x32_C;
 
     return func;
 }
 
+// Calls |func| for the block rows of the screen. If the thread pool exists, the rows are split
+// into contiguous ranges that are processed in parallel.
+void Differ::runOnBlockRows(const std::function<void(int first_row, int last_row)>& func)
+{
+    // The last block row may be partial.
+    const int block_rows = diff_height_ - 1;
+
+    if (!thread_pool_)
+    {
+        func(0, block_rows);
+        return;
+    }
+
+    const int task_count = thread_pool_->threadCount();
+
+    // Each task writes only to its own rows of |diff_info_|, so no synchronization is required.
+    thread_pool_->run(task_count, [&](int index)
+    {
+        func(block_rows * index / task_count, block_rows * (index + 1) / task_count);
+    });
+}
+
 // Identify all of the blocks that contain changed pixels.
 void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    runOnBlockRows([&](int first_row, int last_row)
+    {
+        markDirtyBlockRows(prev_image, curr_image, first_row, last_row);
+    });
+}
+
+// Identify the blocks that contain changed pixels in block rows [first_row, last_row).
+void Differ::markDirtyBlockRows(const uint8_t* prev_image,
+                                const uint8_t* curr_image,
+                                int first_row,
+                                int last_row)
+{
+    const uint8_t* prev_block_row_start = prev_image + first_row * block_stride_y_;
+    const uint8_t* curr_block_row_start = curr_image + first_row * block_stride_y_;
 
     // Offset from the start of one diff_info row to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    uint8_t* is_diff_row_start = diff_info_.get() + first_row * diff_stride;
+
+    const int last_full_row = std::min(last_row, full_blocks_y_);
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    for (int y = first_row; y < last_full_row; ++y)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -206,8 +373,8 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
             *is_different = diffPartialBlock(prev_block,
                                              curr_block,
                                              bytes_per_row_,
-                                             bytes_per_block_,
-                                             kBlockSize);
+                                             partial_column_width_ * bytes_per_pixel_,
+                                             block_size_);
         }
 
         // Update pointers for next row.
@@ -220,7 +387,7 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
     // If the screen height is not a multiple of the block size, then this
     // handles the last partial row. This situation is far more common than
     // the 'partial column' case.
-    if (partial_row_height_ != 0)
+    if (partial_row_height_ != 0 && last_row > full_blocks_y_)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -252,13 +419,51 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
     }
 }
 
+// Identify the blocks in block rows [first_row, last_row) whose hashes differ from the hashes
+// calculated for the previous image and remember the new hashes.
+void Differ::markChangedHashBlockRows(const uint8_t* curr_image, int first_row, int last_row)
+{
+    // The hashes are stored with the same layout as |diff_info_|, the boundary column is unused.
+    const int hash_stride = diff_width_;
+    const int block_columns = diff_width_ - 1;
+
+    for (int y = first_row; y < last_row; ++y)
+    {
+        const int block_height = (y < full_blocks_y_) ? block_size_ : partial_row_height_;
+        const uint8_t* curr_block = curr_image + y * block_stride_y_;
+
+        uint64_t* hash = block_hashes_.get() + y * hash_stride;
+        uint8_t* is_different = diff_info_.get() + y * hash_stride;
+
+        for (int x = 0; x < block_columns; ++x)
+        {
+            const int block_bytes = (x < full_blocks_x_) ?
+                bytes_per_block_ : partial_column_width_ * bytes_per_pixel_;
+
+            const uint64_t block_hash =
+                hashBlock(curr_block, bytes_per_row_, block_bytes, block_height);
+
+            *is_different = (!block_hashes_valid_ || *hash != block_hash) ? 1U : 0U;
+            *hash = block_hash;
+
+            curr_block += bytes_per_block_;
+
+            ++is_different;
+            ++hash;
+        }
+    }
+}
+
 //
 // After the dirty blocks have been identified, this routine merges adjacent
 // blocks into a region.
 // The goal is to minimize the region that covers the dirty blocks.
+// Returns the number of added rectangles.
 //
-void Differ::mergeBlocks(Region* dirty_region)
+int Differ::mergeBlocks(Region* dirty_region)
 {
+    int rect_count = 0;
+
     uint8_t* is_diff_row_start = diff_info_.get();
     const int diff_stride = diff_width_;
 
@@ -323,13 +528,14 @@ void Differ::mergeBlocks(Region* dirty_region)
                     }
                 } while (found_new_row);
 
-                Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
-                                                 width * kBlockSize, height * kBlockSize);
+                Rect dirty_rect = Rect::makeXYWH(x * block_size_, y * block_size_,
+                                                 width * block_size_, height * block_size_);
 
                 dirty_rect.intersectWith(screen_rect_);
 
                 // Add rect to region.
                 dirty_region->addRect(dirty_rect);
+                ++rect_count;
             }
 
             // Increment to next block in this row.
@@ -339,22 +545,74 @@ void Differ::mergeBlocks(Region* dirty_region)
         // Go to start of next row.
         is_diff_row_start += diff_stride;
     }
+
+    return rect_count;
 }
 
 void Differ::calcDirtyRegion(const uint8_t* prev_image,
                              const uint8_t* curr_image,
                              Region* dirty_region)
 {
+    const auto start_time = std::chrono::steady_clock::now();
+
     dirty_region->clear();
 
     // Identify all the blocks that contain changed pixels.
     markDirtyBlocks(prev_image, curr_image);
 
+    // The hashes no longer match the last image.
+    block_hashes_valid_ = false;
+
     //
     // Now that we've identified the blocks that have changed, merge adjacent
     // blocks to minimize the number of rects that we return.
     //
-    mergeBlocks(dirty_region);
+    const int rect_count = mergeBlocks(dirty_region);
+
+    if (auto_block_size_)
+    {
+        // The next call compares the images again, so the block size can be changed at any time.
+        tuneBlockSize(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time), rect_count);
+    }
+}
+
+void Differ::calcDirtyRegion(const uint8_t* curr_image, Region* dirty_region)
+{
+    const auto start_time = std::chrono::steady_clock::now();
+
+    dirty_region->clear();
+
+    if (!block_hashes_)
+    {
+        const int hash_count = diff_width_ * diff_height_;
+
+        block_hashes_ = std::make_unique<uint64_t[]>(hash_count);
+        block_hashes_valid_ = false;
+    }
+
+    auto mark_changed_blocks = [&](int first_row, int last_row)
+    {
+        markChangedHashBlockRows(curr_image, first_row, last_row);
+    };
+
+    // Identify all the blocks whose hashes have changed.
+    runOnBlockRows(mark_changed_blocks);
+
+    block_hashes_valid_ = true;
+
+    const int rect_count = mergeBlocks(dirty_region);
+
+    if (auto_block_size_ && tuneBlockSize(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time), rect_count))
+    {
+        // The hashes of the previous block size are lost. Calculate the hashes of the current
+        // image for the new block size, otherwise the next call returns the whole screen.
+        runOnBlockRows(mark_changed_blocks);
+        block_hashes_valid_ = true;
+
+        memset(diff_info_.get(), 0, diff_width_ * diff_height_);
+    }
 }
 
 } // namespace desktop
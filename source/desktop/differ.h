@@ -23,29 +23,69 @@
 #include "desktop/desktop_region.h"
 #include "desktop/pixel_format.h"
 
+#include <chrono>
+#include <functional>
 #include <memory>
 
+namespace base {
+class ThreadPool;
+} // namespace base
+
 namespace desktop {
 
 // Class to search for changed regions of the screen.
 class Differ
 {
 public:
-    Differ(const Size& size, const PixelFormat& format);
-    ~Differ() = default;
+    // Passing this value as |thread_count| selects the number of threads depending on the number
+    // of processor cores and the screen size.
+    static constexpr int kAutoThreadCount = 0;
+
+    // Passing this value as |block_size| selects the initial block size depending on the screen
+    // size. After that the block size is adjusted depending on the time spent on the search and
+    // on the number of rectangles in the resulting regions.
+    static const int kAutoBlockSize = 0;
+
+    // If |thread_count| is greater than 1, the block rows of the screen are split between
+    // |thread_count| threads. The resulting region does not depend on the number of threads.
+    // |block_size| can be 8, 16, 32 or kAutoBlockSize.
+    Differ(const Size& size, const PixelFormat& format, int thread_count = 1, int block_size = 8);
+    ~Differ();
 
+    int threadCount() const;
+    int blockSize() const { return block_size_; }
+
+    // Searches for the changed blocks by comparing |prev_image| and |curr_image| byte by byte.
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          Region* changed_region);
 
+    // Searches for the changed blocks by comparing 64-bit hashes of the blocks of |curr_image|
+    // with the hashes calculated in the previous call. The previous image does not need to be
+    // kept. The first call returns the whole screen.
+    void calcDirtyRegion(const uint8_t* curr_image, Region* changed_region);
+
 private:
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
 
-    static DiffFullBlockFunc diffFunctionFor32bpp();
-    static DiffFullBlockFunc diffFunctionFor16bpp();
+    static DiffFullBlockFunc diffFunctionFor32bpp(int block_size);
+    static DiffFullBlockFunc diffFunctionFor16bpp(int block_size);
+
+    static int autoThreadCount(int block_rows);
+    static int autoBlockSize(const Size& size);
+
+    void setBlockSize(int block_size);
+    bool tuneBlockSize(const std::chrono::microseconds& elapsed, int rect_count);
+
+    void runOnBlockRows(const std::function<void(int first_row, int last_row)>& func);
 
     void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
-    void mergeBlocks(Region* dirty_region);
+    void markDirtyBlockRows(const uint8_t* prev_image,
+                            const uint8_t* curr_image,
+                            int first_row,
+                            int last_row);
+    void markChangedHashBlockRows(const uint8_t* curr_image, int first_row, int last_row);
+    int mergeBlocks(Region* dirty_region);
 
     const Rect screen_rect_;
 
@@ -53,20 +93,34 @@ private:
     int bytes_per_row_;
     int bytes_per_block_;
 
-    const int full_blocks_x_;
-    const int full_blocks_y_;
+    int block_size_ = 0;
+
+    int full_blocks_x_;
+    int full_blocks_y_;
 
     int partial_column_width_;
     int partial_row_height_;
 
     int block_stride_y_;
 
-    const int diff_width_;
-    const int diff_height_;
+    int diff_width_;
+    int diff_height_;
 
     std::unique_ptr<uint8_t[]> diff_info_;
 
-    DiffFullBlockFunc diff_full_block_func_;
+    // Hashes of the blocks for the hash mode. Allocated on the first use.
+    std::unique_ptr<uint64_t[]> block_hashes_;
+    bool block_hashes_valid_ = false;
+
+    DiffFullBlockFunc diff_full_block_func_ = nullptr;
+
+    std::unique_ptr<base::ThreadPool> thread_pool_;
+
+    // Statistics for the automatic selection of the block size.
+    bool auto_block_size_ = false;
+    int tuning_frames_ = 0;
+    int tuning_rects_ = 0;
+    std::chrono::microseconds tuning_time_ = std::chrono::microseconds::zero();
 
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
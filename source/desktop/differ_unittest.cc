@@ -0,0 +1,227 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/differ.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+struct TestImages
+{
+    TestImages(const Size& size, const PixelFormat& format)
+        : bytes_per_row(size.width() * format.bytesPerPixel()),
+          prev(bytes_per_row * size.height()),
+          curr(bytes_per_row * size.height())
+    {
+        // Nothing
+    }
+
+    const int bytes_per_row;
+    std::vector<uint8_t> prev;
+    std::vector<uint8_t> curr;
+};
+
+void changePixels(TestImages* images, std::mt19937* random, int count)
+{
+    std::uniform_int_distribution<size_t> offset(0, images->curr.size() - 1);
+
+    for (int i = 0; i < count; ++i)
+        ++images->curr[offset(*random)];
+}
+
+void checkThreadCounts(const Size& size, const PixelFormat& format, int block_size = 8)
+{
+    std::mt19937 random(size.width() * size.height());
+    TestImages images(size, format);
+
+    for (auto& value : images.prev)
+        value = static_cast<uint8_t>(random());
+
+    for (int pass = 0; pass < 4; ++pass)
+    {
+        images.curr = images.prev;
+        changePixels(&images, &random, pass * 50);
+
+        Differ serial_differ(size, format, 1, block_size);
+        EXPECT_EQ(serial_differ.threadCount(), 1);
+
+        Region serial_region;
+        serial_differ.calcDirtyRegion(images.prev.data(), images.curr.data(), &serial_region);
+        EXPECT_EQ(serial_region.isEmpty(), pass == 0);
+
+        for (int thread_count = 2; thread_count <= 7; ++thread_count)
+        {
+            Differ parallel_differ(size, format, thread_count, block_size);
+            EXPECT_GT(parallel_differ.threadCount(), 1);
+
+            Region parallel_region;
+            parallel_differ.calcDirtyRegion(
+                images.prev.data(), images.curr.data(), &parallel_region);
+
+            EXPECT_TRUE(parallel_region.equals(serial_region))
+                << "size: " << size.width() << "x" << size.height()
+                << " threads: " << thread_count << " block: " << block_size;
+        }
+    }
+}
+
+void checkHashMode(const Size& size,
+                   const PixelFormat& format,
+                   int thread_count,
+                   int block_size = 8)
+{
+    std::mt19937 random(size.width() + size.height());
+    TestImages images(size, format);
+
+    for (auto& value : images.curr)
+        value = static_cast<uint8_t>(random());
+
+    Differ compare_differ(size, format, 1, block_size);
+    Differ hash_differ(size, format, thread_count, block_size);
+
+    // The first call in the hash mode returns the whole screen.
+    Region hash_region;
+    hash_differ.calcDirtyRegion(images.curr.data(), &hash_region);
+    EXPECT_TRUE(hash_region.equals(Region(Rect::makeSize(size))));
+
+    for (int pass = 0; pass < 8; ++pass)
+    {
+        images.prev = images.curr;
+        changePixels(&images, &random, pass * 20);
+
+        Region compare_region;
+        compare_differ.calcDirtyRegion(images.prev.data(), images.curr.data(), &compare_region);
+
+        hash_differ.calcDirtyRegion(images.curr.data(), &hash_region);
+
+        EXPECT_TRUE(hash_region.equals(compare_region))
+            << "size: " << size.width() << "x" << size.height() << " pass: " << pass
+            << " block: " << block_size;
+    }
+}
+
+bool containsRegion(const Region& region, const Region& other)
+{
+    Region intersection;
+    intersection.intersect(region, other);
+    return intersection.equals(other);
+}
+
+} // namespace
+
+TEST(differ_test, parallel_equals_serial_32bpp)
+{
+    checkThreadCounts(Size(640, 480), PixelFormat::ARGB());
+    checkThreadCounts(Size(1283, 721), PixelFormat::ARGB());
+    checkThreadCounts(Size(100, 37), PixelFormat::ARGB());
+}
+
+TEST(differ_test, parallel_equals_serial_16bpp)
+{
+    checkThreadCounts(Size(640, 480), PixelFormat::RGB565());
+    checkThreadCounts(Size(1021, 767), PixelFormat::RGB565());
+}
+
+TEST(differ_test, thread_count_limited_by_block_rows)
+{
+    // The screen has only two block rows.
+    Differ differ(Size(64, 12), PixelFormat::ARGB(), 8);
+    EXPECT_EQ(differ.threadCount(), 2);
+
+    Differ auto_differ(Size(64, 12), PixelFormat::ARGB(), Differ::kAutoThreadCount);
+    EXPECT_EQ(auto_differ.threadCount(), 1);
+}
+
+TEST(differ_test, hash_mode_equals_compare_mode)
+{
+    checkHashMode(Size(640, 480), PixelFormat::ARGB(), 1);
+    checkHashMode(Size(1283, 721), PixelFormat::ARGB(), 3);
+    checkHashMode(Size(1021, 767), PixelFormat::RGB565(), 1);
+    checkHashMode(Size(100, 37), PixelFormat::RGB565(), 2);
+}
+
+TEST(differ_test, block_sizes)
+{
+    for (int block_size : { 16, 32 })
+    {
+        checkThreadCounts(Size(640, 480), PixelFormat::ARGB(), block_size);
+        checkThreadCounts(Size(1283, 721), PixelFormat::ARGB(), block_size);
+        checkThreadCounts(Size(1021, 767), PixelFormat::RGB565(), block_size);
+
+        checkHashMode(Size(1283, 721), PixelFormat::ARGB(), 3, block_size);
+        checkHashMode(Size(100, 37), PixelFormat::RGB565(), 1, block_size);
+    }
+}
+
+TEST(differ_test, auto_block_size_depends_on_screen_size)
+{
+    const PixelFormat format = PixelFormat::ARGB();
+
+    EXPECT_EQ(Differ(Size(1280, 1024), format, 1, Differ::kAutoBlockSize).blockSize(), 8);
+    EXPECT_EQ(Differ(Size(1920, 1080), format, 1, Differ::kAutoBlockSize).blockSize(), 16);
+    EXPECT_EQ(Differ(Size(3840, 2160), format, 1, Differ::kAutoBlockSize).blockSize(), 32);
+}
+
+TEST(differ_test, auto_block_size_grows_with_fragmentation)
+{
+    const Size size(1280, 1024);
+    const PixelFormat format = PixelFormat::ARGB();
+
+    std::mt19937 random(1);
+    TestImages images(size, format);
+
+    Differ exact_differ(size, format, 1, 8);
+    Differ compare_differ(size, format, 1, Differ::kAutoBlockSize);
+    Differ hash_differ(size, format, 2, Differ::kAutoBlockSize);
+
+    Region hash_region;
+    hash_differ.calcDirtyRegion(images.curr.data(), &hash_region);
+
+    for (int pass = 0; pass < 100; ++pass)
+    {
+        images.prev = images.curr;
+
+        // Hundreds of scattered changes produce hundreds of small rectangles.
+        changePixels(&images, &random, 500);
+
+        Region exact_region;
+        exact_differ.calcDirtyRegion(images.prev.data(), images.curr.data(), &exact_region);
+
+        Region compare_region;
+        compare_differ.calcDirtyRegion(images.prev.data(), images.curr.data(), &compare_region);
+        hash_differ.calcDirtyRegion(images.curr.data(), &hash_region);
+
+        // The regions of larger blocks are less precise, but must cover all the changes.
+        EXPECT_TRUE(containsRegion(compare_region, exact_region)) << "pass: " << pass;
+        EXPECT_TRUE(containsRegion(hash_region, exact_region)) << "pass: " << pass;
+    }
+
+    EXPECT_GT(compare_differ.blockSize(), 8);
+    EXPECT_GT(hash_differ.blockSize(), 8);
+
+    // Changing the block size in the hash mode does not produce a full screen update.
+    hash_differ.calcDirtyRegion(images.curr.data(), &hash_region);
+    EXPECT_TRUE(hash_region.isEmpty());
+}
+
+} // namespace desktop
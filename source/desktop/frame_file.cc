@@ -0,0 +1,212 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/frame_file.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+
+namespace desktop {
+
+namespace {
+
+const uint32_t kMagic = 0x4D524641; // "AFRM"
+const uint32_t kVersion = 1;
+
+// The largest supported frame size.
+const int32_t kMaxSize = 16384;
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+};
+
+struct RectHeader
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+template <typename T>
+bool readValue(std::ifstream& stream, T* value)
+{
+    stream.read(reinterpret_cast<char*>(value), sizeof(T));
+    return !stream.fail();
+}
+
+template <typename T>
+void writeValue(std::ofstream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+bool FrameFileWriter::open(const std::filesystem::path& file_path, const Size& size)
+{
+    file_stream_.open(file_path, std::ofstream::binary | std::ofstream::trunc);
+    if (!file_stream_.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to create file: " << file_path;
+        return false;
+    }
+
+    writeValue(file_stream_, FileHeader{ kMagic, kVersion, size.width(), size.height() });
+
+    size_ = size;
+    first_frame_ = true;
+
+    return !file_stream_.fail();
+}
+
+void FrameFileWriter::close()
+{
+    file_stream_.close();
+}
+
+bool FrameFileWriter::writeFrame(const Frame& frame)
+{
+    if (!file_stream_.is_open() || frame.size() != size_ || frame.format().bitsPerPixel() != 32)
+        return false;
+
+    // The first record contains the whole frame, so the file can be played from the beginning.
+    const Region region =
+        first_frame_ ? Region(Rect::makeSize(size_)) : frame.constUpdatedRegion();
+
+    first_frame_ = false;
+
+    uint32_t rect_count = 0;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        ++rect_count;
+
+    writeValue(file_stream_, rect_count);
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        writeValue(file_stream_, RectHeader{ rect.x(), rect.y(), rect.width(), rect.height() });
+    }
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            file_stream_.write(reinterpret_cast<const char*>(row),
+                               rect.width() * frame.format().bytesPerPixel());
+            row += frame.stride();
+        }
+    }
+
+    return !file_stream_.fail();
+}
+
+bool FrameFileReader::open(const std::filesystem::path& file_path)
+{
+    file_stream_.open(file_path, std::ifstream::binary);
+    if (!file_stream_.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to open file: " << file_path;
+        return false;
+    }
+
+    FileHeader header;
+    if (!readValue(file_stream_, &header) || header.magic != kMagic || header.version != kVersion)
+    {
+        LOG(LS_WARNING) << "Invalid frame file: " << file_path;
+        return false;
+    }
+
+    if (header.width <= 0 || header.width > kMaxSize ||
+        header.height <= 0 || header.height > kMaxSize)
+    {
+        LOG(LS_WARNING) << "Invalid frame size: " << header.width << "x" << header.height;
+        return false;
+    }
+
+    size_.set(header.width, header.height);
+    first_record_ = file_stream_.tellg();
+    return true;
+}
+
+bool FrameFileReader::readFrame(Frame* frame)
+{
+    DCHECK(frame);
+
+    if (!file_stream_.is_open() || frame->size() != size_ || frame->format().bitsPerPixel() != 32)
+        return false;
+
+    uint32_t rect_count;
+    if (!readValue(file_stream_, &rect_count))
+        return false;
+
+    Region* updated_region = frame->updatedRegion();
+    updated_region->clear();
+
+    const Rect frame_rect = Rect::makeSize(size_);
+
+    for (uint32_t i = 0; i < rect_count; ++i)
+    {
+        RectHeader header;
+        if (!readValue(file_stream_, &header))
+            return false;
+
+        const Rect rect = Rect::makeXYWH(header.x, header.y, header.width, header.height);
+        if (rect.isEmpty() || !frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "Invalid rectangle in frame file";
+            return false;
+        }
+
+        updated_region->addRect(rect);
+    }
+
+    // The rectangles are written in the order of the region iterator, so they are read in the
+    // same order.
+    for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        uint8_t* row = frame->frameDataAtPos(rect.topLeft());
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            file_stream_.read(reinterpret_cast<char*>(row),
+                              rect.width() * frame->format().bytesPerPixel());
+            if (file_stream_.fail())
+                return false;
+
+            row += frame->stride();
+        }
+    }
+
+    return true;
+}
+
+void FrameFileReader::rewind()
+{
+    file_stream_.clear();
+    file_stream_.seekg(first_record_);
+}
+
+} // namespace desktop
@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__FRAME_FILE_H
+#define DESKTOP__FRAME_FILE_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace desktop {
+
+class Frame;
+
+// A file with a sequence of captured 32bpp frames. Each record contains only the updated region
+// of the frame. The first record always contains the whole frame.
+//
+// File layout (little-endian):
+//   uint32 magic, uint32 version, int32 width, int32 height
+//   Records: uint32 rect_count, rect_count * (int32 x, y, width, height), pixels of the rects.
+class FrameFileWriter
+{
+public:
+    FrameFileWriter() = default;
+    ~FrameFileWriter() = default;
+
+    bool open(const std::filesystem::path& file_path, const Size& size);
+    void close();
+    bool isOpen() const { return file_stream_.is_open(); }
+
+    // Writes the updated region of |frame|. The size of the frame must be equal to the size
+    // passed to open().
+    bool writeFrame(const Frame& frame);
+
+private:
+    std::ofstream file_stream_;
+    Size size_;
+    bool first_frame_ = true;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameFileWriter);
+};
+
+class FrameFileReader
+{
+public:
+    FrameFileReader() = default;
+    ~FrameFileReader() = default;
+
+    bool open(const std::filesystem::path& file_path);
+
+    const Size& size() const { return size_; }
+
+    // Applies the next record to |frame| and sets the updated region of the frame. Returns false
+    // at the end of the file or if the file is damaged.
+    bool readFrame(Frame* frame);
+
+    // Moves to the first record.
+    void rewind();
+
+private:
+    std::ifstream file_stream_;
+    std::streampos first_record_;
+    Size size_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameFileReader);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__FRAME_FILE_H
@@ -0,0 +1,130 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/hash_block.h"
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+
+// Number of bytes processed by all accumulators for one step.
+const int kStripeSize = 32;
+
+inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t* data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t accumulate(uint64_t acc, uint64_t input)
+{
+    acc += input * kPrime2;
+    acc = rotateLeft(acc, 31);
+    return acc * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+    acc ^= accumulate(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+uint64_t hashBlock(const uint8_t* image, int bytes_per_row, int bytes_per_block, int height)
+{
+    uint64_t acc[4] = { kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1 };
+
+    if (bytes_per_block % kStripeSize == 0)
+    {
+        // Fast path for full blocks: each row consists of whole stripes.
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < bytes_per_block; x += kStripeSize)
+            {
+                acc[0] = accumulate(acc[0], read64(image + x));
+                acc[1] = accumulate(acc[1], read64(image + x + 8));
+                acc[2] = accumulate(acc[2], read64(image + x + 16));
+                acc[3] = accumulate(acc[3], read64(image + x + 24));
+            }
+
+            image += bytes_per_row;
+        }
+    }
+    else
+    {
+        int lane = 0;
+
+        for (int y = 0; y < height; ++y)
+        {
+            int x = 0;
+
+            for (; x + 8 <= bytes_per_block; x += 8)
+            {
+                acc[lane] = accumulate(acc[lane], read64(image + x));
+                lane = (lane + 1) & 3;
+            }
+
+            // The tail of the row is padded with zeros.
+            if (x < bytes_per_block)
+            {
+                uint64_t tail = 0;
+                memcpy(&tail, image + x, bytes_per_block - x);
+
+                acc[lane] = accumulate(acc[lane], tail);
+                lane = (lane + 1) & 3;
+            }
+
+            image += bytes_per_row;
+        }
+    }
+
+    uint64_t hash = rotateLeft(acc[0], 1) + rotateLeft(acc[1], 7) +
+                    rotateLeft(acc[2], 12) + rotateLeft(acc[3], 18);
+
+    hash = mergeRound(hash, acc[0]);
+    hash = mergeRound(hash, acc[1]);
+    hash = mergeRound(hash, acc[2]);
+    hash = mergeRound(hash, acc[3]);
+
+    hash += static_cast<uint64_t>(bytes_per_block) * height;
+
+    // Final avalanche.
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+} // namespace desktop
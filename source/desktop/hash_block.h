@@ -0,0 +1,34 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__HASH_BLOCK_H
+#define DESKTOP__HASH_BLOCK_H
+
+#include <cstdint>
+
+namespace desktop {
+
+// Calculates a 64-bit hash of the image block. The block has |height| rows, each row contains
+// |bytes_per_block| bytes, rows are separated by |bytes_per_row| bytes.
+// The algorithm follows the structure of XXH64: four independent accumulators are updated with
+// 8-byte words, which allows the processor to compute them in parallel.
+uint64_t hashBlock(const uint8_t* image, int bytes_per_row, int bytes_per_block, int height);
+
+} // namespace desktop
+
+#endif // DESKTOP__HASH_BLOCK_H
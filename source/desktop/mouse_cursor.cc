@@ -17,6 +17,9 @@
 //
 
 #include "desktop/mouse_cursor.h"
+#include "desktop/hash_block.h"
+
+#include <cstring>
 
 namespace desktop {
 
@@ -45,4 +48,18 @@ bool MouseCursor::isEqual(const MouseCursor& other)
     return false;
 }
 
+uint64_t MouseCursor::hash() const
+{
+    uint64_t hash = hashBlock(data_.get(), stride(), stride(), size_.height());
+
+    const uint64_t geometry[] = { static_cast<uint64_t>(size_.width()),
+                                  static_cast<uint64_t>(hotspot_.x()),
+                                  static_cast<uint64_t>(hotspot_.y()) };
+
+    for (uint64_t value : geometry)
+        hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+
+    return hash;
+}
+
 } // namespace desktop
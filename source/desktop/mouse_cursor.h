@@ -41,6 +41,9 @@ public:
 
     bool isEqual(const MouseCursor& other);
 
+    // Calculates a 64-bit hash of the image, the size and the hotspot of the cursor.
+    uint64_t hash() const;
+
 private:
     std::unique_ptr<uint8_t[]> const data_;
     const Size size_;
@@ -24,28 +24,36 @@ namespace desktop {
 namespace {
 
 constexpr size_t kMinCacheSize = 2;
-constexpr size_t kMaxCacheSize = 31;
 
 } // namespace
 
-MouseCursorCache::MouseCursorCache(size_t cache_size) :
-    cache_size_(cache_size)
+const size_t MouseCursorCache::kInvalidIndex;
+const size_t MouseCursorCache::kMaxFifoCacheSize;
+const size_t MouseCursorCache::kMaxLruCacheSize;
+
+MouseCursorCache::MouseCursorCache(size_t cache_size, Eviction eviction)
+    : cache_size_(cache_size),
+      eviction_(eviction)
 {
-    // Nothing
+    DCHECK(isValidCacheSize(cache_size, eviction));
 }
 
+MouseCursorCache::~MouseCursorCache() = default;
+
 size_t MouseCursorCache::find(const MouseCursor* mouse_cursor)
 {
     DCHECK(mouse_cursor);
 
-    size_t size = cache_.size();
+    auto range = hash_index_.equal_range(mouse_cursor->hash());
 
-    for (size_t index = 0; index < size; ++index)
+    for (auto it = range.first; it != range.second; ++it)
     {
-        // If the cursor is found in the cache.
-        if (cache_.at(index)->isEqual(*mouse_cursor))
+        const size_t index = idToIndex(it->second);
+
+        // Different cursors may have the same hash.
+        if (entries_[index].cursor->isEqual(*mouse_cursor))
         {
-            // Return its index.
+            touch(index);
             return index;
         }
     }
@@ -57,47 +65,114 @@ size_t MouseCursorCache::add(std::unique_ptr<MouseCursor> mouse_cursor)
 {
     DCHECK(mouse_cursor);
 
-    // Add the cursor to the end of the list.
-    cache_.emplace_back(std::move(mouse_cursor));
+    const uint64_t hash = mouse_cursor->hash();
 
-    // If the current cache size exceeds the maximum cache size.
-    if (cache_.size() > cache_size_)
+    if (eviction_ == Eviction::FIFO)
     {
-        // Delete the first element in the cache (the oldest one).
-        cache_.pop_front();
+        // Add the cursor to the end of the list.
+        entries_.push_back({ std::move(mouse_cursor), hash });
+        hash_index_.emplace(hash, removed_count_ + entries_.size() - 1);
+
+        // If the current cache size exceeds the maximum cache size.
+        if (entries_.size() > cache_size_)
+        {
+            // Delete the first element in the cache (the oldest one).
+            removeFromHashIndex(entries_.front().hash, removed_count_);
+            entries_.pop_front();
+            ++removed_count_;
+        }
+
+        return entries_.size() - 1;
     }
 
-    return cache_.size() - 1;
+    size_t index;
+
+    if (entries_.size() < cache_size_)
+    {
+        // Free indexes are used first.
+        index = entries_.size();
+        entries_.push_back({ std::move(mouse_cursor), hash });
+        lru_positions_.push_back(lru_list_.insert(lru_list_.begin(), index));
+    }
+    else
+    {
+        // Replace the least recently used cursor.
+        index = lru_list_.back();
+        removeFromHashIndex(entries_[index].hash, index);
+        entries_[index] = { std::move(mouse_cursor), hash };
+        touch(index);
+    }
+
+    hash_index_.emplace(hash, index);
+    return index;
 }
 
 std::shared_ptr<MouseCursor> MouseCursorCache::get(size_t index)
 {
-    if (index > kMaxCacheSize)
+    if (index >= entries_.size())
     {
         LOG(LS_WARNING) << "Invalid cache index: " << index;
         return nullptr;
     }
 
-    return cache_.at(index);
+    touch(index);
+    return entries_[index].cursor;
 }
 
 bool MouseCursorCache::isEmpty() const
 {
-    return cache_.empty();
+    return entries_.empty();
 }
 
 void MouseCursorCache::clear()
 {
-    cache_.clear();
+    entries_.clear();
+    removed_count_ = 0;
+    lru_list_.clear();
+    lru_positions_.clear();
+    hash_index_.clear();
 }
 
 // static
-bool MouseCursorCache::isValidCacheSize(size_t size)
+bool MouseCursorCache::isValidCacheSize(size_t size, Eviction eviction)
 {
-    if (size < kMinCacheSize || size > kMaxCacheSize)
+    const size_t max_size =
+        (eviction == Eviction::FIFO) ? kMaxFifoCacheSize : kMaxLruCacheSize;
+
+    if (size < kMinCacheSize || size > max_size)
         return false;
 
     return true;
 }
 
+size_t MouseCursorCache::idToIndex(uint64_t id) const
+{
+    if (eviction_ == Eviction::FIFO)
+        return static_cast<size_t>(id - removed_count_);
+
+    return static_cast<size_t>(id);
+}
+
+void MouseCursorCache::touch(size_t index)
+{
+    if (eviction_ != Eviction::LRU)
+        return;
+
+    lru_list_.splice(lru_list_.begin(), lru_list_, lru_positions_[index]);
+}
+
+void MouseCursorCache::removeFromHashIndex(uint64_t hash, uint64_t id)
+{
+    auto range = hash_index_.equal_range(hash);
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == id)
+        {
+            hash_index_.erase(it);
+            return;
+        }
+    }
+}
+
 } // namespace desktop
@@ -22,27 +22,50 @@
 #include "desktop/mouse_cursor.h"
 
 #include <deque>
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <vector>
 
 namespace desktop {
 
+// The cache of the cursors sent to the client. The host and the client have the caches of the
+// same size and eviction type, and make the same changes in them, so the host can send only the
+// index of the cursor in the cache. The cursors are found by the hash of their content.
 class MouseCursorCache
 {
 public:
-    explicit MouseCursorCache(size_t cache_size);
-    ~MouseCursorCache() = default;
+    enum class Eviction
+    {
+        // The oldest cursor is removed and the indexes of the next cursors are decreased by one.
+        // Used with the clients which support only the small cache.
+        FIFO,
+
+        // The least recently used cursor is replaced with the new one. The indexes of the other
+        // cursors do not change.
+        LRU
+    };
+
+    explicit MouseCursorCache(size_t cache_size, Eviction eviction = Eviction::FIFO);
+    ~MouseCursorCache();
 
     static const size_t kInvalidIndex = std::numeric_limits<size_t>::max();
 
+    // The maximum cache sizes. The index in the FIFO cache is sent in 5 bits of the flags.
+    static const size_t kMaxFifoCacheSize = 31;
+    static const size_t kMaxLruCacheSize = 1024;
+
     // Looks for a matching cursor in the cache.
-    // If the cursor is already in the cache, the cursor index in the cache is
-    // returned.
-    // If the cursor is not in the cache, -1 is returned.
+    // If the cursor is already in the cache, the cursor index in the cache is returned and the
+    // cursor becomes the most recently used.
+    // If the cursor is not in the cache, kInvalidIndex is returned.
     size_t find(const MouseCursor* mouse_cursor);
 
     // Adds the cursor to the cache and returns the index of the added element.
     size_t add(std::unique_ptr<MouseCursor> mouse_cursor);
 
-    // Returns the pointer to the cached cursor by its index in the cache.
+    // Returns the pointer to the cached cursor by its index in the cache. The cursor becomes the
+    // most recently used. Returns nullptr if the index is invalid.
     std::shared_ptr<MouseCursor> get(size_t index);
 
     // Checks an empty cache or not.
@@ -53,12 +76,36 @@ public:
 
     // The current size of the cache.
     size_t size() const { return cache_size_; }
+    Eviction eviction() const { return eviction_; }
 
-    static bool isValidCacheSize(size_t size);
+    static bool isValidCacheSize(size_t size, Eviction eviction = Eviction::FIFO);
 
 private:
-    std::deque<std::shared_ptr<MouseCursor>> cache_;
+    struct Entry
+    {
+        std::shared_ptr<MouseCursor> cursor;
+        uint64_t hash;
+    };
+
+    size_t idToIndex(uint64_t id) const;
+    void touch(size_t index);
+    void removeFromHashIndex(uint64_t hash, uint64_t id);
+
     const size_t cache_size_;
+    const Eviction eviction_;
+
+    // FIFO: the cursors in the order of adding. The identifier of the cursor is its index plus
+    // the number of the removed cursors, so it does not change when the first cursor is removed.
+    // LRU: the cursors by their indexes. The identifier of the cursor is its index.
+    std::deque<Entry> entries_;
+    uint64_t removed_count_ = 0;
+
+    // LRU only. The indexes from the most recently used to the least recently used.
+    std::list<size_t> lru_list_;
+    std::vector<std::list<size_t>::iterator> lru_positions_;
+
+    // Maps the hashes of the cursors to their identifiers.
+    std::unordered_multimap<uint64_t, uint64_t> hash_index_;
 };
 
 } // namespace desktop
@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/mouse_cursor_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+std::unique_ptr<MouseCursor> createCursor(int id)
+{
+    const Size size(32, 32);
+    const size_t data_size = size.width() * size.height() * sizeof(uint32_t);
+
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(data_size);
+    memset(data.get(), id, data_size);
+
+    return std::make_unique<MouseCursor>(std::move(data), size, Point(id % 7, id % 5));
+}
+
+} // namespace
+
+TEST(mouse_cursor_cache_test, find)
+{
+    MouseCursorCache cache(8);
+    EXPECT_TRUE(cache.isEmpty());
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(cache.add(createCursor(i)), static_cast<size_t>(i));
+
+    EXPECT_FALSE(cache.isEmpty());
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(cache.find(createCursor(i).get()), static_cast<size_t>(i));
+
+    EXPECT_EQ(cache.find(createCursor(4).get()), MouseCursorCache::kInvalidIndex);
+
+    // The same image with a different hotspot is a different cursor.
+    std::unique_ptr<MouseCursor> cursor = createCursor(1);
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(32 * 32 * sizeof(uint32_t));
+    memcpy(data.get(), cursor->data(), 32 * 32 * sizeof(uint32_t));
+    MouseCursor moved_hotspot(std::move(data), cursor->size(), Point(10, 10));
+
+    EXPECT_EQ(cache.find(&moved_hotspot), MouseCursorCache::kInvalidIndex);
+
+    cache.clear();
+    EXPECT_TRUE(cache.isEmpty());
+    EXPECT_EQ(cache.find(createCursor(0).get()), MouseCursorCache::kInvalidIndex);
+}
+
+TEST(mouse_cursor_cache_test, fifo_eviction)
+{
+    MouseCursorCache cache(4, MouseCursorCache::Eviction::FIFO);
+
+    for (int i = 0; i < 4; ++i)
+        cache.add(createCursor(i));
+
+    // The use of the cursor does not matter for the FIFO cache.
+    EXPECT_EQ(cache.find(createCursor(0).get()), 0u);
+
+    // The oldest cursor is removed and the indexes are shifted.
+    EXPECT_EQ(cache.add(createCursor(4)), 3u);
+    EXPECT_EQ(cache.find(createCursor(0).get()), MouseCursorCache::kInvalidIndex);
+
+    for (int i = 1; i < 5; ++i)
+        EXPECT_EQ(cache.find(createCursor(i).get()), static_cast<size_t>(i - 1));
+
+    EXPECT_TRUE(cache.get(0)->isEqual(*createCursor(1)));
+    EXPECT_FALSE(cache.get(4));
+}
+
+TEST(mouse_cursor_cache_test, lru_eviction)
+{
+    MouseCursorCache cache(4, MouseCursorCache::Eviction::LRU);
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(cache.add(createCursor(i)), static_cast<size_t>(i));
+
+    // Cursors 0 and 2 are used, so cursor 1 is the least recently used.
+    EXPECT_EQ(cache.find(createCursor(0).get()), 0u);
+    EXPECT_TRUE(cache.get(2));
+
+    EXPECT_EQ(cache.add(createCursor(4)), 1u);
+    EXPECT_EQ(cache.find(createCursor(1).get()), MouseCursorCache::kInvalidIndex);
+
+    // The indexes of the other cursors do not change.
+    EXPECT_EQ(cache.find(createCursor(0).get()), 0u);
+    EXPECT_EQ(cache.find(createCursor(2).get()), 2u);
+    EXPECT_EQ(cache.find(createCursor(3).get()), 3u);
+    EXPECT_EQ(cache.find(createCursor(4).get()), 1u);
+
+    // Now cursor 0 is the least recently used.
+    EXPECT_EQ(cache.add(createCursor(5)), 0u);
+}
+
+TEST(mouse_cursor_cache_test, cache_size)
+{
+    EXPECT_FALSE(MouseCursorCache::isValidCacheSize(1));
+    EXPECT_TRUE(MouseCursorCache::isValidCacheSize(31));
+    EXPECT_FALSE(MouseCursorCache::isValidCacheSize(32));
+    EXPECT_TRUE(MouseCursorCache::isValidCacheSize(256, MouseCursorCache::Eviction::LRU));
+    EXPECT_FALSE(MouseCursorCache::isValidCacheSize(2048, MouseCursorCache::Eviction::LRU));
+}
+
+} // namespace desktop
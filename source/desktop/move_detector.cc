@@ -0,0 +1,418 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/move_detector.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+#include "desktop/hash_block.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace desktop {
+
+namespace {
+
+// Width of a row segment and height of a column segment for which the hashes are calculated.
+const int kStripSize = 64;
+
+// The minimum length (in rows or columns) of the moved area.
+const int kMinMoveLength = 16;
+
+const uint64_t kColumnPrime = 0x9E3779B185EBCA87ULL;
+const uint64_t kCombinePrime = 0xC2B2AE3D27D4EB4FULL;
+
+// Calculates the range of strips [first, last) that are fully inside [begin, end). The last
+// strip of the screen may be partial.
+void fullStripRange(int begin, int end, int total_length, int* first, int* last)
+{
+    *first = (begin + kStripSize - 1) / kStripSize;
+
+    if (end == total_length)
+        *last = (end + kStripSize - 1) / kStripSize;
+    else
+        *last = end / kStripSize;
+}
+
+// Combines the hashes of strips [first, last) of one row (or one column) into a single key.
+uint64_t combineHashes(const uint64_t* hashes, int first, int last, int stride)
+{
+    uint64_t key = 0;
+
+    for (int i = first; i < last; ++i)
+        key = (key ^ hashes[i * stride]) * kCombinePrime;
+
+    return key;
+}
+
+// Searches for the offset at which the most |curr_keys| have a unique match in |prev_keys|.
+// Index |i| of |curr_keys| corresponds to the position |curr_begin + i| and index |i| of
+// |prev_keys| corresponds to the position |prev_begin + i|.
+// Then searches for the longest run of positions where the keys match at that offset.
+bool findMove(const std::vector<uint64_t>& curr_keys, int curr_begin,
+              const std::vector<uint64_t>& prev_keys, int prev_begin,
+              int* offset, int* run_begin, int* run_end)
+{
+    // Key -> position in the previous frame, or -1 if the key is not unique.
+    std::unordered_map<uint64_t, int> prev_positions;
+
+    for (size_t i = 0; i < prev_keys.size(); ++i)
+    {
+        const int pos = prev_begin + static_cast<int>(i);
+
+        auto result = prev_positions.emplace(prev_keys[i], pos);
+        if (!result.second)
+            result.first->second = -1;
+    }
+
+    // Offset -> number of positions that moved by this offset.
+    std::unordered_map<int, int> votes;
+
+    for (size_t i = 0; i < curr_keys.size(); ++i)
+    {
+        const int pos = curr_begin + static_cast<int>(i);
+
+        auto it = prev_positions.find(curr_keys[i]);
+        if (it == prev_positions.end() || it->second < 0 || it->second == pos)
+            continue;
+
+        ++votes[pos - it->second];
+    }
+
+    int best_offset = 0;
+    int best_votes = 0;
+
+    for (const auto& vote : votes)
+    {
+        if (vote.second > best_votes ||
+            (vote.second == best_votes && std::abs(vote.first) < std::abs(best_offset)))
+        {
+            best_offset = vote.first;
+            best_votes = vote.second;
+        }
+    }
+
+    if (best_votes < kMinMoveLength)
+        return false;
+
+    const int prev_end = prev_begin + static_cast<int>(prev_keys.size());
+    int current_begin = -1;
+    int best_length = 0;
+
+    for (size_t i = 0; i <= curr_keys.size(); ++i)
+    {
+        const int pos = curr_begin + static_cast<int>(i);
+        const int prev_pos = pos - best_offset;
+
+        const bool match = i < curr_keys.size() && prev_pos >= prev_begin &&
+            prev_pos < prev_end && curr_keys[i] == prev_keys[prev_pos - prev_begin];
+
+        if (match)
+        {
+            if (current_begin < 0)
+                current_begin = pos;
+        }
+        else if (current_begin >= 0)
+        {
+            if (pos - current_begin > best_length)
+            {
+                best_length = pos - current_begin;
+                *run_begin = current_begin;
+                *run_end = pos;
+            }
+
+            current_begin = -1;
+        }
+    }
+
+    if (best_length < kMinMoveLength)
+        return false;
+
+    *offset = best_offset;
+    return true;
+}
+
+} // namespace
+
+void MoveDetector::detect(const Frame* frame, Region* dirty_region, MoveList* moves)
+{
+    DCHECK(frame);
+    DCHECK(dirty_region);
+    DCHECK(moves);
+
+    if (!hashes_valid_ || size_ != frame->size() || !(format_ == frame->format()))
+    {
+        size_ = frame->size();
+        format_ = frame->format();
+
+        strips_x_ = (size_.width() + kStripSize - 1) / kStripSize;
+        strips_y_ = (size_.height() + kStripSize - 1) / kStripSize;
+
+        const size_t row_hashes_count = static_cast<size_t>(size_.height()) * strips_x_;
+        const size_t column_hashes_count = static_cast<size_t>(size_.width()) * strips_y_;
+
+        prev_row_hashes_.resize(row_hashes_count);
+        curr_row_hashes_.resize(row_hashes_count);
+        prev_column_hashes_.resize(column_hashes_count);
+        curr_column_hashes_.resize(column_hashes_count);
+
+        const Rect frame_rect = Rect::makeSize(size_);
+
+        calcRowHashes(frame, frame_rect);
+        calcColumnHashes(frame, frame_rect);
+        applyHashes(frame_rect);
+
+        hashes_valid_ = true;
+        return;
+    }
+
+    std::vector<Rect> rects;
+
+    for (Region::Iterator it(*dirty_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        calcRowHashes(frame, rect);
+        calcColumnHashes(frame, rect);
+
+        rects.push_back(rect);
+    }
+
+    // Larger areas are checked first.
+    std::sort(rects.begin(), rects.end(), [](const Rect& r1, const Rect& r2)
+    {
+        return r1.width() * r1.height() > r2.width() * r2.height();
+    });
+
+    Region moved_region;
+    Region source_region;
+
+    for (const auto& rect : rects)
+    {
+        if (rect.width() < kMinMoveLength || rect.height() < kMinMoveLength)
+            continue;
+
+        Move move;
+
+        if (!findVerticalMove(rect, &move) && !findHorizontalMove(rect, &move))
+            continue;
+
+        const Rect source_rect = Rect::makeXYWH(move.source_pos, move.dest_rect.size());
+
+        // The source of a move must not be overwritten by the destination of another move and
+        // vice versa.
+        Region source_conflict(source_rect);
+        source_conflict.intersectWith(moved_region);
+
+        Region dest_conflict(move.dest_rect);
+        dest_conflict.intersectWith(source_region);
+
+        if (!source_conflict.isEmpty() || !dest_conflict.isEmpty())
+            continue;
+
+        moved_region.addRect(move.dest_rect);
+        source_region.addRect(source_rect);
+
+        moves->push_back(move);
+    }
+
+    for (const auto& rect : rects)
+        applyHashes(rect);
+
+    dirty_region->subtract(moved_region);
+}
+
+void MoveDetector::reset()
+{
+    hashes_valid_ = false;
+}
+
+void MoveDetector::calcRowHashes(const Frame* frame, const Rect& rect)
+{
+    const int bytes_per_pixel = format_.bytesPerPixel();
+    const int first_strip = rect.left() / kStripSize;
+    const int last_strip = (rect.right() - 1) / kStripSize;
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint64_t* hashes = curr_row_hashes_.data() + y * strips_x_;
+
+        for (int strip = first_strip; strip <= last_strip; ++strip)
+        {
+            const int x = strip * kStripSize;
+            const int width = std::min(kStripSize, size_.width() - x);
+
+            hashes[strip] = hashBlock(
+                frame->frameDataAtPos(x, y), frame->stride(), width * bytes_per_pixel, 1);
+        }
+    }
+}
+
+void MoveDetector::calcColumnHashes(const Frame* frame, const Rect& rect)
+{
+    const int bytes_per_pixel = format_.bytesPerPixel();
+    const int first_strip = rect.top() / kStripSize;
+    const int last_strip = (rect.bottom() - 1) / kStripSize;
+
+    for (int strip = first_strip; strip <= last_strip; ++strip)
+    {
+        const int top = strip * kStripSize;
+        const int bottom = std::min(top + kStripSize, size_.height());
+
+        uint64_t* hashes = curr_column_hashes_.data() + strip * size_.width();
+
+        for (int x = rect.left(); x < rect.right(); ++x)
+            hashes[x] = kColumnPrime;
+
+        // The frame is read row by row, each column has its own accumulator.
+        for (int y = top; y < bottom; ++y)
+        {
+            const uint8_t* pixel = frame->frameDataAtPos(rect.left(), y);
+
+            for (int x = rect.left(); x < rect.right(); ++x)
+            {
+                uint32_t value = 0;
+                memcpy(&value, pixel, bytes_per_pixel);
+
+                hashes[x] = (hashes[x] ^ value) * kColumnPrime;
+                pixel += bytes_per_pixel;
+            }
+        }
+
+        for (int x = rect.left(); x < rect.right(); ++x)
+            hashes[x] ^= hashes[x] >> 29;
+    }
+}
+
+bool MoveDetector::findVerticalMove(const Rect& rect, Move* move) const
+{
+    int first_strip;
+    int last_strip;
+
+    fullStripRange(rect.left(), rect.right(), size_.width(), &first_strip, &last_strip);
+    if (first_strip >= last_strip)
+        return false;
+
+    // The content can be moved from the rows above or below the area.
+    const int search_top = std::max(0, rect.top() - rect.height());
+    const int search_bottom = std::min(size_.height(), rect.bottom() + rect.height());
+
+    std::vector<uint64_t> curr_keys;
+    std::vector<uint64_t> prev_keys;
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        curr_keys.push_back(combineHashes(
+            curr_row_hashes_.data() + y * strips_x_, first_strip, last_strip, 1));
+    }
+
+    for (int y = search_top; y < search_bottom; ++y)
+    {
+        prev_keys.push_back(combineHashes(
+            prev_row_hashes_.data() + y * strips_x_, first_strip, last_strip, 1));
+    }
+
+    int offset;
+    int run_top;
+    int run_bottom;
+
+    if (!findMove(curr_keys, rect.top(), prev_keys, search_top, &offset, &run_top, &run_bottom))
+        return false;
+
+    const int left = first_strip * kStripSize;
+    const int right = std::min(last_strip * kStripSize, size_.width());
+
+    move->dest_rect = Rect::makeLTRB(left, run_top, right, run_bottom);
+    move->source_pos = Point(left, run_top - offset);
+    return true;
+}
+
+bool MoveDetector::findHorizontalMove(const Rect& rect, Move* move) const
+{
+    int first_strip;
+    int last_strip;
+
+    fullStripRange(rect.top(), rect.bottom(), size_.height(), &first_strip, &last_strip);
+    if (first_strip >= last_strip)
+        return false;
+
+    // The content can be moved from the columns to the left or to the right of the area.
+    const int search_left = std::max(0, rect.left() - rect.width());
+    const int search_right = std::min(size_.width(), rect.right() + rect.width());
+
+    std::vector<uint64_t> curr_keys;
+    std::vector<uint64_t> prev_keys;
+
+    for (int x = rect.left(); x < rect.right(); ++x)
+    {
+        curr_keys.push_back(combineHashes(
+            curr_column_hashes_.data() + x, first_strip, last_strip, size_.width()));
+    }
+
+    for (int x = search_left; x < search_right; ++x)
+    {
+        prev_keys.push_back(combineHashes(
+            prev_column_hashes_.data() + x, first_strip, last_strip, size_.width()));
+    }
+
+    int offset;
+    int run_left;
+    int run_right;
+
+    if (!findMove(curr_keys, rect.left(), prev_keys, search_left, &offset, &run_left, &run_right))
+        return false;
+
+    const int top = first_strip * kStripSize;
+    const int bottom = std::min(last_strip * kStripSize, size_.height());
+
+    move->dest_rect = Rect::makeLTRB(run_left, top, run_right, bottom);
+    move->source_pos = Point(run_left - offset, top);
+    return true;
+}
+
+void MoveDetector::applyHashes(const Rect& rect)
+{
+    const int first_strip_x = rect.left() / kStripSize;
+    const int last_strip_x = (rect.right() - 1) / kStripSize;
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const size_t offset = y * strips_x_ + first_strip_x;
+
+        std::copy_n(curr_row_hashes_.begin() + offset,
+                    last_strip_x - first_strip_x + 1,
+                    prev_row_hashes_.begin() + offset);
+    }
+
+    const int first_strip_y = rect.top() / kStripSize;
+    const int last_strip_y = (rect.bottom() - 1) / kStripSize;
+
+    for (int strip = first_strip_y; strip <= last_strip_y; ++strip)
+    {
+        const size_t offset = strip * size_.width() + rect.left();
+
+        std::copy_n(curr_column_hashes_.begin() + offset,
+                    rect.width(),
+                    prev_column_hashes_.begin() + offset);
+    }
+}
+
+} // namespace desktop
@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__MOVE_DETECTOR_H
+#define DESKTOP__MOVE_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+#include "desktop/pixel_format.h"
+
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+
+// Searches for areas of the screen that were shifted vertically or horizontally between frames
+// (scrolling of a window content, moving of a window).
+//
+// The previous frame is not kept. Instead, the detector keeps hashes of row segments (strips of
+// kStripSize pixels width) and column segments (strips of kStripSize pixels height). Only the
+// hashes inside the dirty region are calculated again for each frame.
+class MoveDetector
+{
+public:
+    struct Move
+    {
+        // Top-left corner of the area in the previous frame.
+        Point source_pos;
+
+        // The area in the current frame.
+        Rect dest_rect;
+    };
+
+    using MoveList = std::vector<Move>;
+
+    MoveDetector() = default;
+    ~MoveDetector() = default;
+
+    // Searches for the moved areas inside |dirty_region| of |frame|. The found areas are added to
+    // |moves| and removed from |dirty_region|. The sources of the moves are located in the
+    // previous frame and never overlap with the destinations of other moves.
+    // The first call (and the first call after reset() or a change of the frame size or format)
+    // only calculates the hashes.
+    void detect(const Frame* frame, Region* dirty_region, MoveList* moves);
+
+    // Forgets the previous frame.
+    void reset();
+
+private:
+    void calcRowHashes(const Frame* frame, const Rect& rect);
+    void calcColumnHashes(const Frame* frame, const Rect& rect);
+
+    bool findVerticalMove(const Rect& rect, Move* move) const;
+    bool findHorizontalMove(const Rect& rect, Move* move) const;
+
+    void applyHashes(const Rect& rect);
+
+    Size size_;
+    PixelFormat format_;
+
+    int strips_x_ = 0;
+    int strips_y_ = 0;
+
+    // Hashes of row segments: |height| rows of |strips_x_| hashes.
+    std::vector<uint64_t> prev_row_hashes_;
+    std::vector<uint64_t> curr_row_hashes_;
+
+    // Hashes of column segments: |strips_y_| rows of |width| hashes.
+    std::vector<uint64_t> prev_column_hashes_;
+    std::vector<uint64_t> curr_column_hashes_;
+
+    bool hashes_valid_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(MoveDetector);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__MOVE_DETECTOR_H
@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/move_detector.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(640, 480);
+const Rect kWindowRect = Rect::makeLTRB(96, 50, 500, 400);
+
+std::unique_ptr<Frame> createFrame(std::mt19937* random)
+{
+    std::unique_ptr<Frame> frame = FrameAligned::create(kScreenSize, PixelFormat::ARGB(), 32);
+
+    uint8_t* data = frame->frameData();
+    for (int i = 0; i < frame->stride() * kScreenSize.height(); ++i)
+        data[i] = static_cast<uint8_t>((*random)());
+
+    return frame;
+}
+
+void fillRect(Frame* frame, const Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width() * frame->format().bytesPerPixel(); ++x)
+            row[x] = static_cast<uint8_t>((*random)());
+    }
+}
+
+// Applies the moves and the dirty region to |client_frame| the same way as the client does.
+void applyUpdate(Frame* client_frame,
+                 const Frame& host_frame,
+                 const MoveDetector::MoveList& moves,
+                 const Region& dirty_region)
+{
+    for (const auto& move : moves)
+        client_frame->movePixels(move.source_pos, move.dest_rect);
+
+    for (Region::Iterator it(dirty_region); !it.isAtEnd(); it.advance())
+        client_frame->copyPixelsFrom(host_frame, it.rect().topLeft(), it.rect());
+}
+
+bool isEqualFrames(const Frame& frame1, const Frame& frame2)
+{
+    return memcmp(frame1.frameData(), frame2.frameData(),
+                  frame1.stride() * frame1.size().height()) == 0;
+}
+
+void checkMove(int dx, int dy)
+{
+    std::mt19937 random(dx * 1000 + dy);
+
+    std::unique_ptr<Frame> host_frame = createFrame(&random);
+    std::unique_ptr<Frame> client_frame = FrameAligned::create(kScreenSize, PixelFormat::ARGB(), 32);
+    client_frame->copyPixelsFrom(*host_frame, Point(0, 0), Rect::makeSize(kScreenSize));
+
+    MoveDetector detector;
+    MoveDetector::MoveList moves;
+
+    Region dirty_region(Rect::makeSize(kScreenSize));
+    detector.detect(host_frame.get(), &dirty_region, &moves);
+    EXPECT_TRUE(moves.empty());
+
+    // Scroll the content of the window and draw the new content in the uncovered area.
+    Rect dest_rect = kWindowRect;
+    dest_rect.intersectWith(Rect::makeXYWH(
+        kWindowRect.left() + dx, kWindowRect.top() + dy, kWindowRect.width(), kWindowRect.height()));
+
+    host_frame->movePixels(Point(dest_rect.left() - dx, dest_rect.top() - dy), dest_rect);
+
+    Region uncovered_region(kWindowRect);
+    uncovered_region.subtract(dest_rect);
+
+    for (Region::Iterator it(uncovered_region); !it.isAtEnd(); it.advance())
+        fillRect(host_frame.get(), it.rect(), &random);
+
+    dirty_region.setRect(kWindowRect);
+    detector.detect(host_frame.get(), &dirty_region, &moves);
+
+    ASSERT_FALSE(moves.empty());
+
+    for (const auto& move : moves)
+    {
+        EXPECT_EQ(move.dest_rect.left() - move.source_pos.x(), dx);
+        EXPECT_EQ(move.dest_rect.top() - move.source_pos.y(), dy);
+    }
+
+    // A large part of the window must be moved instead of being sent.
+    Region moved_region(kWindowRect);
+    moved_region.subtract(dirty_region);
+
+    int moved_area = 0;
+    for (Region::Iterator it(moved_region); !it.isAtEnd(); it.advance())
+        moved_area += it.rect().width() * it.rect().height();
+
+    EXPECT_GT(moved_area, kWindowRect.width() * kWindowRect.height() / 3);
+
+    applyUpdate(client_frame.get(), *host_frame, moves, dirty_region);
+    EXPECT_TRUE(isEqualFrames(*client_frame, *host_frame));
+}
+
+} // namespace
+
+TEST(move_detector_test, vertical_move)
+{
+    checkMove(0, -24);
+    checkMove(0, 24);
+    checkMove(0, -150);
+}
+
+TEST(move_detector_test, horizontal_move)
+{
+    checkMove(-40, 0);
+    checkMove(40, 0);
+}
+
+TEST(move_detector_test, no_move)
+{
+    std::mt19937 random(1);
+    std::unique_ptr<Frame> frame = createFrame(&random);
+
+    MoveDetector detector;
+    MoveDetector::MoveList moves;
+
+    Region dirty_region(Rect::makeSize(kScreenSize));
+    detector.detect(frame.get(), &dirty_region, &moves);
+
+    fillRect(frame.get(), kWindowRect, &random);
+
+    dirty_region.setRect(kWindowRect);
+    detector.detect(frame.get(), &dirty_region, &moves);
+
+    EXPECT_TRUE(moves.empty());
+    EXPECT_TRUE(dirty_region.equals(Region(kWindowRect)));
+}
+
+} // namespace desktop
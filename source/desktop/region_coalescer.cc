@@ -0,0 +1,273 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/region_coalescer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace desktop {
+
+namespace {
+
+const int64_t kNoMerge = std::numeric_limits<int64_t>::max();
+
+bool intersects(const Rect& rect1, const Rect& rect2)
+{
+    return rect1.left() < rect2.right() && rect2.left() < rect1.right() &&
+           rect1.top() < rect2.bottom() && rect2.top() < rect1.bottom();
+}
+
+} // namespace
+
+RegionCoalescer::RegionCoalescer(const CostModel& cost_model)
+    : cost_model_(cost_model)
+{
+    // Nothing
+}
+
+void RegionCoalescer::coalesce(const Region& region, std::vector<Rect>* rects)
+{
+    std::vector<Rect>& source = source_rects_;
+    source.clear();
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        source.push_back(it.rect());
+
+    rects->clear();
+
+    if (source.empty())
+        return;
+
+    const size_t group_size = std::max(cost_model_.max_group_size, 2);
+
+    // The iterator returns the rectangles sorted by the top edge. A group is closed where none
+    // of its rectangles extends below the next one, so the bounding boxes of different groups do
+    // not overlap. Groups are never allowed to grow beyond |max_group_size| * 4 rectangles to
+    // limit the quadratic cost of the search. Such a group is closed anywhere, and the overlaps
+    // of its boxes with the boxes of the next groups are removed afterwards.
+    size_t first = 0;
+    int bottom = source.front().bottom();
+    bool separated = true;
+
+    for (size_t i = 1; i < source.size(); ++i)
+    {
+        const size_t current_size = i - first;
+
+        if (current_size >= group_size && source[i].top() >= bottom)
+        {
+            coalesceGroup(source.data() + first, current_size, rects);
+            first = i;
+        }
+        else if (current_size >= group_size * 4)
+        {
+            coalesceGroup(source.data() + first, current_size, rects);
+            first = i;
+            separated = false;
+        }
+
+        bottom = std::max(bottom, source[i].bottom());
+    }
+
+    coalesceGroup(source.data() + first, source.size() - first, rects);
+
+    if (!separated)
+        removeOverlaps(rects);
+
+    ++statistics_.regions;
+    statistics_.rects_before += source.size();
+    statistics_.rects_after += rects->size();
+}
+
+// static
+int64_t RegionCoalescer::area(const Rect& rect)
+{
+    return static_cast<int64_t>(rect.width()) * rect.height();
+}
+
+// static
+int64_t RegionCoalescer::mergeExtra(const Box& box1, const Box& box2)
+{
+    const int64_t width = std::max(box1.rect.right(), box2.rect.right()) -
+        std::min(box1.rect.left(), box2.rect.left());
+    const int64_t height = std::max(box1.rect.bottom(), box2.rect.bottom()) -
+        std::min(box1.rect.top(), box2.rect.top());
+
+    return width * height - box1.covered - box2.covered;
+}
+
+void RegionCoalescer::updateBestPartner(size_t index)
+{
+    Box& box = boxes_[index];
+
+    box.best_partner = index;
+    box.best_extra = kNoMerge;
+
+    for (size_t i = 0; i < boxes_.size(); ++i)
+    {
+        if (i == index || boxes_[i].removed)
+            continue;
+
+        const int64_t extra = mergeExtra(box, boxes_[i]);
+        if (extra < box.best_extra)
+        {
+            box.best_extra = extra;
+            box.best_partner = i;
+        }
+    }
+}
+
+void RegionCoalescer::coalesceGroup(const Rect* rects, size_t count, std::vector<Rect>* output)
+{
+    boxes_.clear();
+
+    for (size_t i = 0; i < count; ++i)
+        boxes_.push_back({ rects[i], area(rects[i]), false, i, kNoMerge });
+
+    for (size_t i = 0; i < count; ++i)
+        updateBestPartner(i);
+
+    // Two boxes are merged if the cost of the extra pixels is less than the cost of one
+    // rectangle. The cheapest merge is always done first.
+    const int64_t max_extra_cost = cost_model_.rect_cost;
+    const int64_t pixel_cost = std::max(cost_model_.pixel_cost, 1);
+
+    for (;;)
+    {
+        size_t best = count;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (boxes_[i].removed || boxes_[i].best_extra == kNoMerge)
+                continue;
+
+            if (best == count || boxes_[i].best_extra < boxes_[best].best_extra)
+                best = i;
+        }
+
+        if (best == count || boxes_[best].best_extra * pixel_cost >= max_extra_cost)
+            break;
+
+        Box& box = boxes_[best];
+        const size_t partner = box.best_partner;
+
+        box.rect.unionWith(boxes_[partner].rect);
+        box.covered += boxes_[partner].covered;
+        boxes_[partner].removed = true;
+
+        // The bounding box may overlap other boxes. They are absorbed, so that the resulting
+        // rectangles never overlap.
+        bool absorbed;
+        do
+        {
+            absorbed = false;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i == best || boxes_[i].removed || !intersects(box.rect, boxes_[i].rect))
+                    continue;
+
+                box.rect.unionWith(boxes_[i].rect);
+                box.covered += boxes_[i].covered;
+                boxes_[i].removed = true;
+                absorbed = true;
+            }
+        }
+        while (absorbed);
+
+        updateBestPartner(best);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Box& other = boxes_[i];
+            if (i == best || other.removed)
+                continue;
+
+            const int64_t extra = mergeExtra(other, box);
+
+            if (extra <= other.best_extra && !boxes_[other.best_partner].removed)
+            {
+                other.best_extra = extra;
+                other.best_partner = best;
+            }
+            else if (other.best_partner == best || boxes_[other.best_partner].removed)
+            {
+                // The best partner has grown or has been absorbed, search again.
+                updateBestPartner(i);
+            }
+        }
+    }
+
+    for (const auto& box : boxes_)
+    {
+        if (box.removed)
+            continue;
+
+        output->push_back(box.rect);
+        statistics_.extra_pixels += area(box.rect) - box.covered;
+    }
+}
+
+void RegionCoalescer::removeOverlaps(std::vector<Rect>* rects)
+{
+    std::vector<Rect>& result = disjoint_rects_;
+    result.clear();
+
+    for (const auto& rect : *rects)
+    {
+        Region rest;
+        bool overlaps = false;
+
+        // The rectangles already in |result| do not overlap each other, so the parts of |rect|
+        // outside of them can be added.
+        for (const auto& other : result)
+        {
+            if (!intersects(rect, other))
+                continue;
+
+            if (!overlaps)
+            {
+                rest.setRect(rect);
+                overlaps = true;
+            }
+
+            rest.subtract(other);
+        }
+
+        if (!overlaps)
+        {
+            result.push_back(rect);
+            continue;
+        }
+
+        int64_t rest_area = 0;
+
+        for (Region::Iterator it(rest); !it.isAtEnd(); it.advance())
+        {
+            result.push_back(it.rect());
+            rest_area += area(it.rect());
+        }
+
+        // The removed pixels were counted by both rectangles.
+        statistics_.extra_pixels -= area(rect) - rest_area;
+    }
+
+    rects->swap(result);
+}
+
+} // namespace desktop
@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__REGION_COALESCER_H
+#define DESKTOP__REGION_COALESCER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <vector>
+
+namespace desktop {
+
+// Merges nearby rectangles of a region into their bounding boxes when encoding the extra pixels
+// costs less than encoding the rectangles separately. Every rectangle costs the encoder and the
+// decoder a fixed overhead (a rectangle in the packet, a call of the pixel translator, setup of
+// the row loops), so highly fragmented regions are cheaper to send as fewer, larger rectangles.
+class RegionCoalescer
+{
+public:
+    struct CostModel
+    {
+        // Fixed cost of one rectangle in abstract units.
+        int rect_cost = 2048;
+
+        // Cost of one pixel in the same units. Usually the number of bytes per pixel.
+        int pixel_cost = 4;
+
+        // Regions are split into groups of about this number of rectangles (in top to bottom
+        // order) which are coalesced separately. Limits the time spent on fragmented regions.
+        int max_group_size = 64;
+    };
+
+    struct Statistics
+    {
+        int64_t regions = 0;
+        int64_t rects_before = 0;
+        int64_t rects_after = 0;
+
+        // Pixels that were not in the source regions but are covered by the merged rectangles.
+        int64_t extra_pixels = 0;
+    };
+
+    RegionCoalescer() = default;
+    explicit RegionCoalescer(const CostModel& cost_model);
+    ~RegionCoalescer() = default;
+
+    void setCostModel(const CostModel& cost_model) { cost_model_ = cost_model; }
+    const CostModel& costModel() const { return cost_model_; }
+
+    // Stores the rectangles covering |region| to |rects|. The rectangles cover every pixel of
+    // |region| and may cover some pixels outside of it. The rectangles never overlap.
+    void coalesce(const Region& region, std::vector<Rect>* rects);
+
+    const Statistics& statistics() const { return statistics_; }
+    void resetStatistics() { statistics_ = Statistics(); }
+
+private:
+    struct Box
+    {
+        Rect rect;
+
+        // The number of pixels of the source region covered by the box.
+        int64_t covered;
+
+        bool removed;
+
+        // The box whose merge with this one adds the fewest extra pixels.
+        size_t best_partner;
+        int64_t best_extra;
+    };
+
+    static int64_t area(const Rect& rect);
+    static int64_t mergeExtra(const Box& box1, const Box& box2);
+
+    void coalesceGroup(const Rect* rects, size_t count, std::vector<Rect>* output);
+    void removeOverlaps(std::vector<Rect>* rects);
+    void updateBestPartner(size_t index);
+
+    CostModel cost_model_;
+    Statistics statistics_;
+
+    // Reused between the calls to avoid allocations.
+    std::vector<Rect> source_rects_;
+    std::vector<Box> boxes_;
+    std::vector<Rect> disjoint_rects_;
+
+    DISALLOW_COPY_AND_ASSIGN(RegionCoalescer);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__REGION_COALESCER_H
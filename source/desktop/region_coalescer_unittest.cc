@@ -0,0 +1,223 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/region_coalescer.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+int64_t area(const Rect& rect)
+{
+    return static_cast<int64_t>(rect.width()) * rect.height();
+}
+
+int64_t regionArea(const Region& region)
+{
+    int64_t result = 0;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        result += area(it.rect());
+
+    return result;
+}
+
+// Checks that |rects| cover |region| and do not overlap.
+void checkCoverage(const Region& region, const std::vector<Rect>& rects)
+{
+    Region covered;
+    int64_t rects_area = 0;
+
+    for (const auto& rect : rects)
+    {
+        covered.addRect(rect);
+        rects_area += area(rect);
+    }
+
+    EXPECT_EQ(regionArea(covered), rects_area);
+
+    Region uncovered(region);
+    uncovered.subtract(covered);
+    EXPECT_TRUE(uncovered.isEmpty());
+}
+
+} // namespace
+
+TEST(region_coalescer_test, empty_region)
+{
+    RegionCoalescer coalescer;
+    std::vector<Rect> rects;
+
+    coalescer.coalesce(Region(), &rects);
+    EXPECT_TRUE(rects.empty());
+}
+
+TEST(region_coalescer_test, merges_nearby_rects)
+{
+    RegionCoalescer coalescer;
+    std::vector<Rect> rects;
+
+    // A caret and a character next to it.
+    Region region;
+    region.addRect(Rect::makeXYWH(100, 100, 2, 16));
+    region.addRect(Rect::makeXYWH(104, 102, 8, 12));
+
+    coalescer.coalesce(region, &rects);
+
+    ASSERT_EQ(rects.size(), 1U);
+    EXPECT_EQ(rects[0], Rect::makeLTRB(100, 100, 112, 116));
+
+    const RegionCoalescer::Statistics& statistics = coalescer.statistics();
+    EXPECT_EQ(statistics.regions, 1);
+    EXPECT_EQ(statistics.rects_before, 2);
+    EXPECT_EQ(statistics.rects_after, 1);
+    EXPECT_EQ(statistics.extra_pixels, 12 * 16 - 2 * 16 - 8 * 12);
+}
+
+TEST(region_coalescer_test, keeps_distant_rects)
+{
+    RegionCoalescer coalescer;
+    std::vector<Rect> rects;
+
+    // A caret, a clock in the corner and a spinner in the middle of the screen.
+    Region region;
+    region.addRect(Rect::makeXYWH(100, 100, 2, 16));
+    region.addRect(Rect::makeXYWH(1850, 1050, 60, 20));
+    region.addRect(Rect::makeXYWH(950, 530, 20, 20));
+
+    coalescer.coalesce(region, &rects);
+
+    EXPECT_EQ(rects.size(), 3U);
+    checkCoverage(region, rects);
+}
+
+TEST(region_coalescer_test, cost_model)
+{
+    Region region;
+    region.addRect(Rect::makeXYWH(0, 0, 16, 16));
+    region.addRect(Rect::makeXYWH(32, 0, 16, 16));
+
+    std::vector<Rect> rects;
+
+    // Merging adds 16x16 pixels.
+    RegionCoalescer::CostModel cost_model;
+    cost_model.rect_cost = 256 * 4;
+    cost_model.pixel_cost = 4;
+
+    RegionCoalescer coalescer(cost_model);
+    coalescer.coalesce(region, &rects);
+    EXPECT_EQ(rects.size(), 2U);
+
+    cost_model.rect_cost = 256 * 4 + 1;
+    coalescer.setCostModel(cost_model);
+    coalescer.coalesce(region, &rects);
+    EXPECT_EQ(rects.size(), 1U);
+
+    EXPECT_EQ(coalescer.statistics().regions, 2);
+    EXPECT_EQ(coalescer.statistics().rects_before, 4);
+    EXPECT_EQ(coalescer.statistics().rects_after, 3);
+
+    coalescer.resetStatistics();
+    EXPECT_EQ(coalescer.statistics().regions, 0);
+}
+
+TEST(region_coalescer_test, wide_band)
+{
+    RegionCoalescer coalescer;
+    std::vector<Rect> rects;
+
+    // A wide rectangle and a band of many small spans right below it. The band contains more
+    // rectangles than a group.
+    Region region;
+    region.addRect(Rect::makeLTRB(0, 0, 1024, 127));
+
+    for (int i = 0; i < 300; ++i)
+        region.addRect(Rect::makeXYWH(i * 4, 127, 3, 1));
+
+    coalescer.coalesce(region, &rects);
+    checkCoverage(region, rects);
+}
+
+TEST(region_coalescer_test, tall_stack)
+{
+    RegionCoalescer coalescer;
+    std::vector<Rect> rects;
+
+    // Rows of small spans at random positions, so that each row is a separate band with more
+    // rectangles than a group.
+    std::mt19937 random(1);
+    Region region;
+
+    for (int y = 0; y < 40; ++y)
+    {
+        for (int i = 0; i < 300; ++i)
+            region.addRect(Rect::makeXYWH(i * 64 + random() % 60, y * 4, 2, 1 + random() % 4));
+    }
+
+    coalescer.coalesce(region, &rects);
+    checkCoverage(region, rects);
+
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        for (size_t j = i + 1; j < rects.size(); ++j)
+        {
+            Rect intersection(rects[i]);
+            intersection.intersectWith(rects[j]);
+            EXPECT_TRUE(intersection.isEmpty()) << i << " " << j;
+        }
+    }
+}
+
+TEST(region_coalescer_test, random_regions)
+{
+    std::mt19937 random(1);
+    RegionCoalescer coalescer;
+    std::vector<Rect> rects;
+
+    for (int pass = 0; pass < 100; ++pass)
+    {
+        Region region;
+
+        const int count = 1 + random() % 200;
+        for (int i = 0; i < count; ++i)
+        {
+            region.addRect(Rect::makeXYWH(random() % 1900, random() % 1060,
+                                          1 + random() % 20, 1 + random() % 20));
+        }
+
+        const int64_t extra_pixels = coalescer.statistics().extra_pixels;
+
+        coalescer.coalesce(region, &rects);
+        checkCoverage(region, rects);
+
+        int64_t rects_area = 0;
+        for (const auto& rect : rects)
+            rects_area += area(rect);
+
+        EXPECT_EQ(coalescer.statistics().extra_pixels - extra_pixels,
+                  rects_area - regionArea(region));
+    }
+
+    EXPECT_LT(coalescer.statistics().rects_after, coalescer.statistics().rects_before);
+}
+
+} // namespace desktop
@@ -27,10 +27,14 @@ namespace desktop {
 
 class Frame;
 
-template <typename FrameType>
+// Keeps |kQueueLength| frames which are filled in turn, so the previous frames are not overwritten
+// by the capturer while they are used.
+template <typename FrameType, int kQueueLength = 2>
 class ScreenCaptureFrameQueue
 {
 public:
+    static_assert(kQueueLength >= 2);
+
     ScreenCaptureFrameQueue() = default;
 
     // Moves to the next frame in the queue, moving the 'current' frame to become the 'previous'
@@ -57,6 +61,12 @@ public:
         return frames_[current_].get();
     }
 
+    // Index of the current frame in the range [0, kQueueLength).
+    int currentIndex() const
+    {
+        return current_;
+    }
+
     FrameType* previousFrame() const
     {
         return frames_[(current_ + kQueueLength - 1) % kQueueLength].get();
@@ -66,7 +76,6 @@ private:
     // Index of the current frame.
     int current_ = 0;
 
-    static const int kQueueLength = 2;
     std::unique_ptr<FrameType> frames_[kQueueLength];
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCaptureFrameQueue);
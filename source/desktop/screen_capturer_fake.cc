@@ -0,0 +1,298 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/screen_capturer_fake.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "desktop/differ.h"
+
+#include <algorithm>
+
+namespace desktop {
+
+namespace {
+
+const uint32_t kBackgroundColor = 0xFF2D5F8B;
+const uint32_t kTitleColor = 0xFF1F3F6F;
+const uint32_t kWindowColor = 0xFFFFFFFF;
+const uint32_t kTextColor = 0xFF202020;
+
+const int kTitleHeight = 24;
+const int kCharWidth = 8;
+
+// Caret blinks every |kCaretPeriod| frames.
+const int kCaretPeriod = 15;
+
+uint32_t mixBits(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7FEB352D;
+    value ^= value >> 15;
+    value *= 0x846CA68B;
+    value ^= value >> 16;
+    return value;
+}
+
+} // namespace
+
+ScreenCapturerFake::ScreenCapturerFake(Content content, const Size& size)
+    : content_(content),
+      size_(size)
+{
+    DCHECK(!size_.isEmpty());
+}
+
+ScreenCapturerFake::~ScreenCapturerFake() = default;
+
+void ScreenCapturerFake::setDifferEnabled(bool enable)
+{
+    differ_enabled_ = enable;
+    reset();
+}
+
+Rect ScreenCapturerFake::windowRect() const
+{
+    // The client area of the window (without the title bar).
+    return Rect::makeLTRB(size_.width() / 8,
+                          size_.height() / 8 + kTitleHeight,
+                          size_.width() * 7 / 8,
+                          size_.height() * 7 / 8);
+}
+
+Rect ScreenCapturerFake::videoRect() const
+{
+    const Rect window_rect = windowRect();
+
+    return Rect::makeXYWH(window_rect.left() + window_rect.width() / 4,
+                          window_rect.top() + window_rect.height() / 4,
+                          window_rect.width() / 2,
+                          window_rect.height() / 2);
+}
+
+int ScreenCapturerFake::screenCount()
+{
+    return 1;
+}
+
+bool ScreenCapturerFake::screenList(ScreenList* screens)
+{
+    screens->push_back({ 0, QStringLiteral("Fake screen") });
+    return true;
+}
+
+bool ScreenCapturerFake::selectScreen(ScreenId screen_id)
+{
+    if (screen_id != kFullDesktopScreenId && screen_id != 0)
+        return false;
+
+    reset();
+    return true;
+}
+
+const Frame* ScreenCapturerFake::captureFrame(Error* error)
+{
+    DCHECK(error);
+
+    *error = Error::SUCCEEDED;
+
+    if (!frame_)
+    {
+        frame_ = FrameAligned::create(size_, PixelFormat::ARGB(), 32);
+        if (!frame_)
+        {
+            *error = Error::PERMANENT;
+            return nullptr;
+        }
+
+        if (differ_enabled_)
+        {
+            // The block size is fixed, so the updated regions do not depend on the speed of
+            // the system.
+            differ_ = std::make_unique<Differ>(
+                size_, frame_->format(), Differ::kAutoThreadCount, 16);
+        }
+
+        drawDesktop();
+
+        frame_->updatedRegion()->setRect(Rect::makeSize(size_));
+        ++frame_number_;
+
+        if (differ_)
+            differ_->calcDirtyRegion(frame_->frameData(), frame_->updatedRegion());
+
+        return frame_.get();
+    }
+
+    Region* updated_region = frame_->updatedRegion();
+    updated_region->clear();
+
+    const Rect window_rect = windowRect();
+
+    switch (content_)
+    {
+        case Content::IDLE_DESKTOP:
+        {
+            if (frame_number_ % kCaretPeriod == 0)
+            {
+                const Rect caret_rect = Rect::makeXYWH(
+                    window_rect.left() + 4, window_rect.top() + 2, 2, kLineHeight - 4);
+                const bool visible = (frame_number_ / kCaretPeriod) % 2 != 0;
+
+                fillRect(caret_rect, visible ? kTextColor : kWindowColor);
+                updated_region->setRect(caret_rect);
+            }
+        }
+        break;
+
+        case Content::SCROLLING_TEXT:
+        {
+            const Rect text_rect = Rect::makeLTRB(
+                window_rect.left(), window_rect.top(),
+                window_rect.right(),
+                window_rect.top() + window_rect.height() / kLineHeight * kLineHeight);
+
+            const Rect moved_rect = Rect::makeLTRB(
+                text_rect.left(), text_rect.top(), text_rect.right(),
+                text_rect.bottom() - kLineHeight);
+
+            frame_->movePixels(Point(text_rect.left(), text_rect.top() + kLineHeight), moved_rect);
+
+            ++first_line_;
+
+            drawTextLine(first_line_ + text_rect.height() / kLineHeight - 1,
+                         Rect::makeLTRB(text_rect.left(), moved_rect.bottom(),
+                                        text_rect.right(), text_rect.bottom()));
+
+            // Like the real capturers, the whole scrolled area is reported as updated.
+            updated_region->setRect(text_rect);
+        }
+        break;
+
+        case Content::VIDEO:
+        {
+            const Rect video_rect = videoRect();
+
+            drawVideo(video_rect);
+            updated_region->setRect(video_rect);
+        }
+        break;
+
+        default:
+            NOTREACHED();
+            break;
+    }
+
+    ++frame_number_;
+
+    if (differ_)
+        differ_->calcDirtyRegion(frame_->frameData(), updated_region);
+
+    return frame_.get();
+}
+
+void ScreenCapturerFake::reset()
+{
+    differ_.reset();
+    frame_.reset();
+    frame_number_ = 0;
+    first_line_ = 0;
+}
+
+void ScreenCapturerFake::drawDesktop()
+{
+    const Rect window_rect = windowRect();
+
+    fillRect(Rect::makeSize(size_), kBackgroundColor);
+    fillRect(Rect::makeLTRB(window_rect.left(), window_rect.top() - kTitleHeight,
+                            window_rect.right(), window_rect.top()),
+             kTitleColor);
+
+    for (int y = window_rect.top(); y < window_rect.bottom(); y += kLineHeight)
+    {
+        drawTextLine(first_line_ + (y - window_rect.top()) / kLineHeight,
+                     Rect::makeLTRB(window_rect.left(), y, window_rect.right(),
+                                    std::min(y + kLineHeight, window_rect.bottom())));
+    }
+
+    if (content_ == Content::VIDEO)
+        drawVideo(videoRect());
+}
+
+void ScreenCapturerFake::drawTextLine(int line, const Rect& rect)
+{
+    fillRect(rect, kWindowColor);
+
+    // Lines have different lengths and some of them are empty. A line narrower than a character
+    // is empty too.
+    if (line % 5 == 4 || rect.width() < kCharWidth)
+        return;
+
+    const int length = mixBits(line) % (rect.width() / kCharWidth);
+
+    for (int column = 1; column < length; ++column)
+    {
+        const uint32_t glyph = mixBits(line * 4099 + column);
+
+        // Spaces between words.
+        if (glyph % 7 == 0)
+            continue;
+
+        // Each character is a pattern of 6x10 dots defined by the bits of |glyph|.
+        for (int y = 0; y < 10 && rect.top() + 3 + y < rect.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(
+                frame_->frameDataAtPos(rect.left() + column * kCharWidth, rect.top() + 3 + y));
+
+            for (int x = 0; x < 6; ++x)
+            {
+                if (glyph & (1U << ((y * 6 + x) % 32)))
+                    row[x] = kTextColor;
+            }
+        }
+    }
+}
+
+void ScreenCapturerFake::drawVideo(const Rect& rect)
+{
+    // A moving gradient with noise, which is hard to compress as real video.
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame_->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const uint32_t noise = mixBits((frame_number_ * rect.height() + y) * 8191 + x) & 0x1F;
+            const uint32_t red = (x + frame_number_ * 3 + noise) & 0xFF;
+            const uint32_t green = (y + frame_number_ * 2 + noise) & 0xFF;
+            const uint32_t blue = (x + y + noise) & 0xFF;
+
+            row[x] = 0xFF000000 | (red << 16) | (green << 8) | blue;
+        }
+    }
+}
+
+void ScreenCapturerFake::fillRect(const Rect& rect, uint32_t color)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame_->frameDataAtPos(rect.left(), y));
+        std::fill(row, row + rect.width(), color);
+    }
+}
+
+} // namespace desktop
@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__SCREEN_CAPTURER_FAKE_H
+#define DESKTOP__SCREEN_CAPTURER_FAKE_H
+
+#include "base/macros_magic.h"
+#include "desktop/screen_capturer.h"
+
+#include <memory>
+
+namespace desktop {
+
+class Differ;
+
+// Screen capturer that draws synthetic content instead of capturing the screen. It does not need
+// a desktop or a display, so the capture -> encode pipeline can be tested and measured on a
+// headless machine. Like the rest of the module, it is built only for Windows for now.
+// The content depends only on the number of the captured frame, so the results of the
+// measurements are reproducible.
+class ScreenCapturerFake : public ScreenCapturer
+{
+public:
+    enum class Content
+    {
+        // Nothing changes except the blinking caret in the window.
+        IDLE_DESKTOP,
+
+        // The text in the window is scrolled by one line in each frame.
+        SCROLLING_TEXT,
+
+        // The video region in the window gets new content in each frame.
+        VIDEO
+    };
+
+    static const int kLineHeight = 16;
+
+    explicit ScreenCapturerFake(Content content, const Size& size = Size(1920, 1080));
+    ~ScreenCapturerFake();
+
+    // If enabled (default), the updated region is calculated by the differ, as the GDI capturer
+    // does. Otherwise the region contains exactly the areas which were drawn.
+    void setDifferEnabled(bool enable);
+
+    // Returns the window with the scrolling text or the video. The rest of the screen does not
+    // change after the first frame.
+    Rect windowRect() const;
+    Rect videoRect() const;
+
+    // ScreenCapturer implementation.
+    int screenCount() override;
+    bool screenList(ScreenList* screens) override;
+    bool selectScreen(ScreenId screen_id) override;
+    const Frame* captureFrame(Error* error) override;
+
+protected:
+    // ScreenCapturer implementation.
+    void reset() override;
+
+private:
+    void drawDesktop();
+    void drawTextLine(int line, const Rect& rect);
+    void drawVideo(const Rect& rect);
+    void fillRect(const Rect& rect, uint32_t color);
+
+    const Content content_;
+    const Size size_;
+
+    bool differ_enabled_ = true;
+    std::unique_ptr<Differ> differ_;
+
+    std::unique_ptr<Frame> frame_;
+    int frame_number_ = 0;
+
+    // The number of the text line at the top of the window.
+    int first_line_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCapturerFake);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__SCREEN_CAPTURER_FAKE_H
@@ -0,0 +1,233 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/screen_capturer_fake.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "desktop/frame_file.h"
+#include "desktop/screen_capturer_replay.h"
+
+#include <gtest/gtest.h>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(640, 480);
+const int kFrameCount = 40;
+
+std::unique_ptr<Frame> copyFrame(const Frame& source)
+{
+    std::unique_ptr<Frame> frame = FrameAligned::create(source.size(), source.format(), 32);
+    frame->copyPixelsFrom(source, Point(0, 0), Rect::makeSize(source.size()));
+    return frame;
+}
+
+bool isEqualFrames(const Frame& first, const Frame& second)
+{
+    if (first.size() != second.size())
+        return false;
+
+    const int row_size = first.size().width() * first.format().bytesPerPixel();
+
+    for (int y = 0; y < first.size().height(); ++y)
+    {
+        if (memcmp(first.frameDataAtPos(0, y), second.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+// Returns the region of the pixels that differ in the frames.
+Region changedRegion(const Frame& first, const Frame& second)
+{
+    const int bytes_per_pixel = first.format().bytesPerPixel();
+    Region region;
+
+    for (int y = 0; y < first.size().height(); ++y)
+    {
+        for (int x = 0; x < first.size().width(); ++x)
+        {
+            if (memcmp(first.frameDataAtPos(x, y), second.frameDataAtPos(x, y),
+                       bytes_per_pixel) != 0)
+            {
+                region.addRect(Rect::makeXYWH(x, y, 1, 1));
+            }
+        }
+    }
+
+    return region;
+}
+
+const ScreenCapturerFake::Content kAllContent[] =
+{
+    ScreenCapturerFake::Content::IDLE_DESKTOP,
+    ScreenCapturerFake::Content::SCROLLING_TEXT,
+    ScreenCapturerFake::Content::VIDEO
+};
+
+} // namespace
+
+TEST(screen_capturer_fake_test, deterministic_content)
+{
+    for (const auto content : kAllContent)
+    {
+        ScreenCapturerFake first_capturer(content, kScreenSize);
+        ScreenCapturerFake second_capturer(content, kScreenSize);
+
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            ScreenCapturer::Error error;
+
+            const Frame* first_frame = first_capturer.captureFrame(&error);
+            ASSERT_TRUE(first_frame);
+            ASSERT_EQ(error, ScreenCapturer::Error::SUCCEEDED);
+
+            const Frame* second_frame = second_capturer.captureFrame(&error);
+            ASSERT_TRUE(second_frame);
+
+            EXPECT_TRUE(isEqualFrames(*first_frame, *second_frame));
+            EXPECT_TRUE(first_frame->constUpdatedRegion().equals(
+                second_frame->constUpdatedRegion()));
+        }
+    }
+}
+
+TEST(screen_capturer_fake_test, updated_region)
+{
+    for (const auto content : kAllContent)
+    {
+        for (bool differ_enabled : { false, true })
+        {
+            ScreenCapturerFake capturer(content, kScreenSize);
+            capturer.setDifferEnabled(differ_enabled);
+
+            ScreenCapturer::Error error;
+
+            const Frame* frame = capturer.captureFrame(&error);
+            ASSERT_TRUE(frame);
+            EXPECT_TRUE(frame->constUpdatedRegion().equals(
+                Region(Rect::makeSize(kScreenSize))));
+
+            std::unique_ptr<Frame> previous_frame = copyFrame(*frame);
+            bool has_changes = false;
+
+            for (int i = 0; i < kFrameCount; ++i)
+            {
+                frame = capturer.captureFrame(&error);
+                ASSERT_TRUE(frame);
+
+                // All changed pixels must be within the updated region.
+                Region changed_region = changedRegion(*previous_frame, *frame);
+                if (!changed_region.isEmpty())
+                    has_changes = true;
+
+                changed_region.subtract(frame->constUpdatedRegion());
+                EXPECT_TRUE(changed_region.isEmpty());
+
+                previous_frame = copyFrame(*frame);
+            }
+
+            EXPECT_TRUE(has_changes);
+        }
+    }
+}
+
+TEST(screen_capturer_fake_test, small_screen)
+{
+    // The window is narrower than a character.
+    for (const auto content : kAllContent)
+    {
+        ScreenCapturerFake capturer(content, Size(8, 480));
+
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            ScreenCapturer::Error error;
+            EXPECT_TRUE(capturer.captureFrame(&error));
+        }
+    }
+}
+
+TEST(screen_capturer_replay_test, record_and_replay)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_screen_capturer_replay_test.frames";
+
+    std::vector<std::unique_ptr<Frame>> recorded_frames;
+
+    {
+        ScreenCapturerFake capturer(ScreenCapturerFake::Content::SCROLLING_TEXT, kScreenSize);
+
+        FrameFileWriter writer;
+        ASSERT_TRUE(writer.open(file_path, kScreenSize));
+
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            ScreenCapturer::Error error;
+
+            const Frame* frame = capturer.captureFrame(&error);
+            ASSERT_TRUE(frame);
+            ASSERT_TRUE(writer.writeFrame(*frame));
+
+            recorded_frames.emplace_back(copyFrame(*frame));
+        }
+    }
+
+    std::unique_ptr<ScreenCapturerReplay> replay = ScreenCapturerReplay::create(file_path);
+    ASSERT_TRUE(replay);
+    EXPECT_EQ(replay->frameCount(), 0);
+
+    // The second pass checks that the replay starts over at the end of the file.
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            ScreenCapturer::Error error;
+
+            const Frame* frame = replay->captureFrame(&error);
+            ASSERT_TRUE(frame);
+            EXPECT_TRUE(isEqualFrames(*frame, *recorded_frames[i]));
+        }
+    }
+
+    EXPECT_EQ(replay->frameCount(), kFrameCount * 2);
+
+    replay.reset();
+
+    std::error_code ignored_error;
+    std::filesystem::remove(file_path, ignored_error);
+}
+
+TEST(screen_capturer_replay_test, invalid_file)
+{
+    const std::filesystem::path file_path =
+        std::filesystem::temp_directory_path() / "aspia_screen_capturer_replay_invalid.frames";
+
+    {
+        std::ofstream file_stream(file_path, std::ofstream::binary);
+        file_stream << "not a frame file";
+    }
+
+    EXPECT_FALSE(ScreenCapturerReplay::create(file_path));
+    EXPECT_FALSE(ScreenCapturerReplay::create(file_path / "missing"));
+
+    std::error_code ignored_error;
+    std::filesystem::remove(file_path, ignored_error);
+}
+
+} // namespace desktop
@@ -78,8 +78,6 @@ void ScreenCapturerGdi::reset()
 
 const Frame* ScreenCapturerGdi::captureImage()
 {
-    queue_.moveToNextFrame();
-
     if (!prepareCaptureResources())
         return nullptr;
 
@@ -90,26 +88,26 @@ const Frame* ScreenCapturerGdi::captureImage()
         return nullptr;
     }
 
-    if (!queue_.currentFrame() || queue_.currentFrame()->size() != screen_rect.size())
+    if (!frame_ || frame_->size() != screen_rect.size())
     {
         DCHECK(desktop_dc_);
         DCHECK(memory_dc_);
 
-        std::unique_ptr<Frame> frame = FrameDib::create(
-            screen_rect.size(), pixel_format_, memory_dc_);
-        if (!frame)
+        frame_ = FrameDib::create(screen_rect.size(), pixel_format_, memory_dc_);
+        if (!frame_)
         {
             LOG(LS_WARNING) << "Failed to create frame buffer";
             return nullptr;
         }
 
-        queue_.replaceCurrentFrame(std::move(frame));
+        // The hashes of the blocks are calculated again, so the first frame is fully dirty.
+        differ_ = std::make_unique<Differ>(screen_rect.size(),
+                                           pixel_format_,
+                                           Differ::kAutoThreadCount,
+                                           Differ::kAutoBlockSize);
     }
 
-    FrameDib* current = static_cast<FrameDib*>(queue_.currentFrame());
-    FrameDib* previous = static_cast<FrameDib*>(queue_.previousFrame());
-
-    base::win::ScopedSelectObject select_object(memory_dc_, current->bitmap());
+    base::win::ScopedSelectObject select_object(memory_dc_, frame_->bitmap());
 
     BitBlt(memory_dc_,
            0, 0,
@@ -118,21 +116,11 @@ const Frame* ScreenCapturerGdi::captureImage()
            screen_rect.left(), screen_rect.top(),
            CAPTUREBLT | SRCCOPY);
 
-    current->setTopLeft(screen_rect.topLeft());
+    frame_->setTopLeft(screen_rect.topLeft());
 
-    if (!previous || previous->size() != current->size())
-    {
-        differ_ = std::make_unique<Differ>(screen_rect.size(), pixel_format_);
-        current->updatedRegion()->addRect(Rect::makeSize(screen_rect.size()));
-    }
-    else
-    {
-        differ_->calcDirtyRegion(previous->frameData(),
-                                 current->frameData(),
-                                 current->updatedRegion());
-    }
+    differ_->calcDirtyRegion(frame_->frameData(), frame_->updatedRegion());
 
-    return current;
+    return frame_.get();
 }
 
 bool ScreenCapturerGdi::prepareCaptureResources()
@@ -169,8 +157,8 @@ bool ScreenCapturerGdi::prepareCaptureResources()
         pixel_format_ = ScreenCaptureUtils::detectPixelFormat();
         desktop_dc_rect_ = desktop_rect;
 
-        // Make sure the frame buffers will be reallocated.
-        queue_.reset();
+        // Make sure the frame buffer will be reallocated.
+        frame_.reset();
     }
 
     return true;
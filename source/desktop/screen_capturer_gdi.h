@@ -21,11 +21,11 @@
 
 #include "base/win/scoped_hdc.h"
 #include "desktop/screen_capturer.h"
-#include "desktop/screen_capture_frame_queue.h"
 
 namespace desktop {
 
 class Differ;
+class FrameDib;
 
 class ScreenCapturerGdi : public ScreenCapturer
 {
@@ -57,7 +57,8 @@ private:
     std::unique_ptr<base::win::ScopedGetDC> desktop_dc_;
     base::win::ScopedCreateDC memory_dc_;
 
-    ScreenCaptureFrameQueue<Frame> queue_;
+    // The differ works in the hash mode, so only one frame is kept.
+    std::unique_ptr<FrameDib> frame_;
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerGdi);
 };
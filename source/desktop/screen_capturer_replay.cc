@@ -0,0 +1,100 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/screen_capturer_replay.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame_aligned.h"
+
+namespace desktop {
+
+ScreenCapturerReplay::ScreenCapturerReplay(std::unique_ptr<FrameFileReader> reader)
+    : reader_(std::move(reader))
+{
+    // Nothing
+}
+
+ScreenCapturerReplay::~ScreenCapturerReplay() = default;
+
+// static
+std::unique_ptr<ScreenCapturerReplay> ScreenCapturerReplay::create(
+    const std::filesystem::path& file_path)
+{
+    std::unique_ptr<FrameFileReader> reader = std::make_unique<FrameFileReader>();
+    if (!reader->open(file_path))
+        return nullptr;
+
+    return std::unique_ptr<ScreenCapturerReplay>(new ScreenCapturerReplay(std::move(reader)));
+}
+
+int ScreenCapturerReplay::screenCount()
+{
+    return 1;
+}
+
+bool ScreenCapturerReplay::screenList(ScreenList* screens)
+{
+    screens->push_back({ 0, QStringLiteral("Replay screen") });
+    return true;
+}
+
+bool ScreenCapturerReplay::selectScreen(ScreenId screen_id)
+{
+    return screen_id == kFullDesktopScreenId || screen_id == 0;
+}
+
+const Frame* ScreenCapturerReplay::captureFrame(Error* error)
+{
+    DCHECK(error);
+
+    if (!frame_)
+    {
+        frame_ = FrameAligned::create(reader_->size(), PixelFormat::ARGB(), 32);
+        if (!frame_)
+        {
+            *error = Error::PERMANENT;
+            return nullptr;
+        }
+
+        reader_->rewind();
+    }
+
+    if (!reader_->readFrame(frame_.get()))
+    {
+        // The end of the file. The first record contains the whole frame.
+        reader_->rewind();
+
+        if (!reader_->readFrame(frame_.get()))
+        {
+            LOG(LS_WARNING) << "Unable to read frame";
+            *error = Error::PERMANENT;
+            return nullptr;
+        }
+    }
+
+    ++frame_count_;
+
+    *error = Error::SUCCEEDED;
+    return frame_.get();
+}
+
+void ScreenCapturerReplay::reset()
+{
+    frame_.reset();
+}
+
+} // namespace desktop
@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__SCREEN_CAPTURER_REPLAY_H
+#define DESKTOP__SCREEN_CAPTURER_REPLAY_H
+
+#include "desktop/frame_file.h"
+#include "desktop/screen_capturer.h"
+
+#include <memory>
+
+namespace desktop {
+
+// Screen capturer that plays the frames recorded to a frame file (see FrameFileWriter). When the
+// end of the file is reached, the playback starts from the beginning.
+class ScreenCapturerReplay : public ScreenCapturer
+{
+public:
+    ~ScreenCapturerReplay();
+
+    static std::unique_ptr<ScreenCapturerReplay> create(const std::filesystem::path& file_path);
+
+    // The number of frames played since the start (including repeats).
+    int frameCount() const { return frame_count_; }
+
+    // ScreenCapturer implementation.
+    int screenCount() override;
+    bool screenList(ScreenList* screens) override;
+    bool selectScreen(ScreenId screen_id) override;
+    const Frame* captureFrame(Error* error) override;
+
+protected:
+    // ScreenCapturer implementation.
+    void reset() override;
+
+private:
+    explicit ScreenCapturerReplay(std::unique_ptr<FrameFileReader> reader);
+
+    std::unique_ptr<FrameFileReader> reader_;
+    std::unique_ptr<Frame> frame_;
+    int frame_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCapturerReplay);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__SCREEN_CAPTURER_REPLAY_H
@@ -19,6 +19,7 @@
 #include "desktop/screen_capturer_wrapper.h"
 
 #include "base/logging.h"
+#include "base/qt_logging.h"
 #include "base/win/windows_version.h"
 #include "desktop/screen_capturer_dxgi.h"
 #include "desktop/screen_capturer_gdi.h"
@@ -26,8 +27,57 @@
 #include "desktop/win/effects_disabler.h"
 #include "desktop/win/wallpaper_disabler.h"
 
+#if defined(USE_CAPTURER_TEST_HOOKS)
+#include "desktop/frame_file.h"
+#include "desktop/screen_capturer_fake.h"
+#include "desktop/screen_capturer_replay.h"
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
+
 namespace desktop {
 
+#if defined(USE_CAPTURER_TEST_HOOKS)
+
+namespace {
+
+// For load testing, the real capturers can be replaced with the synthetic ones by setting the
+// environment variable to "idle", "text", "video" or "replay:<path to the frame file>".
+const char kFakeCapturerVariable[] = "ASPIA_FAKE_CAPTURER";
+
+// If the environment variable contains a file path, the captured frames are written to the file.
+// The file can be played later with the replay capturer.
+const char kRecordFileVariable[] = "ASPIA_CAPTURER_RECORD_FILE";
+
+std::unique_ptr<ScreenCapturer> createFakeCapturer()
+{
+    const QString value = qEnvironmentVariable(kFakeCapturerVariable);
+    if (value.isEmpty())
+        return nullptr;
+
+    if (value == QLatin1String("idle"))
+        return std::make_unique<ScreenCapturerFake>(ScreenCapturerFake::Content::IDLE_DESKTOP);
+
+    if (value == QLatin1String("text"))
+        return std::make_unique<ScreenCapturerFake>(ScreenCapturerFake::Content::SCROLLING_TEXT);
+
+    if (value == QLatin1String("video"))
+        return std::make_unique<ScreenCapturerFake>(ScreenCapturerFake::Content::VIDEO);
+
+    const QLatin1String kReplayPrefix("replay:");
+
+    if (value.startsWith(kReplayPrefix))
+    {
+        return ScreenCapturerReplay::create(
+            value.mid(kReplayPrefix.size()).toStdWString());
+    }
+
+    LOG(LS_WARNING) << "Unknown fake capturer: " << value;
+    return nullptr;
+}
+
+} // namespace
+
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
+
 ScreenCapturerWrapper::ScreenCapturerWrapper(uint32_t flags)
     : flags_(flags)
 {
@@ -88,6 +138,12 @@ const Frame* ScreenCapturerWrapper::captureFrame()
                 break;
         }
     }
+#if defined(USE_CAPTURER_TEST_HOOKS)
+    else
+    {
+        recordFrame(*frame);
+    }
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
 
     return frame;
 }
@@ -96,6 +152,16 @@ void ScreenCapturerWrapper::selectCapturer()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
+#if defined(USE_CAPTURER_TEST_HOOKS)
+    std::unique_ptr<ScreenCapturer> capturer_fake = createFakeCapturer();
+    if (capturer_fake)
+    {
+        LOG(LS_INFO) << "Using fake capturer";
+        capturer_ = std::move(capturer_fake);
+        return;
+    }
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
+
     // Mirror screen capture is available only in Windows 7/2008 R2.
     if (base::win::windowsVersion() == base::win::VERSION_WIN7)
     {
@@ -124,6 +190,32 @@ void ScreenCapturerWrapper::selectCapturer()
     }
 }
 
+#if defined(USE_CAPTURER_TEST_HOOKS)
+void ScreenCapturerWrapper::recordFrame(const Frame& frame)
+{
+    if (!frame_writer_)
+    {
+        const QString file_path = qEnvironmentVariable(kRecordFileVariable);
+        if (file_path.isEmpty())
+            return;
+
+        frame_writer_ = std::make_unique<FrameFileWriter>();
+        if (!frame_writer_->open(file_path.toStdWString(), frame.size()))
+            return;
+
+        LOG(LS_INFO) << "Recording frames to " << file_path;
+    }
+
+    // Recording is stopped on the first error (for example, if the screen resolution changes).
+    // |frame_writer_| is kept, so the file is not overwritten.
+    if (frame_writer_->isOpen() && !frame_writer_->writeFrame(frame))
+    {
+        LOG(LS_WARNING) << "Recording stopped";
+        frame_writer_->close();
+    }
+}
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
+
 bool ScreenCapturerWrapper::switchToInputDesktop()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
@@ -30,6 +30,7 @@
 namespace desktop {
 
 class EffectsDisabler;
+class FrameFileWriter;
 class WallpaperDisabler;
 
 class ScreenCapturerWrapper
@@ -54,6 +55,10 @@ private:
     bool switchToInputDesktop();
     void atDesktopSwitch();
 
+#if defined(USE_CAPTURER_TEST_HOOKS)
+    void recordFrame(const Frame& frame);
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
+
     const uint32_t flags_;
 
     base::ScopedThreadDesktop desktop_;
@@ -63,6 +68,11 @@ private:
     std::unique_ptr<EffectsDisabler> effects_disabler_;
     std::unique_ptr<WallpaperDisabler> wallpaper_disabler_;
 
+#if defined(USE_CAPTURER_TEST_HOOKS)
+    // Captured frames are written to the file if recording is enabled.
+    std::unique_ptr<FrameFileWriter> frame_writer_;
+#endif // defined(USE_CAPTURER_TEST_HOOKS)
+
     THREAD_CHECKER(thread_checker_);
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerWrapper);
@@ -0,0 +1,114 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/shared_frame_queue.h"
+#include "desktop/desktop_frame_aligned.h"
+
+namespace desktop {
+
+namespace {
+
+constexpr size_t kAlignment = 32;
+
+} // namespace
+
+bool SharedFrameQueue::push(const Frame& frame)
+{
+    SharedFrame* buffer = nextBuffer(frame);
+    std::unique_ptr<SharedFrame> shared_frame = buffer->share();
+
+    std::unique_lock lock(lock_);
+
+    condition_.wait(lock, [this]()
+    {
+        return closed_ || frames_.size() < kMaxPendingFrames;
+    });
+
+    if (closed_)
+        return false;
+
+    frames_.emplace_back(std::move(shared_frame));
+    condition_.notify_all();
+    return true;
+}
+
+std::unique_ptr<SharedFrame> SharedFrameQueue::pop()
+{
+    std::unique_lock lock(lock_);
+
+    condition_.wait(lock, [this]() { return closed_ || !frames_.empty(); });
+
+    if (closed_)
+        return nullptr;
+
+    std::unique_ptr<SharedFrame> frame = std::move(frames_.front());
+    frames_.pop_front();
+
+    condition_.notify_all();
+    return frame;
+}
+
+void SharedFrameQueue::close()
+{
+    std::scoped_lock lock(lock_);
+
+    closed_ = true;
+    frames_.clear();
+
+    condition_.notify_all();
+}
+
+SharedFrame* SharedFrameQueue::nextBuffer(const Frame& frame)
+{
+    buffers_.moveToNextFrame();
+
+    const int index = buffers_.currentIndex();
+    SharedFrame* buffer = buffers_.currentFrame();
+
+    // The buffer can still be used by the encode thread if it has not released the previous
+    // frame yet. In this case a new buffer is created.
+    if (!buffer || buffer->size() != frame.size() || !buffer->format().isEqual(frame.format()) ||
+        buffer->isShared())
+    {
+        buffers_.replaceCurrentFrame(
+            SharedFrame::wrap(FrameAligned::create(frame.size(), frame.format(), kAlignment)));
+
+        buffer = buffers_.currentFrame();
+        stale_regions_[index].setRect(Rect::makeSize(frame.size()));
+    }
+
+    // The other buffers become outdated in the changed area.
+    for (int i = 0; i < kBufferCount; ++i)
+    {
+        if (i != index)
+            stale_regions_[i].addRegion(frame.constUpdatedRegion());
+    }
+
+    stale_regions_[index].addRegion(frame.constUpdatedRegion());
+    stale_regions_[index].intersectWith(Rect::makeSize(frame.size()));
+
+    for (Region::Iterator it(stale_regions_[index]); !it.isAtEnd(); it.advance())
+        buffer->copyPixelsFrom(frame, it.rect().topLeft(), it.rect());
+
+    stale_regions_[index].clear();
+
+    buffer->copyFrameInfoFrom(frame);
+    return buffer;
+}
+
+} // namespace desktop
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__SHARED_FRAME_QUEUE_H
+#define DESKTOP__SHARED_FRAME_QUEUE_H
+
+#include "desktop/screen_capture_frame_queue.h"
+#include "desktop/shared_desktop_frame.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace desktop {
+
+// Passes the captured frames from the capture thread to the encode thread.
+// The capturers reuse their frame buffers, so each frame is copied to a buffer owned by the queue.
+// Only the areas changed since the buffer was filled last time are copied.
+class SharedFrameQueue
+{
+public:
+    SharedFrameQueue() = default;
+    ~SharedFrameQueue() = default;
+
+    // The maximum number of the frames waiting for encoding.
+    static const int kMaxPendingFrames = 2;
+
+    // Called by the capture thread. Copies |frame| and adds the copy to the queue. If the queue
+    // is full, waits until the encode thread takes a frame.
+    // Returns false if the queue is closed.
+    bool push(const Frame& frame);
+
+    // Called by the encode thread. Waits for the next frame.
+    // Returns nullptr if the queue is closed.
+    std::unique_ptr<SharedFrame> pop();
+
+    // Closes the queue and wakes up the waiting threads.
+    void close();
+
+private:
+    // One buffer is filled by the capture thread, one is encoded and the others are waiting.
+    static const int kBufferCount = kMaxPendingFrames + 2;
+
+    SharedFrame* nextBuffer(const Frame& frame);
+
+    // Used only by the capture thread.
+    ScreenCaptureFrameQueue<SharedFrame, kBufferCount> buffers_;
+
+    // The areas changed since each buffer was filled.
+    Region stale_regions_[kBufferCount];
+
+    std::mutex lock_;
+    std::condition_variable condition_;
+    std::deque<std::unique_ptr<SharedFrame>> frames_;
+    bool closed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedFrameQueue);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__SHARED_FRAME_QUEUE_H
@@ -0,0 +1,215 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/shared_frame_queue.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <thread>
+
+namespace desktop {
+
+namespace {
+
+const Size kFrameSize(64, 48);
+
+std::unique_ptr<Frame> createFrame()
+{
+    std::unique_ptr<Frame> frame =
+        FrameAligned::create(kFrameSize, PixelFormat::ARGB(), 32);
+    memset(frame->frameData(), 0, frame->stride() * frame->size().height());
+    return frame;
+}
+
+// Fills a random rectangle of |frame| with a random color and sets it as the updated region.
+void changeFrame(Frame* frame, std::mt19937* random)
+{
+    const int x = (*random)() % kFrameSize.width();
+    const int y = (*random)() % kFrameSize.height();
+    const int width = 1 + (*random)() % (kFrameSize.width() - x);
+    const int height = 1 + (*random)() % (kFrameSize.height() - y);
+    const uint32_t color = (*random)();
+
+    const Rect rect = Rect::makeXYWH(x, y, width, height);
+
+    for (int row = rect.top(); row < rect.bottom(); ++row)
+    {
+        uint32_t* pixels = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), row));
+        std::fill(pixels, pixels + rect.width(), color);
+    }
+
+    frame->updatedRegion()->setRect(rect);
+}
+
+bool isEqualFrames(const Frame& frame1, const Frame& frame2)
+{
+    if (frame1.size() != frame2.size())
+        return false;
+
+    const int row_size = frame1.size().width() * frame1.format().bytesPerPixel();
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<Frame> copyFrame(const Frame& frame)
+{
+    std::unique_ptr<Frame> copy = createFrame();
+    copy->copyPixelsFrom(frame, Point(0, 0), Rect::makeSize(frame.size()));
+    return copy;
+}
+
+} // namespace
+
+TEST(shared_frame_queue_test, copy_changes)
+{
+    SharedFrameQueue queue;
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(1);
+
+    frame->updatedRegion()->setRect(Rect::makeSize(kFrameSize));
+
+    for (int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(queue.push(*frame));
+
+        // Only the changed area of the capturer frame is valid. The rest must be taken from the
+        // previous frames.
+        const Region updated_region = frame->constUpdatedRegion();
+
+        std::unique_ptr<SharedFrame> shared_frame = queue.pop();
+        ASSERT_TRUE(shared_frame);
+        EXPECT_TRUE(isEqualFrames(*shared_frame, *frame)) << i;
+        EXPECT_TRUE(shared_frame->constUpdatedRegion().equals(updated_region)) << i;
+
+        changeFrame(frame.get(), &random);
+    }
+}
+
+TEST(shared_frame_queue_test, pending_frames)
+{
+    SharedFrameQueue queue;
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(2);
+
+    frame->updatedRegion()->setRect(Rect::makeSize(kFrameSize));
+
+    for (int i = 0; i < 20; ++i)
+    {
+        std::vector<std::unique_ptr<Frame>> expected;
+
+        for (int j = 0; j < SharedFrameQueue::kMaxPendingFrames; ++j)
+        {
+            ASSERT_TRUE(queue.push(*frame));
+            expected.emplace_back(copyFrame(*frame));
+            changeFrame(frame.get(), &random);
+        }
+
+        // The frame held by the encode thread is not overwritten.
+        std::unique_ptr<SharedFrame> held_frame = queue.pop();
+        ASSERT_TRUE(queue.push(*frame));
+        expected.emplace_back(copyFrame(*frame));
+        changeFrame(frame.get(), &random);
+
+        EXPECT_TRUE(isEqualFrames(*held_frame, *expected[0])) << i;
+
+        for (size_t j = 1; j < expected.size(); ++j)
+        {
+            std::unique_ptr<SharedFrame> shared_frame = queue.pop();
+            ASSERT_TRUE(shared_frame);
+            EXPECT_TRUE(isEqualFrames(*shared_frame, *expected[j])) << i << " " << j;
+        }
+
+        EXPECT_TRUE(isEqualFrames(*held_frame, *expected[0])) << i;
+    }
+}
+
+TEST(shared_frame_queue_test, threads)
+{
+    static const int kFrameCount = 200;
+
+    SharedFrameQueue queue;
+    std::vector<std::unique_ptr<Frame>> expected;
+
+    std::unique_ptr<Frame> frame = createFrame();
+    std::mt19937 random(3);
+
+    frame->updatedRegion()->setRect(Rect::makeSize(kFrameSize));
+
+    // The sequence of the screen images. Each image has the area changed since the previous one.
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        expected.emplace_back(copyFrame(*frame));
+        expected.back()->updatedRegion()->addRegion(frame->constUpdatedRegion());
+        changeFrame(frame.get(), &random);
+    }
+
+    std::thread capture_thread([&]()
+    {
+        // Like the capturers, the thread updates only the changed area of its frame.
+        std::unique_ptr<Frame> capturer_frame = createFrame();
+
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            const Region& updated_region = expected[i]->constUpdatedRegion();
+
+            for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+                capturer_frame->copyPixelsFrom(*expected[i], it.rect().topLeft(), it.rect());
+
+            *capturer_frame->updatedRegion() = updated_region;
+
+            if (!queue.push(*capturer_frame))
+                return;
+        }
+    });
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        std::unique_ptr<SharedFrame> shared_frame = queue.pop();
+        ASSERT_TRUE(shared_frame);
+        EXPECT_TRUE(isEqualFrames(*shared_frame, *expected[i])) << i;
+    }
+
+    capture_thread.join();
+}
+
+TEST(shared_frame_queue_test, close)
+{
+    SharedFrameQueue queue;
+    std::unique_ptr<Frame> frame = createFrame();
+
+    std::thread encode_thread([&]()
+    {
+        EXPECT_FALSE(queue.pop());
+    });
+
+    queue.close();
+    encode_thread.join();
+
+    EXPECT_FALSE(queue.push(*frame));
+    EXPECT_FALSE(queue.pop());
+}
+
+} // namespace desktop
@@ -0,0 +1,221 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/tile_cache.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+#include "desktop/hash_block.h"
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+// The number of remembered hashes of the sent tiles per slot of the cache.
+const size_t kSeenHashesPerSlot = 4;
+
+int alignDown(int value)
+{
+    return value & ~(TileCache::kTileSize - 1);
+}
+
+int alignUp(int value)
+{
+    return alignDown(value + TileCache::kTileSize - 1);
+}
+
+} // namespace
+
+TileCache::TileCache(size_t slot_count)
+    : slots_(slot_count)
+{
+    DCHECK_GT(slot_count, 0U);
+
+    for (size_t i = 0; i < slots_.size(); ++i)
+        slots_[i].lru_pos = lru_.insert(lru_.end(), i);
+}
+
+TileCache::~TileCache() = default;
+
+void TileCache::update(const Frame* frame,
+                       Region* dirty_region,
+                       TileList* cached_tiles,
+                       TileList* stored_tiles)
+{
+    DCHECK(frame && dirty_region && cached_tiles && stored_tiles);
+
+    if (bytes_per_pixel_ != frame->format().bytesPerPixel())
+    {
+        clear();
+        bytes_per_pixel_ = frame->format().bytesPerPixel();
+    }
+
+    ++frame_number_;
+
+    // The tiles touched by the dirty region. The rectangles of the region are aligned to the
+    // tile size, so each tile is visited only once.
+    Region tiles;
+
+    for (Region::Iterator it(*dirty_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        tiles.addRect(Rect::makeLTRB(alignDown(rect.left()), alignDown(rect.top()),
+                                     alignUp(rect.right()), alignUp(rect.bottom())));
+    }
+
+    // Partial tiles at the right and bottom edges of the frame are not cached.
+    tiles.intersectWith(Rect::makeLTRB(0, 0,
+                                       alignDown(frame->size().width()),
+                                       alignDown(frame->size().height())));
+
+    for (Region::Iterator it(tiles); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        for (int y = rect.top(); y < rect.bottom(); y += kTileSize)
+        {
+            for (int x = rect.left(); x < rect.right(); x += kTileSize)
+            {
+                updateTile(frame, Point(x, y), dirty_region, cached_tiles, stored_tiles);
+            }
+        }
+    }
+}
+
+void TileCache::updateTile(const Frame* frame,
+                           const Point& pos,
+                           Region* dirty_region,
+                           TileList* cached_tiles,
+                           TileList* stored_tiles)
+{
+    const Rect tile_rect = Rect::makeXYWH(pos, Size(kTileSize, kTileSize));
+
+    const uint8_t* tile = frame->frameDataAtPos(pos);
+    const uint64_t hash =
+        hashBlock(tile, frame->stride(), kTileSize * bytes_per_pixel_, kTileSize);
+
+    auto it = index_.find(hash);
+    if (it != index_.end())
+    {
+        Slot& slot = slots_[it->second];
+
+        // The tiles stored in the current frame are not available to the client yet.
+        if (slot.frame != frame_number_ && isCached(slot, tile, frame->stride()))
+        {
+            lru_.splice(lru_.end(), lru_, slot.lru_pos);
+
+            cached_tiles->push_back({ pos, it->second });
+            dirty_region->subtract(tile_rect);
+            return;
+        }
+
+        // The content differs from the cached tile (a collision of hashes) or the tile has
+        // just been stored.
+        return;
+    }
+
+    if (isSeen(hash))
+    {
+        stored_tiles->push_back({ pos, storeTile(hash, tile, frame->stride()) });
+    }
+}
+
+void TileCache::clear()
+{
+    for (auto& slot : slots_)
+    {
+        slot.used = false;
+        slot.pixels.reset();
+    }
+
+    index_.clear();
+    seen_.clear();
+    seen_order_.clear();
+}
+
+bool TileCache::isCached(const Slot& slot, const uint8_t* tile, int stride) const
+{
+    const int bytes_per_row = kTileSize * bytes_per_pixel_;
+    const uint8_t* cached = slot.pixels.get();
+
+    for (int y = 0; y < kTileSize; ++y)
+    {
+        if (memcmp(cached, tile, bytes_per_row) != 0)
+            return false;
+
+        cached += bytes_per_row;
+        tile += stride;
+    }
+
+    return true;
+}
+
+size_t TileCache::storeTile(uint64_t hash, const uint8_t* tile, int stride)
+{
+    // The least recently used slot is reused.
+    const size_t index = lru_.front();
+    Slot& slot = slots_[index];
+
+    lru_.splice(lru_.end(), lru_, slot.lru_pos);
+
+    if (slot.used)
+        index_.erase(slot.hash);
+
+    const int bytes_per_row = kTileSize * bytes_per_pixel_;
+
+    if (!slot.pixels)
+        slot.pixels = std::make_unique<uint8_t[]>(bytes_per_row * kTileSize);
+
+    uint8_t* pixels = slot.pixels.get();
+
+    for (int y = 0; y < kTileSize; ++y)
+    {
+        memcpy(pixels, tile, bytes_per_row);
+
+        pixels += bytes_per_row;
+        tile += stride;
+    }
+
+    slot.used = true;
+    slot.hash = hash;
+    slot.frame = frame_number_;
+
+    index_[hash] = index;
+    return index;
+}
+
+bool TileCache::isSeen(uint64_t hash)
+{
+    if (seen_.count(hash))
+        return true;
+
+    seen_.insert(hash);
+    seen_order_.push_back(hash);
+
+    if (seen_order_.size() > slots_.size() * kSeenHashesPerSlot)
+    {
+        seen_.erase(seen_order_.front());
+        seen_order_.pop_front();
+    }
+
+    return false;
+}
+
+} // namespace desktop
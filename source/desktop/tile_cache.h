@@ -0,0 +1,122 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__TILE_CACHE_H
+#define DESKTOP__TILE_CACHE_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+
+// Host side index of the screen tiles kept by the client in its tile store (see TileStore).
+// When the same content appears on the screen again (for example, the user switches between
+// the same windows), the host sends references to the cached tiles instead of the pixels.
+//
+// The host assigns the slots of the cache. The client stores each tile to the slot chosen by
+// the host, so the least recently used tiles are evicted on both sides at the same time.
+class TileCache
+{
+public:
+    static const int kTileSize = 64;
+
+    struct Tile
+    {
+        // Top-left corner of the tile in the frame.
+        Point pos;
+
+        // Index of the slot in the cache.
+        size_t slot;
+    };
+
+    using TileList = std::vector<Tile>;
+
+    explicit TileCache(size_t slot_count);
+    ~TileCache();
+
+    size_t slotCount() const { return slots_.size(); }
+
+    // Looks for the tiles of |frame| touched by |dirty_region| in the cache. The tiles found in
+    // the cache are added to |cached_tiles| and removed from |dirty_region|. The tiles that must
+    // be stored by the client after decoding the frame are added to |stored_tiles|.
+    // Only the tiles aligned to kTileSize and fully located inside the frame are cached.
+    void update(const Frame* frame,
+                Region* dirty_region,
+                TileList* cached_tiles,
+                TileList* stored_tiles);
+
+    // Removes all tiles. The client must clear its tile store at the same time.
+    void clear();
+
+private:
+    void updateTile(const Frame* frame,
+                    const Point& pos,
+                    Region* dirty_region,
+                    TileList* cached_tiles,
+                    TileList* stored_tiles);
+
+    struct Slot
+    {
+        bool used = false;
+        uint64_t hash = 0;
+
+        // The frame in which the tile was stored.
+        uint64_t frame = 0;
+
+        // Copy of the tile to compare with when the hashes are equal.
+        std::unique_ptr<uint8_t[]> pixels;
+
+        // Position of the slot in |lru_|.
+        std::list<size_t>::iterator lru_pos;
+    };
+
+    bool isCached(const Slot& slot, const uint8_t* tile, int stride) const;
+    size_t storeTile(uint64_t hash, const uint8_t* tile, int stride);
+    bool isSeen(uint64_t hash);
+
+    std::vector<Slot> slots_;
+
+    // The slots sorted from the least to the most recently used.
+    std::list<size_t> lru_;
+
+    // Maps the hashes of the cached tiles to the slots.
+    std::unordered_map<uint64_t, size_t> index_;
+
+    // Hashes of the recently sent tiles. A tile is stored only when it is sent for the second
+    // time, so that frequently changing content (video) does not push useful tiles out.
+    std::unordered_set<uint64_t> seen_;
+    std::deque<uint64_t> seen_order_;
+
+    int bytes_per_pixel_ = 0;
+    uint64_t frame_number_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCache);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__TILE_CACHE_H
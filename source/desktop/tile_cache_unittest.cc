@@ -0,0 +1,190 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/tile_cache.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "desktop/tile_store.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(640, 480);
+
+std::unique_ptr<Frame> createFrame()
+{
+    std::unique_ptr<Frame> frame = FrameAligned::create(kScreenSize, PixelFormat::ARGB(), 32);
+    memset(frame->frameData(), 0, frame->stride() * kScreenSize.height());
+    return frame;
+}
+
+// Draws the window with the content defined by |seed|.
+void drawWindow(Frame* frame, const Rect& rect, int seed)
+{
+    std::mt19937 random(seed);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width() * frame->format().bytesPerPixel(); ++x)
+            row[x] = static_cast<uint8_t>(random());
+    }
+}
+
+// Applies the update to |client_frame| the same way as the client does.
+void applyUpdate(Frame* client_frame,
+                 TileStore* store,
+                 const Frame& host_frame,
+                 const Region& dirty_region,
+                 const TileCache::TileList& cached_tiles,
+                 const TileCache::TileList& stored_tiles)
+{
+    for (const auto& tile : cached_tiles)
+        ASSERT_TRUE(store->restore(tile.slot, tile.pos, client_frame));
+
+    for (Region::Iterator it(dirty_region); !it.isAtEnd(); it.advance())
+        client_frame->copyPixelsFrom(host_frame, it.rect().topLeft(), it.rect());
+
+    for (const auto& tile : stored_tiles)
+        ASSERT_TRUE(store->store(tile.slot, tile.pos, *client_frame));
+}
+
+bool isEqualFrames(const Frame& frame1, const Frame& frame2)
+{
+    return memcmp(frame1.frameData(), frame2.frameData(),
+                  frame1.stride() * frame1.size().height()) == 0;
+}
+
+} // namespace
+
+TEST(tile_cache_test, switch_windows)
+{
+    std::unique_ptr<Frame> host_frame = createFrame();
+    std::unique_ptr<Frame> client_frame = createFrame();
+
+    TileCache cache(64);
+    TileStore store;
+    ASSERT_TRUE(store.reset(cache.slotCount()));
+
+    const Rect window_rect = Rect::makeLTRB(64, 64, 320, 256);
+    const size_t window_tiles = (window_rect.width() / TileCache::kTileSize) *
+        (window_rect.height() / TileCache::kTileSize);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        drawWindow(host_frame.get(), window_rect, i % 2);
+
+        Region dirty_region(window_rect);
+        TileCache::TileList cached_tiles;
+        TileCache::TileList stored_tiles;
+
+        cache.update(host_frame.get(), &dirty_region, &cached_tiles, &stored_tiles);
+        applyUpdate(client_frame.get(), &store, *host_frame, dirty_region,
+                    cached_tiles, stored_tiles);
+
+        EXPECT_TRUE(isEqualFrames(*host_frame, *client_frame));
+
+        if (i < 2)
+        {
+            // The windows are shown for the first time.
+            EXPECT_TRUE(cached_tiles.empty());
+            EXPECT_TRUE(stored_tiles.empty());
+        }
+        else if (i < 4)
+        {
+            // The windows are shown for the second time and are stored.
+            EXPECT_TRUE(cached_tiles.empty());
+            EXPECT_EQ(stored_tiles.size(), window_tiles);
+        }
+        else
+        {
+            // The windows are taken from the cache.
+            EXPECT_EQ(cached_tiles.size(), window_tiles);
+            EXPECT_TRUE(stored_tiles.empty());
+            EXPECT_TRUE(dirty_region.isEmpty());
+        }
+    }
+}
+
+TEST(tile_cache_test, random_updates)
+{
+    std::mt19937 random(1);
+
+    std::unique_ptr<Frame> host_frame = createFrame();
+    std::unique_ptr<Frame> client_frame = createFrame();
+
+    // The cache is small, so the tiles are evicted often.
+    TileCache cache(8);
+    TileStore store;
+    ASSERT_TRUE(store.reset(cache.slotCount()));
+
+    int cached_count = 0;
+
+    for (int i = 0; i < 300; ++i)
+    {
+        // Each window has its own size. Some positions are not aligned to the tiles.
+        const int window = random() % 4;
+        const Rect window_rect = Rect::makeXYWH(
+            (random() % 8) * 32, (random() % 8) * 32, 100 + window * 40, 70 + window * 30);
+
+        drawWindow(host_frame.get(), window_rect, window);
+
+        Region dirty_region(window_rect);
+        TileCache::TileList cached_tiles;
+        TileCache::TileList stored_tiles;
+
+        cache.update(host_frame.get(), &dirty_region, &cached_tiles, &stored_tiles);
+        applyUpdate(client_frame.get(), &store, *host_frame, dirty_region,
+                    cached_tiles, stored_tiles);
+
+        ASSERT_TRUE(isEqualFrames(*host_frame, *client_frame)) << i;
+
+        cached_count += static_cast<int>(cached_tiles.size());
+    }
+
+    EXPECT_GT(cached_count, 0);
+}
+
+TEST(tile_store_test, invalid_commands)
+{
+    std::unique_ptr<Frame> frame = createFrame();
+    TileStore store;
+
+    EXPECT_FALSE(store.reset(0));
+    EXPECT_FALSE(store.reset(TileStore::kMaxSlotCount + 1));
+    ASSERT_TRUE(store.reset(4));
+
+    // The slot is empty.
+    EXPECT_FALSE(store.restore(0, Point(0, 0), frame.get()));
+
+    EXPECT_FALSE(store.store(4, Point(0, 0), *frame));
+    EXPECT_FALSE(store.store(0, Point(32, 0), *frame));
+    EXPECT_FALSE(store.store(0, Point(640, 0), *frame));
+    EXPECT_FALSE(store.store(0, Point(0, -64), *frame));
+
+    EXPECT_TRUE(store.store(0, Point(576, 384), *frame));
+    EXPECT_TRUE(store.restore(0, Point(0, 0), frame.get()));
+    EXPECT_FALSE(store.restore(0, Point(0, 448), frame.get()));
+}
+
+} // namespace desktop
@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/tile_store.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+#include "desktop/tile_cache.h"
+
+#include <cstring>
+
+namespace desktop {
+
+bool TileStore::reset(size_t slot_count)
+{
+    if (!slot_count || slot_count > kMaxSlotCount)
+    {
+        LOG(LS_WARNING) << "Invalid number of slots: " << slot_count;
+        return false;
+    }
+
+    slots_.clear();
+    slots_.resize(slot_count);
+    return true;
+}
+
+bool TileStore::restore(size_t slot, const Point& pos, Frame* frame) const
+{
+    DCHECK(frame);
+
+    if (slot >= slots_.size() || !slots_[slot].pixels)
+    {
+        LOG(LS_WARNING) << "Invalid tile slot: " << slot;
+        return false;
+    }
+
+    if (!isValidTile(pos, *frame) ||
+        slots_[slot].bytes_per_pixel != frame->format().bytesPerPixel())
+    {
+        LOG(LS_WARNING) << "Invalid tile position: " << pos.x() << "x" << pos.y();
+        return false;
+    }
+
+    frame->copyPixelsFrom(
+        slots_[slot].pixels.get(),
+        TileCache::kTileSize * slots_[slot].bytes_per_pixel,
+        Rect::makeXYWH(pos, Size(TileCache::kTileSize, TileCache::kTileSize)));
+    return true;
+}
+
+bool TileStore::store(size_t slot, const Point& pos, const Frame& frame)
+{
+    if (slot >= slots_.size())
+    {
+        LOG(LS_WARNING) << "Invalid tile slot: " << slot;
+        return false;
+    }
+
+    if (!isValidTile(pos, frame))
+    {
+        LOG(LS_WARNING) << "Invalid tile position: " << pos.x() << "x" << pos.y();
+        return false;
+    }
+
+    Slot& target = slots_[slot];
+
+    const int bytes_per_pixel = frame.format().bytesPerPixel();
+    const int bytes_per_row = TileCache::kTileSize * bytes_per_pixel;
+
+    if (!target.pixels || target.bytes_per_pixel != bytes_per_pixel)
+    {
+        target.pixels = std::make_unique<uint8_t[]>(bytes_per_row * TileCache::kTileSize);
+        target.bytes_per_pixel = bytes_per_pixel;
+    }
+
+    const uint8_t* source = frame.frameDataAtPos(pos);
+    uint8_t* pixels = target.pixels.get();
+
+    for (int y = 0; y < TileCache::kTileSize; ++y)
+    {
+        memcpy(pixels, source, bytes_per_row);
+
+        pixels += bytes_per_row;
+        source += frame.stride();
+    }
+
+    return true;
+}
+
+// static
+bool TileStore::isValidTile(const Point& pos, const Frame& frame)
+{
+    return pos.x() >= 0 && pos.y() >= 0 &&
+           pos.x() % TileCache::kTileSize == 0 && pos.y() % TileCache::kTileSize == 0 &&
+           pos.x() + TileCache::kTileSize <= frame.size().width() &&
+           pos.y() + TileCache::kTileSize <= frame.size().height();
+}
+
+} // namespace desktop
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__TILE_STORE_H
+#define DESKTOP__TILE_STORE_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <memory>
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+
+// Client side storage of the screen tiles. The host decides which tiles are stored and to which
+// slots (see TileCache), the client only executes the commands.
+class TileStore
+{
+public:
+    TileStore() = default;
+    ~TileStore() = default;
+
+    // The maximum number of slots that the host can request.
+    static const size_t kMaxSlotCount = 4096;
+
+    // Removes all tiles and changes the number of slots.
+    bool reset(size_t slot_count);
+
+    size_t slotCount() const { return slots_.size(); }
+
+    // Copies the tile from |slot| to |frame| at |pos|.
+    bool restore(size_t slot, const Point& pos, Frame* frame) const;
+
+    // Copies the tile located at |pos| of |frame| to |slot|.
+    bool store(size_t slot, const Point& pos, const Frame& frame);
+
+private:
+    struct Slot
+    {
+        int bytes_per_pixel = 0;
+        std::unique_ptr<uint8_t[]> pixels;
+    };
+
+    static bool isValidTile(const Point& pos, const Frame& frame);
+
+    std::vector<Slot> slots_;
+
+    DISALLOW_COPY_AND_ASSIGN(TileStore);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__TILE_STORE_H
@@ -18,6 +18,8 @@
 
 #include "host/desktop_config_tracker.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
@@ -58,12 +60,72 @@ uint32_t DesktopConfigTracker::changesMask(const proto::desktop::Config& new_con
     if (old_config_->compress_ratio() != new_config.compress_ratio())
         result |= HAS_VIDEO;
 
+    if (old_config_->max_width() != new_config.max_width() ||
+        old_config_->max_height() != new_config.max_height())
+    {
+        result |= HAS_VIDEO;
+    }
+
     if ((old_config_->flags() & proto::desktop::ENABLE_CURSOR_SHAPE) !=
         (new_config.flags() & proto::desktop::ENABLE_CURSOR_SHAPE))
     {
         result |= HAS_VIDEO;
     }
 
+    if ((old_config_->flags() & proto::desktop::ENABLE_COPY_RECT) !=
+        (new_config.flags() & proto::desktop::ENABLE_COPY_RECT))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_TILE_CACHE) !=
+        (new_config.flags() & proto::desktop::ENABLE_TILE_CACHE))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_LARGE_CURSOR_CACHE) !=
+        (new_config.flags() & proto::desktop::ENABLE_LARGE_CURSOR_CACHE))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_PERSISTENT_STREAM) !=
+        (new_config.flags() & proto::desktop::ENABLE_PERSISTENT_STREAM))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_DELTA_FILTER) !=
+        (new_config.flags() & proto::desktop::ENABLE_DELTA_FILTER))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_PALETTE) !=
+        (new_config.flags() & proto::desktop::ENABLE_PALETTE))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_VP9_I444) !=
+        (new_config.flags() & proto::desktop::ENABLE_VP9_I444))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if ((old_config_->flags() & proto::desktop::ENABLE_VP9_LOSSLESS) !=
+        (new_config.flags() & proto::desktop::ENABLE_VP9_LOSSLESS))
+    {
+        result |= HAS_VIDEO;
+    }
+
+    if (!std::equal(old_config_->zstd_dictionary().begin(), old_config_->zstd_dictionary().end(),
+                    new_config.zstd_dictionary().begin(), new_config.zstd_dictionary().end()))
+    {
+        result |= HAS_VIDEO;
+    }
+
     if ((old_config_->flags() & proto::desktop::ENABLE_CLIPBOARD) !=
         (new_config.flags() & proto::desktop::ENABLE_CLIPBOARD))
     {
@@ -69,6 +69,7 @@ void Session::start()
     connect(channel_, &ipc::Channel::disconnected, this, &Session::stop, Qt::QueuedConnection);
     connect(channel_, &ipc::Channel::errorOccurred, this, &Session::stop, Qt::QueuedConnection);
     connect(channel_, &ipc::Channel::messageReceived, this, &Session::messageReceived);
+    connect(channel_, &ipc::Channel::messageWritten, this, &Session::messageWritten);
 
     channel_->connectToServer(channel_id_);
 }
@@ -78,6 +79,16 @@ void Session::sendMessage(const QByteArray& message)
     channel_->send(message);
 }
 
+int64_t Session::pendingBytes() const
+{
+    return channel_->pendingBytes();
+}
+
+void Session::messageWritten(int /* size */)
+{
+    // Nothing
+}
+
 void Session::stop()
 {
     QCoreApplication::quit();
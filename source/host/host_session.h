@@ -46,9 +46,15 @@ protected:
     // Sends outgoing message.
     void sendMessage(const QByteArray& message);
 
+    // Returns the number of bytes of the outgoing messages which are not sent yet.
+    int64_t pendingBytes() const;
+
     virtual void sessionStarted() = 0;
     virtual void messageReceived(const QByteArray& buffer) = 0;
 
+    // Called when the outgoing message of |size| bytes is sent.
+    virtual void messageWritten(int size);
+
 private:
     QString channel_id_;
     ipc::Channel* channel_ = nullptr;
@@ -18,12 +18,18 @@
 
 #include "host/host_session_desktop.h"
 #include "base/power_controller.h"
+#include "base/qt_logging.h"
+#include "codec/session_recorder.h"
 #include "common/clipboard.h"
 #include "common/desktop_session_constants.h"
 #include "common/message_serialization.h"
 #include "host/input_thread.h"
+#include "host/host_settings.h"
 #include "host/host_system_info.h"
 #include "proto/desktop_extensions.pb.h"
+
+#include <QDateTime>
+#include <QDir>
 #if defined(OS_WIN)
 #include "host/win/updater_launcher.h"
 #endif // defined(OS_WIN)
@@ -51,6 +57,15 @@ SessionDesktop::~SessionDesktop() = default;
 void SessionDesktop::onScreenUpdate(const QByteArray& message)
 {
     sendMessage(message);
+
+    if (screen_updater_)
+        screen_updater_->setPendingBytes(pendingBytes());
+
+    if (session_recorder_)
+    {
+        session_recorder_->addMessage(
+            reinterpret_cast<const uint8_t*>(message.constData()), message.size());
+    }
 }
 
 void SessionDesktop::sessionStarted()
@@ -75,6 +90,8 @@ void SessionDesktop::sessionStarted()
 
     // Send the request.
     sendMessage(common::serializeMessage(outgoing_message_));
+
+    startRecording();
 }
 
 void SessionDesktop::messageReceived(const QByteArray& buffer)
@@ -97,12 +114,20 @@ void SessionDesktop::messageReceived(const QByteArray& buffer)
         readExtension(incoming_message_.extension());
     else if (incoming_message_.has_config())
         readConfig(incoming_message_.config());
+    else if (incoming_message_.has_network_status())
+        readNetworkStatus(incoming_message_.network_status());
     else
     {
         DLOG(LS_WARNING) << "Unhandled message from client";
     }
 }
 
+void SessionDesktop::messageWritten(int size)
+{
+    if (screen_updater_)
+        screen_updater_->onMessageWritten(size, pendingBytes());
+}
+
 void SessionDesktop::clipboardEvent(const proto::desktop::ClipboardEvent& event)
 {
     if (session_type_ != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -122,8 +147,26 @@ void SessionDesktop::readPointerEvent(const proto::desktop::PointerEvent& event)
         return;
     }
 
-    if (input_thread_)
+    if (!input_thread_)
+        return;
+
+    if (!screen_updater_)
+    {
         input_thread_->injectPointerEvent(event);
+        return;
+    }
+
+    screen_updater_->onUserInput();
+
+    // The client may receive the screen scaled down.
+    const desktop::Point pos =
+        screen_updater_->mapToScreen(desktop::Point(event.x(), event.y()));
+
+    proto::desktop::PointerEvent screen_event(event);
+    screen_event.set_x(pos.x());
+    screen_event.set_y(pos.y());
+
+    input_thread_->injectPointerEvent(screen_event);
 }
 
 void SessionDesktop::readKeyEvent(const proto::desktop::KeyEvent& event)
@@ -135,8 +178,13 @@ void SessionDesktop::readKeyEvent(const proto::desktop::KeyEvent& event)
         return;
     }
 
-    if (input_thread_)
-        input_thread_->injectKeyEvent(event);
+    if (!input_thread_)
+        return;
+
+    if (screen_updater_)
+        screen_updater_->onUserInput();
+
+    input_thread_->injectKeyEvent(event);
 }
 
 void SessionDesktop::readClipboardEvent(const proto::desktop::ClipboardEvent& clipboard_event)
@@ -257,11 +305,65 @@ void SessionDesktop::readConfig(const proto::desktop::Config& config)
     {
         screen_updater_.reset(new ScreenUpdater(this));
 
-        if (!screen_updater_->start(config))
+        proto::desktop::Config updater_config(config);
+
+        if (session_recorder_)
+        {
+            screen_updater_->setKeyFrameInterval(codec::SessionRecorder::kKeyFrameInterval);
+
+            // The recording is played from the key frames, so each packet must be decodable
+            // without the streams of the previous packets.
+            updater_config.set_flags(
+                updater_config.flags() & ~proto::desktop::ENABLE_PERSISTENT_STREAM);
+        }
+
+        if (!screen_updater_->start(updater_config))
+        {
             stop();
+            return;
+        }
+
+        if (network_bandwidth_)
+            screen_updater_->setNetworkBandwidth(network_bandwidth_);
     }
 }
 
+void SessionDesktop::readNetworkStatus(const proto::desktop::NetworkStatus& network_status)
+{
+    // The message comes through the same channel as the messages of the client, so the client
+    // can send it too. The capture scheduler limits the value to the range of the real networks.
+    network_bandwidth_ = network_status.bandwidth();
+
+    if (screen_updater_)
+        screen_updater_->setNetworkBandwidth(network_bandwidth_);
+}
+
+void SessionDesktop::startRecording()
+{
+    const QString recording_path = Settings().sessionRecordingPath();
+    if (recording_path.isEmpty())
+        return;
+
+    QDir recording_dir(recording_path);
+    if (!recording_dir.mkpath(QStringLiteral(".")))
+    {
+        LOG(LS_WARNING) << "Unable to create directory: " << recording_path;
+        return;
+    }
+
+    const QString file_name = QStringLiteral("%1-%2.aspr")
+        .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss-zzz")))
+        .arg(session_type_ == proto::SESSION_TYPE_DESKTOP_MANAGE ?
+             QStringLiteral("manage") : QStringLiteral("view"));
+
+    session_recorder_ = codec::SessionRecorder::create(
+        recording_dir.filePath(file_name).toStdWString());
+    if (!session_recorder_)
+        return;
+
+    LOG(LS_INFO) << "Session recording started: " << file_name;
+}
+
 void SessionDesktop::sendSystemInfo()
 {
     proto::system_info::SystemInfo system_info;
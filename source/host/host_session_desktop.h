@@ -25,6 +25,10 @@
 #include "proto/common.pb.h"
 #include "build/build_config.h"
 
+namespace codec {
+class SessionRecorder;
+} // namespace codec
+
 namespace common {
 class Clipboard;
 } // namespace common
@@ -50,6 +54,7 @@ protected:
     // Session implementation.
     void sessionStarted() override;
     void messageReceived(const QByteArray& buffer) override;
+    void messageWritten(int size) override;
 
 private slots:
     void clipboardEvent(const proto::desktop::ClipboardEvent& event);
@@ -60,8 +65,10 @@ private:
     void readClipboardEvent(const proto::desktop::ClipboardEvent& event);
     void readExtension(const proto::desktop::Extension& extension);
     void readConfig(const proto::desktop::Config& config);
+    void readNetworkStatus(const proto::desktop::NetworkStatus& network_status);
 
     void sendSystemInfo();
+    void startRecording();
 
     const proto::SessionType session_type_;
 
@@ -72,7 +79,12 @@ private:
 
     DesktopConfigTracker config_tracker_;
 
+    // The speed of the network channel to the client in bytes per second. It is measured by the
+    // service process, which owns the channel.
+    int64_t network_bandwidth_ = 0;
+
     std::unique_ptr<ScreenUpdater> screen_updater_;
+    std::unique_ptr<codec::SessionRecorder> session_recorder_;
     std::unique_ptr<common::Clipboard> clipboard_;
     std::unique_ptr<InputThread> input_thread_;
 
@@ -17,6 +17,8 @@
 //
 
 #include "host/host_session_fake_desktop.h"
+#include "codec/video_encoder_av1.h"
+#include "codec/video_encoder_hybrid.h"
 #include "codec/video_encoder_vpx.h"
 #include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
@@ -88,11 +90,19 @@ codec::VideoEncoder* SessionFakeDesktop::createEncoder(const proto::desktop::Con
         case proto::desktop::VIDEO_ENCODING_VP9:
             return codec::VideoEncoderVPX::createVP9();
 
+        case proto::desktop::VIDEO_ENCODING_AV1:
+            return codec::VideoEncoderAV1::create();
+
         case proto::desktop::VIDEO_ENCODING_ZSTD:
             return codec::VideoEncoderZstd::create(
                 codec::VideoUtil::fromVideoPixelFormat(
                     config.pixel_format()), config.compress_ratio());
 
+        case proto::desktop::VIDEO_ENCODING_HYBRID:
+            return codec::VideoEncoderHybrid::create(
+                codec::VideoUtil::fromVideoPixelFormat(
+                    config.pixel_format()), config.compress_ratio());
+
         default:
             LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
             return nullptr;
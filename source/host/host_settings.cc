@@ -186,6 +186,16 @@ void Settings::setUpdateServer(const QString& server)
     system_settings_.setValue(QStringLiteral("UpdateServer"), server);
 }
 
+QString Settings::sessionRecordingPath() const
+{
+    return system_settings_.value(QStringLiteral("SessionRecordingPath")).toString();
+}
+
+void Settings::setSessionRecordingPath(const QString& path)
+{
+    system_settings_.setValue(QStringLiteral("SessionRecordingPath"), path);
+}
+
 // static
 bool Settings::copySettings(
     const QString& source_path, const QString& target_path, bool silent, QWidget* parent)
@@ -57,6 +57,11 @@ public:
     QString updateServer() const;
     void setUpdateServer(const QString& server);
 
+    // The directory for the session recordings. If the path is empty, the sessions are not
+    // recorded.
+    QString sessionRecordingPath() const;
+    void setSessionRecordingPath(const QString& path);
+
 private:
     static bool copySettings(
         const QString& source_path, const QString& target_path, bool silent, QWidget* parent);
@@ -35,14 +35,55 @@ ScreenUpdater::ScreenUpdater(Delegate* delegate, QObject* parent)
 bool ScreenUpdater::start(const proto::desktop::Config& config)
 {
     impl_ = new ScreenUpdaterImpl(this);
+    impl_->setKeyFrameInterval(key_frame_interval_);
     return impl_->startUpdater(config);
 }
 
+void ScreenUpdater::setKeyFrameInterval(std::chrono::milliseconds interval)
+{
+    key_frame_interval_ = interval;
+}
+
 void ScreenUpdater::selectScreen(int64_t screen_id)
 {
     impl_->selectScreen(screen_id);
 }
 
+desktop::Point ScreenUpdater::mapToScreen(const desktop::Point& pos) const
+{
+    if (!impl_)
+        return pos;
+
+    return impl_->mapToScreen(pos);
+}
+
+void ScreenUpdater::onUserInput()
+{
+    if (impl_)
+        impl_->onUserInput();
+}
+
+void ScreenUpdater::setPendingBytes(int64_t pending_bytes)
+{
+    if (impl_)
+        impl_->setPendingBytes(static_cast<size_t>(pending_bytes));
+}
+
+void ScreenUpdater::onMessageWritten(int message_size, int64_t pending_bytes)
+{
+    if (impl_)
+    {
+        impl_->onMessageWritten(static_cast<size_t>(message_size),
+                                static_cast<size_t>(pending_bytes));
+    }
+}
+
+void ScreenUpdater::setNetworkBandwidth(int64_t bandwidth)
+{
+    if (impl_)
+        impl_->setNetworkBandwidth(bandwidth);
+}
+
 void ScreenUpdater::customEvent(QEvent* event)
 {
     if (event->type() != ScreenUpdaterImpl::MessageEvent::kType)
@@ -20,10 +20,13 @@
 #define HOST__SCREEN_UPDATER_H
 
 #include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
 #include "proto/desktop.pb.h"
 
 #include <QObject>
 
+#include <chrono>
+
 namespace host {
 
 class ScreenUpdaterImpl;
@@ -44,6 +47,27 @@ public:
     ScreenUpdater(Delegate* delegate, QObject* parent = nullptr);
     ~ScreenUpdater() = default;
 
+    // If |interval| is not zero, key frames are sent with this interval. It must be called
+    // before start().
+    void setKeyFrameInterval(std::chrono::milliseconds interval);
+
+    // Converts the position received from the client to the position on the screen.
+    desktop::Point mapToScreen(const desktop::Point& pos) const;
+
+    // Called when the input from the client is received. The frame rate is raised while the
+    // user interacts with the desktop.
+    void onUserInput();
+
+    // Called when the outgoing queue of the session is changed. While the queue cannot be sent
+    // within the latency budget, the updater captures the frames less often and does not send
+    // them. The changes are sent in one frame when the queue is drained.
+    void setPendingBytes(int64_t pending_bytes);
+    void onMessageWritten(int message_size, int64_t pending_bytes);
+
+    // Called when the speed of the network channel to the client is measured. The bitrate of the
+    // video is adjusted to it.
+    void setNetworkBandwidth(int64_t bandwidth);
+
 public slots:
     bool start(const proto::desktop::Config& config);
     void selectScreen(int64_t screen_id);
@@ -55,6 +79,7 @@ protected:
 private:
     ScreenUpdaterImpl* impl_ = nullptr;
     Delegate* delegate_;
+    std::chrono::milliseconds key_frame_interval_{ 0 };
 
     DISALLOW_COPY_AND_ASSIGN(ScreenUpdater);
 };
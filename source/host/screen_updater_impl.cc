@@ -19,20 +19,65 @@
 #include "host/screen_updater_impl.h"
 
 #include "codec/cursor_encoder.h"
+#include "codec/scale_reducer.h"
+#include "codec/video_encoder_av1.h"
+#include "codec/video_encoder_hybrid.h"
 #include "codec/video_encoder_vpx.h"
 #include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
+#include "codec/zstd_dictionary.h"
 #include "common/desktop_session_constants.h"
 #include "common/message_serialization.h"
 #include "desktop/capture_scheduler.h"
 #include "desktop/cursor_capturer_win.h"
+#include "desktop/mouse_cursor.h"
 #include "desktop/screen_capturer_wrapper.h"
 #include "proto/desktop_extensions.pb.h"
 
 #include <QCoreApplication>
 
+#include <thread>
+
 namespace host {
 
+namespace {
+
+// The video encoder gets the estimated speed of the outgoing channel with this interval.
+constexpr std::chrono::seconds kBitrateUpdateInterval{ 1 };
+
+// The part of the channel used by the video. The rest is left for the cursor, the other channels
+// and the variations of the frame size.
+constexpr double kBandwidthUsage = 0.7;
+
+void configureZstdEncoder(const proto::desktop::Config& config,
+                          codec::VideoEncoderZstd* video_encoder)
+{
+    video_encoder->setCopyRectEnabled(
+        (config.flags() & proto::desktop::ENABLE_COPY_RECT) != 0);
+    video_encoder->setTileCacheEnabled(
+        (config.flags() & proto::desktop::ENABLE_TILE_CACHE) != 0);
+    video_encoder->setThreadCount(codec::VideoEncoderZstd::kAutoThreadCount);
+    video_encoder->setPersistentStreamEnabled(
+        (config.flags() & proto::desktop::ENABLE_PERSISTENT_STREAM) != 0);
+    video_encoder->setDeltaFilterEnabled(
+        (config.flags() & proto::desktop::ENABLE_DELTA_FILTER) != 0);
+    video_encoder->setPaletteEnabled(
+        (config.flags() & proto::desktop::ENABLE_PALETTE) != 0);
+
+    for (uint32_t dictionary_id : config.zstd_dictionary())
+    {
+        std::shared_ptr<const codec::ZstdDictionary> dictionary =
+            codec::ZstdDictionaryStore::instance()->find(dictionary_id);
+        if (dictionary)
+        {
+            video_encoder->setDictionary(std::move(dictionary));
+            break;
+        }
+    }
+}
+
+} // namespace
+
 ScreenUpdaterImpl::ScreenUpdaterImpl(QObject* parent)
     : QThread(parent)
 {
@@ -49,10 +94,18 @@ ScreenUpdaterImpl::~ScreenUpdaterImpl()
     // Notify the thread about the event.
     event_condition_.notify_all();
 
+    // The capture thread may wait for the encode thread.
+    frame_queue_.close();
+
     // Waiting for the completion of the thread.
     wait();
 }
 
+void ScreenUpdaterImpl::setKeyFrameInterval(std::chrono::milliseconds interval)
+{
+    key_frame_interval_ = interval;
+}
+
 bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
 {
     switch (config.video_encoding())
@@ -62,14 +115,54 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
             break;
 
         case proto::desktop::VIDEO_ENCODING_VP9:
-            video_encoder_.reset(codec::VideoEncoderVPX::createVP9());
+        {
+            std::unique_ptr<codec::VideoEncoderVPX> video_encoder(
+                codec::VideoEncoderVPX::createVP9());
+
+            video_encoder->setI444Enabled(
+                (config.flags() & proto::desktop::ENABLE_VP9_I444) != 0);
+            video_encoder->setLosslessEnabled(
+                (config.flags() & proto::desktop::ENABLE_VP9_LOSSLESS) != 0);
+
+            video_encoder_ = std::move(video_encoder);
+        }
+        break;
+
+        case proto::desktop::VIDEO_ENCODING_AV1:
+            video_encoder_.reset(codec::VideoEncoderAV1::create());
             break;
 
         case proto::desktop::VIDEO_ENCODING_ZSTD:
-            video_encoder_.reset(codec::VideoEncoderZstd::create(
-                codec::VideoUtil::fromVideoPixelFormat(
-                    config.pixel_format()), config.compress_ratio()));
-            break;
+        {
+            std::unique_ptr<codec::VideoEncoderZstd> video_encoder(
+                codec::VideoEncoderZstd::create(
+                    codec::VideoUtil::fromVideoPixelFormat(
+                        config.pixel_format()), config.compress_ratio()));
+
+            configureZstdEncoder(config, video_encoder.get());
+            video_encoder_ = std::move(video_encoder);
+        }
+        break;
+
+        case proto::desktop::VIDEO_ENCODING_HYBRID:
+        {
+            std::unique_ptr<codec::VideoEncoderHybrid> video_encoder(
+                codec::VideoEncoderHybrid::create(
+                    codec::VideoUtil::fromVideoPixelFormat(
+                        config.pixel_format()), config.compress_ratio()));
+
+            codec::VideoEncoderZstd* lossless_encoder = video_encoder->losslessEncoder();
+
+            configureZstdEncoder(config, lossless_encoder);
+
+            // The client has lossy or stale pixels in the video areas, so they can not be the
+            // source of the cached tiles and the moved areas.
+            lossless_encoder->setTileCacheEnabled(false);
+            lossless_encoder->setCopyRectEnabled(false);
+
+            video_encoder_ = std::move(video_encoder);
+        }
+        break;
 
         default:
         {
@@ -83,10 +176,21 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
     if (!video_encoder_)
         return false;
 
+    max_size_.set(config.max_width(), config.max_height());
+
+    if (!max_size_.isEmpty())
+        scale_reducer_ = std::make_unique<codec::ScaleReducer>();
+
     if (config.flags() & proto::desktop::ENABLE_CURSOR_SHAPE)
     {
         cursor_capturer_.reset(new desktop::CursorCapturerWin());
-        cursor_encoder_.reset(new codec::CursorEncoder());
+        const bool large_cache = (config.flags() & proto::desktop::ENABLE_LARGE_CURSOR_CACHE) != 0;
+
+        cursor_encoder_.reset(new codec::CursorEncoder(
+            large_cache ? codec::CursorEncoder::CacheType::LARGE :
+                          codec::CursorEncoder::CacheType::SMALL));
+        cursor_encoder_->setPersistentStreamEnabled(
+            (config.flags() & proto::desktop::ENABLE_PERSISTENT_STREAM) != 0);
     }
 
     capture_scheduler_.reset(
@@ -113,10 +217,70 @@ void ScreenUpdaterImpl::selectScreen(desktop::ScreenCapturer::ScreenId screen_id
     event_condition_.notify_all();
 }
 
+desktop::Point ScreenUpdaterImpl::mapToScreen(const desktop::Point& pos)
+{
+    std::scoped_lock lock(scale_lock_);
+
+    if (scaled_size_.isEmpty() || scaled_size_ == source_rect_.size())
+        return pos;
+
+    // The scaled frame has the same top left corner as the source frame.
+    const int64_t x = pos.x() - source_rect_.x();
+    const int64_t y = pos.y() - source_rect_.y();
+
+    return desktop::Point(
+        source_rect_.x() + static_cast<int32_t>(x * source_rect_.width() / scaled_size_.width()),
+        source_rect_.y() + static_cast<int32_t>(y * source_rect_.height() / scaled_size_.height()));
+}
+
+void ScreenUpdaterImpl::onUserInput()
+{
+    if (!capture_scheduler_ || !capture_scheduler_->onUserInput())
+        return;
+
+    // The updater waits for the changes of the idle screen. The next capture is started now.
+    std::scoped_lock lock(event_lock_);
+    event_condition_.notify_all();
+}
+
+void ScreenUpdaterImpl::setPendingBytes(size_t pending_bytes)
+{
+    if (capture_scheduler_)
+        capture_scheduler_->setPendingBytes(pending_bytes);
+}
+
+void ScreenUpdaterImpl::onMessageWritten(size_t message_size, size_t pending_bytes)
+{
+    if (!capture_scheduler_ || !capture_scheduler_->onMessageWritten(message_size, pending_bytes))
+        return;
+
+    // The outgoing queue is drained. The changes accumulated while the channel was congested
+    // are sent with the next frame, which is captured now.
+    std::scoped_lock lock(event_lock_);
+    event_condition_.notify_all();
+}
+
+void ScreenUpdaterImpl::setNetworkBandwidth(int64_t bandwidth)
+{
+    if (capture_scheduler_)
+        capture_scheduler_->setNetworkBandwidth(bandwidth);
+}
+
 void ScreenUpdaterImpl::run()
 {
     screen_capturer_ = std::make_unique<desktop::ScreenCapturerWrapper>(screen_capturer_flags_);
 
+    // Frame N + 1 is captured while frame N is encoded.
+    std::thread encode_thread(&ScreenUpdaterImpl::encodeFrames, this);
+
+    captureFrames();
+
+    frame_queue_.close();
+    encode_thread.join();
+}
+
+void ScreenUpdaterImpl::captureFrames()
+{
     while (true)
     {
         int count = screen_capturer_->screenCount();
@@ -162,28 +326,20 @@ void ScreenUpdaterImpl::run()
         const desktop::Frame* screen_frame = screen_capturer_->captureFrame();
         if (screen_frame)
         {
-            message_.Clear();
-
-            if (!screen_frame->constUpdatedRegion().isEmpty())
-                video_encoder_->encode(screen_frame, message_.mutable_video_packet());
-
-            if (cursor_capturer_ && cursor_encoder_)
+            if (cursor_capturer_)
             {
                 std::unique_ptr<desktop::MouseCursor> mouse_cursor(
                     cursor_capturer_->captureCursor());
                 if (mouse_cursor)
                 {
-                    cursor_encoder_->encode(std::move(mouse_cursor),
-                                            message_.mutable_cursor_shape());
+                    std::scoped_lock lock(cursor_lock_);
+                    mouse_cursor_ = std::move(mouse_cursor);
                 }
             }
 
-            if (message_.has_video_packet() || message_.has_cursor_shape())
-            {
-                QCoreApplication::postEvent(parent(),
-                                        new MessageEvent(common::serializeMessage(message_)),
-                                        Qt::HighEventPriority);
-            }
+            // Waits if the encode thread is busy with the previous frames.
+            if (!frame_queue_.push(*screen_frame))
+                return;
         }
 
         capture_scheduler_->endCapture();
@@ -208,4 +364,123 @@ void ScreenUpdaterImpl::run()
     }
 }
 
+void ScreenUpdaterImpl::encodeFrames()
+{
+    while (true)
+    {
+        std::unique_ptr<desktop::SharedFrame> shared_frame = frame_queue_.pop();
+        if (!shared_frame)
+            return;
+
+        // The frames are not encoded while the outgoing queue cannot be sent in time. Their
+        // changes are accumulated and sent in one frame when the queue is drained.
+        if (capture_scheduler_->isCongested())
+        {
+            const desktop::Region& updated_region = shared_frame->constUpdatedRegion();
+
+            capture_scheduler_->onFrameCaptured(!updated_region.isEmpty());
+            skipped_region_.addRegion(updated_region);
+            continue;
+        }
+
+        if (!skipped_region_.isEmpty())
+        {
+            skipped_region_.addRegion(shared_frame->constUpdatedRegion());
+            skipped_region_.intersectWith(desktop::Rect::makeSize(shared_frame->size()));
+
+            shared_frame->updatedRegion()->swap(&skipped_region_);
+            skipped_region_.clear();
+        }
+
+        capture_scheduler_->beginEncode();
+
+        const desktop::Frame* screen_frame = shared_frame.get();
+        if (scale_reducer_)
+        {
+            const desktop::Frame* scaled_frame =
+                scale_reducer_->scaleFrame(screen_frame, max_size_);
+
+            std::scoped_lock lock(scale_lock_);
+
+            source_rect_ = desktop::Rect::makeXYWH(screen_frame->topLeft(), screen_frame->size());
+            scaled_size_ = scaled_frame->size();
+
+            screen_frame = scaled_frame;
+        }
+
+        frame_message_.Clear();
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if (key_frame_interval_ != std::chrono::milliseconds::zero() &&
+            now - key_frame_time_ >= key_frame_interval_)
+        {
+            video_encoder_->requestKeyFrame();
+        }
+
+        if (now - bitrate_time_ >= kBitrateUpdateInterval)
+        {
+            bitrate_time_ = now;
+
+            // Bytes per second to kilobits per second.
+            const int64_t bandwidth = capture_scheduler_->bandwidth();
+            if (bandwidth)
+            {
+                video_encoder_->setTargetBitrate(
+                    static_cast<uint32_t>(bandwidth * 8 * kBandwidthUsage / 1000));
+            }
+        }
+
+        const bool frame_changed = !screen_frame->constUpdatedRegion().isEmpty();
+
+        if (frame_changed || video_encoder_->isKeyFrameRequested() ||
+            video_encoder_->hasPendingRefresh())
+        {
+            video_encoder_->encode(screen_frame, frame_message_.mutable_video_packet());
+
+            const proto::desktop::VideoPacket& packet = frame_message_.video_packet();
+
+            if (packet.has_format())
+            {
+                key_frame_time_ = now;
+            }
+            else if (!frame_changed && !packet.dirty_rect_size())
+            {
+                // Nothing was refreshed in this frame.
+                frame_message_.clear_video_packet();
+            }
+        }
+
+        if (cursor_encoder_)
+        {
+            std::unique_ptr<desktop::MouseCursor> mouse_cursor;
+
+            {
+                std::scoped_lock lock(cursor_lock_);
+                mouse_cursor = std::move(mouse_cursor_);
+            }
+
+            if (mouse_cursor)
+            {
+                cursor_encoder_->encode(std::move(mouse_cursor),
+                                        frame_message_.mutable_cursor_shape());
+            }
+        }
+
+        const bool has_changes =
+            frame_message_.has_video_packet() || frame_message_.has_cursor_shape();
+
+        capture_scheduler_->onFrameCaptured(has_changes);
+
+        if (has_changes)
+        {
+            QCoreApplication::postEvent(parent(),
+                                        new MessageEvent(common::serializeMessage(frame_message_)),
+                                        Qt::HighEventPriority);
+        }
+
+        capture_scheduler_->endEncode();
+    }
+}
+
 } // namespace host
@@ -20,11 +20,14 @@
 #define HOST__SCREEN_UPDATER_IMPL_H
 
 #include "desktop/screen_capturer_wrapper.h"
+#include "desktop/shared_frame_queue.h"
 #include "proto/desktop.pb.h"
 
 #include <QEvent>
 #include <QThread>
 
+#include <chrono>
+
 namespace codec {
 class CursorEncoder;
 class ScaleReducer;
@@ -34,6 +37,7 @@ class VideoEncoder;
 namespace desktop {
 class CaptureScheduler;
 class CursorCapturer;
+class MouseCursor;
 } // namespace desktop
 
 namespace host {
@@ -63,9 +67,21 @@ public:
         DISALLOW_COPY_AND_ASSIGN(MessageEvent);
     };
 
+    void setKeyFrameInterval(std::chrono::milliseconds interval);
     bool startUpdater(const proto::desktop::Config& config);
     void selectScreen(desktop::ScreenCapturer::ScreenId screen_id);
 
+    // Converts the position in the frame sent to the client to the position on the screen.
+    // The positions differ if the frames are scaled down for the client.
+    desktop::Point mapToScreen(const desktop::Point& pos);
+
+    // The feedback for the capture scheduler. The methods can be called from any thread after
+    // the updater is started.
+    void onUserInput();
+    void setPendingBytes(size_t pending_bytes);
+    void onMessageWritten(size_t message_size, size_t pending_bytes);
+    void setNetworkBandwidth(int64_t bandwidth);
+
 protected:
     // QThread implementation.
     void run() override;
@@ -73,15 +89,49 @@ protected:
 private:
     enum class Event { NO_EVENT, SELECT_SCREEN, TERMINATE };
 
+    // The capture thread captures the screen and the cursor and passes them to the encode
+    // thread. The encode thread encodes them and posts the messages.
+    void captureFrames();
+    void encodeFrames();
+
     uint32_t screen_capturer_flags_ = 0;
 
     std::unique_ptr<desktop::CaptureScheduler> capture_scheduler_;
 
+    // Used by the capture thread.
     std::unique_ptr<desktop::ScreenCapturerWrapper> screen_capturer_;
-    std::unique_ptr<codec::VideoEncoder> video_encoder_;
-
     std::unique_ptr<desktop::CursorCapturer> cursor_capturer_;
+    proto::desktop::HostToClient message_;
+
+    desktop::SharedFrameQueue frame_queue_;
+
+    // The last captured cursor which is not encoded yet.
+    std::mutex cursor_lock_;
+    std::unique_ptr<desktop::MouseCursor> mouse_cursor_;
+
+    // Used by the encode thread.
+    std::unique_ptr<codec::ScaleReducer> scale_reducer_;
+    std::unique_ptr<codec::VideoEncoder> video_encoder_;
     std::unique_ptr<codec::CursorEncoder> cursor_encoder_;
+    proto::desktop::HostToClient frame_message_;
+
+    // The changes of the frames which were not sent because the channel was congested.
+    desktop::Region skipped_region_;
+
+    // If the interval is not zero, key frames are requested from the encoder with this interval.
+    std::chrono::milliseconds key_frame_interval_{ 0 };
+    std::chrono::steady_clock::time_point key_frame_time_;
+
+    // The last time when the target bitrate of the video encoder was updated.
+    std::chrono::steady_clock::time_point bitrate_time_;
+
+    // The frames larger than this size are scaled down before encoding.
+    desktop::Size max_size_;
+
+    // The source and the scaled frame geometry for mapping the pointer events.
+    std::mutex scale_lock_;
+    desktop::Rect source_rect_;
+    desktop::Size scaled_size_;
 
     // By default, we capture the full screen.
     desktop::ScreenCapturer::ScreenId screen_id_ =
@@ -92,8 +142,6 @@ private:
     std::condition_variable event_condition_;
     std::mutex event_lock_;
 
-    proto::desktop::HostToClient message_;
-
     DISALLOW_COPY_AND_ASSIGN(ScreenUpdaterImpl);
 };
 
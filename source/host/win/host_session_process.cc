@@ -18,15 +18,32 @@
 
 #include "host/win/host_session_process.h"
 #include "base/qt_logging.h"
+#include "common/message_serialization.h"
 #include "host/host_session_fake.h"
 #include "ipc/ipc_channel.h"
 #include "ipc/ipc_server.h"
 #include "net/network_channel_host.h"
+#include "proto/desktop.pb.h"
 
 #include <QCoreApplication>
 
+#include <algorithm>
+#include <limits>
+
 namespace host {
 
+namespace {
+
+// If the sending queue of the network channel contains more data, the messages from the session
+// process are not read. The session process sees the growth of its own sending queue and
+// reduces the frame rate.
+constexpr int64_t kMaxNetworkPendingBytes = 256 * 1024; // 256kB
+
+// The interval between the messages with the speed of the network channel.
+constexpr std::chrono::milliseconds kNetworkStatusInterval{ 500 };
+
+} // namespace
+
 SessionProcess::SessionProcess(QObject* parent)
     : QObject(parent)
 {
@@ -346,8 +363,11 @@ void SessionProcess::ipcNewConnection(ipc::Channel* channel)
             Qt::QueuedConnection);
 
     connect(ipc_channel_, &ipc::Channel::disconnected, ipc_channel_, &ipc::Channel::deleteLater);
-    connect(ipc_channel_, &ipc::Channel::messageReceived, network_channel_, &net::Channel::send);
+    connect(ipc_channel_, &ipc::Channel::messageReceived,
+            this, &SessionProcess::ipcMessageReceived);
     connect(network_channel_, &net::Channel::messageReceived, ipc_channel_, &ipc::Channel::send);
+    connect(network_channel_, &net::Channel::messageWritten,
+            this, &SessionProcess::networkMessageWritten, Qt::UniqueConnection);
 
     LOG(LS_INFO) << "Session process is attached (SID: " << session_id_ << ")";
     state_ = State::ATTACHED;
@@ -358,6 +378,61 @@ void SessionProcess::ipcNewConnection(ipc::Channel* channel)
     ipc_channel_->start();
 }
 
+void SessionProcess::ipcMessageReceived(const QByteArray& buffer)
+{
+    network_channel_->send(buffer);
+
+    bandwidth_estimator_.setPendingBytes(static_cast<size_t>(network_channel_->pendingBytes()),
+                                         base::BandwidthEstimator::Clock::now());
+
+    if (network_channel_->pendingBytes() > kMaxNetworkPendingBytes)
+        ipc_channel_->pause();
+}
+
+void SessionProcess::networkMessageWritten(int size)
+{
+    const base::BandwidthEstimator::Clock::time_point now =
+        base::BandwidthEstimator::Clock::now();
+
+    bandwidth_estimator_.onMessageWritten(
+        static_cast<size_t>(size), static_cast<size_t>(network_channel_->pendingBytes()), now);
+
+    if (!ipc_channel_)
+        return;
+
+    if (now - network_status_time_ >= kNetworkStatusInterval)
+        sendNetworkStatus(now);
+
+    if (ipc_channel_->isPaused() && network_channel_->pendingBytes() <= kMaxNetworkPendingBytes)
+        ipc_channel_->start();
+}
+
+void SessionProcess::sendNetworkStatus(const base::BandwidthEstimator::Clock::time_point& time)
+{
+    // Only the desktop sessions adjust the stream to the speed of the channel.
+    switch (network_channel_->sessionType())
+    {
+        case proto::SESSION_TYPE_DESKTOP_MANAGE:
+        case proto::SESSION_TYPE_DESKTOP_VIEW:
+            break;
+
+        default:
+            return;
+    }
+
+    const int64_t bandwidth = bandwidth_estimator_.bandwidth();
+    if (!bandwidth)
+        return;
+
+    network_status_time_ = time;
+
+    proto::desktop::ClientToHost message;
+    message.mutable_network_status()->set_bandwidth(static_cast<uint32_t>(
+        std::min(bandwidth, static_cast<int64_t>(std::numeric_limits<uint32_t>::max()))));
+
+    ipc_channel_->send(common::serializeMessage(message));
+}
+
 bool SessionProcess::startFakeSession()
 {
     LOG(LS_INFO) << "Starting a fake session";
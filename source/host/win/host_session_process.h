@@ -19,6 +19,7 @@
 #ifndef HOST__WIN__HOST_SESSION_PROCESS_H
 #define HOST__WIN__HOST_SESSION_PROCESS_H
 
+#include "base/bandwidth_estimator.h"
 #include "base/win/session_id.h"
 #include "base/win/session_status.h"
 #include "host/win/host_process.h"
@@ -79,9 +80,12 @@ protected:
 
 private slots:
     void ipcNewConnection(ipc::Channel* channel);
+    void ipcMessageReceived(const QByteArray& buffer);
+    void networkMessageWritten(int size);
 
 private:
     bool startFakeSession();
+    void sendNetworkStatus(const base::BandwidthEstimator::Clock::time_point& time);
 
     std::string uuid_;
 
@@ -95,6 +99,11 @@ private:
     QPointer<HostProcess> session_process_;
     QPointer<SessionFake> fake_session_;
 
+    // The session process sees only its own writes into the IPC channel, which are much faster
+    // than the network. The speed of the network channel is measured here and sent to it.
+    base::BandwidthEstimator bandwidth_estimator_;
+    base::BandwidthEstimator::Clock::time_point network_status_time_;
+
     DISALLOW_COPY_AND_ASSIGN(SessionProcess);
 };
 
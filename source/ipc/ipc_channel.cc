@@ -32,6 +32,9 @@ namespace {
 
 constexpr uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
 
+// While the channel is paused, the socket reads no more than this size from the pipe.
+constexpr int64_t kPausedReadBufferSize = 64 * 1024; // 64kB
+
 #if defined(OS_WIN)
 base::ProcessId clientProcessIdImpl(HANDLE pipe_handle)
 {
@@ -145,14 +148,30 @@ void Channel::stop()
 
 void Channel::start()
 {
+    if (paused_)
+    {
+        paused_ = false;
+        socket_->setReadBufferSize(0);
+    }
+
     onReadyRead();
 }
 
+void Channel::pause()
+{
+    if (paused_)
+        return;
+
+    paused_ = true;
+    socket_->setReadBufferSize(kPausedReadBufferSize);
+}
+
 void Channel::send(const QByteArray& buffer)
 {
     bool schedule_write = write_queue_.empty();
 
     write_queue_.emplace(buffer);
+    pending_bytes_ += sizeof(MessageSizeType) + buffer.size();
 
     if (schedule_write)
         scheduleWrite();
@@ -169,6 +188,7 @@ void Channel::onBytesWritten(int64_t bytes)
     const QByteArray& write_buffer = write_queue_.front();
 
     written_ += bytes;
+    pending_bytes_ -= bytes;
 
     if (written_ < sizeof(MessageSizeType))
     {
@@ -182,11 +202,15 @@ void Channel::onBytesWritten(int64_t bytes)
     }
     else
     {
+        const int message_size = write_buffer.size();
+
         write_queue_.pop();
         written_ = 0;
 
         if (!write_queue_.empty())
             scheduleWrite();
+
+        emit messageWritten(message_size);
     }
 }
 
@@ -194,7 +218,7 @@ void Channel::onReadyRead()
 {
     int64_t current;
 
-    for (;;)
+    while (!paused_)
     {
         if (!read_size_received_)
         {
@@ -55,6 +55,12 @@ public:
 
     void connectToServer(const QString& channel_name);
 
+    // Returns the number of bytes in the sending queue.
+    int64_t pendingBytes() const { return pending_bytes_; }
+
+    // If the channel is paused, it returns true, if not, then false.
+    bool isPaused() const { return paused_; }
+
 #if defined(OS_WIN)
     base::ProcessId clientProcessId() const { return client_process_id_; }
     base::ProcessId serverProcessId() const { return server_process_id_; }
@@ -66,8 +72,13 @@ public slots:
     void stop();
 
     // Starts reading the message.
+    // If the channel is paused, then reading continues.
     void start();
 
+    // Pauses reading the messages. The unread data remains in the pipe, so the sender is blocked
+    // when the pipe is full. To continue reading, you need to call slot |start|.
+    void pause();
+
     // Sends a message.
     void send(const QByteArray& buffer);
 
@@ -77,6 +88,9 @@ signals:
     void errorOccurred();
     void messageReceived(const QByteArray& buffer);
 
+    // Emitted when the message of |size| bytes is written.
+    void messageWritten(int size);
+
 private slots:
     void onError(QLocalSocket::LocalSocketError socket_error);
     void onBytesWritten(int64_t bytes);
@@ -106,7 +120,9 @@ private:
     std::queue<QByteArray, QueueContainer> write_queue_;
     MessageSizeType write_size_ = 0;
     int64_t written_ = 0;
+    int64_t pending_bytes_ = 0;
 
+    bool paused_ = false;
     bool read_size_received_ = false;
     QByteArray read_buffer_;
     MessageSizeType read_size_ = 0;
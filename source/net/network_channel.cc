@@ -143,6 +143,7 @@ void Channel::send(const QByteArray& buffer)
 
     // Add the buffer to the queue for sending.
     write_.queue.emplace(buffer);
+    write_.pending_bytes += buffer.size();
 
     if (schedule_write)
         scheduleWrite();
@@ -308,12 +309,17 @@ void Channel::onMessageWritten()
     {
         DCHECK(!write_.queue.empty());
 
+        const int message_size = write_.queue.front().size();
+
         // Delete the sent message from the queue.
+        write_.pending_bytes -= message_size;
         write_.queue.pop();
 
         // If the queue is not empty, then we send the following message.
         if (!write_.queue.empty())
             scheduleWrite();
+
+        emit messageWritten(message_size);
     }
     else
     {
@@ -78,6 +78,9 @@ public:
     // Returns the version of the connected peer.
     base::Version peerVersion() const { return peer_version_; }
 
+    // Returns the number of bytes of the messages in the sending queue.
+    int64_t pendingBytes() const { return write_.pending_bytes; }
+
 signals:
     // Emits when the connection is aborted.
     void disconnected();
@@ -88,6 +91,9 @@ signals:
     // Emitted when a new message is received.
     void messageReceived(const QByteArray& buffer);
 
+    // Emitted when a message of |size| bytes from the sending queue is written.
+    void messageWritten(int size);
+
 public slots:
     // Starts reading messages from the channel. After receiving each new message, the signal
     // |messageReceived| will be emmited.
@@ -150,6 +156,9 @@ private:
         // The queue contains unencrypted source messages.
         std::queue<QByteArray, QueueContainer> queue;
 
+        // Total size of the messages in the |queue|.
+        int64_t pending_bytes = 0;
+
         // The buffer contains an encrypted message that is being sent to the current moment.
         QByteArray buffer;
 
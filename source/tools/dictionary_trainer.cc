@@ -0,0 +1,255 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Trains a zstd dictionary for the screen content on the recorded sessions (see
+// codec/session_recorder.h).
+//
+// Usage:
+//   aspia_dictionary_trainer [--size=<bytes>] [--format=<argb|rgb565|rgb332|rgb222|rgb111>]
+//                            <output file> <recording file>...
+//
+// The samples are the changed rectangles of the video packets translated to the pixel format of
+// the client, the same data that the ZSTD video encoder compresses. So the dictionary is useful
+// only for the clients with the same pixel format. The dictionary is used if it is copied to the
+// "dictionaries" directory next to the executables of both the host and the client with the
+// ".dict" extension.
+
+#include "codec/pixel_translator.h"
+#include "codec/session_player.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+
+#include <zdict.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The default size of the dictionary (the same as the zstd command line tool uses).
+constexpr size_t kDefaultDictionarySize = 110 * 1024;
+
+// The larger packets are split into several samples.
+constexpr size_t kMaxSampleSize = 128 * 1024;
+
+// The trainer needs about ten times more memory than the samples take.
+constexpr size_t kMaxSamplesSize = 256 * 1024 * 1024;
+
+struct PixelFormatName
+{
+    const char* name;
+    desktop::PixelFormat (*format)();
+};
+
+const PixelFormatName kPixelFormats[] =
+{
+    { "argb",   desktop::PixelFormat::ARGB   },
+    { "rgb565", desktop::PixelFormat::RGB565 },
+    { "rgb332", desktop::PixelFormat::RGB332 },
+    { "rgb222", desktop::PixelFormat::RGB222 },
+    { "rgb111", desktop::PixelFormat::RGB111 }
+};
+
+class SampleCollector
+{
+public:
+    explicit SampleCollector(const desktop::PixelFormat& format)
+        : format_(format),
+          translator_(codec::PixelTranslator::create(desktop::PixelFormat::ARGB(), format))
+    {
+        // Nothing
+    }
+
+    bool isFull() const { return samples_.size() >= kMaxSamplesSize; }
+
+    const std::string& samples() const { return samples_; }
+    const std::vector<size_t>& sampleSizes() const { return sample_sizes_; }
+
+    // Adds the changed rectangles of the last decoded packet as one or several samples.
+    void addPacket(const proto::desktop::VideoPacket& packet, const desktop::Frame& frame)
+    {
+        for (int i = 0; i < packet.dirty_rect_size() && !isFull(); ++i)
+        {
+            const desktop::Rect rect = codec::VideoUtil::fromVideoRect(packet.dirty_rect(i));
+            const int stride = rect.width() * format_.bytesPerPixel();
+
+            for (int y = rect.top(); y < rect.bottom(); ++y)
+            {
+                if (current_size_ + stride > kMaxSampleSize)
+                    endSample();
+
+                const size_t offset = samples_.size();
+                samples_.resize(offset + stride);
+
+                translator_->translate(frame.frameDataAtPos(rect.left(), y), frame.stride(),
+                                       reinterpret_cast<uint8_t*>(samples_.data() + offset),
+                                       stride, rect.width(), 1);
+                current_size_ += stride;
+            }
+        }
+
+        endSample();
+    }
+
+private:
+    void endSample()
+    {
+        if (!current_size_)
+            return;
+
+        sample_sizes_.push_back(current_size_);
+        current_size_ = 0;
+    }
+
+    const desktop::PixelFormat format_;
+    std::unique_ptr<codec::PixelTranslator> translator_;
+
+    std::string samples_;
+    std::vector<size_t> sample_sizes_;
+    size_t current_size_ = 0;
+};
+
+void printUsage()
+{
+    std::cout << "Usage: aspia_dictionary_trainer [--size=<bytes>] "
+                 "[--format=<argb|rgb565|rgb332|rgb222|rgb111>] "
+                 "<output file> <recording file>..." << std::endl;
+}
+
+bool readRecording(const std::filesystem::path& file_path, SampleCollector* collector)
+{
+    std::unique_ptr<codec::SessionPlayer> player = codec::SessionPlayer::open(file_path);
+    if (!player)
+    {
+        std::cerr << "Unable to open recording: " << file_path << std::endl;
+        return false;
+    }
+
+    while (!collector->isFull() && player->readNextMessage())
+    {
+        const proto::desktop::HostToClient& message = player->message();
+
+        if (message.has_video_packet() &&
+            message.video_packet().encoding() == proto::desktop::VIDEO_ENCODING_ZSTD &&
+            player->frame())
+        {
+            collector->addPacket(message.video_packet(), *player->frame());
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t dictionary_size = kDefaultDictionarySize;
+    desktop::PixelFormat format = desktop::PixelFormat::RGB565();
+    std::vector<std::filesystem::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+
+        if (arg.rfind("--size=", 0) == 0)
+        {
+            dictionary_size = std::strtoul(arg.c_str() + strlen("--size="), nullptr, 10);
+            if (!dictionary_size)
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (arg.rfind("--format=", 0) == 0)
+        {
+            const std::string name = arg.substr(strlen("--format="));
+            bool found = false;
+
+            for (const auto& pixel_format : kPixelFormats)
+            {
+                if (name == pixel_format.name)
+                {
+                    format = pixel_format.format();
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            files.emplace_back(arg);
+        }
+    }
+
+    if (files.size() < 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    SampleCollector collector(format);
+
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        if (!readRecording(files[i], &collector))
+            return 1;
+    }
+
+    const std::vector<size_t>& sample_sizes = collector.sampleSizes();
+
+    std::cout << "Training on " << sample_sizes.size() << " samples ("
+              << collector.samples().size() << " bytes)" << std::endl;
+
+    std::string dictionary(dictionary_size, 0);
+
+    const size_t result = ZDICT_trainFromBuffer(dictionary.data(),
+                                                dictionary.size(),
+                                                collector.samples().data(),
+                                                sample_sizes.data(),
+                                                static_cast<unsigned>(sample_sizes.size()));
+    if (ZDICT_isError(result))
+    {
+        std::cerr << "Training failed: " << ZDICT_getErrorName(result) << std::endl;
+        return 1;
+    }
+
+    dictionary.resize(result);
+
+    std::ofstream file_stream(files.front(), std::ofstream::binary | std::ofstream::trunc);
+    if (!file_stream.write(dictionary.data(), dictionary.size()))
+    {
+        std::cerr << "Unable to write dictionary: " << files.front() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Dictionary " << ZDICT_getDictID(dictionary.data(), dictionary.size())
+              << " (" << dictionary.size() << " bytes) written to " << files.front() << std::endl;
+    return 0;
+}